@@ -11,6 +11,7 @@ from .views import (
     LabAnalyticsView,
     OperationalMetricsView,
     PatientAnalyticsView,
+    PatientExtractView,
     RevenueAnalyticsView,
 )
 
@@ -18,6 +19,7 @@ urlpatterns = [
     path("dashboard/", DashboardStatsView.as_view(), name="dashboard-stats"),
     path("revenue/", RevenueAnalyticsView.as_view(), name="revenue-analytics"),
     path("patients/", PatientAnalyticsView.as_view(), name="patient-analytics"),
+    path("patients/extract/", PatientExtractView.as_view(), name="patient-extract"),
     path("lab/", LabAnalyticsView.as_view(), name="lab-analytics"),
     path("operational/", OperationalMetricsView.as_view(), name="operational-metrics"),
 ]
@@ -4,6 +4,7 @@ Analytics views for dashboard and reporting.
 Copyright (c) 2025, Immanuel Njogu. All rights reserved.
 """
 
+from collections import Counter
 from datetime import timedelta
 from decimal import Decimal
 
@@ -17,9 +18,11 @@ from rest_framework.response import Response
 from rest_framework.views import APIView
 
 from apps.billing.models import Invoice, InvoiceStatus, Payment, PaymentStatus
-from apps.lab_orders.models import LabOrder
+from apps.core.utils import obx_columns, pseudonym_key, pseudonymize_many
+from apps.lab_orders.models import LabOrder, LabResult
 from apps.patients.models import Patient
 from apps.users.models import User, UserRole
+from apps.users.permissions import IsAdmin
 
 
 class DashboardStatsView(APIView):
@@ -338,6 +341,14 @@ class LabAnalyticsView(APIView):
 
         avg_turnaround_hours = total_turnaround.total_seconds() / 3600 / completed_count if completed_count > 0 else 0
 
+        # Observations from the stored OBX segments, extracted in bulk as columns
+        obx_texts = LabResult.objects.filter(resulted_at__date__gte=start_date).exclude(hl7_obx_segments="")
+        columns = obx_columns(list(obx_texts.values_list("hl7_obx_segments", flat=True)))
+        # OBX-8 empty or "N" means normal; anything else (H, L, HH, LL, A, ...) is flagged
+        abnormal_by_code = Counter(
+            code for code, flag in zip(columns.column("code"), columns.column("flags")) if flag not in ("", "N")
+        )
+
         return Response(
             {
                 "period_days": days,
@@ -353,6 +364,14 @@ class LabAnalyticsView(APIView):
                     for item in top_tests
                 ],
                 "avg_turnaround_hours": round(avg_turnaround_hours, 2),
+                "observations": {
+                    "total": len(columns),
+                    "numeric": len(columns) - columns.value_null_count,
+                    "abnormal": sum(abnormal_by_code.values()),
+                    "top_abnormal_codes": [
+                        {"code": code, "count": count} for code, count in abnormal_by_code.most_common(10)
+                    ],
+                },
             }
         )
 
@@ -429,3 +448,78 @@ class OperationalMetricsView(APIView):
                 "generated_at": timezone.now().isoformat(),
             }
         )
+
+
+class PatientExtractView(APIView):
+    """
+    Export a de-identified patient extract for offline analytics.
+
+    Direct identifiers are replaced with keyed tokens that stay stable
+    across exports, so extracts can be joined without exposing MRN, SSN or
+    phone. Quasi-identifiers are generalized (birth year, registration month).
+
+    GET /api/v1/analytics/patients/extract/?limit=1000&offset=0
+    """
+
+    permission_classes = [IsAdmin]
+
+    MAX_LIMIT = 50000
+    EXTRACT_FIELDS = (
+        "mrn",
+        "ssn_hash",
+        "phone",
+        "date_of_birth",
+        "gender",
+        "blood_type",
+        "state",
+        "country",
+        "is_active",
+        "created_at",
+    )
+
+    def get(self, request):
+        """Return one page of de-identified patient rows."""
+        try:
+            limit = min(int(request.query_params.get("limit", 1000)), self.MAX_LIMIT)
+            offset = int(request.query_params.get("offset", 0))
+        except ValueError:
+            return Response({"error": "limit and offset must be integers"}, status=status.HTTP_400_BAD_REQUEST)
+        if limit < 0 or offset < 0:
+            return Response({"error": "limit and offset must not be negative"}, status=status.HTTP_400_BAD_REQUEST)
+
+        rows = list(
+            Patient.objects.order_by("created_at", "id").values(*self.EXTRACT_FIELDS)[offset : offset + limit]
+        )
+
+        tokens = {}
+        for field in ("mrn", "ssn_hash", "phone"):
+            present = [row[field] for row in rows if row[field]]
+            key = pseudonym_key(field)
+            tokens[field] = iter(pseudonymize_many(present, key))
+
+        def token(row, field):
+            return next(tokens[field]) if row[field] else None
+
+        return Response(
+            {
+                "offset": offset,
+                "count": len(rows),
+                "total": Patient.objects.count(),
+                "results": [
+                    {
+                        "patient_token": token(row, "mrn"),
+                        "ssn_token": token(row, "ssn_hash"),
+                        "phone_token": token(row, "phone"),
+                        "birth_year": row["date_of_birth"].year,
+                        "gender": row["gender"],
+                        "blood_type": row["blood_type"],
+                        "state": row["state"],
+                        "country": row["country"],
+                        "is_active": row["is_active"],
+                        "registered_month": row["created_at"].strftime("%Y-%m"),
+                    }
+                    for row in rows
+                ],
+                "generated_at": timezone.now().isoformat(),
+            }
+        )
@@ -205,9 +205,16 @@ class Invoice(models.Model):
 
     def _calculate_totals(self):
         """Calculate invoice totals from line items."""
-        self.subtotal = sum(item.total_price for item in self.items.all())
-        self.total_amount = self.subtotal + self.tax_amount - self.discount_amount
-        self.balance_due = self.total_amount - self.amount_paid
+        from apps.core.utils import invoice_totals
+
+        items = [(0, quantity, unit_price) for quantity, unit_price in self.items.values_list("quantity", "unit_price")]
+        self.apply_totals(invoice_totals([(self.tax_amount, self.discount_amount, self.amount_paid)], items)[0])
+
+    def apply_totals(self, totals):
+        """Set subtotal, total and balance from an InvoiceTotals, and the status they imply."""
+        self.subtotal = totals.subtotal
+        self.total_amount = totals.total
+        self.balance_due = totals.balance
 
         # Update status based on payment
         if self.balance_due <= 0:
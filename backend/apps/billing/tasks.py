@@ -42,6 +42,73 @@ def check_overdue_invoices():
     return {"updated": updated_count}
 
 
+@shared_task(name="apps.billing.tasks.recalculate_open_invoices")
+def recalculate_open_invoices(batch_size: int = 5000):
+    """
+    Recompute the totals of every open invoice from its line items.
+
+    Runs monthly via Celery Beat, before statements go out. Each batch of
+    invoices costs one query for the invoices, one for all of their items
+    and a single invoice_totals call; only invoices whose amounts or status
+    changed are written back, in one bulk update. The batch's rows are
+    locked so a payment recorded meanwhile is not overwritten.
+
+    Args:
+        batch_size: Invoices per batch
+    """
+    from django.db import transaction
+
+    from apps.billing.models import Invoice, InvoiceItem, InvoiceStatus
+    from apps.core.utils import invoice_totals
+
+    open_statuses = [
+        InvoiceStatus.DRAFT,
+        InvoiceStatus.PENDING,
+        InvoiceStatus.PARTIALLY_PAID,
+        InvoiceStatus.OVERDUE,
+    ]
+    fields = ["subtotal", "total_amount", "balance_due", "status", "updated_at"]
+
+    checked = updated = 0
+    last_pk = None
+    while True:
+        with transaction.atomic():
+            invoices = Invoice.objects.select_for_update().filter(status__in=open_statuses).order_by("pk")
+            if last_pk is not None:
+                invoices = invoices.filter(pk__gt=last_pk)
+            batch = list(invoices[:batch_size])
+            if not batch:
+                break
+            last_pk = batch[-1].pk
+
+            index = {invoice.pk: i for i, invoice in enumerate(batch)}
+            items = [
+                (index[invoice_id], quantity, unit_price)
+                for invoice_id, quantity, unit_price in InvoiceItem.objects.filter(invoice_id__in=index).values_list(
+                    "invoice_id", "quantity", "unit_price"
+                )
+            ]
+            totals = invoice_totals(
+                [(invoice.tax_amount, invoice.discount_amount, invoice.amount_paid) for invoice in batch], items
+            )
+
+            now = timezone.now()
+            changed = []
+            for invoice, result in zip(batch, totals):
+                before = (invoice.subtotal, invoice.total_amount, invoice.balance_due, invoice.status)
+                invoice.apply_totals(result)
+                if (invoice.subtotal, invoice.total_amount, invoice.balance_due, invoice.status) != before:
+                    invoice.updated_at = now
+                    changed.append(invoice)
+            Invoice.objects.bulk_update(changed, fields)
+
+        checked += len(batch)
+        updated += len(changed)
+
+    logger.info(f"Recalculated open invoices: {checked} checked, {updated} updated")
+    return {"checked": checked, "updated": updated}
+
+
 @shared_task(name="apps.billing.tasks.send_payment_reminder")
 def send_payment_reminder(invoice_id: str):
     """
@@ -5,12 +5,22 @@ Provides Python wrappers around C extensions with fallback to pure Python
 when C modules are not available or disabled.
 """
 
+import array
+import functools
 import hashlib
+import hmac
+import ipaddress
 import logging
+import os
+import re
 import secrets
-from typing import Optional
+import struct
+import threading
+from decimal import ROUND_HALF_UP, Decimal, localcontext
+from typing import Any, Iterable, Iterator, NamedTuple, Optional
 
 from django.conf import settings
+from django.core.exceptions import ImproperlyConfigured
 
 logger = logging.getLogger(__name__)
 
@@ -48,6 +58,30 @@ def generate_pii_token() -> str:
     return secrets.token_hex(32)
 
 
+def generate_pii_tokens(n: int, size: int = 32) -> list[str]:
+    """
+    Generate many secure random tokens in one call.
+
+    The native path fills all tokens from one pooled CSPRNG draw and hex
+    encodes them in place, for bulk pseudonymization of exports.
+
+    Args:
+        n: Number of tokens
+        size: Random bytes per token
+
+    Returns:
+        List of hex-encoded tokens
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.generate_tokens(n, size)
+        except Exception as e:
+            logger.warning(f"C bulk token generation failed, using Python: {e}")
+
+    # Python fallback
+    return [secrets.token_hex(size) for _ in range(n)]
+
+
 def sha256_hash(data: bytes) -> str:
     """
     Compute SHA-256 hash of data.
@@ -69,6 +103,149 @@ def sha256_hash(data: bytes) -> str:
     return hashlib.sha256(data).hexdigest()
 
 
+def sha256_hex_many(values: list[str | bytes], salt: str | bytes | None = None) -> list[str]:
+    """
+    Compute hex SHA-256 of salt + value for many short values at once.
+
+    Strings are hashed as UTF-8. The native path absorbs the salt once and
+    hashes the whole list in a single call, which matters for imports and
+    duplicate detection over hundreds of thousands of SSNs.
+
+    Args:
+        values: Strings or bytes to hash
+        salt: Optional prefix mixed into every hash
+
+    Returns:
+        List of hex-encoded hashes, in input order
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.sha256_hex_many(values, salt)
+        except Exception as e:
+            logger.warning(f"C batch SHA-256 failed, using Python: {e}")
+
+    # Python fallback
+    prefix = hashlib.sha256(salt.encode() if isinstance(salt, str) else (salt or b""))
+    result = []
+    for value in values:
+        h = prefix.copy()
+        h.update(value.encode() if isinstance(value, str) else value)
+        result.append(h.hexdigest())
+    return result
+
+
+def pseudonym_key(field: str) -> bytes:
+    """
+    Derive the pseudonymization key for one identifier type.
+
+    Each field (e.g. "mrn", "ssn", "phone") gets its own key, so tokens for
+    different identifier types can never be correlated with each other.
+
+    Args:
+        field: Identifier type name
+
+    Returns:
+        32-byte HMAC key
+    """
+    secret = settings.HOSPITAL_SETTINGS.get("PSEUDONYMIZATION_KEY") or settings.HOSPITAL_SETTINGS.get(
+        "PII_ENCRYPTION_KEY"
+    )
+    if not secret:
+        raise ValueError("PSEUDONYMIZATION_KEY not configured")
+    if isinstance(secret, str):
+        secret = secret.encode("utf-8")
+    return hmac.new(secret, b"pseudonym:" + field.encode("utf-8"), hashlib.sha256).digest()
+
+
+@functools.lru_cache(maxsize=16)
+def _native_pseudonymizer(key: bytes):
+    """Return a native Pseudonymizer handle with the HMAC pads precomputed for key."""
+    return hospital_native.Pseudonymizer(key)
+
+
+def pseudonymize_many(values: list[str | bytes], key: bytes, threads: int = 0) -> list[str]:
+    """
+    Map identifiers to stable keyed tokens (hex HMAC-SHA256).
+
+    The same value and key always give the same token, so de-identified
+    extracts can be joined across exports without exposing the identifier.
+    Strings are hashed as UTF-8.
+
+    Args:
+        values: Identifiers to pseudonymize
+        key: HMAC key (see pseudonym_key)
+        threads: Native worker threads (0 = all CPUs)
+
+    Returns:
+        List of hex-encoded tokens, in input order
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return _native_pseudonymizer(bytes(key)).pseudonymize_many(values, threads=threads)
+        except Exception as e:
+            logger.warning(f"C pseudonymization failed, using Python: {e}")
+
+    # Python fallback
+    base = hmac.new(key, digestmod=hashlib.sha256)
+    result = []
+    for value in values:
+        h = base.copy()
+        h.update(value.encode() if isinstance(value, str) else value)
+        result.append(h.hexdigest())
+    return result
+
+
+def sha256_hasher(data: bytes = b""):
+    """
+    Create an incremental SHA-256 hasher.
+
+    Both the native Sha256 object and the hashlib fallback expose
+    update()/digest()/hexdigest()/copy(), so large payloads (lab
+    attachments, audit log segments) can be hashed chunk by chunk without
+    being buffered in memory.
+
+    Args:
+        data: Optional initial data
+
+    Returns:
+        A hashlib-compatible hasher
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.Sha256(data)
+        except Exception as e:
+            logger.warning(f"C SHA-256 hasher failed, using Python: {e}")
+
+    return hashlib.sha256(data)
+
+
+def sha256_stream(chunks: Iterable[bytes]) -> str:
+    """
+    Compute the hex SHA-256 of data arriving in chunks.
+
+    Args:
+        chunks: Iterable of bytes-like objects (e.g. UploadedFile.chunks())
+
+    Returns:
+        Hex-encoded hash
+    """
+    hasher = sha256_hasher()
+    for chunk in chunks:
+        hasher.update(chunk)
+    return hasher.hexdigest()
+
+
+@functools.lru_cache(maxsize=8)
+def _native_aes_key(key: bytes):
+    """
+    Return a native AesKey handle for key.
+
+    The PII key rarely changes, so caching the handle means the AES key
+    schedule is expanded once per process instead of on every call.
+    """
+    return hospital_native.AesKey(key)
+
+
 def aes_gcm_encrypt(plaintext: bytes, key: bytes) -> bytes:
     """
     Encrypt data using AES-256-GCM.
@@ -82,7 +259,7 @@ def aes_gcm_encrypt(plaintext: bytes, key: bytes) -> bytes:
     """
     if C_MODULES_AVAILABLE:
         try:
-            return hospital_native.aes_gcm_encrypt(plaintext, key)
+            return _native_aes_key(bytes(key)).encrypt(plaintext)
         except Exception as e:
             logger.error(f"C encryption failed: {e}")
             raise
@@ -109,7 +286,7 @@ def aes_gcm_decrypt(ciphertext: bytes, key: bytes) -> bytes:
     """
     if C_MODULES_AVAILABLE:
         try:
-            return hospital_native.aes_gcm_decrypt(ciphertext, key)
+            return _native_aes_key(bytes(key)).decrypt(ciphertext)
         except Exception as e:
             logger.error(f"C decryption failed: {e}")
             raise
@@ -123,15 +300,134 @@ def aes_gcm_decrypt(ciphertext: bytes, key: bytes) -> bytes:
     return aesgcm.decrypt(nonce, ct, None)
 
 
+def aes_gcm_encrypt_many(plaintexts: list[bytes], key: bytes) -> list[bytes]:
+    """
+    Encrypt many values with AES-256-GCM in one call.
+
+    Args:
+        plaintexts: Values to encrypt
+        key: 32-byte encryption key
+
+    Returns:
+        Encrypted values (IV + ciphertext + tag), in input order
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            results = _native_aes_key(bytes(key)).encrypt_many(plaintexts)
+        except Exception as e:
+            logger.error(f"C batch encryption failed: {e}")
+            raise
+        if any(r is None for r in results):
+            raise RuntimeError("C batch encryption failed for one or more records")
+        return results
+
+    return [aes_gcm_encrypt(p, key) for p in plaintexts]
+
+
+def aes_gcm_decrypt_many(ciphertexts: list[bytes], key: bytes) -> list[Optional[bytes]]:
+    """
+    Decrypt many values with AES-256-GCM in one call.
+
+    Records that fail authentication are returned as None rather than
+    aborting the whole batch.
+
+    Args:
+        ciphertexts: Encrypted values (IV + ciphertext + tag)
+        key: 32-byte decryption key
+
+    Returns:
+        Decrypted values (or None per failed record), in input order
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return _native_aes_key(bytes(key)).decrypt_many(ciphertexts)
+        except Exception as e:
+            logger.error(f"C batch decryption failed: {e}")
+            raise
+
+    from cryptography.exceptions import InvalidTag
+
+    results: list[Optional[bytes]] = []
+    for ct in ciphertexts:
+        try:
+            results.append(aes_gcm_decrypt(ct, key))
+        except (InvalidTag, ValueError):
+            results.append(None)
+    return results
+
+
+def reencrypt_many(ciphertexts: list[bytes], old_key: bytes, new_key: bytes, threads: int = 0) -> list[Optional[bytes]]:
+    """
+    Re-encrypt values from old_key to new_key (key rotation).
+
+    The native path splits the batch across a worker pool without holding
+    the GIL. Records that do not decrypt under old_key come back as None.
+
+    Args:
+        ciphertexts: Values encrypted under old_key
+        old_key: Current 32-byte key
+        new_key: Replacement 32-byte key
+        threads: Native worker threads (0 = all CPUs)
+
+    Returns:
+        Values encrypted under new_key (or None per failed record)
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.reencrypt_batch(ciphertexts, bytes(old_key), bytes(new_key), threads=threads)
+        except Exception as e:
+            logger.error(f"C re-encryption failed: {e}")
+            raise
+
+    plaintexts = aes_gcm_decrypt_many(ciphertexts, old_key)
+    return [aes_gcm_encrypt(p, new_key) if p is not None else None for p in plaintexts]
+
+
+def reencrypt_stream(
+    records: Iterable[tuple[Any, bytes]],
+    old_key: bytes,
+    new_key: bytes,
+    batch_size: int = 5000,
+    threads: int = 0,
+) -> Iterator[list[tuple[Any, Optional[bytes]]]]:
+    """
+    Re-encrypt a stream of (id, ciphertext) pairs in fixed-size batches.
+
+    Suitable for management commands that iterate a large table: only one
+    batch is held in memory at a time.
+
+    Yields:
+        Lists of (id, new_ciphertext or None) for each batch
+    """
+    batch: list[tuple[Any, bytes]] = []
+    for record in records:
+        batch.append(record)
+        if len(batch) >= batch_size:
+            yield _reencrypt_batch(batch, old_key, new_key, threads)
+            batch = []
+    if batch:
+        yield _reencrypt_batch(batch, old_key, new_key, threads)
+
+
+def _reencrypt_batch(batch, old_key, new_key, threads):
+    rotated = reencrypt_many([bytes(ct) for _, ct in batch], old_key, new_key, threads=threads)
+    return [(record_id, new_ct) for (record_id, _), new_ct in zip(batch, rotated)]
+
+
 # HL7 validation
 
 
-def validate_hl7_segment(segment: str) -> bool:
+HL7_DEFAULT_DELIMITERS = "|^~\\&"
+
+
+def validate_hl7_segment(segment: str, delimiters: Optional[str] = None) -> bool:
     """
     Validate HL7 v2 segment structure.
 
     Args:
         segment: HL7 segment string
+        delimiters: MSH-1 followed by MSH-2 of the enclosing message
+            (default "|^~\\&"); MSH segments always use their own
 
     Returns:
         True if valid
@@ -141,21 +437,1153 @@ def validate_hl7_segment(segment: str) -> bool:
     """
     if C_MODULES_AVAILABLE:
         try:
-            hospital_native.validate_hl7_segment(segment)
+            hospital_native.validate_hl7_segment(segment, delimiters)
             return True
+        except ValueError:
+            raise
         except Exception as e:
             logger.warning(f"C HL7 validation failed, using Python: {e}")
 
-    # Python fallback - basic validation
-    if not segment or len(segment) < 4:
-        raise ValueError("Segment too short")
+    return _validate_hl7_segment_py(segment, _hl7_delimiters(segment, delimiters))
+
+
+def _hl7_field_separator(segment: str, delimiters: Optional[str]) -> str:
+    if segment.startswith("MSH") and len(segment) > 3:
+        return segment[3]
+    return (delimiters or HL7_DEFAULT_DELIMITERS)[0]
+
+
+def _hl7_delimiters(segment: str, delimiters: Optional[str]) -> str:
+    """MSH-1 and MSH-2 in effect for a segment; an MSH segment always uses its own."""
+    if segment.startswith("MSH") and len(segment) > 3:
+        return segment[3] + segment[4:].split(segment[3], 1)[0][:4]
+    return delimiters or HL7_DEFAULT_DELIMITERS
+
+
+# Segment schemas of the native validator (native/src/hl7val_schema.c): per
+# segment ID, the fewest fields (the ID is field 0), the field naming the type
+# of the VARIES field, and (datatype, required, max length per repetition) by
+# field number. Segments without a schema only get the structural checks.
+_HL7_SCHEMAS = {
+    "EVN": (1, 0, {2: ("TS", False, 26), 3: ("TS", False, 26), 6: ("TS", False, 26)}),
+    "MSH": (
+        12,
+        0,
+        {
+            2: ("ST", True, 5),
+            3: ("ANY", False, 227),
+            4: ("ANY", False, 227),
+            5: ("ANY", False, 227),
+            6: ("ANY", False, 227),
+            7: ("TS", True, 26),
+            9: ("ANY", True, 15),
+            10: ("ST", True, 20),
+            11: ("ANY", True, 3),
+            12: ("ANY", True, 60),
+            13: ("NM", False, 15),
+        },
+    ),
+    "NTE": (1, 0, {1: ("SI", False, 4), 2: ("ST", False, 8)}),
+    "OBR": (
+        4,
+        0,
+        {
+            1: ("SI", False, 4),
+            4: ("CE", True, 250),
+            6: ("TS", False, 26),
+            7: ("TS", False, 26),
+            8: ("TS", False, 26),
+            14: ("TS", False, 26),
+            22: ("TS", False, 26),
+            25: ("ST", False, 1),
+        },
+    ),
+    "OBX": (
+        5,
+        2,
+        {
+            1: ("SI", False, 4),
+            2: ("ST", False, 3),
+            3: ("CE", True, 250),
+            4: ("ST", False, 20),
+            5: ("VARIES", False, 0),
+            6: ("CE", False, 250),
+            7: ("ST", False, 60),
+            8: ("ST", False, 5),
+            11: ("ST", False, 1),
+            14: ("TS", False, 26),
+            19: ("TS", False, 26),
+        },
+    ),
+    "ORC": (1, 0, {1: ("ST", True, 2), 9: ("TS", False, 26)}),
+    "PID": (
+        5,
+        0,
+        {
+            1: ("SI", False, 4),
+            3: ("ANY", True, 250),
+            5: ("ANY", True, 250),
+            7: ("TS", False, 26),
+            8: ("ST", False, 1),
+            29: ("TS", False, 26),
+        },
+    ),
+    "PV1": (1, 0, {1: ("SI", False, 4), 2: ("ST", True, 1), 44: ("TS", False, 26), 45: ("TS", False, 26)}),
+}
+
+# OBX-2 codes and the datatype OBX-5 is checked as. NM results are checked
+# as SN (reported as NM), since labs routinely send values such as "<5".
+_HL7_VARIES_TYPES = {
+    "NM": "OBS_NM",
+    "SN": "SN",
+    "SI": "SI",
+    "DT": "DT",
+    "TS": "TS",
+    "DTM": "TS",
+    "ST": "ST",
+    "TX": "ST",
+    "FT": "ST",
+    "CE": "CE",
+}
+
+_HL7_MAX_FIELDS = 256
+_HL7_CONTROL = re.compile(r"[\x00-\x1f\x7f]")
+_HL7_NM = re.compile(r"[+-]?(?:[0-9]+\.?[0-9]*|\.[0-9]+)")
+_HL7_COMPARATOR = re.compile(r"<=|>=|<>|<|>|=")
+_HL7_INLINE_SN = re.compile(rf"(?:{_HL7_COMPARATOR.pattern})?{_HL7_NM.pattern}")
+_HL7_DAYS_IN_MONTH = (31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31)
+
+
+def _hl7_date_ok(value: str) -> bool:
+    """YYYY[MM[DD]], with the day checked against the month."""
+    if len(value) not in (4, 6, 8) or not (value.isascii() and value.isdigit()):
+        return False
+    if len(value) == 4:
+        return True
+    year, month = int(value[:4]), int(value[4:6])
+    if not 1 <= month <= 12:
+        return False
+    if len(value) == 6:
+        return True
+    leap = (year % 4 == 0 and year % 100 != 0) or year % 400 == 0
+    max_day = 28 if month == 2 and not leap else _HL7_DAYS_IN_MONTH[month - 1]
+    return 1 <= int(value[6:8]) <= max_day
+
+
+def _hl7_ts_ok(value: str) -> bool:
+    """YYYY[MM[DD[HH[MM[SS[.S[S[S[S]]]]]]]]][+/-ZZZZ], parsed left to right."""
+    if len(value) < 4:
+        return False
+    i = 4
+    while i < len(value) and value[i] in "0123456789":
+        i += 1
+    digits = i
+    if digits > 14 or digits % 2 or not _hl7_date_ok(value[: min(digits, 8)]):
+        return False
+    for at, limit in zip(range(8, digits, 2), (23, 59, 59)):
+        if int(value[at : at + 2]) > limit:
+            return False
+
+    # Fractional seconds: 1-4 digits after a full HHMMSS
+    if i < len(value) and value[i] == ".":
+        i += 1
+        frac = i
+        while i < len(value) and value[i] in "0123456789":
+            i += 1
+        if digits != 14 or not 1 <= i - frac <= 4:
+            return False
+
+    # Time zone offset
+    if i < len(value) and value[i] in "+-":
+        zone = value[i + 1 :]
+        return len(zone) == 4 and zone.isascii() and zone.isdigit() and int(zone[:2]) <= 14 and int(zone[2:]) <= 59
+    return i == len(value)
 
-    if segment[3] != "|":
-        raise ValueError("Invalid field delimiter")
 
-    # Check segment ID (3 chars)
+def _hl7_sn_ok(components: list[str]) -> bool:
+    """Structured numeric: "<5" in one component, or comparator^num1^separator/suffix^num2."""
+    if len(components) == 1:
+        return _HL7_INLINE_SN.fullmatch(components[0]) is not None
+    if len(components) > 4:
+        return False
+    comparator, num1, separator, num2 = components + [""] * (4 - len(components))
+    return (
+        (not comparator or _HL7_COMPARATOR.fullmatch(comparator) is not None)
+        and _HL7_NM.fullmatch(num1) is not None
+        and (not separator or separator in ("-", "+", "/", ".", ":"))
+        and (not num2 or _HL7_NM.fullmatch(num2) is not None)
+    )
+
+
+def _hl7_value_ok(datatype: str, value: str, component_separator: str) -> bool:
+    """Check one repetition of a field; the HL7 null value "" is accepted for every type."""
+    if value == '""':
+        return True
+    components = value.split(component_separator) if component_separator else [value]
+    if datatype == "ST":
+        return _HL7_CONTROL.search(value) is None
+    if datatype == "NM":
+        return not value or (len(components) == 1 and _HL7_NM.fullmatch(value) is not None)
+    if datatype == "SI":
+        return not value or (len(components) == 1 and value.isascii() and value.isdigit())
+    if datatype == "DT":
+        return not value or (len(components) == 1 and _hl7_date_ok(value))
+    if datatype == "TS":
+        # The second component (degree of precision) is not checked
+        return not components[0] or _hl7_ts_ok(components[0])
+    if datatype == "CE":
+        return len(components) <= 6
+    if datatype in ("SN", "OBS_NM"):
+        return not value or _hl7_sn_ok(components)
+    return True
+
+
+def _check_hl7_schema(segment: str, delimiters: str) -> None:
+    """Field count and per-field rules, in the native validator's order of precedence."""
     seg_id = segment[:3]
-    if not seg_id.isupper():
-        raise ValueError("Invalid segment ID")
+    schema = _HL7_SCHEMAS.get(seg_id)
+    values = segment.split(delimiters[0])
+
+    # MSH-1 is the separator itself, so MSH fields are numbered from 2
+    is_msh = seg_id == "MSH"
+    first = 2 if is_msh else 1
+    highest = len(values) - 2 + first
+    min_fields = schema[0] if schema else 1
+    if highest + 1 < min_fields:
+        raise ValueError(f"Segment {seg_id} has {highest + 1} fields, requires at least {min_fields}")
+    if highest + 1 > _HL7_MAX_FIELDS:
+        raise ValueError(f"Segment has {highest + 1} fields, exceeds maximum {_HL7_MAX_FIELDS}")
+    if schema is None:
+        return
+
+    _, type_field, rules = schema
+    component = delimiters[1] if len(delimiters) > 1 else ""
+    repetition = delimiters[2] if len(delimiters) > 2 else ""
+    varies = "ANY"
+    for num, value in enumerate(values[1:], start=first):
+        if num == type_field:
+            varies = _HL7_VARIES_TYPES.get(value, "ANY")
+        rule = rules.get(num)
+        if rule is None:
+            continue
+        datatype, required, max_len = rule
+        if datatype == "VARIES":
+            datatype = varies
+        if required and not value:
+            raise ValueError(f"Field {seg_id}-{num} is required")
+        # MSH-2 holds the encoding characters themselves
+        literal = is_msh and num == 2
+        for rep in [value] if literal or not repetition else value.split(repetition):
+            if max_len and len(rep.encode("utf-8")) > max_len:
+                raise ValueError(f"Field {seg_id}-{num} exceeds maximum length {max_len}")
+            if not _hl7_value_ok(datatype, rep, "" if literal else component):
+                name = "NM" if datatype == "OBS_NM" else datatype
+                raise ValueError(f"Field {seg_id}-{num} is not a valid {name} value")
+
+    # Required fields past the end of the segment
+    for num in sorted(rules):
+        if num > highest and rules[num][1]:
+            raise ValueError(f"Field {seg_id}-{num} is required")
+
+
+def _check_hl7_header(segment: str, delimiters: str) -> None:
+    """Length, segment ID and field delimiter checks; a segment passing them can be split into fields."""
+    if not segment or len(segment) < 5:
+        raise ValueError("Segment too short (minimum 5 characters)")
+
+    # Segment ID: 3 uppercase letters or digits
+    for i, c in enumerate(segment[:3]):
+        if not ("A" <= c <= "Z" or "0" <= c <= "9"):
+            raise ValueError(f"Invalid segment ID at position {i}")
+
+    if segment[3] != delimiters[0]:
+        raise ValueError(f"Invalid field delimiter (expected '{delimiters[0]}', got '{segment[3]}')")
+
 
+def _validate_hl7_segment_py(segment: str, delimiters: str = HL7_DEFAULT_DELIMITERS) -> bool:
+    """Pure Python check used when the C module is unavailable, with the native segment schemas."""
+    _check_hl7_header(segment, delimiters)
+    _check_hl7_schema(segment, delimiters)
     return True
+
+
+def extract_hl7_fields(segment: str, fields, delimiters: Optional[str] = None) -> list:
+    """
+    Extract several fields of one HL7 segment in a single pass.
+
+    Fields are numbered as in extract_field: 1 is the first field after
+    the segment ID (so PID-3 is 3). There is no length limit on values.
+
+    Args:
+        segment: HL7 segment string
+        fields: Field numbers, in any order
+        delimiters: MSH-1 followed by MSH-2 (default "|^~\\&")
+
+    Returns:
+        One value per requested field; None where the segment has no such field
+
+    Raises:
+        ValueError: If the segment or a field number is invalid
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.extract_hl7_fields(segment, fields, delimiters)
+        except ValueError:
+            raise
+        except Exception as e:
+            logger.warning(f"C HL7 field extraction failed, using Python: {e}")
+
+    if len(segment) < 4:
+        raise ValueError("Segment too short")
+    values = segment[4:].split(_hl7_field_separator(segment, delimiters))
+    result = []
+    for num in fields:
+        if num < 1:
+            raise ValueError("Invalid field number")
+        result.append(values[num - 1] if num <= len(values) else None)
+    return result
+
+
+class HL7SegmentResult(NamedTuple):
+    """Per-segment result of parse_hl7_message (same fields as the native SegmentResult)."""
+
+    line: int
+    segment_id: str
+    offset: int
+    length: int
+    field_count: int
+    error: Optional[str]
+
+
+_HL7_LINE_BREAK = re.compile(r"\r\n|\r|\n")
+
+
+def parse_hl7_message(message: str, delimiters: Optional[str] = None) -> list:
+    """
+    Validate every segment of an HL7 v2 message in one call.
+
+    Segments may be separated by \\r, \\n or \\r\\n. Blank lines are skipped
+    but still counted, so line numbers match the input text. Each MSH
+    segment sets the delimiters for the segments after it.
+
+    Args:
+        message: HL7 message text (e.g. MSH/OBR/OBX lines)
+        delimiters: Delimiters to assume before the first MSH (default "|^~\\&")
+
+    Returns:
+        One result per segment with line, segment_id, offset, length,
+        field_count and error (None when the segment is valid)
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.parse_hl7_message(message, delimiters)
+        except Exception as e:
+            logger.warning(f"C HL7 message parsing failed, using Python: {e}")
+
+    # Python fallback
+    results = []
+    offset = 0
+    for line_no, line in enumerate(_HL7_LINE_BREAK.split(message), start=1):
+        segment = line.strip(" \t")
+        if segment:
+            start = offset + line.index(segment)
+            delims = _hl7_delimiters(segment, delimiters)
+            try:
+                _validate_hl7_segment_py(segment, delims)
+                field_count = segment.count(delims[0]) + (1 if segment.startswith("MSH") else 0)
+                if segment.startswith("MSH"):
+                    delimiters = delims
+                error = None
+            except ValueError as e:
+                field_count = 0
+                error = str(e)
+            results.append(HL7SegmentResult(line_no, segment[:3], start, len(segment), field_count, error))
+        offset += len(line)
+        offset += 2 if message.startswith("\r\n", offset) else 1
+    return results
+
+
+@functools.lru_cache(maxsize=1)
+def _native_segment_cache():
+    """Return the process-wide native cache of parsed HL7 messages."""
+    return hospital_native.SegmentCache(settings.HOSPITAL_SETTINGS.get("HL7_PARSE_CACHE_BYTES", 0))
+
+
+def hl7_message_fields(message: str, fields, delimiters: Optional[str] = None) -> list:
+    """
+    Extract the same fields from every segment of an HL7 message.
+
+    The native path keeps a bounded LRU cache of parsed messages keyed by
+    content hash, so reading a stored (immutable) result again skips
+    splitting and validation. Field 0 is the segment ID; for MSH, field 1 is
+    the field separator.
+
+    Args:
+        message: HL7 message text, segments separated by \r, \n or \r\n
+        fields: Field numbers (0-255)
+        delimiters: Delimiters to assume before the first MSH (default "|^~\\&")
+
+    Returns:
+        Per segment, a tuple of the requested fields (None where absent), or
+        None for a segment that cannot be split into fields. Values are
+        returned whether or not they pass the schema checks.
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return _native_segment_cache().fields(message, fields, delimiters)
+        except ValueError:
+            raise
+        except Exception as e:
+            logger.warning(f"C HL7 segment cache failed, using Python: {e}")
+
+    for num in fields:
+        if not 0 <= num < 256:
+            raise ValueError("Invalid field number")
+    results = []
+    for line in _HL7_LINE_BREAK.split(message):
+        segment = line.strip(" \t")
+        if not segment:
+            continue
+        delims = _hl7_delimiters(segment, delimiters)
+        try:
+            _check_hl7_header(segment, delims)
+        except ValueError:
+            results.append(None)
+            continue
+        values = segment.split(delims[0])
+        if segment.startswith("MSH"):
+            values.insert(1, delims[0])
+            # Only a valid MSH switches delimiters for the segments after it
+            try:
+                _check_hl7_schema(segment, delims)
+                delimiters = delims
+            except ValueError:
+                pass
+        if len(values) > _HL7_MAX_FIELDS:
+            results.append(None)
+            continue
+        results.append(tuple(values[num] if num < len(values) else None for num in fields))
+    return results
+
+
+def hl7_segment_cache_stats() -> Optional[dict]:
+    """Hit/miss counters of the native HL7 segment cache, or None without C modules."""
+    if not C_MODULES_AVAILABLE:
+        return None
+    return _native_segment_cache().stats()
+
+
+def native_call_stats(reset: bool = False) -> Optional[dict]:
+    """
+    Per-API call counters of the native libraries, or None when they are not
+    in use or were built without HOSPITAL_NATIVE_STATS.
+
+    Shape: {"cutils": {api: counters}, "hl7val": {api: counters}}, counters
+    being calls, bytes, total_ns, errors ({error code: count}) and latency
+    (entry i counts calls of [2**i, 2**(i+1)) ns), summed over all threads of
+    this process. With reset=True the counters are zeroed after reading, so
+    a periodic exporter gets per-interval figures.
+    """
+    if not C_MODULES_AVAILABLE or not getattr(hospital_native, "STATS_ENABLED", False):
+        return None
+    snapshot = hospital_native.stats()
+    if reset:
+        hospital_native.reset_stats()
+    return snapshot
+
+
+def validate_hl7_file(path, threads: int = 0, max_errors: int = 100) -> dict:
+    """
+    Validate every segment of a file of HL7 messages (batch or archive).
+
+    The native path maps the file and validates it across threads; results
+    are the same as parse_hl7_message over the whole file.
+
+    Args:
+        path: File path (str or os.PathLike)
+        threads: Worker threads (0 = one per CPU)
+        max_errors: Most invalid segments to list
+
+    Returns:
+        Dict with bytes, segments, invalid (count) and errors, a list of
+        (offset, segment_index, line, segment_id, error) tuples in file order
+
+    Raises:
+        OSError: If the file cannot be read
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.validate_hl7_file(path, threads=threads, max_errors=max_errors)
+        except OSError:
+            raise
+        except Exception as e:
+            logger.warning(f"C HL7 file validation failed, using Python: {e}")
+
+    # Python fallback: latin-1 keeps character offsets equal to byte offsets
+    with open(path, "rb") as f:
+        data = f.read()
+    results = parse_hl7_message(data.decode("latin-1"))
+    invalid = [(i, r) for i, r in enumerate(results) if r.error is not None]
+    return {
+        "bytes": len(data),
+        "segments": len(results),
+        "invalid": len(invalid),
+        "errors": [(r.offset, i, r.line, r.segment_id, r.error) for i, r in invalid[:max_errors]],
+    }
+
+
+_OBX_STRING_COLUMNS = ("code", "units", "flags")
+
+
+class _ObxColumns:
+    """Python stand-in for hospital_native.ObxColumns, backed by array objects."""
+
+    def __init__(self):
+        self.record = array.array("I")
+        self.value = array.array("d")
+        self.valid = []
+        self.strings = {name: [] for name in _OBX_STRING_COLUMNS}
+
+    def __len__(self) -> int:
+        return len(self.record)
+
+    @property
+    def value_null_count(self) -> int:
+        return self.valid.count(False)
+
+    def buffer(self, name: str) -> memoryview:
+        if name in ("record", "value"):
+            return memoryview(getattr(self, name)).toreadonly()
+        if name == "value_valid":
+            bitmap = bytearray((len(self.valid) + 7) // 8)
+            for i, valid in enumerate(self.valid):
+                if valid:
+                    bitmap[i // 8] |= 1 << (i % 8)
+            return memoryview(bytes(bitmap))
+        column, _, part = name.partition("_")
+        if column in self.strings and part in ("offsets", "data"):
+            encoded = [s.encode() for s in self.strings[column]]
+            if part == "data":
+                return memoryview(b"".join(encoded))
+            offsets = array.array("q", [0])
+            for s in encoded:
+                offsets.append(offsets[-1] + len(s))
+            return memoryview(offsets).toreadonly()
+        raise KeyError(f"no such buffer: {name!r}")
+
+    def column(self, name: str) -> list:
+        if name == "record":
+            return self.record.tolist()
+        if name == "value":
+            return [v if ok else None for v, ok in zip(self.value, self.valid)]
+        if name in self.strings:
+            return list(self.strings[name])
+        raise KeyError(f"no such column: {name!r}")
+
+
+def obx_columns(texts, threads: int = 0):
+    """
+    Extract OBX-3, OBX-5, OBX-6 and OBX-8 from many stored OBX texts as columns.
+
+    One row per OBX segment, in input order. Columns are record (index of
+    the input text), value (OBX-5 as a float, None unless it is a plain NM
+    number), code and units (first component of OBX-3 and OBX-6) and flags
+    (OBX-8 as written). The native path runs across threads and
+    buffer(name) exposes every array without copying, in the Arrow layout
+    (value_valid is an LSB-first bitmap; strings are *_offsets plus *_data).
+
+    Args:
+        texts: Sequence of HL7 texts (str or bytes); None counts as empty
+        threads: Worker threads (0 = one per CPU)
+
+    Returns:
+        An object with len(), column(name) -> list and buffer(name) -> memoryview
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.obx_columns(texts, threads=threads)
+        except Exception as e:
+            logger.warning(f"C OBX column extraction failed, using Python: {e}")
+
+    cols = _ObxColumns()
+    for record, text in enumerate(texts):
+        if not text:
+            continue
+        if not isinstance(text, str):
+            text = bytes(text).decode("utf-8", errors="replace")
+        for line in _HL7_LINE_BREAK.split(text):
+            segment = line.strip(" \t")
+            if not segment.startswith("OBX|"):
+                continue
+            values = segment.split("|")
+            code, value, units, flags = (values[n] if n < len(values) else "" for n in (3, 5, 6, 8))
+            numeric = _HL7_NM.fullmatch(value) is not None
+            cols.record.append(record)
+            cols.value.append(float(value) if numeric else 0.0)
+            cols.valid.append(numeric)
+            cols.strings["code"].append(re.split(r"[\^~]", code, maxsplit=1)[0])
+            cols.strings["units"].append(re.split(r"[\^~]", units, maxsplit=1)[0])
+            cols.strings["flags"].append(flags)
+    return cols
+
+
+# Request throttling and IP blocklists
+
+
+@functools.lru_cache(maxsize=4)
+def _native_rate_limiter(name: str):
+    return hospital_native.RateLimiter(name)
+
+
+def rate_limit_hit(key: str, limit: int, window: float) -> Optional[float]:
+    """
+    Count a hit against key in the host-wide native rate table.
+
+    SECURITY_RATE_LIMIT_SHM names the shared memory segment (e.g.
+    "/hospital-ratelimit") that every worker process on the host attaches
+    to, so they all count against the same buckets without a cache round
+    trip. Each key gets limit hits per window, refilled evenly; denied hits
+    are not counted.
+
+    Args:
+        key: Bucket key, e.g. "ip|path"
+        limit: Hits allowed per window
+        window: Window length in seconds
+
+    Returns:
+        0.0 if the hit is allowed, else the seconds until it would be; None
+        when no table is configured or C modules are unavailable, so the
+        caller keeps counting its own way
+    """
+    name = getattr(settings, "SECURITY_RATE_LIMIT_SHM", "")
+    if not name or not C_MODULES_AVAILABLE:
+        return None
+    try:
+        return _native_rate_limiter(name).hit(key, limit, window)
+    except Exception as e:
+        logger.warning(f"C rate limiter failed, using the cache: {e}")
+        return None
+
+
+class _IpSet:
+    """Python stand-in for hospital_native.IpSet, backed by the ipaddress module."""
+
+    def __init__(self, networks: Iterable[str] = ()):
+        self._networks: dict[int, list] = {4: [], 6: []}
+        for network in networks:
+            try:
+                net = ipaddress.ip_network(network, strict=False)
+            except (TypeError, ValueError):
+                raise ValueError(f"invalid network: {network!r}") from None
+            mapped = net.version == 6 and net.prefixlen >= 96 and net.network_address.ipv4_mapped
+            if mapped:
+                net = ipaddress.ip_network((mapped, net.prefixlen - 96))
+            self._networks[net.version].append(net)
+
+    def __contains__(self, ip) -> bool:
+        try:
+            address = ipaddress.ip_address(ip)
+        except ValueError:
+            return False
+        if address.version == 6 and address.ipv4_mapped:
+            address = address.ipv4_mapped
+        return any(address in net for net in self._networks[address.version])
+
+
+def ip_blocklist(networks: Iterable[str]):
+    """
+    Build an immutable set of IP networks for fast membership tests.
+
+    The native set is a radix trie answering `ip in blocklist` in well under
+    a microsecond however many networks it holds. IPv4-mapped IPv6 addresses
+    match IPv4 networks; anything that is not an address is not a member.
+
+    Args:
+        networks: Addresses or networks ("10.0.0.0/8", "2001:db8::/32", "203.0.113.9")
+
+    Returns:
+        An object supporting `ip in blocklist`
+
+    Raises:
+        ValueError: If an entry is not an address or network
+    """
+    # Both paths may need the entries, and a generator can only be read once
+    networks = list(networks)
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.IpSet(networks)
+        except ValueError:
+            raise
+        except Exception as e:
+            logger.warning(f"C IP set failed, using Python: {e}")
+    return _IpSet(networks)
+
+
+# Tamper-evident audit chain, in the format of hospital_native.AuditLog
+# (see native/include/libcutils.h): "HNAUDIT1" then records of
+# u32 length | u64 seq | entry | SHA-256(previous digest || length || seq || entry)
+
+_AUDIT_MAGIC = b"HNAUDIT1"
+_AUDIT_HEADER = struct.Struct("<IQ")
+_AUDIT_DIGEST = 32
+_AUDIT_MAX_ENTRY = 1 << 20
+
+
+class _AuditLog:
+    """Python stand-in for hospital_native.AuditLog, writing each entry in the caller."""
+
+    def __init__(self, path, seed: Optional[bytes] = None, sync: bool = False):
+        import fcntl
+
+        if seed is not None and len(seed) != _AUDIT_DIGEST:
+            raise ValueError("seed must be 32 bytes")
+        self._lock = threading.Lock()
+        self._sync = sync
+        self._file = open(path, "a+b")
+        try:
+            fcntl.flock(self._file, fcntl.LOCK_EX | fcntl.LOCK_NB)
+            self._count, self._head = self._recover(seed or bytes(_AUDIT_DIGEST))
+        except BaseException:
+            self._file.close()
+            raise
+
+    def _recover(self, head: bytes) -> tuple[int, bytes]:
+        """Check the headers, trim a torn last record and return (count, last digest)."""
+        f = self._file
+        size = os.fstat(f.fileno()).st_size
+        f.seek(0)
+        magic = f.read(len(_AUDIT_MAGIC))
+        if magic != _AUDIT_MAGIC:
+            if not _AUDIT_MAGIC.startswith(magic):
+                raise ValueError("not an audit log")
+            f.truncate(0)
+            f.write(_AUDIT_MAGIC)
+            f.flush()
+            return 0, head
+        count, offset = 0, len(_AUDIT_MAGIC)
+        while size - offset >= _AUDIT_HEADER.size:
+            f.seek(offset)
+            length, seq = _AUDIT_HEADER.unpack(f.read(_AUDIT_HEADER.size))
+            if seq != count or length > _AUDIT_MAX_ENTRY:
+                raise ValueError(f"audit chain broken at record {count}")
+            end = offset + _AUDIT_HEADER.size + length + _AUDIT_DIGEST
+            if end > size:
+                break
+            count, offset = count + 1, end
+        if offset < size:
+            f.truncate(offset)
+        if count:
+            f.seek(offset - _AUDIT_DIGEST)
+            head = f.read(_AUDIT_DIGEST)
+        return count, head
+
+    def append(self, entry) -> None:
+        data = entry.encode() if isinstance(entry, str) else bytes(entry)
+        if len(data) > _AUDIT_MAX_ENTRY:
+            raise ValueError("audit entry too large")
+        with self._lock:
+            record = _AUDIT_HEADER.pack(len(data), self._count) + data
+            digest = hashlib.sha256(self._head + record).digest()
+            self._file.write(record + digest)
+            self._file.flush()
+            if self._sync:
+                os.fdatasync(self._file.fileno())
+            self._count, self._head = self._count + 1, digest
+
+    def flush(self) -> None:
+        with self._lock:
+            self._file.flush()
+
+    def head(self) -> tuple[int, bytes]:
+        with self._lock:
+            return self._count, self._head
+
+    def close(self) -> None:
+        with self._lock:
+            self._file.close()
+
+
+def _audit_verify_py(path, seed: Optional[bytes] = None) -> tuple[int, bytes]:
+    head = seed or bytes(_AUDIT_DIGEST)
+    count = 0
+    with open(path, "rb") as f:
+        if f.read(len(_AUDIT_MAGIC)) != _AUDIT_MAGIC:
+            raise ValueError("audit chain broken at record 0")
+        while header := f.read(_AUDIT_HEADER.size):
+            length, seq = _AUDIT_HEADER.unpack(header) if len(header) == _AUDIT_HEADER.size else (0, -1)
+            if seq != count or length > _AUDIT_MAX_ENTRY:
+                raise ValueError(f"audit chain broken at record {count}")
+            entry = f.read(length)
+            digest = f.read(_AUDIT_DIGEST)
+            if len(entry) != length or not hmac.compare_digest(
+                digest, hashlib.sha256(head + header + entry).digest()
+            ):
+                raise ValueError(f"audit chain broken at record {count}")
+            count, head = count + 1, digest
+    return count, head
+
+
+_audit_log = None
+_audit_log_pid = 0
+_audit_log_lock = threading.Lock()
+
+
+def _process_audit_log():
+    """This process's audit chain writer, or None when SECURITY_AUDIT_CHAIN_PATH is unset."""
+    global _audit_log, _audit_log_pid
+
+    path = getattr(settings, "SECURITY_AUDIT_CHAIN_PATH", "")
+    if not path:
+        return None
+    # The chain file is locked by its writer, so processes sharing one would all but the first fail
+    if "{pid}" not in path:
+        raise ImproperlyConfigured('SECURITY_AUDIT_CHAIN_PATH must contain "{pid}", one chain per process')
+    pid = os.getpid()
+    if _audit_log_pid == pid:
+        return _audit_log
+    with _audit_log_lock:
+        # A forked worker inherits its parent's writer, which is of no use here
+        if _audit_log_pid != pid:
+            path = path.format(pid=pid)
+            sync = getattr(settings, "SECURITY_AUDIT_CHAIN_SYNC", False)
+            log = None
+            if C_MODULES_AVAILABLE:
+                try:
+                    log = hospital_native.AuditLog(path, sync=sync)
+                except (OSError, ValueError):
+                    raise
+                except Exception as e:
+                    logger.warning(f"C audit log failed, using Python: {e}")
+            _audit_log = log or _AuditLog(path, sync=sync)
+            _audit_log_pid = pid
+    return _audit_log
+
+
+def audit_chain_append(entry: str | bytes) -> bool:
+    """
+    Append an entry to this process's tamper-evident audit chain.
+
+    SECURITY_AUDIT_CHAIN_PATH names the file ("{pid}" is replaced by the
+    process id, since each process writes its own chain). Every record
+    carries the SHA-256 of the previous one, so editing or removing an entry
+    breaks every later digest. The native path only queues the entry: a
+    background thread hashes and writes batches, so the caller does no I/O.
+
+    Args:
+        entry: Entry text (UTF-8 encoded) or bytes, at most 1 MiB
+
+    Returns:
+        False if the chain is disabled, True once the entry is queued
+
+    Raises:
+        ImproperlyConfigured: If SECURITY_AUDIT_CHAIN_PATH has no "{pid}"
+        OSError: If the log cannot be opened or a write has failed
+        BlockingIOError: If the native writer has fallen too far behind
+    """
+    log = _process_audit_log()
+    if log is None:
+        return False
+    log.append(entry)
+    return True
+
+
+def audit_chain_flush() -> None:
+    """Wait until every entry appended to this process's chain is on disk."""
+    log = _process_audit_log()
+    if log is not None:
+        log.flush()
+
+
+def audit_chain_verify(path, seed: Optional[bytes] = None) -> tuple[int, bytes]:
+    """
+    Recompute the chain of an audit log file.
+
+    Args:
+        path: File path (str or os.PathLike)
+        seed: 32-byte value the chain was started from (default all zero)
+
+    Returns:
+        (record count, digest of the last record), to compare with a copy
+        kept elsewhere
+
+    Raises:
+        ValueError: At the first altered, reordered or truncated record
+        OSError: If the file cannot be read
+    """
+    if C_MODULES_AVAILABLE:
+        try:
+            return hospital_native.audit_verify(path, seed)
+        except (OSError, ValueError):
+            raise
+        except Exception as e:
+            logger.warning(f"C audit verification failed, using Python: {e}")
+    return _audit_verify_py(path, seed)
+
+
+# Billing
+
+
+class InvoiceTotals(NamedTuple):
+    """Amounts computed by invoice_totals, as Decimals with two places."""
+
+    subtotal: Decimal
+    discount: Decimal
+    tax: Decimal
+    total: Decimal
+    balance: Decimal
+
+
+_CENT = Decimal("0.01")
+_RATE_STEP = Decimal("0.000001")
+
+
+def _exact_decimal(value, step: Decimal, what: str) -> Decimal:
+    """value as a Decimal quantized to step, refusing floats and anything that would need rounding."""
+    if not isinstance(value, (Decimal, int, str)):
+        raise TypeError(f"{what} must be a Decimal, int or str: {value!r}")
+    try:
+        number = Decimal(value)
+        exact = number.quantize(step)
+    except ArithmeticError:
+        exact = None
+    if exact is None or exact != number:
+        places = -step.as_tuple().exponent
+        raise ValueError(f"{what} must be a decimal with at most {places} places: {value!r}")
+    return exact
+
+
+def _invoice_totals_py(invoices, items) -> list[tuple]:
+    with localcontext() as ctx:
+        ctx.prec = 40  # Every sum and product below stays exact
+        parsed = []
+        for i, invoice in enumerate(invoices):
+            if not 3 <= len(invoice) <= 5:
+                raise ValueError(f"invoice {i}: expected 3 to 5 fields, got {len(invoice)}")
+            tax, discount, paid = (_exact_decimal(v, _CENT, w) for v, w in zip(invoice, ("tax", "discount", "paid")))
+            rates = []
+            for value, what in zip(invoice[3:], ("tax_rate", "discount_rate")):
+                rate = _exact_decimal(value, _RATE_STEP, what)
+                if not 0 <= rate <= 1:
+                    raise ValueError(f"{what} must be between 0 and 1: {value!r}")
+                rates.append(rate)
+            rates += [Decimal(0)] * (2 - len(rates))
+            parsed.append((tax, discount, paid, *rates))
+
+        subtotals = [Decimal("0.00")] * len(parsed)
+        for i, item in enumerate(items):
+            if len(item) != 3:
+                raise ValueError(f"item {i}: expected 3 fields, got {len(item)}")
+            index, quantity, unit_price = item
+            if not isinstance(index, int) or not isinstance(quantity, int):
+                raise TypeError(f"item {i}: invoice index and quantity must be ints")
+            if not 0 <= index < len(parsed):
+                raise ValueError(f"invoice index out of range: {index!r}")
+            if not 0 <= quantity < 1 << 32:
+                raise ValueError(f"quantity out of range: {quantity!r}")
+            subtotals[index] += quantity * _exact_decimal(unit_price, _CENT, "unit_price")
+
+        results = []
+        for subtotal, (tax, discount, paid, tax_rate, discount_rate) in zip(subtotals, parsed):
+            discount += (subtotal * discount_rate).quantize(_CENT, rounding=ROUND_HALF_UP)
+            tax += (max(subtotal - discount, Decimal(0)) * tax_rate).quantize(_CENT, rounding=ROUND_HALF_UP)
+            total = subtotal + tax - discount
+            results.append((subtotal, discount, tax, total, total - paid))
+        return results
+
+
+def invoice_totals(invoices, items) -> list[InvoiceTotals]:
+    """
+    Compute the totals of many invoices in one call.
+
+    All arithmetic is exact: the native path works in integer cents and
+    rounds proportional tax and discount half up (away from zero) to the
+    cent once, as Decimal.quantize(ROUND_HALF_UP) does, so both paths give
+    the same Decimals. With no rates this is Invoice._calculate_totals.
+
+    Args:
+        invoices: (tax_amount, discount_amount, amount_paid[, tax_rate[,
+            discount_rate]]) per invoice; rates are fractions (Decimal("0.16"))
+            with at most six places, tax applying after the discount
+        items: (invoice index, quantity, unit_price) per line item, in any order
+
+    Returns:
+        InvoiceTotals(subtotal, discount, tax, total, balance) per invoice
+
+    Raises:
+        ValueError: If an amount has more than two places (or a rate six),
+            or an item names an invoice out of range
+        TypeError: If an amount is a float
+        OverflowError: From the native path, past about 9 * 10**16
+    """
+    if not isinstance(invoices, (list, tuple)):
+        invoices = list(invoices)
+    if not isinstance(items, (list, tuple)):
+        items = list(items)
+    if C_MODULES_AVAILABLE and hasattr(hospital_native, "invoice_totals"):
+        try:
+            return [InvoiceTotals._make(row) for row in hospital_native.invoice_totals(invoices, items)]
+        except (TypeError, ValueError, OverflowError):
+            raise
+        except Exception as e:
+            logger.warning(f"C invoice totals failed, using Python: {e}")
+    return [InvoiceTotals._make(row) for row in _invoice_totals_py(invoices, items)]
+
+
+# Authorization policy
+
+_ALL_STATES = (1 << 64) - 1
+
+
+class _Policy:
+    """Python stand-in for hospital_native.Policy, with role and state sets as int bitmasks."""
+
+    def __init__(self, roles, permissions, states=(), grants=()):
+        self.roles = self._names(roles, "roles")
+        self.states = self._names(states, "states")
+        self.permissions = tuple(permissions)
+        self._roles = {name: i for i, name in enumerate(self.roles)}
+        self._states = {name: i for i, name in enumerate(self.states)}
+        self._permissions: dict = {}
+        for i, pair in enumerate(self.permissions):
+            if not (isinstance(pair, tuple) and len(pair) == 2 and all(isinstance(p, str) for p in pair)):
+                raise TypeError(f"permissions must be (resource, action) tuples of str, not {pair!r}")
+            if pair in self._permissions:
+                raise ValueError(f"duplicate permission: {pair!r}")
+            self._permissions[pair] = i
+        if not self.roles or not self.permissions:
+            raise ValueError("a policy needs at least one role and one permission")
+        self._holders = [0] * len(self.permissions)  # Roles with a grant, per permission
+        self._cells: dict[tuple[int, int], tuple[int, int]] = {}  # (permission, role) -> (states, own_states)
+        self._apply(grants)
+
+    @staticmethod
+    def _names(names, what: str) -> tuple:
+        names = tuple(names)
+        if len(names) > 64:
+            raise ValueError(f"at most 64 {what}")
+        for i, name in enumerate(names):
+            if not isinstance(name, str):
+                raise TypeError(f"{what} must be str, not {name!r}")
+            if name in names[:i]:
+                raise ValueError(f"duplicate name in {what}: {name!r}")
+        return names
+
+    def _state_mask(self, states) -> int:
+        if states is None:
+            return _ALL_STATES
+        if isinstance(states, str):
+            raise TypeError(f"grant states must be None or an iterable of state names, not {states!r}")
+        mask = 0
+        for state in states:
+            if state not in self._states:
+                raise ValueError(f"unknown state: {state!r}")
+            mask |= 1 << self._states[state]
+        return mask
+
+    def _apply(self, grants) -> None:
+        cells = []
+        for grant in grants:
+            grant = tuple(grant)
+            if not 3 <= len(grant) <= 5:
+                raise TypeError(f"grants must be (role, resource, action[, states[, own_states]]), not {grant!r}")
+            role, resource, action = grant[:3]
+            if role not in self._roles:
+                raise ValueError(f"unknown role: {role!r}")
+            if (resource, action) not in self._permissions:
+                raise ValueError(f"unknown permission: ({resource!r}, {action!r})")
+            states = self._state_mask(grant[3]) if len(grant) > 3 else _ALL_STATES
+            own_states = self._state_mask(grant[4]) if len(grant) > 4 else 0
+            cells.append((self._permissions[resource, action], self._roles[role], states, own_states & ~states))
+        for permission, role, states, own_states in cells:
+            if states | own_states:
+                self._cells[permission, role] = (states, own_states)
+                self._holders[permission] |= 1 << role
+            else:
+                self._cells.pop((permission, role), None)
+                self._holders[permission] &= ~(1 << role)
+
+    def _role_mask(self, roles) -> int:
+        if isinstance(roles, str):
+            roles = (roles,)
+        return sum(1 << self._roles[role] for role in set(roles) if role in self._roles)
+
+    def _scope(self, roles, action, resource) -> tuple[int, int]:
+        permission = self._permissions.get((resource, action))
+        if permission is None:
+            return 0, 0
+        held = self._role_mask(roles) & self._holders[permission]
+        states = own_states = 0
+        for role in range(held.bit_length()):
+            if held >> role & 1:
+                cell = self._cells[permission, role]
+                states |= cell[0]
+                own_states |= cell[1]
+        return states, own_states & ~states
+
+    def can(self, roles, action, resource) -> bool:
+        permission = self._permissions.get((resource, action))
+        return permission is not None and bool(self._role_mask(roles) & self._holders[permission])
+
+    def scope(self, roles, action, resource) -> tuple[frozenset, frozenset]:
+        states, own_states = self._scope(roles, action, resource)
+        return (
+            frozenset(name for i, name in enumerate(self.states) if states >> i & 1),
+            frozenset(name for i, name in enumerate(self.states) if own_states >> i & 1),
+        )
+
+    def filter(self, roles, action, resource, states, owners=None, subject=None) -> list[int]:
+        if owners is not None and len(owners) != len(states):
+            raise ValueError("states and owners must have the same length")
+        allowed, own_states = self._scope(roles, action, resource)
+        bits = [self._states.get(state, 64) for state in states]
+        if owners is None or subject is None:
+            return [i for i, bit in enumerate(bits) if allowed >> bit & 1]
+        return [
+            i
+            for i, (bit, owner) in enumerate(zip(bits, owners))
+            if (allowed | (own_states if owner == subject else 0)) >> bit & 1
+        ]
+
+    def replace(self, grants) -> "_Policy":
+        copy = object.__new__(_Policy)
+        copy.__dict__.update(self.__dict__, _holders=list(self._holders), _cells=dict(self._cells))
+        copy._apply(grants)
+        return copy
+
+
+def authz_policy(roles, permissions, states=(), grants=()):
+    """
+    Compile a role/permission policy for per-request authorization decisions.
+
+    Permissions are (resource, action) pairs granted to roles, optionally only
+    on objects in some states, or in further states on objects the user owns.
+    The native policy holds them as bitsets: `can` is one AND of the user's
+    role mask, and `filter` decides a whole batch of objects from two state
+    masks computed once. Policies are immutable; `replace` returns a changed
+    copy, so readers never see a half-applied change.
+
+    Args:
+        roles: Role names (at most 64)
+        permissions: (resource, action) pairs
+        states: Object state names (at most 64)
+        grants: (role, resource, action[, states[, own_states]]); states None
+            or omitted means every state, own_states omitted none
+
+    Returns:
+        An object with can(roles, action, resource), scope(roles, action,
+        resource) -> (states, own_states), filter(roles, action, resource,
+        states, owners=None, subject=None) -> allowed indexes, and
+        replace(grants) -> policy
+
+    Raises:
+        ValueError: On unknown or duplicate names, or too many roles or states
+        TypeError: If a permission or grant is malformed
+    """
+    if C_MODULES_AVAILABLE and hasattr(hospital_native, "Policy"):
+        try:
+            return hospital_native.Policy(roles, permissions, states, grants)
+        except (TypeError, ValueError):
+            raise
+        except Exception as e:
+            logger.warning(f"C authorization policy failed, using Python: {e}")
+    return _Policy(roles, permissions, states, grants)
@@ -14,7 +14,10 @@ from django.conf import settings
 from django.core.exceptions import ValidationError
 from django.db import models
 
-from apps.core.utils import validate_hl7_segment
+from apps.core.utils import hl7_message_fields, parse_hl7_message, validate_hl7_segment
+
+# OBX set ID, value type, identifier, value, units, reference range, abnormal flag
+OBX_VALUE_FIELDS = (1, 2, 3, 5, 6, 7, 8)
 
 
 class OrderStatus(models.TextChoices):
@@ -274,18 +277,15 @@ class LabResult(models.Model):
             except ValueError as e:
                 raise ValidationError({"hl7_obr_segment": f"Invalid HL7 OBR segment: {e}"})
 
-        # Validate OBX segments if provided
+        # Validate OBX segments if provided (all lines in one native call)
         if self.hl7_obx_segments:
-            for i, segment in enumerate(self.hl7_obx_segments.strip().split("\n")):
-                segment = segment.strip()
-                if not segment:
-                    continue
-                try:
-                    validate_hl7_segment(segment)
-                    if not segment.startswith("OBX|"):
-                        raise ValidationError({"hl7_obx_segments": f"Line {i+1}: Segment must be an OBX segment"})
-                except ValueError as e:
-                    raise ValidationError({"hl7_obx_segments": f"Line {i+1}: Invalid HL7 OBX segment: {e}"})
+            for segment in parse_hl7_message(self.hl7_obx_segments.strip()):
+                if segment.error:
+                    raise ValidationError(
+                        {"hl7_obx_segments": f"Line {segment.line}: Invalid HL7 OBX segment: {segment.error}"}
+                    )
+                if segment.segment_id != "OBX":
+                    raise ValidationError({"hl7_obx_segments": f"Line {segment.line}: Segment must be an OBX segment"})
 
     def save(self, *args, **kwargs):
         self.full_clean()
@@ -310,18 +310,23 @@ class LabResult(models.Model):
         - reference_range: Normal range
         - abnormal_flag: H (high), L (low), A (abnormal), etc.
         """
+        if not self.hl7_obx_segments:
+            return []
+        # Stored results do not change, so repeated reads hit the parse cache
         results = []
-        for segment in self.get_obx_list():
-            fields = segment.split("|")
-            if len(fields) >= 6:
-                result = {
-                    "set_id": fields[1] if len(fields) > 1 else "",
-                    "value_type": fields[2] if len(fields) > 2 else "",
-                    "identifier": fields[3] if len(fields) > 3 else "",
-                    "value": fields[5] if len(fields) > 5 else "",
-                    "units": fields[6] if len(fields) > 6 else "",
-                    "reference_range": fields[7] if len(fields) > 7 else "",
-                    "abnormal_flag": fields[8] if len(fields) > 8 else "",
-                }
-                results.append(result)
+        for row in hl7_message_fields(self.hl7_obx_segments, OBX_VALUE_FIELDS):
+            # Segments must reach OBX-5 (the value); later fields may be absent
+            if row is not None and row[3] is not None:
+                set_id, value_type, identifier, value, units, reference_range, abnormal_flag = (v or "" for v in row)
+                results.append(
+                    {
+                        "set_id": set_id,
+                        "value_type": value_type,
+                        "identifier": identifier,
+                        "value": value,
+                        "units": units,
+                        "reference_range": reference_range,
+                        "abnormal_flag": abnormal_flag,
+                    }
+                )
         return results
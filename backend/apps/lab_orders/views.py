@@ -13,6 +13,7 @@ from rest_framework.response import Response
 from django_filters.rest_framework import DjangoFilterBackend
 from drf_spectacular.utils import OpenApiParameter, extend_schema, extend_schema_view
 
+from apps.users import policy
 from apps.users.permissions import (
     CanOrderLabs,
     CanViewPatients,
@@ -126,18 +127,10 @@ class LabOrderViewSet(viewsets.ModelViewSet):
         return [CanViewPatients()]
 
     def get_queryset(self):
-        queryset = super().get_queryset()
-        user = self.request.user
-
-        # Filter by role
-        if user.is_doctor:
-            # Doctors see their own orders and orders for their patients
-            queryset = queryset.filter(ordering_provider=user)
-        elif user.is_lab_tech:
-            # Lab techs see orders that need processing
-            queryset = queryset.exclude(status__in=[OrderStatus.CANCELLED, OrderStatus.REVIEWED])
-
-        return queryset
+        # Doctors see their own orders, lab techs the ones that need processing
+        return policy.scope_queryset(
+            super().get_queryset(), self.request.user, "view", "lab_order", "status", "ordering_provider"
+        )
 
     @action(detail=True, methods=["post"], permission_classes=[IsClinicalStaff])
     @extend_schema(
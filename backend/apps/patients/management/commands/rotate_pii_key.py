@@ -0,0 +1,75 @@
+"""
+Django management command: re-encrypt patient PII under a new key.
+
+Deploy the new PII_ENCRYPTION_KEY first, then run with the previous
+secret exposed through an environment variable:
+
+    OLD_PII_ENCRYPTION_KEY=... python manage.py rotate_pii_key
+"""
+
+import os
+
+from django.conf import settings
+from django.core.management.base import BaseCommand, CommandError
+from django.db import transaction
+
+from apps.core.utils import reencrypt_stream
+from apps.patients.models import Patient, derive_encryption_key
+
+
+class Command(BaseCommand):
+    """Django command to rotate the PII encryption key."""
+
+    help = "Re-encrypt all patient SSNs from the old PII key to the current one"
+
+    def add_arguments(self, parser):
+        parser.add_argument(
+            "--old-key-env",
+            default="OLD_PII_ENCRYPTION_KEY",
+            help="Environment variable holding the previous PII secret",
+        )
+        parser.add_argument("--batch-size", type=int, default=5000, help="Records re-encrypted per native call")
+        parser.add_argument("--threads", type=int, default=0, help="Native worker threads (0 = all CPUs)")
+        parser.add_argument("--dry-run", action="store_true", help="Re-encrypt without writing changes")
+
+    def handle(self, *args, **options):
+        old_secret = os.environ.get(options["old_key_env"])
+        if not old_secret:
+            raise CommandError(f"Environment variable {options['old_key_env']} is not set")
+
+        old_key = derive_encryption_key(old_secret)
+        new_key = derive_encryption_key(settings.HOSPITAL_SETTINGS.get("PII_ENCRYPTION_KEY"))
+        if old_key == new_key:
+            raise CommandError("Old and new PII keys are identical")
+
+        records = (
+            Patient.objects.exclude(_ssn_encrypted=None)
+            .order_by("pk")
+            .values_list("pk", "_ssn_encrypted")
+            .iterator(chunk_size=options["batch_size"])
+        )
+
+        rotated = 0
+        failed = 0
+        for batch in reencrypt_stream(
+            records, old_key, new_key, batch_size=options["batch_size"], threads=options["threads"]
+        ):
+            updates = []
+            for pk, new_ct in batch:
+                if new_ct is None:
+                    failed += 1
+                    continue
+                patient = Patient(pk=pk)
+                patient._ssn_encrypted = new_ct
+                updates.append(patient)
+
+            if updates and not options["dry_run"]:
+                with transaction.atomic():
+                    Patient.objects.bulk_update(updates, ["_ssn_encrypted"])
+            rotated += len(updates)
+            self.stdout.write(f"🔄 Re-encrypted {rotated} records...")
+
+        suffix = " (dry run)" if options["dry_run"] else ""
+        self.stdout.write(self.style.SUCCESS(f"✅ Rotated {rotated} records{suffix}"))
+        if failed:
+            self.stdout.write(self.style.WARNING(f"⚠️ {failed} records did not decrypt under the old key"))
@@ -15,7 +15,7 @@ from django.conf import settings
 from django.core.validators import RegexValidator
 from django.db import models
 
-from apps.core.utils import aes_gcm_decrypt, aes_gcm_encrypt
+from apps.core.utils import aes_gcm_decrypt, aes_gcm_decrypt_many, aes_gcm_encrypt, sha256_hex_many
 
 
 class Gender(models.TextChoices):
@@ -56,6 +56,27 @@ def generate_mrn():
     return f"MRN-{date_part}-{random_part}"
 
 
+def derive_encryption_key(secret) -> bytes:
+    """
+    Derive the 32-byte AES-256 key from a configured PII secret.
+
+    Args:
+        secret: PII_ENCRYPTION_KEY value (str or bytes)
+
+    Returns:
+        SHA-256 digest of the secret
+    """
+    if not secret:
+        raise ValueError("PII_ENCRYPTION_KEY not configured")
+
+    # Ensure key is 32 bytes for AES-256
+    if isinstance(secret, str):
+        secret = secret.encode("utf-8")
+
+    # Hash the key to ensure exactly 32 bytes
+    return hashlib.sha256(secret).digest()
+
+
 class Patient(models.Model):
     """
     Patient model with encrypted sensitive data.
@@ -154,16 +175,7 @@ class Patient(models.Model):
 
     def _get_encryption_key(self):
         """Get the PII encryption key from settings."""
-        key = settings.HOSPITAL_SETTINGS.get("PII_ENCRYPTION_KEY")
-        if not key:
-            raise ValueError("PII_ENCRYPTION_KEY not configured")
-
-        # Ensure key is 32 bytes for AES-256
-        if isinstance(key, str):
-            key = key.encode("utf-8")
-
-        # Hash the key to ensure exactly 32 bytes
-        return hashlib.sha256(key).digest()
+        return derive_encryption_key(settings.HOSPITAL_SETTINGS.get("PII_ENCRYPTION_KEY"))
 
     def set_ssn(self, ssn: str):
         """
@@ -201,6 +213,32 @@ class Patient(models.Model):
         decrypted = aes_gcm_decrypt(bytes(self._ssn_encrypted), key)
         return decrypted.decode()
 
+    @classmethod
+    def get_ssn_many(cls, patients) -> dict:
+        """
+        Decrypt SSNs for many patients in a single batch.
+
+        Intended for list pages and exports where decrypting row by row
+        would cross into the C module once per patient.
+
+        Args:
+            patients: Iterable of Patient instances
+
+        Returns:
+            Dict mapping patient pk to decrypted SSN (or None)
+        """
+        patients = list(patients)
+        result = {p.pk: None for p in patients}
+        encrypted = [p for p in patients if p._ssn_encrypted]
+        if not encrypted:
+            return result
+
+        key = encrypted[0]._get_encryption_key()
+        decrypted = aes_gcm_decrypt_many([bytes(p._ssn_encrypted) for p in encrypted], key)
+        for patient, value in zip(encrypted, decrypted):
+            result[patient.pk] = value.decode() if value is not None else None
+        return result
+
     @property
     def ssn_masked(self) -> str | None:
         """Return masked SSN (XXX-XX-1234)."""
@@ -227,3 +265,36 @@ class Patient(models.Model):
             return cls.objects.get(ssn_hash=ssn_hash)
         except cls.DoesNotExist:
             return None
+
+    @staticmethod
+    def hash_ssn_many(ssns) -> list[str]:
+        """
+        Compute lookup hashes for many SSNs in one batch.
+
+        Produces the same values as ``ssn_hash`` set by ``set_ssn``.
+
+        Args:
+            ssns: Iterable of plain text SSNs (dashes/spaces allowed)
+
+        Returns:
+            List of hex hashes, in input order
+        """
+        return sha256_hex_many([ssn.replace("-", "").replace(" ", "") for ssn in ssns])
+
+    @classmethod
+    def find_by_ssn_many(cls, ssns) -> dict:
+        """
+        Find patients for many SSNs with one hash batch and one query.
+
+        Intended for imports and duplicate detection.
+
+        Args:
+            ssns: Iterable of plain text SSNs
+
+        Returns:
+            Dict mapping each input SSN to its Patient (or None)
+        """
+        ssns = list(ssns)
+        hashes = cls.hash_ssn_many(ssns)
+        found = {p.ssn_hash: p for p in cls.objects.filter(ssn_hash__in=set(hashes))}
+        return {ssn: found.get(h) for ssn, h in zip(ssns, hashes)}
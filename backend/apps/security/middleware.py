@@ -4,12 +4,15 @@ Security middleware for IP tracking, blocking, and request logging.
 Copyright (c) 2025, Immanuel Njogu. All rights reserved.
 """
 
+import json
 import logging
 import time
 from typing import Callable
 
 from django.conf import settings
 from django.core.cache import cache
+from django.core.exceptions import ImproperlyConfigured
+from django.db.models import Q
 from django.http import HttpRequest, HttpResponse, HttpResponseForbidden
 from django.utils import timezone
 
@@ -31,11 +34,51 @@ def get_client_ip(request: HttpRequest) -> str:
     return ip
 
 
+# Active blocks of this process as one in-memory IP set. It is rebuilt when
+# a BlockedIP is saved or deleted here (see signals), when a block in it
+# expires, and otherwise after SECURITY_BLOCKLIST_REFRESH seconds, which
+# bounds how long changes made by other processes take to show.
+_blocklist = None
+_blocklist_deadline = 0.0
+
+
+def invalidate_blocklist():
+    """Have this process rebuild its blocklist snapshot on the next request."""
+    global _blocklist
+    _blocklist = None
+
+
+def _current_blocklist():
+    """The blocklist snapshot, or None when SECURITY_BLOCKLIST_REFRESH disables it."""
+    global _blocklist, _blocklist_deadline
+
+    refresh = getattr(settings, "SECURITY_BLOCKLIST_REFRESH", 30)
+    if refresh <= 0:
+        return None
+    if _blocklist is not None and time.monotonic() < _blocklist_deadline:
+        return _blocklist
+
+    from apps.core.utils import ip_blocklist
+    from apps.security.models import BlockedIP
+
+    now = timezone.now()
+    blocks = BlockedIP.objects.filter(Q(expires_at__isnull=True) | Q(expires_at__gt=now), is_active=True)
+    rows = list(blocks.values_list("ip_address", "expires_at"))
+    ttl = float(refresh)
+    expiries = [expires_at for _, expires_at in rows if expires_at is not None]
+    if expiries:
+        ttl = min(ttl, (min(expiries) - now).total_seconds())
+    _blocklist_deadline = time.monotonic() + ttl
+    _blocklist = ip_blocklist(ip for ip, _ in rows)
+    return _blocklist
+
+
 class IPBlockingMiddleware:
     """
     Middleware to block requests from blacklisted IP addresses.
 
-    Checks BlockedIP model and caches results for performance.
+    Checks an in-memory snapshot of the active BlockedIP rows, or with
+    SECURITY_BLOCKLIST_REFRESH = 0 the cache and database for each IP.
     """
 
     CACHE_PREFIX = "blocked_ip:"
@@ -61,6 +104,10 @@ class IPBlockingMiddleware:
 
     def _is_ip_blocked(self, ip: str) -> bool:
         """Check if IP is blocked, using cache for performance."""
+        blocklist = _current_blocklist()
+        if blocklist is not None:
+            return ip in blocklist
+
         cache_key = f"{self.CACHE_PREFIX}{ip}"
 
         # Check cache first
@@ -123,6 +170,10 @@ class RequestLoggingMiddleware:
 
     def __init__(self, get_response: Callable):
         self.get_response = get_response
+        # Fail at startup rather than on every request in every worker but the first
+        path = getattr(settings, "SECURITY_AUDIT_CHAIN_PATH", "")
+        if path and "{pid}" not in path:
+            raise ImproperlyConfigured('SECURITY_AUDIT_CHAIN_PATH must contain "{pid}", one chain per process')
 
     def __call__(self, request: HttpRequest) -> HttpResponse:
         # Check if request logging is enabled
@@ -148,6 +199,8 @@ class RequestLoggingMiddleware:
 
         # Log request asynchronously (or directly if Celery not available)
         self._log_request(request, response, ip, response_time_ms)
+        # The audit chain is kept even when database request logging is off
+        self._append_audit_chain(request, response, ip, response_time_ms)
 
         return response
 
@@ -180,6 +233,34 @@ class RequestLoggingMiddleware:
             # Don't let logging failures break the request
             logger.error(f"Failed to log request: {e}")
 
+    def _append_audit_chain(
+        self,
+        request: HttpRequest,
+        response: HttpResponse,
+        ip: str,
+        response_time_ms: int,
+    ):
+        """Append the request to the tamper-evident audit chain, if configured."""
+        if not getattr(settings, "SECURITY_AUDIT_CHAIN_PATH", ""):
+            return
+
+        from apps.core.utils import audit_chain_append
+
+        user = getattr(request, "user", None)
+        entry = {
+            "at": timezone.now().isoformat(),
+            "ip": ip,
+            "method": request.method,
+            "path": request.path[:500],
+            "user": user.pk if user is not None and user.is_authenticated else None,
+            "status": response.status_code,
+            "ms": response_time_ms,
+        }
+        try:
+            audit_chain_append(json.dumps(entry, separators=(",", ":"), default=str))
+        except Exception as e:
+            logger.error(f"Failed to append to audit chain: {e}")
+
 
 class RateLimitMiddleware:
     """
@@ -220,6 +301,14 @@ class RateLimitMiddleware:
             return False
 
         config = rate_limits[path]
+
+        # Host-wide shared-memory buckets, when configured
+        from apps.core.utils import rate_limit_hit
+
+        retry_after = rate_limit_hit(f"{ip}|{path}", config["limit"], config["window"])
+        if retry_after is not None:
+            return retry_after > 0
+
         cache_key = f"rate_limit:{ip}:{path}"
 
         # Get current count
@@ -7,9 +7,10 @@ Copyright (c) 2025, Immanuel Njogu. All rights reserved.
 import logging
 
 from django.contrib.auth.signals import user_logged_in, user_logged_out, user_login_failed
+from django.db.models.signals import post_delete, post_save
 from django.dispatch import receiver
 
-from .models import SecurityEvent
+from .models import BlockedIP, SecurityEvent
 
 logger = logging.getLogger(__name__)
 
@@ -73,3 +74,11 @@ def log_login_failed(sender, credentials, request, **kwargs):
         severity=SecurityEvent.Severity.MEDIUM,
         metadata={"username": username},
     )
+
+
+@receiver([post_save, post_delete], sender=BlockedIP)
+def invalidate_ip_blocklist(sender, **kwargs):
+    """Make this process's middleware pick up the changed block."""
+    from apps.security.middleware import invalidate_blocklist
+
+    invalidate_blocklist()
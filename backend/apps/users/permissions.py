@@ -9,6 +9,7 @@ Copyright (c) 2025, Immanuel Njogu. All rights reserved.
 
 from rest_framework.permissions import BasePermission
 
+from . import policy
 from .models import UserRole
 
 
@@ -112,7 +113,7 @@ class CanOrderLabs(BasePermission):
     message = "Lab ordering permission required."
 
     def has_permission(self, request, view):
-        return bool(request.user and request.user.is_authenticated and request.user.can_order_labs)
+        return bool(request.user and request.user.is_authenticated and policy.can(request.user, "create", "lab_order"))
 
 
 class CanViewPatients(BasePermission):
@@ -123,7 +124,7 @@ class CanViewPatients(BasePermission):
     message = "Patient viewing permission required."
 
     def has_permission(self, request, view):
-        return bool(request.user and request.user.is_authenticated and request.user.can_view_patients)
+        return bool(request.user and request.user.is_authenticated and policy.can(request.user, "view", "patient"))
 
 
 class IsOwnerOrAdmin(BasePermission):
@@ -0,0 +1,110 @@
+"""
+Compiled role/permission policy for API authorization.
+
+The grants below are compiled once per process into an apps.core.utils
+authz_policy (bitsets in hospital_native when it is available), so a
+permission check is a lookup and one AND rather than a walk over role
+checks, and list endpoints turn a user's grants into one queryset filter.
+
+Copyright (c) 2025, Immanuel Njogu. All rights reserved.
+"""
+
+import threading
+
+from django.db.models import Q
+
+from apps.core.utils import authz_policy
+from apps.lab_orders.models import OrderStatus
+
+from .models import UserRole
+
+PERMISSIONS = [
+    ("patient", "view"),
+    ("lab_order", "view"),
+    ("lab_order", "create"),
+]
+
+# (role, resource, action[, states[, own_states]]); states are lab order statuses
+GRANTS = [
+    *((role, "patient", "view") for role in UserRole.values),
+    *((role, "lab_order", "create") for role in (UserRole.ADMIN, UserRole.DOCTOR, UserRole.NURSE)),
+    *((role, "lab_order", "view") for role in (UserRole.ADMIN, UserRole.NURSE, UserRole.RECEPTIONIST)),
+    # Doctors see the orders they placed; lab techs the ones still to process
+    (UserRole.DOCTOR, "lab_order", "view", (), None),
+    (
+        UserRole.LAB_TECH,
+        "lab_order",
+        "view",
+        [s for s in OrderStatus.values if s not in (OrderStatus.CANCELLED, OrderStatus.REVIEWED)],
+    ),
+]
+
+_policy = None
+_lock = threading.Lock()
+
+
+def _compile():
+    return authz_policy(UserRole.values, PERMISSIONS, OrderStatus.values, GRANTS)
+
+
+def get_policy():
+    """Return the process-wide policy, compiling GRANTS on first use."""
+    global _policy
+    if _policy is None:
+        with _lock:
+            if _policy is None:
+                _policy = _compile()
+    return _policy
+
+
+def update_grants(grants) -> None:
+    """
+    Replace the grants of the (role, resource, action) cells named.
+
+    Only those cells are recompiled. Requests in flight keep the policy they
+    started with; later ones see the new one.
+    """
+    global _policy
+    with _lock:
+        _policy = (_policy or _compile()).replace(grants)
+
+
+def reset_policy() -> None:
+    """Drop any update_grants changes; the next check recompiles GRANTS."""
+    global _policy
+    with _lock:
+        _policy = None
+
+
+def user_roles(user) -> tuple:
+    """The policy roles of a user; superusers also act as admins."""
+    if user.is_superuser:
+        return (user.role, UserRole.ADMIN)
+    return (user.role,)
+
+
+def can(user, action: str, resource: str) -> bool:
+    """Whether an authenticated user may perform action on at least some resource objects."""
+    return get_policy().can(user_roles(user), action, resource)
+
+
+def scope_queryset(queryset, user, action: str, resource: str, state_field: str, owner_field: str | None = None):
+    """
+    Restrict a queryset to the objects the user may perform action on.
+
+    Objects are matched on their state (state_field) and, for grants limited
+    to the user's own objects, on owner_field. The user's grants are reduced
+    to two state sets once, so the database does the per-object work.
+    """
+    policy = get_policy()
+    states, own_states = policy.scope(user_roles(user), action, resource)
+    if len(states) == len(policy.states):
+        return queryset
+
+    q = Q(**{f"{state_field}__in": states}) if states else Q(pk__in=[])
+    if owner_field and own_states:
+        if len(states | own_states) == len(policy.states):
+            q |= Q(**{owner_field: user})
+        else:
+            q |= Q(**{owner_field: user, f"{state_field}__in": own_states})
+    return queryset.filter(q)
@@ -207,6 +207,8 @@ SPECTACULAR_SETTINGS = {
 }
 
 # Celery Configuration
+from celery.schedules import crontab
+
 CELERY_BROKER_URL = env("CELERY_BROKER_URL", default="redis://localhost:6379/0")
 CELERY_RESULT_BACKEND = env("CELERY_RESULT_BACKEND", default="redis://localhost:6379/0")
 CELERY_ACCEPT_CONTENT = ["json"]
@@ -224,6 +226,10 @@ CELERY_BEAT_SCHEDULE = {
         "task": "apps.billing.tasks.check_overdue_invoices",
         "schedule": 3600,  # Hourly
     },
+    "recalculate-open-invoices": {
+        "task": "apps.billing.tasks.recalculate_open_invoices",
+        "schedule": crontab(minute=0, hour=1, day_of_month=1),  # Monthly, before statements
+    },
 }
 
 # Redis Cache Configuration
@@ -249,6 +255,13 @@ MPESA_ENVIRONMENT = env("MPESA_ENVIRONMENT", default="sandbox")  # sandbox or pr
 # Security Settings
 SECURITY_LOG_REQUESTS = env.bool("SECURITY_LOG_REQUESTS", default=True)
 SECURITY_REQUEST_LOG_RETENTION_DAYS = env.int("SECURITY_REQUEST_LOG_RETENTION_DAYS", default=90)
+# Hash-chained request audit file, one per process ("{pid}" is replaced); empty disables it
+SECURITY_AUDIT_CHAIN_PATH = env("SECURITY_AUDIT_CHAIN_PATH", default="")
+SECURITY_AUDIT_CHAIN_SYNC = env.bool("SECURITY_AUDIT_CHAIN_SYNC", default=False)
+# Seconds an in-memory snapshot of the IP blocklist is trusted; 0 checks every IP against cache/DB
+SECURITY_BLOCKLIST_REFRESH = env.int("SECURITY_BLOCKLIST_REFRESH", default=30)
+# POSIX shared memory name of the host-wide native rate table (e.g. "/hospital-ratelimit"); empty uses the cache
+SECURITY_RATE_LIMIT_SHM = env("SECURITY_RATE_LIMIT_SHM", default="")
 
 # Logging
 LOGGING = {
@@ -299,6 +312,10 @@ SECURE_BROWSER_XSS_FILTER = True
 HOSPITAL_SETTINGS = {
     "ENABLE_C_MODULES": env.bool("ENABLE_C_MODULES", default=True),
     "PII_ENCRYPTION_KEY": env("PII_ENCRYPTION_KEY", default=None),
+    # Keys de-identified analytics tokens; falls back to PII_ENCRYPTION_KEY
+    "PSEUDONYMIZATION_KEY": env("PSEUDONYMIZATION_KEY", default=None),
     "AUDIT_LOG_RETENTION_DAYS": env.int("AUDIT_LOG_RETENTION_DAYS", default=2555),  # 7 years
     "MAX_APPOINTMENT_FUTURE_DAYS": env.int("MAX_APPOINTMENT_FUTURE_DAYS", default=90),
+    # Memory budget of the native parsed-HL7 cache used for result reads
+    "HL7_PARSE_CACHE_BYTES": env.int("HL7_PARSE_CACHE_BYTES", default=16 * 1024 * 1024),
 }
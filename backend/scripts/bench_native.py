@@ -0,0 +1,301 @@
+#!/usr/bin/env python
+"""
+Benchmark the native (hospital_native) path against the pure-Python fallbacks.
+
+apps.core.utils uses the C modules when C_MODULES_AVAILABLE is set and falls
+back to hashlib, secrets, `cryptography` and Python HL7 checks otherwise (or
+when a C call fails). This drives the same public helpers through both paths,
+with inputs and batch sizes taken from the endpoints that call them, and
+reports per-call latency percentiles so native work can be aimed where it pays.
+
+Usage:
+    cd backend && python scripts/bench_native.py [--iterations N] [--filter REGEX] [--json] [--out FILE]
+
+Every call is timed on its own with perf_counter_ns, GC disabled, after a
+warm-up; the timer's own overhead (measured on an empty call) is subtracted.
+Batch cases also report the cost per item.
+
+© 2025 Immanuel Njogu. All rights reserved.
+"""
+
+import argparse
+import gc
+import json
+import logging
+import os
+import platform
+import re
+import secrets
+import sys
+import time
+from decimal import Decimal
+from pathlib import Path
+from typing import Callable, NamedTuple
+
+# Add backend to path if running directly
+backend_dir = Path(__file__).resolve().parent.parent
+if str(backend_dir) not in sys.path:
+    sys.path.insert(0, str(backend_dir))
+
+os.environ.setdefault("DJANGO_SETTINGS_MODULE", "config.settings.test")
+
+import django
+
+django.setup()
+
+from django.conf import settings
+
+from apps.core import utils
+
+PAGE_SIZE = settings.REST_FRAMEWORK.get("PAGE_SIZE", 20)
+KEY = secrets.token_bytes(32)
+
+OBR_SEGMENT = (
+    "OBR|1|ORD448811|LAB99881|58410-2^CBC panel - Blood by Automated count^LN|||20240312070000|||||||"
+    "20240312071500||1234^SMITH^JOHN^A^^DR||||||20240312083000|||F"
+)
+OBX_BLOCK = "\n".join(
+    f"OBX|{i + 1}|NM|{code}^{name}^LN||{value}|{units}|{ref}|{flag}|||F"
+    for i, (code, name, value, units, ref, flag) in enumerate(
+        [
+            ("6690-2", "Leukocytes", "7.2", "10*3/uL", "4.5-11.0", "N"),
+            ("789-8", "Erythrocytes", "4.61", "10*6/uL", "4.20-5.40", "N"),
+            ("718-7", "Hemoglobin", "11.8", "g/dL", "12.0-16.0", "L"),
+            ("4544-3", "Hematocrit", "36.1", "%", "37.0-47.0", "L"),
+            ("787-2", "MCV", "88.3", "fL", "80.0-100.0", "N"),
+            ("777-3", "Platelets", "412", "10*3/uL", "150-400", "H"),
+            ("2345-7", "Glucose", "105", "mg/dL", "70-99", "H"),
+            ("2823-3", "Potassium", "4.1", "mmol/L", "3.5-5.1", "N"),
+            ("2951-2", "Sodium", "139", "mmol/L", "136-145", "N"),
+            ("2160-0", "Creatinine", "0.92", "mg/dL", "0.60-1.10", "N"),
+        ]
+    )
+)
+
+
+def _ssns(n: int) -> list[str]:
+    return [f"{100000000 + i * 7919:09d}" for i in range(n)]
+
+
+class Case(NamedTuple):
+    name: str
+    used_by: str
+    items: int
+    # Builds the call to time; run once per path so inputs come from that path
+    setup: Callable[[], Callable[[], object]]
+
+
+def _encrypt(n):
+    plaintexts = [s.encode() for s in _ssns(n)]
+    if n == 1:
+        return lambda: utils.aes_gcm_encrypt(plaintexts[0], KEY)
+    return lambda: utils.aes_gcm_encrypt_many(plaintexts, KEY)
+
+
+def _decrypt(n):
+    ciphertexts = utils.aes_gcm_encrypt_many([s.encode() for s in _ssns(n)], KEY)
+    if n == 1:
+        return lambda: utils.aes_gcm_decrypt(ciphertexts[0], KEY)
+    return lambda: utils.aes_gcm_decrypt_many(ciphertexts, KEY)
+
+
+def _hash(n):
+    ssns = _ssns(n)
+    if n == 1:
+        data = ssns[0].encode()
+        return lambda: utils.sha256_hash(data)
+    return lambda: utils.sha256_hex_many(ssns)
+
+
+def _tokens(n):
+    if n == 1:
+        return utils.generate_pii_token
+    return lambda: utils.generate_pii_tokens(n)
+
+
+def _invoices(n):
+    # Six lines per invoice, as the month-end job fetches them (item order, not invoice order)
+    invoices = [(Decimal(i % 900) / 100, Decimal(i % 500) / 100, Decimal(0)) for i in range(n)]
+    items = [((k * 7919) % n, 1 + k % 4, Decimal(100 + k % 90000) / 100) for k in range(n * 6)]
+    return lambda: utils.invoice_totals(invoices, items)
+
+
+def _authz(n):
+    from apps.lab_orders.models import OrderStatus
+    from apps.users.models import UserRole
+    from apps.users.policy import GRANTS, PERMISSIONS
+
+    policy = utils.authz_policy(UserRole.values, PERMISSIONS, OrderStatus.values, GRANTS)
+    if n == 1:
+        return lambda: policy.can(("DOCTOR",), "create", "lab_order")
+    # A doctor filtering orders by status and owner, a third of them their own
+    states = [OrderStatus.values[i % len(OrderStatus.values)] for i in range(n)]
+    owners = [i % 3 for i in range(n)]
+    return lambda: policy.filter(("DOCTOR",), "view", "lab_order", states, owners, 0)
+
+
+CASES = [
+    Case("aes_gcm_encrypt", "Patient.set_ssn", 1, lambda: _encrypt(1)),
+    Case("aes_gcm_encrypt_many", "patient import batch", 500, lambda: _encrypt(500)),
+    Case("aes_gcm_decrypt", "Patient.get_ssn (detail view)", 1, lambda: _decrypt(1)),
+    Case("aes_gcm_decrypt_many", "Patient.get_ssn_many (list page)", PAGE_SIZE, lambda: _decrypt(PAGE_SIZE)),
+    Case("aes_gcm_decrypt_many", "Patient.get_ssn_many (export)", 1000, lambda: _decrypt(1000)),
+    Case("sha256_hash", "SSN lookup hash", 1, lambda: _hash(1)),
+    Case("sha256_hex_many", "Patient.find_by_ssn_many (import)", 500, lambda: _hash(500)),
+    Case("generate_pii_token", "PII token", 1, lambda: _tokens(1)),
+    Case("generate_pii_tokens", "bulk pseudonymization", 100, lambda: _tokens(100)),
+    Case("validate_hl7_segment", "LabResult.clean (OBR)", 1, lambda: lambda: utils.validate_hl7_segment(OBR_SEGMENT)),
+    Case("parse_hl7_message", "LabResult.clean (10 OBX)", 10, lambda: lambda: utils.parse_hl7_message(OBX_BLOCK)),
+    Case("invoice_totals", "Invoice.recalculate", 1, lambda: _invoices(1)),
+    Case("invoice_totals", "recalculate_open_invoices (batch)", 5000, lambda: _invoices(5000)),
+    Case("authz_policy.can", "CanOrderLabs.has_permission", 1, lambda: _authz(1)),
+    Case("authz_policy.filter", "lab order list page", PAGE_SIZE, lambda: _authz(PAGE_SIZE)),
+    Case("authz_policy.filter", "lab order export", 1000, lambda: _authz(1000)),
+]
+
+PERCENTILES = (50, 90, 99, 99.9)
+
+
+def _percentile(ordered: list[int], pct: float) -> int:
+    """Nearest-rank percentile of an ascending list."""
+    rank = max(1, -(-len(ordered) * pct // 100))
+    return ordered[int(rank) - 1]
+
+
+def _time_calls(fn: Callable[[], object], iterations: int) -> list[int]:
+    timer = time.perf_counter_ns
+    samples = [0] * iterations
+    for i in range(iterations):
+        start = timer()
+        fn()
+        samples[i] = timer() - start
+    return samples
+
+
+def _timer_overhead() -> int:
+    samples = sorted(_time_calls(lambda: None, 20000))
+    return samples[len(samples) // 2]
+
+
+def measure(fn: Callable[[], object], iterations: int, overhead: int) -> dict:
+    warmup = max(10, iterations // 10)
+    _time_calls(fn, warmup)
+    gc_was_enabled = gc.isenabled()
+    gc.disable()
+    try:
+        samples = _time_calls(fn, iterations)
+    finally:
+        if gc_was_enabled:
+            gc.enable()
+    ordered = sorted(max(0, s - overhead) for s in samples)
+    stats = {f"p{pct:g}": _percentile(ordered, pct) for pct in PERCENTILES}
+    stats["mean"] = sum(ordered) / len(ordered)
+    stats["max"] = ordered[-1]
+    return stats
+
+
+def run(cases: list[Case], iterations: int, native: bool) -> list[dict]:
+    overhead = _timer_overhead()
+    saved = utils.C_MODULES_AVAILABLE
+    utils.C_MODULES_AVAILABLE = native
+    try:
+        results = []
+        for case in cases:
+            # Batches are many times slower per call; keep the run time comparable
+            count = max(50, iterations // max(1, case.items // 10))
+            stats = measure(case.setup(), count, overhead)
+            results.append(
+                {
+                    "name": case.name,
+                    "used_by": case.used_by,
+                    "items": case.items,
+                    "path": "native" if native else "python",
+                    "iterations": count,
+                    "unit": "ns",
+                    **stats,
+                    "mean_per_item": stats["mean"] / case.items,
+                }
+            )
+        return results
+    finally:
+        utils.C_MODULES_AVAILABLE = saved
+
+
+def _format_ns(ns: float) -> str:
+    if ns >= 1e6:
+        return f"{ns / 1e6:.2f} ms"
+    if ns >= 1e3:
+        return f"{ns / 1e3:.1f} us"
+    return f"{ns:.0f} ns"
+
+
+def print_table(native: list[dict], python: list[dict]) -> None:
+    header = f"{'Case':<22} {'Used by':<34} {'Items':>5} {'Path':<7}"
+    header += "".join(f" {'p' + format(p, 'g'):>9}" for p in PERCENTILES) + f" {'per item':>9} {'speedup':>8}"
+    print(header)
+    print("-" * len(header))
+    for i, py in enumerate(python):
+        rows = [native[i], py] if native else [py]
+        for row in rows:
+            line = f"{row['name']:<22} {row['used_by']:<34} {row['items']:>5} {row['path']:<7}"
+            line += "".join(f" {_format_ns(row[f'p{p:g}']):>9}" for p in PERCENTILES)
+            line += f" {_format_ns(row['mean_per_item']):>9}"
+            if row is not py and py["p50"]:
+                line += f" {py['p50'] / max(row['p50'], 1):>7.1f}x"
+            print(line)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--iterations", type=int, default=5000, help="timed calls per single-item case")
+    parser.add_argument("--filter", help="only cases whose name or 'used by' matches this regex")
+    parser.add_argument("--json", action="store_true", help="print JSON instead of a table")
+    parser.add_argument("--out", help="also write the JSON results to this file")
+    args = parser.parse_args()
+
+    # A failing native call logs and falls back; keep that visible but brief
+    logging.getLogger("apps.core.utils").setLevel(logging.ERROR)
+
+    cases = CASES
+    if args.filter:
+        pattern = re.compile(args.filter)
+        cases = [c for c in CASES if pattern.search(c.name) or pattern.search(c.used_by)]
+
+    if utils.hospital_native is None:
+        # ENABLE_C_MODULES is off: still measure the native path if it is installed
+        try:
+            import hospital_native  # type: ignore[import-not-found]
+
+            utils.hospital_native = hospital_native
+        except ImportError:
+            pass
+    native_available = utils.hospital_native is not None
+    native = run(cases, args.iterations, True) if native_available else []
+    python = run(cases, args.iterations, False)
+
+    report = {
+        "context": {
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "python": platform.python_version(),
+            "implementation": platform.python_implementation(),
+            "machine": platform.machine(),
+            "native_available": native_available,
+            "page_size": PAGE_SIZE,
+        },
+        "results": native + python,
+    }
+    if args.json:
+        json.dump(report, sys.stdout, indent=2)
+        print()
+    else:
+        if not native_available:
+            print("hospital_native is not importable (or ENABLE_C_MODULES is off): Python path only\n")
+        print_table(native, python)
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(report, f, indent=2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
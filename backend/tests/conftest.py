@@ -8,6 +8,7 @@ from rest_framework.test import APIClient
 
 import pytest
 
+from apps.core import utils
 from apps.users.models import User, UserRole
 
 
@@ -17,6 +18,15 @@ def api_client():
     return APIClient()
 
 
+@pytest.fixture(params=[True, False], ids=["native", "python"])
+def native(request, monkeypatch):
+    """Run the test once on the C modules and once on the Python fallbacks of apps.core.utils."""
+    if request.param and not utils.C_MODULES_AVAILABLE:
+        pytest.skip("C modules not available")
+    monkeypatch.setattr(utils, "C_MODULES_AVAILABLE", request.param)
+    return request.param
+
+
 @pytest.fixture
 def admin_user(db):
     """Create and return an admin user."""
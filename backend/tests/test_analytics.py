@@ -184,6 +184,51 @@ class TestPatientAnalytics:
         assert "61+" in age_dist
 
 
+class TestPatientExtract:
+    """Tests for the de-identified patient extract."""
+
+    @pytest.fixture(autouse=True)
+    def pseudonymization_key(self, settings):
+        settings.HOSPITAL_SETTINGS = {**settings.HOSPITAL_SETTINGS, "PSEUDONYMIZATION_KEY": "test-pseudonym-key"}
+
+    def test_extract_replaces_identifiers(self, authenticated_admin_client, setup_analytics_data):
+        """Test that the extract carries tokens instead of MRNs."""
+        url = reverse("patient-extract")
+        response = authenticated_admin_client.get(url)
+
+        assert response.status_code == status.HTTP_200_OK
+        assert response.data["count"] == 5
+        mrns = set(Patient.objects.values_list("mrn", flat=True))
+        for row in response.data["results"]:
+            assert len(row["patient_token"]) == 64
+            assert row["patient_token"] not in mrns
+            assert "mrn" not in row
+
+    def test_extract_tokens_are_stable(self, authenticated_admin_client, setup_analytics_data):
+        """Test that tokens are identical across exports and distinct per patient."""
+        url = reverse("patient-extract")
+        first = [row["patient_token"] for row in authenticated_admin_client.get(url).data["results"]]
+        second = [row["patient_token"] for row in authenticated_admin_client.get(url).data["results"]]
+
+        assert first == second
+        assert len(set(first)) == len(first)
+
+    @pytest.mark.parametrize("params", [{"limit": "-1"}, {"offset": "-5"}, {"limit": "ten"}, {"offset": "1.5"}])
+    def test_extract_rejects_bad_paging(self, authenticated_admin_client, setup_analytics_data, params):
+        """Test that a negative or non-integer limit or offset is a 400, not a 500."""
+        url = reverse("patient-extract")
+        response = authenticated_admin_client.get(url, params)
+
+        assert response.status_code == status.HTTP_400_BAD_REQUEST
+
+    def test_extract_requires_admin(self, authenticated_doctor_client, setup_analytics_data):
+        """Test that non-admin users cannot export."""
+        url = reverse("patient-extract")
+        response = authenticated_doctor_client.get(url)
+
+        assert response.status_code == status.HTTP_403_FORBIDDEN
+
+
 class TestLabAnalytics:
     """Tests for laboratory analytics endpoint."""
 
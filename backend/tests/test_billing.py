@@ -25,6 +25,7 @@ from apps.billing.models import (
     ServiceCategory,
 )
 from apps.billing.mpesa import MpesaService
+from apps.core import utils
 from apps.patients.models import Patient
 
 
@@ -356,6 +357,79 @@ class TestInvoiceModel:
         assert test_invoice.subtotal == Decimal("1500.00")
         assert test_invoice.total_amount == Decimal("1500.00")
 
+    def test_recalculate_open_invoices(self, db, test_invoice, test_patient, admin_user):
+        """Test that the month-end job recomputes open invoices and leaves the rest alone."""
+        from apps.billing.tasks import recalculate_open_invoices
+
+        # Change a line behind the model's back
+        InvoiceItem.objects.filter(invoice=test_invoice).update(quantity=3)
+        Invoice.objects.filter(pk=test_invoice.pk).update(tax_amount=Decimal("80.00"))
+        cancelled = Invoice.objects.create(
+            patient=test_patient,
+            due_date=date.today(),
+            status=InvoiceStatus.CANCELLED,
+            created_by=admin_user,
+        )
+        Invoice.objects.filter(pk=cancelled.pk).update(subtotal=Decimal("7.00"))
+
+        result = recalculate_open_invoices(batch_size=1)
+
+        assert result == {"checked": 1, "updated": 1}
+        test_invoice.refresh_from_db()
+        assert test_invoice.subtotal == Decimal("1500.00")
+        assert test_invoice.total_amount == Decimal("1580.00")
+        assert test_invoice.balance_due == Decimal("1580.00")
+        cancelled.refresh_from_db()
+        assert cancelled.subtotal == Decimal("7.00")
+        assert recalculate_open_invoices() == {"checked": 1, "updated": 0}
+
+
+class TestInvoiceTotals:
+    """Tests for the batch invoice_totals helper (native and Python paths)."""
+
+    INVOICES = [
+        (Decimal("1.50"), Decimal("2.00"), Decimal("10.00")),
+        (Decimal("0.00"), Decimal("0.00"), Decimal("0.00"), Decimal("0.16"), Decimal("0.1")),
+        (Decimal("0.00"), Decimal("0.00"), Decimal("0.00"), Decimal("0.05")),
+        (Decimal("0.00"), Decimal("0.00"), Decimal("5.00")),
+    ]
+    ITEMS = [
+        (1, 3, Decimal("19.99")),
+        (0, 2, Decimal("25.50")),
+        (2, 1, Decimal("0.10")),
+        (0, 1, Decimal("4.99")),
+    ]
+    EXPECTED = [
+        ("55.99", "2.00", "1.50", "55.49", "45.49"),
+        # 59.97 less 10% (5.997 -> 6.00), then 16% of 53.97 (8.6352 -> 8.64)
+        ("59.97", "6.00", "8.64", "62.61", "62.61"),
+        # 5% of 0.10 is a half cent, rounded up
+        ("0.10", "0.00", "0.01", "0.11", "0.11"),
+        ("0.00", "0.00", "0.00", "0.00", "-5.00"),
+    ]
+
+    def test_totals(self, native):
+        """Test both paths give the same Decimals, exponent included."""
+        totals = utils.invoice_totals(self.INVOICES, self.ITEMS)
+
+        assert [tuple(str(amount) for amount in row) for row in totals] == [tuple(row) for row in self.EXPECTED]
+        assert totals[0].balance == Decimal("45.49")
+
+    @pytest.mark.parametrize(
+        "invoices, items, error",
+        [
+            ([(Decimal("0.001"), 0, 0)], [], ValueError),
+            ([(0.5, 0, 0)], [], TypeError),
+            ([(0, 0, 0, Decimal("1.5"))], [], ValueError),
+            ([(0, 0, 0)], [(1, 1, Decimal("1.00"))], ValueError),
+            ([(0, 0, 0)], [(0, -1, Decimal("1.00"))], ValueError),
+        ],
+    )
+    def test_invalid_input(self, native, invoices, items, error):
+        """Test both paths reject inexact amounts, floats and bad indexes alike."""
+        with pytest.raises(error):
+            utils.invoice_totals(invoices, items)
+
 
 class TestMpesaService:
     """Tests for MpesaService class."""
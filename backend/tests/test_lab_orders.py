@@ -12,6 +12,7 @@ from rest_framework import status
 
 import pytest
 
+from apps.core import utils
 from apps.lab_orders.models import (
     LabOrder,
     LabResult,
@@ -21,6 +22,7 @@ from apps.lab_orders.models import (
     TestType,
 )
 from apps.patients.models import Patient
+from apps.users.models import User, UserRole
 
 
 @pytest.fixture
@@ -191,6 +193,30 @@ class TestLabResultModel:
             )
         assert "OBX segment" in str(exc_info.value)
 
+    def test_hl7_schema_checks(self, native, lab_order, lab_tech_user):
+        """Test both paths accept comparator results and reject other non-numeric NM values alike."""
+        lab_order.transition_to(OrderStatus.COLLECTED)
+
+        assert utils.validate_hl7_segment("OBX|1|NM|GLU||<5|mg/dL")
+        assert utils.validate_hl7_segment("OBX|1|SN|GLU||>^1000|mg/dL")
+        with pytest.raises(ValueError, match="Field OBX-5 is not a valid NM value"):
+            utils.validate_hl7_segment("OBX|1|NM|GLU||7.5 H|mg/dL")
+        with pytest.raises(ValueError, match="Field OBR-4 is required"):
+            utils.validate_hl7_segment("OBR|1|12345|67890||||20231115120000")
+
+        with pytest.raises(DjangoValidationError, match="Line 2: Invalid HL7 OBX segment"):
+            LabResult.objects.create(
+                order=lab_order,
+                hl7_obx_segments="OBX|1|NM|GLU||<5|mg/dL\nOBX|2|NM|K||high|mmol/L",
+                resulted_by=lab_tech_user,
+            )
+        result = LabResult.objects.create(
+            order=lab_order,
+            hl7_obx_segments="OBX|1|NM|GLU||<5|mg/dL\nOBX|2|NM|K||>1000|mmol/L",
+            resulted_by=lab_tech_user,
+        )
+        assert result.pk is not None
+
     def test_parse_obx_values(self, lab_order, lab_tech_user):
         """Test parsing OBX segments."""
         lab_order.transition_to(OrderStatus.COLLECTED)
@@ -211,6 +237,24 @@ OBX|3|NM|HGB^Hemoglobin||14.5|g/dL|12.0-17.5|N"""
         assert parsed[0]["units"] == "10*3/uL"
         assert parsed[1]["identifier"] == "RBC^Red Blood Cell Count"
 
+    def test_parse_obx_values_independent_of_schema(self, native, lab_order, lab_tech_user):
+        """Test values are read whether or not they pass the schema checks."""
+        lab_order.transition_to(OrderStatus.COLLECTED)
+
+        result = LabResult.objects.create(
+            order=lab_order,
+            hl7_obx_segments="OBX|1|NM|GLU^Glucose||<5|mg/dL|70-99|L",
+            resulted_by=lab_tech_user,
+        )
+        # Stored before the schema accepted this value; it must still be read
+        result.hl7_obx_segments += "\nOBX|2|NM|K||7.5 H|mmol/L\nobx|3|NM|NA||139"
+
+        parsed = result.parse_obx_values()
+        assert [(r["set_id"], r["value"], r["abnormal_flag"]) for r in parsed] == [
+            ("1", "<5", "L"),
+            ("2", "7.5 H", ""),
+        ]
+
 
 @pytest.mark.django_db
 class TestLabOrderAPI:
@@ -222,6 +266,24 @@ class TestLabOrderAPI:
 
         assert response.status_code == status.HTTP_200_OK
 
+    def test_list_orders_scoped_by_role(
+        self, authenticated_doctor_client, authenticated_lab_tech_client, lab_order, sample_patient, test_type
+    ):
+        """Test doctors list only their own orders and lab techs only those still to process."""
+        other_doctor = User.objects.create_user(
+            email="other.doctor@hospital.test", password="DoctorPass123!", role=UserRole.DOCTOR
+        )
+        other_order = LabOrder.objects.create(
+            patient=sample_patient, ordering_provider=other_doctor, test_type=test_type
+        )
+        other_order.transition_to(OrderStatus.CANCELLED)
+
+        response = authenticated_doctor_client.get("/api/v1/lab/orders/")
+        assert [order["id"] for order in response.data["results"]] == [str(lab_order.id)]
+
+        response = authenticated_lab_tech_client.get("/api/v1/lab/orders/")
+        assert [order["id"] for order in response.data["results"]] == [str(lab_order.id)]
+
     def test_create_order(self, authenticated_doctor_client, sample_patient, test_type):
         """Test creating a lab order."""
         order_data = {
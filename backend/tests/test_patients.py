@@ -4,6 +4,7 @@ Tests for the patients app.
 Copyright (c) 2025, Immanuel Njogu. All rights reserved.
 """
 
+import io
 from datetime import date
 
 from django.conf import settings
@@ -80,6 +81,33 @@ class TestPatientModel:
         """Test masked SSN display."""
         assert sample_patient.ssn_masked == "XXX-XX-6789"
 
+    def test_get_ssn_many(self, sample_patient):
+        """Test batch SSN decryption, including patients without SSN and tampered data."""
+        no_ssn = Patient.objects.create(first_name="No", last_name="Ssn", date_of_birth=date(1990, 1, 1))
+        tampered = Patient(first_name="Bad", last_name="Tag", date_of_birth=date(1990, 1, 1))
+        tampered.set_ssn("987-65-4321")
+        tampered._ssn_encrypted = bytes(tampered._ssn_encrypted)[:-1] + b"\x00"
+        tampered.save()
+
+        ssns = Patient.get_ssn_many([sample_patient, no_ssn, tampered])
+        assert ssns == {sample_patient.pk: "123456789", no_ssn.pk: None, tampered.pk: None}
+        assert Patient.get_ssn_many([]) == {}
+
+    def test_rotate_pii_key(self, sample_patient, settings, monkeypatch):
+        """Test key rotation re-encrypts SSNs under the new key."""
+        from django.core.management import call_command
+
+        old_secret = settings.HOSPITAL_SETTINGS["PII_ENCRYPTION_KEY"]
+        monkeypatch.setenv("OLD_PII_ENCRYPTION_KEY", old_secret)
+        settings.HOSPITAL_SETTINGS = {**settings.HOSPITAL_SETTINGS, "PII_ENCRYPTION_KEY": "rotated-key-for-pytest"}
+        old_blob = bytes(sample_patient._ssn_encrypted)
+
+        call_command("rotate_pii_key", "--batch-size", "1", stdout=io.StringIO())
+
+        sample_patient.refresh_from_db()
+        assert bytes(sample_patient._ssn_encrypted) != old_blob
+        assert sample_patient.get_ssn() == "123456789"
+
     def test_find_by_ssn(self, sample_patient):
         """Test finding patient by SSN."""
         # Find with dashes
@@ -96,6 +124,15 @@ class TestPatientModel:
         not_found = Patient.find_by_ssn("999-99-9999")
         assert not_found is None
 
+    def test_find_by_ssn_many(self, sample_patient):
+        """Test batch SSN hashing matches set_ssn and finds existing patients."""
+        assert Patient.hash_ssn_many(["123-45-6789"]) == [sample_patient.ssn_hash]
+
+        found = Patient.find_by_ssn_many(["123-45-6789", "123 45 6789", "999-99-9999"])
+        assert found["123-45-6789"].id == sample_patient.id
+        assert found["123 45 6789"].id == sample_patient.id
+        assert found["999-99-9999"] is None
+
     def test_mrn_uniqueness(self, db):
         """Test MRN is unique."""
         patient1 = Patient.objects.create(
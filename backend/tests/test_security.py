@@ -7,8 +7,11 @@ Copyright (c) 2025, Immanuel Njogu. All rights reserved.
 from datetime import timedelta
 from unittest.mock import patch
 
+from django.contrib.auth.models import AnonymousUser
 from django.core.cache import cache
-from django.test import override_settings
+from django.core.exceptions import ImproperlyConfigured
+from django.http import HttpResponse
+from django.test import RequestFactory, override_settings
 from django.urls import reverse
 from django.utils import timezone
 
@@ -16,7 +19,7 @@ from rest_framework import status
 
 import pytest
 
-from apps.security.middleware import get_client_ip
+from apps.security.middleware import RequestLoggingMiddleware, get_client_ip
 from apps.security.models import BlockedIP, RateLimitViolation, RequestLog, SecurityEvent
 
 
@@ -249,6 +252,69 @@ class TestIPBlockingMiddleware:
         response = client.get("/health/")
         assert response.status_code == status.HTTP_200_OK
 
+    @override_settings(SECURITY_SETTINGS={"ENABLE_IP_BLOCKING": True, "ENABLE_IP_TRACKING": False})
+    def test_block_added_after_snapshot_applies(self, client, db, admin_user):
+        """A new block reaches the in-memory blocklist without waiting for a refresh."""
+        with patch("apps.security.middleware.get_client_ip") as mock_get_ip:
+            mock_get_ip.return_value = "203.0.113.7"
+            assert client.get("/health/").status_code == status.HTTP_200_OK
+
+            block = BlockedIP.objects.create(ip_address="203.0.113.7", reason="Test block", blocked_by=admin_user)
+            assert client.get("/health/").status_code == status.HTTP_403_FORBIDDEN
+
+            block.is_active = False
+            block.save()
+            assert client.get("/health/").status_code == status.HTTP_200_OK
+
+    def test_blocklist_fallback_keeps_entries(self):
+        """A failing native IpSet falls back to Python with every entry of a generator."""
+        from apps.core import utils
+
+        networks = (network for network in ["192.168.1.100", "10.0.0.0/8"])
+        with (
+            patch.object(utils, "C_MODULES_AVAILABLE", True),
+            patch.object(utils, "hospital_native", create=True) as native,
+        ):
+            native.IpSet.side_effect = RuntimeError("native failure")
+            blocklist = utils.ip_blocklist(networks)
+
+        assert "192.168.1.100" in blocklist
+        assert "10.1.2.3" in blocklist
+        assert "192.168.1.101" not in blocklist
+
+
+class TestAuditChain:
+    """Tests for the per-process audit chain settings."""
+
+    @override_settings(SECURITY_AUDIT_CHAIN_PATH="/tmp/hospital-audit.chain")
+    def test_path_without_pid_rejected(self):
+        """A path shared by every worker is a configuration error, not a per-request failure."""
+        from apps.core import utils
+
+        with pytest.raises(ImproperlyConfigured):
+            utils.audit_chain_append("entry")
+        with pytest.raises(ImproperlyConfigured):
+            RequestLoggingMiddleware(lambda request: None)
+
+    @pytest.mark.django_db
+    @override_settings(
+        SECURITY_SETTINGS={"ENABLE_IP_TRACKING": True},
+        SECURITY_LOG_REQUESTS=False,
+        SECURITY_AUDIT_CHAIN_PATH="/tmp/hospital-audit-{pid}.chain",
+    )
+    def test_chain_kept_without_request_logging(self):
+        """Turning off database request logging must not turn off the audit chain."""
+        request = RequestFactory().get("/api/v1/patients/")
+        request.user = AnonymousUser()
+        middleware = RequestLoggingMiddleware(lambda request: HttpResponse(status=200))
+
+        with patch("apps.core.utils.audit_chain_append") as append:
+            middleware(request)
+
+        append.assert_called_once()
+        assert '"path":"/api/v1/patients/"' in append.call_args.args[0]
+        assert RequestLog.objects.count() == 0
+
 
 class TestGetClientIP:
     """Tests for client IP extraction."""
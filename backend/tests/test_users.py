@@ -10,6 +10,7 @@ from rest_framework import status
 
 import pytest
 
+from apps.core import utils
 from apps.users.models import User, UserRole
 
 
@@ -189,3 +190,98 @@ class TestPermissions:
         """Test doctor denied access to admin-only routes."""
         response = authenticated_doctor_client.get("/api/v1/users/")
         assert response.status_code == status.HTTP_403_FORBIDDEN
+
+
+class TestAuthzPolicy:
+    """Tests for the authz_policy helper (native and Python paths)."""
+
+    ROLES = ["ADMIN", "DOCTOR", "LAB_TECH"]
+    PERMISSIONS = [("patient", "view"), ("lab_order", "view"), ("lab_order", "create")]
+    STATES = ["PENDING", "RESULTED", "CANCELLED"]
+    GRANTS = [
+        ("ADMIN", "patient", "view"),
+        ("ADMIN", "lab_order", "view"),
+        ("DOCTOR", "lab_order", "view", (), None),
+        ("DOCTOR", "lab_order", "create"),
+        ("LAB_TECH", "lab_order", "view", ["PENDING", "RESULTED"]),
+    ]
+
+    def _policy(self):
+        return utils.authz_policy(self.ROLES, self.PERMISSIONS, self.STATES, self.GRANTS)
+
+    def test_can(self, native):
+        """Test a permission is held by any of the user's roles."""
+        policy = self._policy()
+
+        assert policy.can("DOCTOR", "create", "lab_order")
+        assert policy.can(["LAB_TECH", "DOCTOR"], "create", "lab_order")
+        assert not policy.can("LAB_TECH", "create", "lab_order")
+        assert not policy.can("DOCTOR", "view", "patient")
+        assert not policy.can("UNKNOWN", "view", "patient")
+        assert not policy.can("ADMIN", "delete", "patient")
+
+    def test_filter(self, native):
+        """Test object-level decisions on states and owners, in one batch."""
+        policy = self._policy()
+        states = ["PENDING", "CANCELLED", "RESULTED", "CANCELLED", "UNKNOWN"]
+        owners = [7, 7, 8, None, 7]
+
+        assert policy.scope("LAB_TECH", "view", "lab_order") == (frozenset({"PENDING", "RESULTED"}), frozenset())
+        assert policy.filter("LAB_TECH", "view", "lab_order", states) == [0, 2]
+        assert policy.filter("DOCTOR", "view", "lab_order", states, owners, subject=7) == [0, 1]
+        assert policy.filter("DOCTOR", "view", "lab_order", states) == []
+        assert policy.filter(["DOCTOR", "LAB_TECH"], "view", "lab_order", states, owners, subject=7) == [0, 1, 2]
+        assert policy.filter("ADMIN", "view", "lab_order", states) == [0, 1, 2, 3]
+
+    def test_replace(self, native):
+        """Test replace changes only the cells named, on a copy."""
+        policy = self._policy()
+        updated = policy.replace([("LAB_TECH", "lab_order", "create"), ("DOCTOR", "lab_order", "view", (), ())])
+
+        assert updated.can("LAB_TECH", "create", "lab_order")
+        assert not updated.can("DOCTOR", "view", "lab_order")
+        assert updated.can("DOCTOR", "create", "lab_order")
+        assert not policy.can("LAB_TECH", "create", "lab_order")
+        assert policy.can("DOCTOR", "view", "lab_order")
+
+    @pytest.mark.parametrize(
+        "roles, grants, error",
+        [
+            (["ADMIN", "ADMIN"], [], ValueError),
+            (ROLES, [("NURSE", "patient", "view")], ValueError),
+            (ROLES, [("ADMIN", "patient", "edit")], ValueError),
+            (ROLES, [("ADMIN", "lab_order", "view", ["ARCHIVED"])], ValueError),
+            (ROLES, [("ADMIN", "lab_order")], TypeError),
+        ],
+    )
+    def test_invalid_input(self, native, roles, grants, error):
+        """Test both paths reject unknown and duplicate names alike."""
+        with pytest.raises(error):
+            utils.authz_policy(roles, self.PERMISSIONS, self.STATES, grants)
+
+
+@pytest.mark.django_db
+class TestPolicyPermissions:
+    """Tests for the hospital policy behind the DRF permission classes."""
+
+    def test_grants_match_roles(self, admin_user, doctor_user, nurse_user, lab_tech_user, receptionist_user):
+        """Test the compiled policy agrees with the User role properties."""
+        from apps.users import policy
+
+        for user in [admin_user, doctor_user, nurse_user, lab_tech_user, receptionist_user]:
+            assert policy.can(user, "create", "lab_order") == user.can_order_labs
+            assert policy.can(user, "view", "patient") == user.can_view_patients
+
+    def test_update_grants(self, authenticated_nurse_client):
+        """Test update_grants takes effect on the next request, and reset_policy undoes it."""
+        from apps.users import policy
+
+        try:
+            policy.update_grants([(UserRole.NURSE, "patient", "view", ())])
+            response = authenticated_nurse_client.get("/api/v1/patients/")
+            assert response.status_code == status.HTTP_403_FORBIDDEN
+        finally:
+            policy.reset_policy()
+
+        response = authenticated_nurse_client.get("/api/v1/patients/")
+        assert response.status_code == status.HTTP_200_OK
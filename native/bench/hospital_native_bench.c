@@ -0,0 +1,1291 @@
+/*
+ * hospital_native_bench: throughput of the cutils, hl7val, bill and authz hot paths.
+ *
+ *   hospital_native_bench [--filter REGEX] [--min-time SEC] [--repetitions N]
+ *                         [--json] [--out FILE] [--list]
+ *
+ * Every benchmark is run over a list of parameters (an input size in bytes,
+ * an item count, or a segment type), named "family/param". The iteration
+ * count is calibrated until one run takes at least --min-time, then the run
+ * is repeated and the median reported. --json prints, and --out writes, the
+ * results in the JSON layout of Google Benchmark, so its compare.py and any
+ * dashboard that reads that format can track regressions.
+ *
+ * HL7 inputs are synthetic but shaped like production traffic: ORU^R01
+ * results with MSH, PID, PV1, ORC, OBR and a CBC/BMP run of OBX segments.
+ */
+#include "../include/libauthz.h"
+#include "../include/libbill.h"
+#include "../include/libcutils.h"
+#include "../include/libhl7val.h"
+#include <errno.h>
+#include <getopt.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ---- Harness ---- */
+
+typedef struct {
+    size_t arg;           /* the benchmark's parameter */
+    uint64_t iterations;  /* set by the harness */
+    uint64_t bytes;       /* processed per iteration, set by the benchmark */
+    uint64_t items;       /* processed per iteration, set by the benchmark */
+    double real_start, cpu_start;
+    double real_time, cpu_time;  /* seconds, between bench_start and bench_stop */
+} bench_state_t;
+
+/* Runs st->iterations iterations between bench_start and bench_stop; 0 on success */
+typedef int (*bench_fn)(bench_state_t *st);
+
+typedef struct {
+    const char *name;
+    bench_fn fn;
+    const size_t *args;          /* 0-terminated; NULL for a single run with arg 0 */
+    const char *const *labels;   /* names for the args instead of their values, or NULL */
+} bench_def_t;
+
+typedef struct {
+    char name[96];
+    uint64_t iterations;
+    double real_ns, cpu_ns;      /* per iteration, median over repetitions */
+    double bytes_per_second;
+    double items_per_second;
+} bench_result_t;
+
+/* Consumes results so the compiler cannot drop the work */
+static volatile uint64_t bench_sink;
+
+static double clock_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench_start(bench_state_t *st) {
+    st->cpu_start = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    st->real_start = clock_seconds(CLOCK_MONOTONIC);
+}
+
+static void bench_stop(bench_state_t *st) {
+    st->real_time = clock_seconds(CLOCK_MONOTONIC) - st->real_start;
+    st->cpu_time = clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - st->cpu_start;
+}
+
+static int bench_fail(const char *what, const char *why) {
+    fprintf(stderr, "benchmark call failed: %s: %s\n", what, why);
+    return -1;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+#define MAX_REPETITIONS 64
+
+static int bench_measure(const bench_def_t *def, size_t arg, double min_time, int repetitions,
+                         bench_result_t *out) {
+    bench_state_t st = {.arg = arg, .iterations = 1};
+
+    /* Grow the iteration count until a run is long enough to time */
+    for (;;) {
+        if (def->fn(&st) != 0) {
+            return -1;
+        }
+        if (st.real_time >= min_time || st.iterations >= (1ull << 40)) {
+            break;
+        }
+        double scale = st.real_time > 0 ? min_time * 1.4 / st.real_time : 100.0;
+        if (scale > 100.0) {
+            scale = 100.0;
+        } else if (scale < 2.0) {
+            scale = 2.0;
+        }
+        st.iterations = (uint64_t)((double)st.iterations * scale);
+    }
+
+    double real[MAX_REPETITIONS], cpu[MAX_REPETITIONS];
+    real[0] = st.real_time;
+    cpu[0] = st.cpu_time;
+    for (int r = 1; r < repetitions; r++) {
+        if (def->fn(&st) != 0) {
+            return -1;
+        }
+        real[r] = st.real_time;
+        cpu[r] = st.cpu_time;
+    }
+    qsort(real, (size_t)repetitions, sizeof(double), compare_double);
+    qsort(cpu, (size_t)repetitions, sizeof(double), compare_double);
+    double real_time = real[repetitions / 2];
+    double cpu_time = cpu[repetitions / 2];
+
+    out->iterations = st.iterations;
+    out->real_ns = real_time * 1e9 / (double)st.iterations;
+    out->cpu_ns = cpu_time * 1e9 / (double)st.iterations;
+    out->bytes_per_second = st.bytes && real_time > 0 ? (double)(st.bytes * st.iterations) / real_time : 0;
+    out->items_per_second = st.items && real_time > 0 ? (double)(st.items * st.iterations) / real_time : 0;
+    return 0;
+}
+
+/* ---- Inputs ---- */
+
+static const size_t crypto_sizes[] = {16, 64, 256, 1024, 4096, 16384, 65536, 0};
+static const size_t hash_sizes[] = {16, 64, 256, 1024, 4096, 65536, 0};
+static const size_t batch_counts[] = {16, 256, 4096, 0};
+static const size_t obx_counts[] = {1, 10, 50, 0};
+static const size_t record_counts[] = {64, 1024, 0};
+static const size_t buffer_sizes[] = {1 << 20, 16 << 20, 0};
+static const size_t key_counts[] = {1, 4096, 0};
+static const size_t invoice_counts[] = {1024, 32768, 0};
+static const size_t object_counts[] = {1024, 65536, 0};
+
+static uint8_t bench_key[CUTILS_AES_KEY_SIZE];
+static uint8_t *bench_data;  /* BENCH_DATA_SIZE random bytes */
+#define BENCH_DATA_SIZE (64 * 1024)
+
+typedef struct {
+    const char *code, *name, *value, *units, *range, *flag;
+} obx_row_t;
+
+/* A CBC followed by a basic metabolic panel, as a lab system sends them */
+static const obx_row_t obx_rows[] = {
+    {"6690-2", "Leukocytes [#/volume] in Blood", "7.2", "10*3/uL", "4.5-11.0", "N"},
+    {"789-8", "Erythrocytes [#/volume] in Blood", "4.61", "10*6/uL", "4.20-5.40", "N"},
+    {"718-7", "Hemoglobin [Mass/volume] in Blood", "11.8", "g/dL", "12.0-16.0", "L"},
+    {"4544-3", "Hematocrit [Volume Fraction] of Blood", "36.1", "%", "37.0-47.0", "L"},
+    {"787-2", "MCV [Entitic volume]", "88.3", "fL", "80.0-100.0", "N"},
+    {"777-3", "Platelets [#/volume] in Blood", "412", "10*3/uL", "150-400", "H"},
+    {"2345-7", "Glucose [Mass/volume] in Serum or Plasma", "105", "mg/dL", "70-99", "H"},
+    {"2823-3", "Potassium [Moles/volume] in Serum or Plasma", "4.1", "mmol/L", "3.5-5.1", "N"},
+    {"2951-2", "Sodium [Moles/volume] in Serum or Plasma", "139", "mmol/L", "136-145", "N"},
+    {"2160-0", "Creatinine [Mass/volume] in Serum or Plasma", "0.92", "mg/dL", "0.60-1.10", "N"},
+};
+#define OBX_ROW_COUNT (sizeof(obx_rows) / sizeof(obx_rows[0]))
+
+static const char *const bench_segments[] = {
+    "MSH|^~\\&|LIS|GENHOSP|EHR|GENHOSP|20240312083015||ORU^R01^ORU_R01|MSG00012345|P|2.5.1|||AL|NE",
+    "PID|1||000123456^^^GENHOSP^MR~999123456^^^USSSA^SS||DOE^JANE^A^^MS^^L||19750412|F|||"
+    "123 MAIN ST^APT 4B^SPRINGFIELD^IL^62701^USA^H||^PRN^PH^^1^217^5551234|||M||ACC0001234",
+    "PV1|1|I|4W^412^B^GENHOSP||||1234^SMITH^JOHN^A^^DR|||MED||||7|||1234^SMITH^JOHN^A^^DR|IN|"
+    "VIS0098765|||||||||||||||||||||||||20240311143000",
+    "ORC|RE|ORD448811|LAB99881||CM||||20240312070000|||1234^SMITH^JOHN^A^^DR",
+    "OBR|1|ORD448811|LAB99881|58410-2^CBC panel - Blood by Automated count^LN|||20240312070000|||||||"
+    "20240312071500||1234^SMITH^JOHN^A^^DR||||||20240312083000|||F",
+    "OBX|3|NM|718-7^Hemoglobin [Mass/volume] in Blood^LN||11.8|g/dL|12.0-16.0|L|||F|||20240312080000",
+};
+static const char *const segment_labels[] = {"MSH", "PID", "PV1", "ORC", "OBR", "OBX", NULL};
+static const size_t segment_args[] = {1, 2, 3, 4, 5, 6, 0};  /* 1-based: 0 ends the list */
+
+/* Append an ORU^R01 message with obx_count results; returns its length, 0 if it does not fit */
+static size_t build_message(char *buf, size_t cap, size_t obx_count, unsigned int id) {
+    size_t n = 0;
+    int w = snprintf(buf, cap,
+                     "MSH|^~\\&|LIS|GENHOSP|EHR|GENHOSP|20240312083015||ORU^R01^ORU_R01|MSG%08u|P|2.5.1|||AL|NE\r"
+                     "%s\r%s\r%s\r%s\r",
+                     id, bench_segments[1], bench_segments[2], bench_segments[3], bench_segments[4]);
+    if (w < 0 || (size_t)w >= cap) {
+        return 0;
+    }
+    n = (size_t)w;
+    for (size_t i = 0; i < obx_count; i++) {
+        const obx_row_t *r = &obx_rows[(i + id) % OBX_ROW_COUNT];
+        w = snprintf(buf + n, cap - n, "OBX|%zu|NM|%s^%s^LN||%s|%s|%s|%s|||F|||20240312080000\r", i + 1, r->code,
+                     r->name, r->value, r->units, r->range, r->flag);
+        if (w < 0 || (size_t)w >= cap - n) {
+            return 0;
+        }
+        n += (size_t)w;
+    }
+    return n;
+}
+
+#define MESSAGE_CAP (64 * 1024)
+
+/* ---- cutils ---- */
+
+static int bm_aes_gcm(bench_state_t *st, int encrypt) {
+    size_t len = st->arg;
+    uint8_t *ct = malloc(len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE);
+    uint8_t *out = malloc(len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE);
+    size_t ct_len = len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE;
+    int ret = -1;
+
+    if (!ct || !out || cutils_aes_gcm_encrypt(bench_data, len, bench_key, ct, &ct_len) != CUTILS_SUCCESS) {
+        goto cleanup;
+    }
+    st->bytes = len;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        size_t out_len = len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE;
+        int rc = encrypt ? cutils_aes_gcm_encrypt(bench_data, len, bench_key, out, &out_len)
+                         : cutils_aes_gcm_decrypt(ct, ct_len, bench_key, out, &out_len);
+        if (rc != CUTILS_SUCCESS) {
+            ret = bench_fail(encrypt ? "aes_gcm_encrypt" : "aes_gcm_decrypt", cutils_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += out[0];
+    ret = 0;
+
+cleanup:
+    free(out);
+    free(ct);
+    return ret;
+}
+
+static int bm_aes_gcm_encrypt(bench_state_t *st) {
+    return bm_aes_gcm(st, 1);
+}
+
+static int bm_aes_gcm_decrypt(bench_state_t *st) {
+    return bm_aes_gcm(st, 0);
+}
+
+/* Key handle, as AesKey and the field encryption layer use it */
+static int bm_key_encrypt(bench_state_t *st) {
+    size_t len = st->arg;
+    uint8_t *out = malloc(len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE);
+    cutils_key_t *key = NULL;
+    int ret = -1;
+
+    if (!out || cutils_key_new(bench_key, &key) != CUTILS_SUCCESS) {
+        goto cleanup;
+    }
+    st->bytes = len;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        size_t out_len = len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE;
+        int rc = cutils_key_encrypt(key, bench_data, len, out, &out_len);
+        if (rc != CUTILS_SUCCESS) {
+            ret = bench_fail("key_encrypt", cutils_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += out[0];
+    ret = 0;
+
+cleanup:
+    cutils_key_free(key);
+    free(out);
+    return ret;
+}
+
+/* A batch of SSN-sized records through one key handle */
+static int bm_key_encrypt_many(bench_state_t *st) {
+    size_t count = st->arg;
+    cutils_buf_t *inputs = calloc(count, sizeof(*inputs));
+    cutils_batch_result_t *results = calloc(count, sizeof(*results));
+    cutils_key_t *key = NULL;
+    uint8_t *arena = NULL;
+    int ret = -1;
+
+    if (!inputs || !results || cutils_key_new(bench_key, &key) != CUTILS_SUCCESS) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < count; i++) {
+        inputs[i].data = bench_data + (i * 16) % (BENCH_DATA_SIZE - 16);
+        inputs[i].len = 11;
+    }
+    size_t arena_size = cutils_aes_gcm_batch_size(1, inputs, count);
+    arena = malloc(arena_size);
+    if (!arena) {
+        goto cleanup;
+    }
+    st->bytes = count * 11;
+    st->items = count;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_key_encrypt_many(key, inputs, count, arena, arena_size, results);
+        if (rc != CUTILS_SUCCESS) {
+            ret = bench_fail("key_encrypt_many", cutils_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += arena[0];
+    ret = 0;
+
+cleanup:
+    free(arena);
+    cutils_key_free(key);
+    free(results);
+    free(inputs);
+    return ret;
+}
+
+static int bm_sha256(bench_state_t *st) {
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    st->bytes = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_sha256(bench_data, st->arg, digest);
+        if (rc != CUTILS_SUCCESS) {
+            return bench_fail("sha256", cutils_error_string(rc));
+        }
+    }
+    bench_stop(st);
+    bench_sink += digest[0];
+    return 0;
+}
+
+/* Salted identifier hashing, as sha256_hex_many does it */
+static int bm_sha256_many(bench_state_t *st) {
+    size_t count = st->arg;
+    cutils_buf_t *inputs = calloc(count, sizeof(*inputs));
+    uint8_t *digests = malloc(count * CUTILS_SHA256_SIZE);
+    int ret = -1;
+
+    if (!inputs || !digests) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < count; i++) {
+        inputs[i].data = bench_data + (i * 16) % (BENCH_DATA_SIZE - 16);
+        inputs[i].len = 9;
+    }
+    st->items = count;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_sha256_many(inputs, count, bench_key, 16, digests);
+        if (rc != CUTILS_SUCCESS) {
+            ret = bench_fail("sha256_many", cutils_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += digests[0];
+    ret = 0;
+
+cleanup:
+    free(digests);
+    free(inputs);
+    return ret;
+}
+
+static int bm_pseudonymize_many(bench_state_t *st) {
+    size_t count = st->arg;
+    cutils_buf_t *inputs = calloc(count, sizeof(*inputs));
+    uint8_t *digests = malloc(count * CUTILS_SHA256_SIZE);
+    cutils_pseudonymizer_t *ps = NULL;
+    int ret = -1;
+
+    if (!inputs || !digests || cutils_pseudonymizer_new(bench_key, sizeof(bench_key), &ps) != CUTILS_SUCCESS) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < count; i++) {
+        inputs[i].data = bench_data + (i * 16) % (BENCH_DATA_SIZE - 16);
+        inputs[i].len = 9;
+    }
+    st->items = count;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_pseudonymize_many(ps, inputs, count, digests, 1);
+        if (rc != CUTILS_SUCCESS) {
+            ret = bench_fail("pseudonymize_many", cutils_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += digests[0];
+    ret = 0;
+
+cleanup:
+    cutils_pseudonymizer_free(ps);
+    free(digests);
+    free(inputs);
+    return ret;
+}
+
+static int bm_xxh3_64(bench_state_t *st) {
+    uint64_t h = 0;
+    st->bytes = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        h += cutils_xxh3_64(bench_data, st->arg, i);
+    }
+    bench_stop(st);
+    bench_sink += h;
+    return 0;
+}
+
+static int bm_xxh3_128(bench_state_t *st) {
+    uint64_t h = 0;
+    st->bytes = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        h += cutils_xxh3_128(bench_data, st->arg, i).low;
+    }
+    bench_stop(st);
+    bench_sink += h;
+    return 0;
+}
+
+static int bm_hex_encode(bench_state_t *st) {
+    char *out = malloc(st->arg * 2 + 1);
+    if (!out) {
+        return bench_fail("hex_encode", "out of memory");
+    }
+    st->bytes = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        cutils_hex_encode(bench_data, st->arg, out);
+    }
+    bench_stop(st);
+    bench_sink += (uint8_t)out[0];
+    free(out);
+    return 0;
+}
+
+static int bm_hex_decode(bench_state_t *st) {
+    char *hex = malloc(st->arg * 2 + 1);
+    uint8_t *out = malloc(st->arg);
+    int ret = -1;
+
+    if (!hex || !out) {
+        goto cleanup;
+    }
+    cutils_hex_encode(bench_data, st->arg, hex);
+    st->bytes = st->arg * 2;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_hex_decode_len(hex, st->arg * 2, out, NULL);
+        if (rc != CUTILS_SUCCESS) {
+            ret = bench_fail("hex_decode", cutils_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += out[0];
+    ret = 0;
+
+cleanup:
+    free(out);
+    free(hex);
+    return ret;
+}
+
+static int bm_generate_token(bench_state_t *st) {
+    uint8_t token[CUTILS_TOKEN_SIZE];
+    st->bytes = CUTILS_TOKEN_SIZE;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_generate_token(token);
+        if (rc != CUTILS_SUCCESS) {
+            return bench_fail("generate_token", cutils_error_string(rc));
+        }
+    }
+    bench_stop(st);
+    bench_sink += token[0];
+    return 0;
+}
+
+static int bm_random_bytes(bench_state_t *st) {
+    uint8_t *out = malloc(st->arg);
+    if (!out) {
+        return bench_fail("random_bytes", "out of memory");
+    }
+    st->bytes = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = cutils_random_bytes(out, st->arg);
+        if (rc != CUTILS_SUCCESS) {
+            free(out);
+            return bench_fail("random_bytes", cutils_error_string(rc));
+        }
+    }
+    bench_stop(st);
+    bench_sink += out[0];
+    free(out);
+    return 0;
+}
+
+/* Hits spread over arg client keys, as from that many addresses on one route */
+static int bm_ratelimit_hit(bench_state_t *st) {
+    cutils_ratelimit_t *rl;
+    int rc = cutils_ratelimit_open(NULL, 0, &rl);
+    if (rc != CUTILS_SUCCESS) {
+        return bench_fail("ratelimit_open", cutils_error_string(rc));
+    }
+    char (*keys)[48] = malloc(st->arg * sizeof(*keys));
+    if (!keys) {
+        cutils_ratelimit_close(rl);
+        return bench_fail("ratelimit_hit", "out of memory");
+    }
+    for (size_t k = 0; k < st->arg; k++) {
+        snprintf(keys[k], sizeof(keys[k]), "10.%zu.%zu.%zu|/api/v1/auth/login/", k >> 16, (k >> 8) & 255, k & 255);
+    }
+
+    uint64_t denied = 0;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        const char *key = keys[i % st->arg];
+        uint64_t retry;
+        cutils_ratelimit_hit(rl, (const uint8_t*)key, strlen(key), 1000000, 1000000000, &retry);
+        denied += retry != 0;
+    }
+    bench_stop(st);
+    bench_sink += denied;
+    free(keys);
+    cutils_ratelimit_close(rl);
+    return 0;
+}
+
+/* Lookups of random IPv4 addresses in a set of arg networks, /16 to /32 */
+static int bm_ipset_contains(bench_state_t *st) {
+    cutils_ipset_t *set;
+    int rc = cutils_ipset_new(&set);
+    if (rc != CUTILS_SUCCESS) {
+        return bench_fail("ipset_new", cutils_error_string(rc));
+    }
+    for (size_t k = 0; k < st->arg; k++) {
+        const uint8_t *net = bench_data + (k * 5) % (BENCH_DATA_SIZE - 5);
+        rc = cutils_ipset_add(set, net, 4, 16 + net[4] % 17);
+        if (rc != CUTILS_SUCCESS) {
+            cutils_ipset_free(set);
+            return bench_fail("ipset_add", cutils_error_string(rc));
+        }
+    }
+
+    uint64_t found = 0;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int hit;
+        cutils_ipset_contains(set, bench_data + (i * 4) % (BENCH_DATA_SIZE - 4), 4, &hit);
+        found += (uint64_t)hit;
+    }
+    bench_stop(st);
+    bench_sink += found;
+    cutils_ipset_free(set);
+    return 0;
+}
+
+/* ---- hl7val ---- */
+
+static int bm_validate_segment(bench_state_t *st) {
+    const char *seg = bench_segments[st->arg - 1];
+    size_t len = strlen(seg);
+    char error[256];
+
+    st->bytes = len;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_validate_segment(seg, len, error);
+        if (rc != HL7VAL_SUCCESS) {
+            return bench_fail("validate_segment", error);
+        }
+    }
+    bench_stop(st);
+    return 0;
+}
+
+static int bm_parse_segment(bench_state_t *st) {
+    const char *seg = bench_segments[st->arg - 1];
+    size_t len = strlen(seg);
+    hl7val_segment_t *index = malloc(sizeof(*index));
+    if (!index) {
+        return bench_fail("parse_segment", "out of memory");
+    }
+
+    st->bytes = len;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_parse_segment(seg, len, index);
+        if (rc != HL7VAL_SUCCESS) {
+            free(index);
+            return bench_fail("parse_segment", hl7val_error_string(rc));
+        }
+    }
+    bench_stop(st);
+    bench_sink += index->field_count;
+    free(index);
+    return 0;
+}
+
+/* PID-5 (patient name): the lookup behind extract_hl7_field */
+static int bm_field_view(bench_state_t *st) {
+    const char *pid = bench_segments[1];
+    size_t len = strlen(pid);
+    hl7val_view_t view = {0};
+
+    st->bytes = len;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_field_view(pid, len, 5, NULL, &view);
+        if (rc != HL7VAL_SUCCESS) {
+            return bench_fail("field_view", hl7val_error_string(rc));
+        }
+    }
+    bench_stop(st);
+    bench_sink += view.len;
+    return 0;
+}
+
+/* PID-3, -5, -7, -8 and -18 in one scan */
+static int bm_extract_fields(bench_state_t *st) {
+    static const int fields[] = {3, 5, 7, 8, 18};
+    const char *pid = bench_segments[1];
+    size_t len = strlen(pid);
+    hl7val_view_t views[5];
+
+    st->bytes = len;
+    st->items = 5;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_extract_fields(pid, len, fields, 5, NULL, views);
+        if (rc != HL7VAL_SUCCESS) {
+            return bench_fail("extract_fields", hl7val_error_string(rc));
+        }
+    }
+    bench_stop(st);
+    bench_sink += views[4].len;
+    return 0;
+}
+
+static int bm_validate_message(bench_state_t *st) {
+    char *msg = malloc(MESSAGE_CAP);
+    size_t len = msg ? build_message(msg, MESSAGE_CAP, st->arg, 1) : 0;
+    char error[256];
+    int ret = -1;
+
+    if (!len) {
+        goto cleanup;
+    }
+    st->bytes = len;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_validate_message(msg, len, error);
+        if (rc != HL7VAL_SUCCESS) {
+            ret = bench_fail("validate_message", error);
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    ret = 0;
+
+cleanup:
+    free(msg);
+    return ret;
+}
+
+static int bm_parse_message(bench_state_t *st) {
+    char *msg = malloc(MESSAGE_CAP);
+    size_t len = msg ? build_message(msg, MESSAGE_CAP, st->arg, 1) : 0;
+    hl7val_segment_result_t results[64];
+    size_t count = 0;
+    int ret = -1;
+
+    if (!len) {
+        goto cleanup;
+    }
+    st->bytes = len;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_parse_message(msg, len, results, 64, &count);
+        if (rc != HL7VAL_SUCCESS) {
+            ret = bench_fail("parse_message", hl7val_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += count;
+    ret = 0;
+
+cleanup:
+    free(msg);
+    return ret;
+}
+
+/* Cache hit plus an OBX-5 lookup per segment: re-reading a stored result */
+static int bm_cache_fields(bench_state_t *st) {
+    char *msg = malloc(MESSAGE_CAP);
+    size_t len = msg ? build_message(msg, MESSAGE_CAP, st->arg, 1) : 0;
+    hl7val_cache_t *cache = NULL;
+    int ret = -1;
+
+    if (!len || hl7val_cache_new(0, &cache) != HL7VAL_SUCCESS) {
+        goto cleanup;
+    }
+    st->bytes = len;
+    st->items = 1;
+    uint64_t total = 0;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        const hl7val_message_index_t *index;
+        int rc = hl7val_cache_get(cache, msg, len, NULL, &index);
+        if (rc != HL7VAL_SUCCESS) {
+            ret = bench_fail("cache_get", hl7val_error_string(rc));
+            goto cleanup;
+        }
+        for (size_t s = 0; s < index->segment_count; s++) {
+            hl7val_span_t span;
+            if (hl7val_index_field(index, s, 5, &span) == HL7VAL_SUCCESS) {
+                total += span.len;
+            }
+        }
+    }
+    bench_stop(st);
+    bench_sink += total;
+    ret = 0;
+
+cleanup:
+    hl7val_cache_free(cache);
+    free(msg);
+    return ret;
+}
+
+static void mllp_count(void *ctx, const char *message, size_t message_len, int status, const char *error_msg) {
+    (void)message;
+    (void)message_len;
+    (void)status;
+    (void)error_msg;
+    (*(uint64_t*)ctx)++;
+}
+
+/* One frame per receive buffer, delivered without copying */
+static int bm_mllp_feed(bench_state_t *st) {
+    char *frame = malloc(MESSAGE_CAP + 3);
+    size_t len = frame ? build_message(frame + 1, MESSAGE_CAP, st->arg, 1) : 0;
+    hl7val_mllp_t *mllp = NULL;
+    uint64_t frames = 0;
+    int ret = -1;
+
+    if (!len || hl7val_mllp_new(0, mllp_count, &frames, &mllp) != HL7VAL_SUCCESS) {
+        goto cleanup;
+    }
+    frame[0] = HL7VAL_MLLP_START_BLOCK;
+    frame[len + 1] = HL7VAL_MLLP_END_BLOCK;
+    frame[len + 2] = '\r';
+    st->bytes = len + 3;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_mllp_feed(mllp, frame, len + 3);
+        if (rc != 1) {
+            ret = bench_fail("mllp_feed", hl7val_error_string(rc < 0 ? rc : HL7VAL_ERR_INVALID_FMT));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    bench_sink += frames;
+    hl7val_mllp_stats_t stats;
+    hl7val_mllp_get_stats(mllp, &stats);
+    if (stats.invalid || stats.dropped) {
+        ret = bench_fail("mllp_feed", "frames were rejected");
+        goto cleanup;
+    }
+    ret = 0;
+
+cleanup:
+    hl7val_mllp_free(mllp);
+    free(frame);
+    return ret;
+}
+
+/* A batch file of ten-result messages, validated on one thread */
+static int bm_validate_buffer(bench_state_t *st) {
+    char *data = malloc(st->arg + MESSAGE_CAP);
+    size_t len = 0;
+    hl7val_file_report_t report;
+    int ret = -1;
+
+    if (!data) {
+        return bench_fail("validate_buffer", "out of memory");
+    }
+    for (unsigned int id = 1; len < st->arg; id++) {
+        len += build_message(data + len, MESSAGE_CAP, 10, id);
+    }
+    st->bytes = len;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_validate_buffer(data, len, 1, NULL, 0, &report);
+        if (rc != HL7VAL_SUCCESS) {
+            ret = bench_fail("validate_buffer", hl7val_error_string(rc));
+            goto cleanup;
+        }
+    }
+    bench_stop(st);
+    st->items = report.segments;
+    ret = 0;
+
+cleanup:
+    free(data);
+    return ret;
+}
+
+/* Stored OBX texts (ten results each) to columns on one thread */
+static int bm_obx_columns(bench_state_t *st) {
+    size_t count = st->arg;
+    hl7val_view_t *texts = calloc(count, sizeof(*texts));
+    char *data = malloc(count * 2048);
+    hl7val_obx_columns_t cols = {0};
+    int ret = -1;
+
+    if (!texts || !data) {
+        goto cleanup;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        char *text = data + used;
+        size_t n = 0;
+        for (size_t r = 0; r < 10; r++) {
+            const obx_row_t *row = &obx_rows[(r + i) % OBX_ROW_COUNT];
+            n += (size_t)snprintf(text + n, 2048 - n, "OBX|%zu|NM|%s^%s^LN||%s|%s|%s|%s|||F\r", r + 1, row->code,
+                                  row->name, row->value, row->units, row->range, row->flag);
+        }
+        texts[i].data = text;
+        texts[i].len = n;
+        used += n;
+    }
+    st->bytes = used;
+    st->items = count * 10;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = hl7val_obx_columns(texts, count, 1, &cols);
+        if (rc != HL7VAL_SUCCESS) {
+            ret = bench_fail("obx_columns", hl7val_error_string(rc));
+            goto cleanup;
+        }
+        bench_sink += cols.rows;
+        hl7val_obx_columns_free(&cols);
+    }
+    bench_stop(st);
+    ret = 0;
+
+cleanup:
+    free(data);
+    free(texts);
+    return ret;
+}
+
+/* ---- bill ---- */
+
+#define BENCH_ITEMS_PER_INVOICE 6
+
+/* Month-end re-billing: arg invoices of six lines each, lines in query (not invoice) order */
+static int bm_bill_totals(bench_state_t *st) {
+    size_t item_count = st->arg * BENCH_ITEMS_PER_INVOICE;
+    bill_invoice_t *invoices = calloc(st->arg, sizeof(*invoices));
+    bill_item_t *items = malloc(item_count * sizeof(*items));
+    bill_totals_t *totals = malloc(st->arg * sizeof(*totals));
+    int ret = -1;
+    if (!invoices || !items || !totals) {
+        ret = bench_fail("bill_totals", "out of memory");
+        goto cleanup;
+    }
+    for (size_t i = 0; i < st->arg; i++) {
+        invoices[i] = (bill_invoice_t){.tax = (int64_t)(i % 900), .discount = (int64_t)(i % 500),
+                                       .paid = i % 3 ? 0 : 10000, .tax_rate = i % 2 ? 160000 : 0};
+    }
+    for (size_t k = 0; k < item_count; k++) {
+        const uint8_t *r = bench_data + (k * 4) % (BENCH_DATA_SIZE - 4);
+        items[k] = (bill_item_t){.invoice = (uint32_t)((k * 2654435761u) % st->arg), .quantity = 1u + r[0] % 10,
+                                 .unit_price = (int64_t)(r[1] | r[2] << 8 | (r[3] & 0x0f) << 16)};
+    }
+
+    st->items = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        int rc = bill_totals(invoices, st->arg, items, item_count, totals);
+        if (rc != BILL_SUCCESS) {
+            ret = bench_fail("bill_totals", bill_error_string(rc));
+            goto cleanup;
+        }
+        bench_sink += (uint64_t)totals[i % st->arg].balance;
+    }
+    bench_stop(st);
+    ret = 0;
+
+cleanup:
+    free(totals);
+    free(items);
+    free(invoices);
+    return ret;
+}
+
+/* ---- authz ---- */
+
+#define BENCH_ROLES       5
+#define BENCH_PERMISSIONS 32
+#define BENCH_STATES      6
+
+/* Every role holds every other permission, on all states or on its own objects in some */
+static authz_policy_t* bench_policy(void) {
+    authz_policy_t *policy;
+    if (authz_policy_new(BENCH_ROLES, BENCH_PERMISSIONS, &policy) != AUTHZ_SUCCESS) {
+        return NULL;
+    }
+    for (uint32_t p = 0; p < BENCH_PERMISSIONS; p++) {
+        for (uint32_t r = 0; r < BENCH_ROLES; r++) {
+            authz_grant_t grant = {r, p, 0, 0};
+            if ((p + r) % 2 == 0) {
+                grant.states = r % 3 ? AUTHZ_ALL_STATES : 0x0f;
+                grant.own_states = r % 3 ? 0 : AUTHZ_ALL_STATES;
+            }
+            authz_policy_set(policy, &grant, 1);
+        }
+    }
+    return policy;
+}
+
+static int bm_authz_can(bench_state_t *st) {
+    authz_policy_t *policy = bench_policy();
+    if (!policy) {
+        return bench_fail("authz_policy_new", "out of memory");
+    }
+    uint64_t granted = 0;
+    st->items = 1;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        granted += (uint64_t)authz_can(policy, UINT64_C(1) << (i % BENCH_ROLES), (uint32_t)(i % BENCH_PERMISSIONS));
+    }
+    bench_stop(st);
+    bench_sink += granted;
+    authz_policy_free(policy);
+    return 0;
+}
+
+/* A list endpoint's page of arg objects, a third owned by the subject, for a role with an ownership grant */
+static int bm_authz_filter(bench_state_t *st) {
+    authz_policy_t *policy = bench_policy();
+    uint8_t *states = malloc(st->arg);
+    int64_t *owners = malloc(st->arg * sizeof(*owners));
+    uint64_t *allowed = malloc(((st->arg + 63) / 64) * sizeof(*allowed));
+    int ret = -1;
+    if (!policy || !states || !owners || !allowed) {
+        ret = bench_fail("authz_filter", "out of memory");
+        goto cleanup;
+    }
+    for (size_t k = 0; k < st->arg; k++) {
+        states[k] = (uint8_t)(bench_data[k % BENCH_DATA_SIZE] % BENCH_STATES);
+        owners[k] = (int64_t)(k % 3);
+    }
+
+    st->items = st->arg;
+    bench_start(st);
+    for (uint64_t i = 0; i < st->iterations; i++) {
+        size_t count;
+        int rc = authz_filter(policy, 1, 0, 1, states, owners, st->arg, allowed, &count);
+        if (rc != AUTHZ_SUCCESS) {
+            ret = bench_fail("authz_filter", authz_error_string(rc));
+            goto cleanup;
+        }
+        bench_sink += count;
+    }
+    bench_stop(st);
+    ret = 0;
+
+cleanup:
+    free(allowed);
+    free(owners);
+    free(states);
+    authz_policy_free(policy);
+    return ret;
+}
+
+static const bench_def_t benchmarks[] = {
+    {"aes_gcm_encrypt", bm_aes_gcm_encrypt, crypto_sizes, NULL},
+    {"aes_gcm_decrypt", bm_aes_gcm_decrypt, crypto_sizes, NULL},
+    {"key_encrypt", bm_key_encrypt, crypto_sizes, NULL},
+    {"key_encrypt_many", bm_key_encrypt_many, batch_counts, NULL},
+    {"sha256", bm_sha256, hash_sizes, NULL},
+    {"sha256_many", bm_sha256_many, batch_counts, NULL},
+    {"pseudonymize_many", bm_pseudonymize_many, batch_counts, NULL},
+    {"xxh3_64", bm_xxh3_64, hash_sizes, NULL},
+    {"xxh3_128", bm_xxh3_128, hash_sizes, NULL},
+    {"hex_encode", bm_hex_encode, hash_sizes, NULL},
+    {"hex_decode", bm_hex_decode, hash_sizes, NULL},
+    {"generate_token", bm_generate_token, NULL, NULL},
+    {"random_bytes", bm_random_bytes, hash_sizes, NULL},
+    {"ratelimit_hit", bm_ratelimit_hit, key_counts, NULL},
+    {"ipset_contains", bm_ipset_contains, batch_counts, NULL},
+    {"hl7_validate_segment", bm_validate_segment, segment_args, segment_labels},
+    {"hl7_parse_segment", bm_parse_segment, segment_args, segment_labels},
+    {"hl7_field_view", bm_field_view, NULL, NULL},
+    {"hl7_extract_fields", bm_extract_fields, NULL, NULL},
+    {"hl7_validate_message", bm_validate_message, obx_counts, NULL},
+    {"hl7_parse_message", bm_parse_message, obx_counts, NULL},
+    {"hl7_cache_fields", bm_cache_fields, obx_counts, NULL},
+    {"hl7_mllp_feed", bm_mllp_feed, obx_counts, NULL},
+    {"hl7_validate_buffer", bm_validate_buffer, buffer_sizes, NULL},
+    {"hl7_obx_columns", bm_obx_columns, record_counts, NULL},
+    {"bill_totals", bm_bill_totals, invoice_counts, NULL},
+    {"authz_can", bm_authz_can, NULL, NULL},
+    {"authz_filter", bm_authz_filter, object_counts, NULL},
+};
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/* ---- Output ---- */
+
+static void format_name(const bench_def_t *def, size_t i, char *out, size_t size) {
+    if (!def->args) {
+        snprintf(out, size, "%s", def->name);
+    } else if (def->labels) {
+        snprintf(out, size, "%s/%s", def->name, def->labels[i]);
+    } else {
+        snprintf(out, size, "%s/%zu", def->name, def->args[i]);
+    }
+}
+
+static void print_console_header(void) {
+    printf("%-32s %12s %14s %14s %12s %14s\n", "Benchmark", "Iterations", "Time (ns)", "CPU (ns)", "MB/s",
+           "items/s");
+}
+
+static void print_console_row(const bench_result_t *r) {
+    printf("%-32s %12llu %14.1f %14.1f", r->name, (unsigned long long)r->iterations, r->real_ns, r->cpu_ns);
+    if (r->bytes_per_second > 0) {
+        printf(" %12.1f", r->bytes_per_second / 1e6);
+    } else {
+        printf(" %12s", "");
+    }
+    if (r->items_per_second > 0) {
+        printf(" %14.0f", r->items_per_second);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void write_json(FILE *f, const bench_result_t *results, size_t count, double min_time, int repetitions) {
+    char date[64] = "";
+    char host[256] = "";
+    time_t now = time(NULL);
+    struct tm tm;
+    if (localtime_r(&now, &tm)) {
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &tm);
+    }
+    gethostname(host, sizeof(host) - 1);
+
+    fprintf(f, "{\n  \"context\": {\n    \"date\": ");
+    json_string(f, date);
+    fprintf(f, ",\n    \"host_name\": ");
+    json_string(f, host);
+    fprintf(f, ",\n    \"executable\": \"hospital_native_bench\",\n");
+    fprintf(f, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+#ifdef NDEBUG
+    fprintf(f, "    \"library_build_type\": \"release\",\n");
+#else
+    fprintf(f, "    \"library_build_type\": \"debug\",\n");
+#endif
+    /* Instrumented builds time every call; keep their numbers apart */
+    fprintf(f, "    \"native_stats\": %s,\n", cutils_stats_enabled() ? "true" : "false");
+    fprintf(f, "    \"min_time\": %.3f,\n    \"repetitions\": %d,\n", min_time, repetitions);
+    fprintf(f, "    \"xxh3_impl\": ");
+    json_string(f, cutils_xxh3_impl());
+    fprintf(f, ",\n    \"hex_impl\": ");
+    json_string(f, cutils_hex_impl());
+    fprintf(f, ",\n    \"hl7val_scan_impl\": ");
+    json_string(f, hl7val_scan_impl());
+    fprintf(f, "\n  },\n  \"benchmarks\": [");
+
+    for (size_t i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(f, "%s\n    {\n      \"name\": ", i ? "," : "");
+        json_string(f, r->name);
+        fprintf(f, ",\n      \"run_name\": ");
+        json_string(f, r->name);
+        fprintf(f, ",\n      \"run_type\": \"iteration\",\n      \"repetitions\": %d,\n", repetitions);
+        fprintf(f, "      \"iterations\": %llu,\n", (unsigned long long)r->iterations);
+        fprintf(f, "      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n", r->real_ns, r->cpu_ns);
+        fprintf(f, "      \"time_unit\": \"ns\"");
+        if (r->bytes_per_second > 0) {
+            fprintf(f, ",\n      \"bytes_per_second\": %.1f", r->bytes_per_second);
+        }
+        if (r->items_per_second > 0) {
+            fprintf(f, ",\n      \"items_per_second\": %.1f", r->items_per_second);
+        }
+        fprintf(f, "\n    }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+/* ---- Main ---- */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--filter REGEX] [--min-time SEC] [--repetitions N] [--json] [--out FILE] [--list]\n",
+            prog);
+}
+
+/* Fail before measuring anything if the corpus does not validate */
+static int check_corpus(void) {
+    char error[256];
+    for (size_t i = 0; i < sizeof(bench_segments) / sizeof(bench_segments[0]); i++) {
+        if (hl7val_validate_segment(bench_segments[i], strlen(bench_segments[i]), error) != HL7VAL_SUCCESS) {
+            fprintf(stderr, "corpus segment %s is invalid: %s\n", segment_labels[i], error);
+            return -1;
+        }
+    }
+    char *msg = malloc(MESSAGE_CAP);
+    size_t len = msg ? build_message(msg, MESSAGE_CAP, 50, 1) : 0;
+    int rc = len ? hl7val_validate_message(msg, len, error) : HL7VAL_ERR_NO_MEMORY;
+    free(msg);
+    if (rc != HL7VAL_SUCCESS) {
+        fprintf(stderr, "corpus message is invalid: %s\n", len ? error : hl7val_error_string(rc));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"filter", required_argument, NULL, 'f'},
+        {"min-time", required_argument, NULL, 't'},
+        {"repetitions", required_argument, NULL, 'r'},
+        {"json", no_argument, NULL, 'j'},
+        {"out", required_argument, NULL, 'o'},
+        {"list", no_argument, NULL, 'l'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    const char *filter = NULL;
+    const char *out_path = NULL;
+    double min_time = 0.2;
+    int repetitions = 3;
+    int json = 0;
+    int list = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "f:t:r:jo:lh", options, NULL)) != -1) {
+        char *end;
+        switch (opt) {
+        case 'f':
+            filter = optarg;
+            break;
+        case 't':
+            errno = 0;
+            min_time = strtod(optarg, &end);
+            if (errno || *end || end == optarg || min_time < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'r':
+            errno = 0;
+            repetitions = (int)strtol(optarg, &end, 10);
+            if (errno || *end || end == optarg || repetitions < 1 || repetitions > MAX_REPETITIONS) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'j':
+            json = 1;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'l':
+            list = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind < argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    regex_t re;
+    if (filter && regcomp(&re, filter, REG_EXTENDED | REG_NOSUB) != 0) {
+        fprintf(stderr, "%s: invalid filter '%s'\n", argv[0], filter);
+        return 2;
+    }
+
+    size_t capacity = 0;
+    for (size_t b = 0; b < BENCHMARK_COUNT; b++) {
+        size_t n = 1;
+        if (benchmarks[b].args) {
+            for (n = 0; benchmarks[b].args[n]; n++) {
+            }
+        }
+        capacity += n;
+    }
+    bench_result_t *results = calloc(capacity, sizeof(*results));
+    bench_data = malloc(BENCH_DATA_SIZE);
+    if (!results || !bench_data || cutils_random_bytes(bench_key, sizeof(bench_key)) != CUTILS_SUCCESS ||
+        cutils_random_bytes(bench_data, BENCH_DATA_SIZE) != CUTILS_SUCCESS) {
+        fprintf(stderr, "%s: setup failed\n", argv[0]);
+        return 2;
+    }
+    if (!list && check_corpus() != 0) {
+        return 2;
+    }
+
+    if (!json && !list) {
+        print_console_header();
+    }
+    size_t count = 0;
+    int status = 0;
+    for (size_t b = 0; b < BENCHMARK_COUNT && status == 0; b++) {
+        const bench_def_t *def = &benchmarks[b];
+        for (size_t i = 0; def->args ? def->args[i] != 0 : i == 0; i++) {
+            bench_result_t *r = &results[count];
+            format_name(def, i, r->name, sizeof(r->name));
+            if (filter && regexec(&re, r->name, 0, NULL, 0) != 0) {
+                continue;
+            }
+            if (list) {
+                printf("%s\n", r->name);
+                continue;
+            }
+            if (bench_measure(def, def->args ? def->args[i] : 0, min_time, repetitions, r) != 0) {
+                fprintf(stderr, "%s: %s failed\n", argv[0], r->name);
+                status = 1;
+                break;
+            }
+            count++;
+            if (!json) {
+                print_console_row(r);
+            }
+        }
+    }
+
+    if (json && !list) {
+        write_json(stdout, results, count, min_time, repetitions);
+    }
+    if (out_path && !list) {
+        FILE *f = fopen(out_path, "w");
+        if (!f) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], out_path, strerror(errno));
+            status = 2;
+        } else {
+            write_json(f, results, count, min_time, repetitions);
+            if (fclose(f) != 0) {
+                fprintf(stderr, "%s: %s: %s\n", argv[0], out_path, strerror(errno));
+                status = 2;
+            }
+        }
+    }
+
+    if (filter) {
+        regfree(&re);
+    }
+    free(bench_data);
+    free(results);
+    return status;
+}
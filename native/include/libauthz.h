@@ -0,0 +1,143 @@
+#ifndef LIBAUTHZ_H
+#define LIBAUTHZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file libauthz.h
+ * @brief Role/permission policy compiled to bitsets
+ *
+ * A policy grants permissions (resource-action pairs, numbered by the
+ * caller) to roles, optionally only on objects in some states or owned by
+ * the subject asking:
+ * - A user's roles are a bitmask, so can() is one AND with the mask of
+ *   roles holding the permission
+ * - Object-level decisions for a batch of objects reduce the user's grants
+ *   to two state masks once, then test each object with a shift and AND
+ * - Grants change in place, a few cells at a time, or on a copy that
+ *   replaces the policy readers hold
+ *
+ * Thread-safe: Yes for concurrent reads; authz_policy_set needs exclusive access
+ * GIL: Not required
+ */
+
+/* Error codes */
+#define AUTHZ_SUCCESS           0
+#define AUTHZ_ERR_NULL_INPUT   -1
+#define AUTHZ_ERR_INVALID_SIZE -2   /**< Role, permission or count out of range */
+#define AUTHZ_ERR_MEMORY       -3
+
+/* Constants */
+#define AUTHZ_MAX_ROLES    64         /**< Roles are bits of a uint64_t mask */
+#define AUTHZ_MAX_STATES   64         /**< Object states are bits of a uint64_t mask */
+#define AUTHZ_ALL_STATES   UINT64_MAX
+#define AUTHZ_NO_OWNER     INT64_MIN  /**< An owner (or subject) that never matches */
+
+/** Opaque compiled policy */
+typedef struct authz_policy authz_policy_t;
+
+/**
+ * What one role may do under one permission. Both masks zero revokes it.
+ * Ownership only widens a grant: an owner may act on objects in
+ * states | own_states.
+ */
+typedef struct {
+    uint32_t role;        /**< Below the policy's role count */
+    uint32_t permission;  /**< Below the policy's permission count */
+    uint64_t states;      /**< Object states allowed whoever owns the object (AUTHZ_ALL_STATES for any) */
+    uint64_t own_states;  /**< Further states allowed on objects the subject owns */
+} authz_grant_t;
+
+/**
+ * Get error message for error code
+ *
+ * @param error_code Error code
+ * @return Static error message string
+ */
+const char* authz_error_string(int error_code);
+
+/**
+ * Create a policy granting nothing
+ *
+ * @param role_count Number of roles, 1 to AUTHZ_MAX_ROLES
+ * @param permission_count Number of permissions, at least 1
+ * @param out On success, receives the policy (free with authz_policy_free)
+ * @return AUTHZ_SUCCESS, AUTHZ_ERR_INVALID_SIZE or AUTHZ_ERR_MEMORY
+ */
+int authz_policy_new(size_t role_count, size_t permission_count, authz_policy_t **out);
+
+/**
+ * Copy a policy, e.g. to change grants without disturbing its readers
+ *
+ * @param policy Policy to copy
+ * @param out On success, receives the copy (free with authz_policy_free)
+ * @return AUTHZ_SUCCESS, AUTHZ_ERR_NULL_INPUT or AUTHZ_ERR_MEMORY
+ */
+int authz_policy_copy(const authz_policy_t *policy, authz_policy_t **out);
+
+/**
+ * Replace the grants of the (role, permission) cells named; others are kept
+ *
+ * All grants are checked before any is applied, so on error the policy is
+ * unchanged. A later grant for the same cell wins. Costs O(count).
+ *
+ * @param policy Policy to change; no other thread may use it meanwhile
+ * @param grants Grants (may be NULL if count is 0)
+ * @param count Number of grants
+ * @return AUTHZ_SUCCESS, AUTHZ_ERR_NULL_INPUT or AUTHZ_ERR_INVALID_SIZE
+ */
+int authz_policy_set(authz_policy_t *policy, const authz_grant_t *grants, size_t count);
+
+/** Free a policy (NULL is ignored) */
+void authz_policy_free(authz_policy_t *policy);
+
+/**
+ * Whether any of the roles holds the permission, on at least some objects
+ *
+ * @param policy Policy
+ * @param roles Bitmask of the user's roles; bits past the role count are ignored
+ * @param permission Permission number
+ * @return 1 or 0; 0 for a NULL policy or a permission out of range
+ */
+int authz_can(const authz_policy_t *policy, uint64_t roles, uint32_t permission);
+
+/**
+ * The object states the roles may act on under a permission
+ *
+ * An object in state s is allowed if bit s of *states is set, or if the
+ * subject owns it and bit s of *own_states is. *states == AUTHZ_ALL_STATES
+ * means every object, which list queries can use to skip filtering.
+ *
+ * @param policy Policy
+ * @param roles Bitmask of the user's roles
+ * @param permission Permission number
+ * @param states Output: states allowed on any object
+ * @param own_states Output: further states allowed on owned objects
+ * @return AUTHZ_SUCCESS, AUTHZ_ERR_NULL_INPUT or AUTHZ_ERR_INVALID_SIZE (permission)
+ */
+int authz_scope(const authz_policy_t *policy, uint64_t roles, uint32_t permission, uint64_t *states,
+                uint64_t *own_states);
+
+/**
+ * Object-level decisions for a batch of objects
+ *
+ * Object i is allowed by the authz_scope rule for its state states[i] and
+ * owner owners[i]. States of AUTHZ_MAX_STATES or more are never allowed.
+ *
+ * @param policy Policy
+ * @param roles Bitmask of the user's roles
+ * @param permission Permission number
+ * @param subject The user asking, compared with the owners (AUTHZ_NO_OWNER owns nothing)
+ * @param states State of each object (may be NULL if count is 0)
+ * @param owners Owner of each object, or NULL if the objects have no owners
+ * @param count Number of objects
+ * @param allowed Output: (count + 63) / 64 words, bit i % 64 of word i / 64 set if object i is allowed
+ * @param allowed_count Output: number of allowed objects (may be NULL)
+ * @return AUTHZ_SUCCESS, AUTHZ_ERR_NULL_INPUT or AUTHZ_ERR_INVALID_SIZE (permission)
+ */
+int authz_filter(const authz_policy_t *policy, uint64_t roles, uint32_t permission, int64_t subject,
+                 const uint8_t *states, const int64_t *owners, size_t count, uint64_t *allowed,
+                 size_t *allowed_count);
+
+#endif /* LIBAUTHZ_H */
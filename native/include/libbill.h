@@ -0,0 +1,112 @@
+#ifndef LIBBILL_H
+#define LIBBILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file libbill.h
+ * @brief Fixed-point invoice totals
+ *
+ * Computes invoice subtotals, discounts, tax, totals and balances over
+ * packed arrays of line items, in 64-bit integer minor units (cents):
+ * - Exact sums and products, with overflow reported instead of wrapped
+ * - Proportional tax and discount rounded half away from zero to the cent
+ *   (Decimal's ROUND_HALF_UP), so results match the Decimal code path
+ * - Conversion of decimal text (e.g. str(Decimal)) to and from fixed point
+ *
+ * Thread-safe: Yes (no shared state)
+ * GIL: Not required
+ */
+
+/* Error codes */
+#define BILL_SUCCESS           0
+#define BILL_ERR_NULL_INPUT   -1
+#define BILL_ERR_INVALID_SIZE -2   /**< Item of an invoice past the end, rate above BILL_RATE_SCALE, bad scale */
+#define BILL_ERR_INVALID_FMT  -3   /**< Not a decimal number, or not exact at the requested scale */
+#define BILL_ERR_OVERFLOW     -4   /**< A value does not fit in int64 minor units */
+
+/* Constants */
+#define BILL_RATE_SCALE   1000000  /**< Rates are in millionths: 160000 is 16% */
+#define BILL_MAX_SCALE    18       /**< Most fractional digits of a fixed-point value */
+#define BILL_FIXED_BUF_SIZE 24     /**< Enough for any bill_format_fixed output and its NUL */
+
+/** One invoice line: quantity x unit price, added to invoice `invoice` */
+typedef struct {
+    uint32_t invoice;      /**< Index into the invoices array */
+    uint32_t quantity;
+    int64_t unit_price;    /**< In cents */
+} bill_item_t;
+
+/** Per-invoice adjustments, all amounts in cents */
+typedef struct {
+    int64_t tax;            /**< Fixed tax, added to the proportional part */
+    int64_t discount;       /**< Fixed discount, added to the proportional part */
+    int64_t paid;           /**< Amount paid so far */
+    uint32_t tax_rate;      /**< Tax on the discounted subtotal (never below 0), in BILL_RATE_SCALE units */
+    uint32_t discount_rate; /**< Discount on the subtotal, in BILL_RATE_SCALE units */
+} bill_invoice_t;
+
+/** Computed amounts of one invoice, in cents */
+typedef struct {
+    int64_t subtotal;  /**< Sum of quantity x unit_price over the invoice's items */
+    int64_t discount;  /**< discount + round(subtotal x discount_rate) */
+    int64_t tax;       /**< tax + round(max(subtotal - discount, 0) x tax_rate) */
+    int64_t total;     /**< subtotal + tax - discount */
+    int64_t balance;   /**< total - paid */
+} bill_totals_t;
+
+/**
+ * Get error message for error code
+ *
+ * @param error_code Error code
+ * @return Static error message string
+ */
+const char* bill_error_string(int error_code);
+
+/**
+ * Compute the totals of a batch of invoices
+ *
+ * Items may come in any order and any number per invoice, including none.
+ * With zero rates this is exactly Invoice._calculate_totals:
+ * subtotal + tax_amount - discount_amount, less amount_paid.
+ *
+ * @param invoices Invoice adjustments (may be NULL if invoice_count is 0)
+ * @param invoice_count Number of invoices
+ * @param items Line items (may be NULL if item_count is 0)
+ * @param item_count Number of items
+ * @param out Output: invoice_count totals, in the order of invoices
+ * @return BILL_SUCCESS or error code; out is unspecified on error
+ */
+int bill_totals(const bill_invoice_t *invoices, size_t invoice_count, const bill_item_t *items,
+                size_t item_count, bill_totals_t *out);
+
+/**
+ * Parse decimal text into a fixed-point integer with `scale` fractional digits
+ *
+ * Accepts what str(Decimal) produces for finite values: an optional sign,
+ * digits with an optional decimal point, and an optional exponent
+ * ("12.50", "-3", "1E+2", "5.0E-1"). Digits past the scale must be zero;
+ * nothing is rounded.
+ *
+ * @param text Text (not necessarily NUL-terminated)
+ * @param len Length of text
+ * @param scale Fractional digits of the result, at most BILL_MAX_SCALE (2 for cents)
+ * @param out Output: value x 10^scale
+ * @return BILL_SUCCESS, BILL_ERR_INVALID_FMT, BILL_ERR_OVERFLOW or BILL_ERR_INVALID_SIZE (scale)
+ */
+int bill_parse_fixed(const char *text, size_t len, unsigned int scale, int64_t *out);
+
+/**
+ * Format a fixed-point integer as decimal text with exactly `scale` fractional digits
+ *
+ * @param value Value x 10^scale
+ * @param scale Fractional digits, at most BILL_MAX_SCALE
+ * @param buf Output buffer, NUL-terminated on success
+ * @param buf_size Size of buf (BILL_FIXED_BUF_SIZE always suffices)
+ * @param out_len Output: length written, excluding the NUL (may be NULL)
+ * @return BILL_SUCCESS, BILL_ERR_INVALID_SIZE (scale or buffer too small) or BILL_ERR_NULL_INPUT
+ */
+int bill_format_fixed(int64_t value, unsigned int scale, char *buf, size_t buf_size, size_t *out_len);
+
+#endif /* LIBBILL_H */
@@ -12,7 +12,7 @@
  * - AES-256-GCM encryption/decryption (via OpenSSL)
  * - SHA-256 hashing
  * - XXH3 fast hashing (for non-cryptographic needs)
- * - Random token generation for PII pseudonymization
+ * - Random token generation and keyed (HMAC-SHA256) pseudonymization
  * 
  * Thread-safe: Yes (uses thread-local OpenSSL contexts)
  * GIL: Not required during crypto operations
@@ -24,6 +24,8 @@
 #define CUTILS_ERR_INVALID_SIZE -2
 #define CUTILS_ERR_CRYPTO       -3
 #define CUTILS_ERR_BUFFER_SIZE  -4
+#define CUTILS_ERR_IO           -5  /* errno holds the cause */
+#define CUTILS_ERR_INTEGRITY    -6
 
 /* Constants */
 #define CUTILS_AES_KEY_SIZE     32  /* AES-256 */
@@ -72,6 +74,179 @@ int cutils_aes_gcm_decrypt(
     size_t *output_len
 );
 
+/**
+ * @brief Opaque AES-256-GCM key handle with a pre-expanded key schedule
+ *
+ * A handle may be shared between threads; each thread keeps its own
+ * working context and only copies the schedule when switching handles.
+ */
+typedef struct cutils_key cutils_key_t;
+
+/**
+ * @brief Create a key handle, expanding the AES key schedule once
+ *
+ * @param key 32-byte encryption key (not retained)
+ * @param out On success, receives the new handle (free with cutils_key_free)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_key_new(const uint8_t *key, cutils_key_t **out);
+
+/**
+ * @brief Destroy a key handle and wipe its key material
+ *
+ * The handle must not be in use by any other thread. NULL is ignored.
+ *
+ * @param key Handle from cutils_key_new
+ */
+void cutils_key_free(cutils_key_t *key);
+
+/**
+ * @brief Encrypt with a key handle (same format as cutils_aes_gcm_encrypt)
+ *
+ * @param key Key handle
+ * @param plaintext Input plaintext
+ * @param plaintext_len Length of plaintext
+ * @param output Output buffer (must be >= plaintext_len + 28)
+ * @param output_len On input: buffer size, on output: actual encrypted size
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_key_encrypt(
+    const cutils_key_t *key,
+    const uint8_t *plaintext,
+    size_t plaintext_len,
+    uint8_t *output,
+    size_t *output_len
+);
+
+/**
+ * @brief Decrypt with a key handle (same format as cutils_aes_gcm_decrypt)
+ *
+ * @param key Key handle
+ * @param ciphertext Input ciphertext with IV and tag
+ * @param ciphertext_len Length of ciphertext (including IV and tag)
+ * @param output Output buffer for plaintext (must be >= ciphertext_len - 28)
+ * @param output_len On input: buffer size, on output: actual plaintext size
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_key_decrypt(
+    const cutils_key_t *key,
+    const uint8_t *ciphertext,
+    size_t ciphertext_len,
+    uint8_t *output,
+    size_t *output_len
+);
+
+/**
+ * @brief Input record for batch APIs
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} cutils_buf_t;
+
+/**
+ * @brief Per-record result of a batch call
+ *
+ * Output for record i lives at arena + offset (len bytes). On failure,
+ * status holds the error code and len is 0.
+ */
+typedef struct {
+    size_t offset;
+    size_t len;
+    int status;
+} cutils_batch_result_t;
+
+/**
+ * @brief Arena size needed for a batch encrypt (encrypt != 0) or decrypt
+ *
+ * Encrypt needs len + 28 per record, decrypt len - 28 (0 for records that
+ * are too short to be valid).
+ *
+ * @param encrypt Non-zero for encryption, zero for decryption
+ * @param inputs Input records
+ * @param count Number of records
+ * @return Required arena size in bytes
+ */
+size_t cutils_aes_gcm_batch_size(int encrypt, const cutils_buf_t *inputs, size_t count);
+
+/**
+ * @brief Encrypt many records with one key setup
+ *
+ * Each output record has the cutils_aes_gcm_encrypt format and is written
+ * back to back into arena. Per-record failures are reported in results
+ * and do not stop the batch.
+ *
+ * @param key 32-byte encryption key
+ * @param inputs Plaintext records
+ * @param count Number of records
+ * @param arena Output arena (>= cutils_aes_gcm_batch_size(1, inputs, count))
+ * @param arena_size Size of arena
+ * @param results Per-record results (count entries)
+ * @return CUTILS_SUCCESS if the batch was processed, negative error code otherwise
+ */
+int cutils_aes_gcm_encrypt_many(const uint8_t *key, const cutils_buf_t *inputs, size_t count,
+                                uint8_t *arena, size_t arena_size, cutils_batch_result_t *results);
+
+/**
+ * @brief Decrypt many records with one key setup
+ *
+ * Records failing authentication get CUTILS_ERR_CRYPTO in results and
+ * their arena slot is zeroed.
+ *
+ * @param key 32-byte decryption key
+ * @param inputs Ciphertext records (IV || ciphertext || tag)
+ * @param count Number of records
+ * @param arena Output arena (>= cutils_aes_gcm_batch_size(0, inputs, count))
+ * @param arena_size Size of arena
+ * @param results Per-record results (count entries)
+ * @return CUTILS_SUCCESS if the batch was processed, negative error code otherwise
+ */
+int cutils_aes_gcm_decrypt_many(const uint8_t *key, const cutils_buf_t *inputs, size_t count,
+                                uint8_t *arena, size_t arena_size, cutils_batch_result_t *results);
+
+/**
+ * @brief Batch encrypt with a key handle (see cutils_aes_gcm_encrypt_many)
+ */
+int cutils_key_encrypt_many(const cutils_key_t *key, const cutils_buf_t *inputs, size_t count,
+                            uint8_t *arena, size_t arena_size, cutils_batch_result_t *results);
+
+/**
+ * @brief Batch decrypt with a key handle (see cutils_aes_gcm_decrypt_many)
+ */
+int cutils_key_decrypt_many(const cutils_key_t *key, const cutils_buf_t *inputs, size_t count,
+                            uint8_t *arena, size_t arena_size, cutils_batch_result_t *results);
+
+/**
+ * @brief Re-encrypt many records from old_key to new_key using a worker pool
+ *
+ * Each input (IV || ciphertext || tag under old_key) is decrypted and
+ * re-encrypted under new_key with a fresh IV. Output records have the same
+ * size as their inputs and are packed back to back in input order, so
+ * output must be at least the sum of input lengths. Per-record failures
+ * (e.g. a tag mismatch because a row was not encrypted with old_key) are
+ * reported in results and their output slot is zeroed.
+ *
+ * @param old_key 32-byte key the inputs are currently encrypted with
+ * @param new_key 32-byte key to encrypt with
+ * @param inputs Ciphertext records
+ * @param count Number of records
+ * @param output Output buffer (>= sum of input lengths)
+ * @param output_size Size of output buffer
+ * @param results Per-record results (count entries)
+ * @param num_threads Worker threads including the caller (0 = online CPUs)
+ * @return CUTILS_SUCCESS if the batch was processed, negative error code otherwise
+ */
+int cutils_reencrypt_batch(
+    const uint8_t *old_key,
+    const uint8_t *new_key,
+    const cutils_buf_t *inputs,
+    size_t count,
+    uint8_t *output,
+    size_t output_size,
+    cutils_batch_result_t *results,
+    unsigned int num_threads
+);
+
 /**
  * @brief Compute SHA-256 hash
  * 
@@ -82,19 +257,262 @@ int cutils_aes_gcm_decrypt(
  */
 int cutils_sha256(const uint8_t *data, size_t data_len, uint8_t *output);
 
+/** Opaque streaming SHA-256 context */
+typedef struct cutils_sha256_ctx cutils_sha256_ctx_t;
+
+/**
+ * @brief Allocate a streaming SHA-256 context, ready for updates
+ * 
+ * @param out Receives the new context (free with cutils_sha256_free)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_new(cutils_sha256_ctx_t **out);
+
+/**
+ * @brief Free a streaming SHA-256 context (NULL is ignored)
+ */
+void cutils_sha256_free(cutils_sha256_ctx_t *ctx);
+
+/**
+ * @brief Reset a context to the empty-message state so it can be reused
+ * 
+ * @param ctx Context to reset
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_init(cutils_sha256_ctx_t *ctx);
+
+/**
+ * @brief Feed data into a streaming SHA-256 context
+ * 
+ * @param ctx Context
+ * @param data Input data (may be NULL when data_len is 0)
+ * @param data_len Length of input
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_update(cutils_sha256_ctx_t *ctx, const uint8_t *data, size_t data_len);
+
+/**
+ * @brief Finish hashing and write the digest
+ * 
+ * The context must be re-initialised with cutils_sha256_init() before
+ * further use.
+ * 
+ * @param ctx Context
+ * @param output Output buffer (must be 32 bytes)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_final(cutils_sha256_ctx_t *ctx, uint8_t *output);
+
+/**
+ * @brief Copy the running state of src into dst (both must be allocated)
+ * 
+ * Useful for hashing many messages that share a prefix: hash the prefix
+ * once, then copy and continue for each message.
+ * 
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_copy(cutils_sha256_ctx_t *dst, const cutils_sha256_ctx_t *src);
+
+/**
+ * @brief Write the digest of the data hashed so far without finishing ctx
+ * 
+ * @param ctx Context (left unchanged; more updates may follow)
+ * @param output Output buffer (must be 32 bytes)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_peek(const cutils_sha256_ctx_t *ctx, uint8_t *output);
+
+/**
+ * @brief Hash many short values in one call: SHA-256(salt || value)
+ * 
+ * The salt is absorbed once and its midstate reused for every value, so
+ * hashing N SSNs costs N short compressions rather than N full setups.
+ * 
+ * @param inputs Array of count values
+ * @param count Number of values
+ * @param salt Optional prefix (NULL when salt_len is 0)
+ * @param salt_len Length of salt
+ * @param output Output buffer of count * CUTILS_SHA256_SIZE bytes
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_sha256_many(const cutils_buf_t *inputs, size_t count,
+                       const uint8_t *salt, size_t salt_len, uint8_t *output);
+
 /**
  * @brief Compute XXH3 64-bit hash (fast, non-cryptographic)
  * 
- * @param data Input data
+ * Output is identical to the reference XXH3_64bits() so hashes can be
+ * compared with other XXH3 producers.
+ * 
+ * @param data Input data (NULL returns 0)
  * @param data_len Length of input
  * @return 64-bit hash value
  */
 uint64_t cutils_xxh3(const uint8_t *data, size_t data_len);
 
+/**
+ * @brief Compute seeded XXH3 64-bit hash (matches XXH3_64bits_withSeed)
+ * 
+ * @param data Input data (may be NULL when data_len is 0)
+ * @param data_len Length of input
+ * @param seed Hash seed
+ * @return 64-bit hash value
+ */
+uint64_t cutils_xxh3_64(const uint8_t *data, size_t data_len, uint64_t seed);
+
+/** 128-bit XXH3 result */
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} cutils_xxh128_t;
+
+/**
+ * @brief Compute seeded XXH3 128-bit hash (matches XXH3_128bits_withSeed)
+ * 
+ * @param data Input data (may be NULL when data_len is 0)
+ * @param data_len Length of input
+ * @param seed Hash seed
+ * @return 128-bit hash value
+ */
+cutils_xxh128_t cutils_xxh3_128(const uint8_t *data, size_t data_len, uint64_t seed);
+
+#define CUTILS_XXH3_SECRET_SIZE 192
+#define CUTILS_XXH3_BUFFER_SIZE 256
+
+/**
+ * @brief Streaming XXH3 state
+ * 
+ * Fields are internal; the struct is public only so it can live on the
+ * stack or inside other objects. One state serves both 64- and 128-bit
+ * digests of the same input.
+ */
+typedef struct {
+    uint64_t acc[8];
+    uint8_t secret[CUTILS_XXH3_SECRET_SIZE];
+    uint8_t buffer[CUTILS_XXH3_BUFFER_SIZE];
+    size_t buffered_size;
+    size_t nb_stripes_acc;
+    uint64_t total_len;
+    uint64_t seed;
+} cutils_xxh3_state_t;
+
+/**
+ * @brief Initialize (or reset) a streaming XXH3 state
+ * 
+ * @param state State to initialize
+ * @param seed Hash seed (0 for the unseeded variant)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_xxh3_init(cutils_xxh3_state_t *state, uint64_t seed);
+
+/**
+ * @brief Feed more input into a streaming XXH3 state
+ * 
+ * @param state Initialized state
+ * @param data Input chunk (may be NULL when data_len is 0)
+ * @param data_len Length of chunk
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_xxh3_update(cutils_xxh3_state_t *state, const uint8_t *data, size_t data_len);
+
+/**
+ * @brief 64-bit digest of everything fed so far (state is not modified)
+ * 
+ * @param state Initialized state
+ * @return 64-bit hash value (0 if state is NULL)
+ */
+uint64_t cutils_xxh3_digest(const cutils_xxh3_state_t *state);
+
+/**
+ * @brief 128-bit digest of everything fed so far (state is not modified)
+ * 
+ * @param state Initialized state
+ * @return 128-bit hash value (zero if state is NULL)
+ */
+cutils_xxh128_t cutils_xxh3_128_digest(const cutils_xxh3_state_t *state);
+
+/**
+ * @brief Name of the XXH3 kernel selected for this CPU
+ * 
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char* cutils_xxh3_impl(void);
+
+/**
+ * @brief Force a specific XXH3 kernel (for tests and benchmarks)
+ * 
+ * Not thread-safe with respect to concurrent hashing.
+ * 
+ * @param name Kernel name as returned by cutils_xxh3_impl, or NULL for auto
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_INVALID_SIZE if unavailable on this CPU
+ */
+int cutils_xxh3_force_impl(const char *name);
+
+/** Opaque keyed pseudonymization handle (HMAC-SHA256 with precomputed pads) */
+typedef struct cutils_pseudonymizer cutils_pseudonymizer_t;
+
+/**
+ * @brief Create a pseudonymizer for deterministic keyed tokens
+ * 
+ * Tokens are HMAC-SHA256(key, value): stable across exports for the same
+ * key, so de-identified extracts can still be joined, but not reversible
+ * or guessable without the key. Use a separate key per identifier type.
+ * A handle may be shared by any number of threads.
+ * 
+ * @param key HMAC key (32+ random bytes recommended)
+ * @param key_len Key length (must be > 0)
+ * @param out Receives the handle (free with cutils_pseudonymizer_free)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_pseudonymizer_new(const uint8_t *key, size_t key_len, cutils_pseudonymizer_t **out);
+
+/**
+ * @brief Free a pseudonymizer (NULL is ignored)
+ */
+void cutils_pseudonymizer_free(cutils_pseudonymizer_t *ps);
+
+/**
+ * @brief Compute the keyed token for one value
+ * 
+ * @param ps Pseudonymizer
+ * @param data Identifier bytes (may be NULL when data_len is 0)
+ * @param data_len Length of identifier
+ * @param output Output buffer (must be 32 bytes)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_pseudonymize(const cutils_pseudonymizer_t *ps, const uint8_t *data, size_t data_len,
+                        uint8_t *output);
+
+/**
+ * @brief Compute keyed tokens for many values using a worker pool
+ * 
+ * @param ps Pseudonymizer
+ * @param inputs Array of count identifiers
+ * @param count Number of identifiers
+ * @param output Output buffer of count * CUTILS_SHA256_SIZE bytes
+ * @param num_threads Worker threads including the caller (0 = online CPUs)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_pseudonymize_many(const cutils_pseudonymizer_t *ps, const cutils_buf_t *inputs, size_t count,
+                             uint8_t *output, unsigned int num_threads);
+
+/**
+ * @brief Fill a buffer with cryptographically secure random bytes
+ * 
+ * Small requests are served from a per-thread buffer refilled from
+ * OpenSSL RAND_bytes in 4 KiB chunks; buffered bytes are discarded in a
+ * forked child. Large requests go straight to RAND_bytes.
+ * 
+ * @param output Output buffer (may be NULL when len is 0)
+ * @param len Number of bytes
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_random_bytes(uint8_t *output, size_t len);
+
 /**
  * @brief Generate cryptographically secure random token
  * 
- * Uses OpenSSL RAND_bytes for CSPRNG
+ * Uses the pooled CSPRNG (see cutils_random_bytes)
  * 
  * @param output Output buffer (must be 32 bytes)
  * @return CUTILS_SUCCESS on success, negative error code on failure
@@ -102,11 +520,13 @@ uint64_t cutils_xxh3(const uint8_t *data, size_t data_len);
 int cutils_generate_token(uint8_t *output);
 
 /**
- * @brief Encode bytes as hexadecimal string
+ * @brief Encode bytes as lowercase hexadecimal string
+ * 
+ * Vectorized (SSSE3/AVX2/NEON) with a scalar fallback.
  * 
  * @param data Input bytes
  * @param data_len Length of input
- * @param output Output buffer (must be >= data_len * 2 + 1)
+ * @param output Output buffer (must be >= data_len * 2 + 1); NUL-terminated
  * @return CUTILS_SUCCESS on success, negative error code on failure
  */
 int cutils_hex_encode(const uint8_t *data, size_t data_len, char *output);
@@ -114,13 +534,306 @@ int cutils_hex_encode(const uint8_t *data, size_t data_len, char *output);
 /**
  * @brief Decode hexadecimal string to bytes
  * 
- * @param hex Input hex string
+ * @param hex Input hex string (NUL-terminated)
  * @param output Output buffer (must be >= strlen(hex) / 2)
  * @param output_len On output: number of bytes written
  * @return CUTILS_SUCCESS on success, negative error code on failure
  */
 int cutils_hex_decode(const char *hex, uint8_t *output, size_t *output_len);
 
+/**
+ * @brief Decode a hexadecimal string of known length to bytes
+ * 
+ * Accepts upper- and lowercase digits. Vectorized (SSSE3/AVX2/NEON) with a
+ * scalar fallback. On error the contents of output are unspecified.
+ * 
+ * @param hex Input hex characters (need not be NUL-terminated)
+ * @param hex_len Number of characters (must be even)
+ * @param output Output buffer (must be >= hex_len / 2)
+ * @param output_len On output: number of bytes written (may be NULL)
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_INVALID_SIZE on odd length or a non-hex character
+ */
+int cutils_hex_decode_len(const char *hex, size_t hex_len, uint8_t *output, size_t *output_len);
+
+/**
+ * @brief Name of the hex kernel selected for this CPU
+ * 
+ * @return "avx2", "ssse3", "neon" or "scalar"
+ */
+const char* cutils_hex_impl(void);
+
+/**
+ * @brief Force a specific hex kernel (for tests and benchmarks)
+ * 
+ * Not thread-safe with respect to concurrent encoding.
+ * 
+ * @param name Kernel name as returned by cutils_hex_impl, or NULL for auto
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_INVALID_SIZE if unavailable on this CPU
+ */
+int cutils_hex_force_impl(const char *name);
+
+/*
+ * Audit log
+ *
+ * Tamper-evident, append-only audit trail. The file is the 8-byte magic
+ * "HNAUDIT1" followed by one record per entry:
+ *
+ *   u32 len | u64 seq | entry[len] | digest[32]     (integers little-endian)
+ *
+ * with digest = SHA-256(previous digest || len || seq || entry), seq
+ * counting from 0 and the 32-byte seed standing in for the digest before
+ * record 0. Editing, dropping or reordering a record breaks every digest
+ * after it; anchoring cutils_audit_head elsewhere also exposes truncation.
+ *
+ * Appends only copy the entry onto a lock-free queue. A writer thread per
+ * log drains the queue, chains the digests and writes each batch with one
+ * writev.
+ */
+#define CUTILS_AUDIT_MAGIC       "HNAUDIT1"
+#define CUTILS_AUDIT_MAX_ENTRY   (1u << 20)  /* Largest entry, bytes */
+#define CUTILS_AUDIT_MAX_PENDING 65536       /* Queued entries before appends push back */
+#define CUTILS_AUDIT_SYNC        0x01u       /* cutils_audit_open flag: fdatasync every batch */
+
+/** Opaque audit log writer */
+typedef struct cutils_audit cutils_audit_t;
+
+/**
+ * @brief Open (creating with mode 0600) an audit log and start its writer
+ *
+ * An existing log continues its chain; a record cut short by a crash is
+ * trimmed off. The file is locked against other writers, so each process
+ * needs its own log. A fork child inherits no writer: there the handle
+ * only fails with CUTILS_ERR_IO, and cutils_audit_close just releases it.
+ *
+ * @param path Log file path
+ * @param seed 32-byte chain seed for a new log (NULL = zeros)
+ * @param flags 0 or CUTILS_AUDIT_SYNC
+ * @param out On success, receives the handle (close with cutils_audit_close)
+ * @return CUTILS_SUCCESS, CUTILS_ERR_IO (also when another writer holds the
+ *         file), CUTILS_ERR_INTEGRITY if the file is not an audit log
+ */
+int cutils_audit_open(const char *path, const uint8_t *seed, unsigned int flags, cutils_audit_t **out);
+
+/**
+ * @brief Queue an entry (thread-safe, lock-free; the entry is copied)
+ *
+ * @param log Audit log
+ * @param entry Entry bytes (may be NULL when len is 0)
+ * @param len Entry length, at most CUTILS_AUDIT_MAX_ENTRY
+ * @return CUTILS_SUCCESS, CUTILS_ERR_BUFFER_SIZE while CUTILS_AUDIT_MAX_PENDING
+ *         entries are queued, CUTILS_ERR_IO once a write has failed
+ */
+int cutils_audit_append(cutils_audit_t *log, const uint8_t *entry, size_t len);
+
+/**
+ * @brief Wait until every entry appended before the call is written
+ *        (and synced, with CUTILS_AUDIT_SYNC)
+ *
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_IO if a write has failed
+ */
+int cutils_audit_flush(cutils_audit_t *log);
+
+/**
+ * @brief Chain head: digest of the last written record and records written
+ *
+ * @param log Audit log
+ * @param digest Receives 32 bytes (the seed while the log is empty)
+ * @param count Receives the number of records in the file (may be NULL)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_audit_head(cutils_audit_t *log, uint8_t *digest, uint64_t *count);
+
+/**
+ * @brief Write out queued entries, stop the writer and free the log
+ *
+ * No other call may be in progress on the log. NULL is ignored.
+ *
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_IO if any write failed
+ */
+int cutils_audit_close(cutils_audit_t *log);
+
+/**
+ * @brief Recompute the chain of an audit log file
+ *
+ * @param path Log file path
+ * @param seed The log's 32-byte seed (NULL = zeros)
+ * @param digest Receives the head digest (may be NULL)
+ * @param count Receives the number of records that verified (may be NULL)
+ * @return CUTILS_SUCCESS, CUTILS_ERR_INTEGRITY at the first bad or
+ *         truncated record (count then tells which), CUTILS_ERR_IO
+ */
+int cutils_audit_verify(const char *path, const uint8_t *seed, uint8_t *digest, uint64_t *count);
+
+/*
+ * Rate limiting
+ *
+ * A table of rate buckets keyed by the XXH3 hash of a caller's key (e.g.
+ * "ip|route"), held in a shared memory segment so that every worker
+ * process on the host counts against the same buckets. A bucket is one
+ * 64-bit theoretical arrival time (GCRA, the token bucket expressed as a
+ * timestamp) updated with a single compare-and-swap: `limit` hits per
+ * `window_ns` are allowed, refilled evenly, in bursts of up to `limit`.
+ *
+ * A key probes 8 slots. When they are all held by other keys the one
+ * closest to refilled is taken over, so a table too small for its traffic
+ * errs towards allowing; counts of the two keys can mix for an instant
+ * while a slot changes hands.
+ */
+#define CUTILS_RATELIMIT_MAGIC         "HNRLIM01"
+#define CUTILS_RATELIMIT_DEFAULT_SLOTS 65536       /* 16 bytes each */
+#define CUTILS_RATELIMIT_MAX_SLOTS     (1u << 26)
+
+/** Opaque handle on a rate bucket table */
+typedef struct cutils_ratelimit cutils_ratelimit_t;
+
+/**
+ * @brief Attach to (creating if needed) a rate bucket table
+ *
+ * @param name POSIX shared memory name, e.g. "/hospital-ratelimit", or
+ *        NULL for an anonymous table shared only with processes forked
+ *        after the call
+ * @param slots Buckets for a new table, rounded up to a power of two
+ *        (0 = CUTILS_RATELIMIT_DEFAULT_SLOTS); an existing table keeps its size
+ * @param out On success, receives the handle (free with cutils_ratelimit_close)
+ * @return CUTILS_SUCCESS, CUTILS_ERR_INVALID_SIZE if slots is above
+ *         CUTILS_RATELIMIT_MAX_SLOTS, CUTILS_ERR_IO, CUTILS_ERR_INTEGRITY
+ *         if the segment is not a rate bucket table
+ */
+int cutils_ratelimit_open(const char *name, size_t slots, cutils_ratelimit_t **out);
+
+/**
+ * @brief Count a hit against a key's bucket (thread- and process-safe, lock-free)
+ *
+ * @param rl Rate bucket table
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param limit Hits allowed per window (at least 1)
+ * @param window_ns Window length in nanoseconds (at least 1)
+ * @param retry_ns Receives 0 if the hit is allowed, else the nanoseconds
+ *        until it would be (a denied hit is not counted)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_ratelimit_hit(cutils_ratelimit_t *rl, const uint8_t *key, size_t key_len,
+                         uint32_t limit, uint64_t window_ns, uint64_t *retry_ns);
+
+/**
+ * @brief Refill a key's bucket (e.g. after a successful login)
+ *
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_ratelimit_reset(cutils_ratelimit_t *rl, const uint8_t *key, size_t key_len);
+
+/** @brief Detach from the table; a named segment stays for other processes. NULL is ignored. */
+void cutils_ratelimit_close(cutils_ratelimit_t *rl);
+
+/**
+ * @brief Remove a named table; attached processes keep using their mapping
+ *
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_IO (errno ENOENT if there is none)
+ */
+int cutils_ratelimit_unlink(const char *name);
+
+/*
+ * IP sets
+ *
+ * IPv4 and IPv6 networks held in a radix trie with 4-bit strides: one node
+ * is 16 child indices, a 64-byte cache line, so a lookup reads at most 8
+ * nodes for IPv4 and 32 for IPv6 and stops at the first covering network.
+ * IPv4-mapped IPv6 addresses (::ffff:a.b.c.d) match the IPv4 networks.
+ * Additions must not overlap other calls; once built, a set can be queried
+ * from any number of threads.
+ */
+
+/** Opaque IP network set */
+typedef struct cutils_ipset cutils_ipset_t;
+
+/**
+ * @brief Parse "a.b.c.d", an IPv6 address, or either followed by "/prefix"
+ *
+ * @param text NUL-terminated address or network
+ * @param addr Receives the address (4 or 16 bytes; host bits are kept)
+ * @param addr_len Receives 4 or 16
+ * @param prefix_len Receives the prefix length (the full length without "/")
+ * @return CUTILS_SUCCESS, or CUTILS_ERR_INVALID_SIZE if text is not an address or network
+ */
+int cutils_ip_parse(const char *text, uint8_t addr[16], size_t *addr_len, unsigned int *prefix_len);
+
+/**
+ * @brief Create an empty IP set
+ *
+ * @param out On success, receives the set (free with cutils_ipset_free)
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_ipset_new(cutils_ipset_t **out);
+
+/**
+ * @brief Add the network addr/prefix_len (host bits are ignored)
+ *
+ * @param set IP set
+ * @param addr Network address, 4 or 16 bytes
+ * @param addr_len 4 or 16
+ * @param prefix_len At most addr_len * 8
+ * @return CUTILS_SUCCESS, CUTILS_ERR_INVALID_SIZE on a bad length or prefix
+ */
+int cutils_ipset_add(cutils_ipset_t *set, const uint8_t *addr, size_t addr_len, unsigned int prefix_len);
+
+/**
+ * @brief Whether an address lies in any network of the set
+ *
+ * @param set IP set
+ * @param addr Address, 4 or 16 bytes
+ * @param addr_len 4 or 16
+ * @param found Receives 1 or 0
+ * @return CUTILS_SUCCESS on success, negative error code on failure
+ */
+int cutils_ipset_contains(const cutils_ipset_t *set, const uint8_t *addr, size_t addr_len, int *found);
+
+/** @brief Free an IP set (NULL is ignored) */
+void cutils_ipset_free(cutils_ipset_t *set);
+
+/*
+ * Instrumentation
+ *
+ * With -DHOSPITAL_NATIVE_STATS=ON the encryption, hashing, pseudonymization
+ * and random APIs count their calls per thread without locking; the
+ * functions below sum those counters. A call counts once, under the API the
+ * caller entered (the IV draw inside cutils_aes_gcm_encrypt is not a
+ * random_bytes call). Sub-100 ns calls (XXH3, hex) are not instrumented.
+ * Without the option nothing is recorded and cutils_stats_snapshot reports
+ * no APIs.
+ */
+#define CUTILS_STATS_ERROR_CODES     16
+#define CUTILS_STATS_LATENCY_BUCKETS 32
+
+/** Counters of one API since start or the last reset */
+typedef struct {
+    const char *name;    /**< API name, e.g. "aes_gcm_decrypt" */
+    uint64_t calls;
+    uint64_t bytes;      /**< Input bytes */
+    uint64_t total_ns;   /**< Summed latency */
+    /** errors[i]: calls that returned -i; the last slot also counts lower codes */
+    uint64_t errors[CUTILS_STATS_ERROR_CODES];
+    /** latency[i]: calls that took [2^i, 2^(i+1)) ns; the last bucket is unbounded */
+    uint64_t latency[CUTILS_STATS_LATENCY_BUCKETS];
+} cutils_stats_t;
+
+/** @brief Whether the library was built with HOSPITAL_NATIVE_STATS */
+int cutils_stats_enabled(void);
+
+/**
+ * @brief Snapshot the per-API counters, summed over all threads
+ *
+ * Thread-safe; threads keep recording while the snapshot is taken.
+ *
+ * @param out Receives up to capacity entries (may be NULL to query the count)
+ * @param capacity Number of entries out can hold
+ * @return Number of instrumented APIs (0 without HOSPITAL_NATIVE_STATS)
+ */
+size_t cutils_stats_snapshot(cutils_stats_t *out, size_t capacity);
+
+/** @brief Zero every counter; calls in flight may land before or after */
+void cutils_stats_reset(void);
+
 /**
  * @brief Get error message for error code
  * 
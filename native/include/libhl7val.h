@@ -2,6 +2,7 @@
 #define LIBHL7VAL_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @file libhl7val.h
@@ -23,10 +24,100 @@
 #define HL7VAL_ERR_INVALID_FMT  -3
 #define HL7VAL_ERR_FIELD_COUNT  -4
 #define HL7VAL_ERR_DATATYPE     -5
+#define HL7VAL_ERR_NO_MEMORY    -6
+#define HL7VAL_ERR_IO           -7
 
 /* Constants */
 #define HL7VAL_MAX_SEGMENT_SIZE 65536
 #define HL7VAL_MAX_FIELDS       256
+#define HL7VAL_MAX_SUB_SEPARATORS 1024
+
+/**
+ * Delimiter context: the field separator (MSH-1) and encoding characters
+ * (MSH-2) in effect for a segment. Characters a message does not declare
+ * are '\0'.
+ */
+typedef struct {
+    char field;         /**< Field separator, '|' by default */
+    char component;     /**< '^' */
+    char repetition;    /**< '~' */
+    char escape;        /**< '\\' */
+    char subcomponent;  /**< '&' */
+} hl7val_delims_t;
+
+#define HL7VAL_DEFAULT_DELIMS_INIT {'|', '^', '~', '\\', '&'}
+
+/** Pointer and length into caller-owned bytes (not null-terminated) */
+typedef struct {
+    const char *data;
+    size_t len;
+} hl7val_view_t;
+
+/** Byte range within a segment */
+typedef struct {
+    uint32_t start;  /**< Offset from the start of the segment */
+    uint32_t len;    /**< Length in bytes */
+} hl7val_span_t;
+
+/**
+ * Field offset index of one segment, filled by hl7val_parse_segment.
+ * 
+ * Fields use HL7 numbering: fields[0] is the segment ID and, for MSH,
+ * fields[1] is the field separator itself (MSH-1). Component (^) and
+ * repetition (~) separator offsets are kept in field order in subs[], with
+ * sub_first[n] .. sub_first[n + 1] covering field n. If a segment has more
+ * than HL7VAL_MAX_SUB_SEPARATORS of them, sub_overflow is set and
+ * component lookups rescan the field instead.
+ * 
+ * The index refers to the parsed bytes; it is not valid once they change.
+ */
+typedef struct {
+    const char *data;
+    size_t len;
+    hl7val_delims_t delims;  /**< Delimiters the segment was parsed with */
+    char id[4];
+    int field_count;  /**< Highest field number present */
+    int sub_overflow;
+    hl7val_span_t fields[HL7VAL_MAX_FIELDS];
+    uint16_t sub_first[HL7VAL_MAX_FIELDS + 1];
+    uint32_t subs[HL7VAL_MAX_SUB_SEPARATORS];
+} hl7val_segment_t;
+
+/**
+ * @brief The standard |^~\\& delimiter set
+ */
+const hl7val_delims_t* hl7val_default_delims(void);
+
+/**
+ * @brief Build a delimiter context from MSH-1 followed by MSH-2
+ * 
+ * Accepts 1-5 distinct characters (e.g. "|^~\\&"); letters, digits,
+ * whitespace and NUL are rejected. Characters not given are '\0'.
+ * 
+ * @param out Delimiter context to fill
+ * @param chars Field separator followed by the encoding characters
+ * @param len Number of characters
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_INVALID_FMT for an invalid set
+ */
+int hl7val_delims_init(hl7val_delims_t *out, const char *chars, size_t len);
+
+/**
+ * @brief Parse the delimiter context declared by an MSH segment
+ * 
+ * @param msh MSH segment (need not be null-terminated)
+ * @param msh_len Length of msh
+ * @param out Delimiter context to fill
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_INVALID_FMT if msh is not an MSH
+ *         segment or its encoding characters are invalid
+ */
+int hl7val_delims_from_msh(const char *msh, size_t msh_len, hl7val_delims_t *out);
+
+/*
+ * The _ex variants below take a delimiter context; NULL means the default
+ * set. An MSH segment always uses the delimiters it declares itself. The
+ * default set is handled by a specialized tokenizer, so passing NULL or
+ * the defaults costs nothing over the plain functions.
+ */
 
 /**
  * @brief Validate an HL7 v2 segment
@@ -36,6 +127,11 @@
  * - Starts with valid 3-character segment ID
  * - Has proper field delimiter structure
  * - Field count matches expectations for segment type
+ * - For segments with a built-in schema (MSH, EVN, PID, PV1, ORC, OBR,
+ *   OBX, NTE): required fields are non-empty (HL7VAL_ERR_FIELD_COUNT),
+ *   repetitions fit the field's maximum length (HL7VAL_ERR_TOO_LARGE) and
+ *   values match the field's datatype - NM, SI, DT, TS, ST or CE, with
+ *   OBX-5 typed by OBX-2 (HL7VAL_ERR_DATATYPE)
  * 
  * @param segment Null-terminated HL7 segment string (e.g., "MSH|^~\\&|...")
  * @param segment_len Length of segment (for bounds checking)
@@ -44,6 +140,10 @@
  */
 int hl7val_validate_segment(const char *segment, size_t segment_len, char *error_msg);
 
+/** @brief hl7val_validate_segment with a delimiter context */
+int hl7val_validate_segment_ex(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                               char *error_msg);
+
 /**
  * @brief Extract field from HL7 segment
  * 
@@ -55,6 +155,482 @@ int hl7val_validate_segment(const char *segment, size_t segment_len, char *error
  */
 int hl7val_extract_field(const char *segment, int field_num, char *output, size_t output_size);
 
+/**
+ * @brief hl7val_extract_field with an explicit length and delimiter context
+ * 
+ * @param segment HL7 segment (need not be null-terminated)
+ * @param segment_len Length of segment
+ */
+int hl7val_extract_field_ex(const char *segment, size_t segment_len, int field_num,
+                            const hl7val_delims_t *delims, char *output, size_t output_size);
+
+/**
+ * @brief Locate a field without copying it
+ * 
+ * Same numbering and checks as hl7val_extract_field, with no limit on the
+ * field's length. The view points into segment.
+ * 
+ * @param segment HL7 segment (need not be null-terminated)
+ * @param segment_len Length of segment
+ * @param field_num Field number (1-based)
+ * @param delims Delimiter context, NULL for the default
+ * @param out Receives the field's bytes
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_FIELD_COUNT if the field is absent
+ */
+int hl7val_field_view(const char *segment, size_t segment_len, int field_num, const hl7val_delims_t *delims,
+                      hl7val_view_t *out);
+
+/**
+ * @brief Locate several fields in one scan
+ * 
+ * Numbering as in hl7val_field_view; field numbers may repeat and come in
+ * any order. The scan stops at the end of the highest one requested.
+ * Absent fields get {NULL, 0}, which an empty field present in the
+ * segment never does.
+ * 
+ * @param segment HL7 segment (need not be null-terminated)
+ * @param segment_len Length of segment
+ * @param field_nums Field numbers, each 1 .. HL7VAL_MAX_FIELDS - 1
+ * @param count Number of fields requested
+ * @param delims Delimiter context, NULL for the default
+ * @param out Receives count views, in request order
+ * @return HL7VAL_SUCCESS, or a negative error code for invalid input
+ */
+int hl7val_extract_fields(const char *segment, size_t segment_len, const int *field_nums, size_t count,
+                          const hl7val_delims_t *delims, hl7val_view_t *out);
+
+/**
+ * @brief Tokenize an HL7 v2 segment into a field offset index
+ * 
+ * Performs the structural checks of hl7val_validate_segment (size, segment
+ * ID, field delimiter, maximum field count) in a single pass while
+ * recording where every field, component and repetition starts. Segment
+ * specific minimum field counts are not enforced.
+ * 
+ * @param segment HL7 segment (need not be null-terminated)
+ * @param segment_len Length of segment
+ * @param out Caller-provided index to fill
+ * @return HL7VAL_SUCCESS on success, negative error code on failure
+ */
+int hl7val_parse_segment(const char *segment, size_t segment_len, hl7val_segment_t *out);
+
+/** @brief hl7val_parse_segment with a delimiter context */
+int hl7val_parse_segment_ex(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                            hl7val_segment_t *out);
+
+/**
+ * @brief Look up a field in a parsed segment (O(1))
+ * 
+ * @param seg Index from hl7val_parse_segment
+ * @param field_num Field number (0 = segment ID; MSH-1 is the separator)
+ * @param out Receives the field's span
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_FIELD_COUNT if the field is absent
+ */
+int hl7val_field_at(const hl7val_segment_t *seg, int field_num, hl7val_span_t *out);
+
+/**
+ * @brief Look up one component of one repetition of a field
+ * 
+ * Only the separators inside the requested field are visited.
+ * 
+ * @param seg Index from hl7val_parse_segment
+ * @param field_num Field number
+ * @param repetition Repetition number (1-based)
+ * @param component Component number (1-based)
+ * @param out Receives the component's span
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_FIELD_COUNT if it is absent
+ */
+int hl7val_component_at(const hl7val_segment_t *seg, int field_num, int repetition, int component,
+                        hl7val_span_t *out);
+
+/** Validation result for one segment of a message */
+typedef struct {
+    size_t offset;      /**< Byte offset of the segment in the message */
+    uint32_t len;       /**< Segment length, without separators or surrounding blanks */
+    uint32_t line;      /**< 1-based line number */
+    char id[4];         /**< Segment ID as written (first 3 bytes) */
+    int field_count;    /**< Highest field number present (0 if invalid) */
+    int status;         /**< HL7VAL_SUCCESS or the segment's error code */
+} hl7val_segment_result_t;
+
+/**
+ * @brief Validate every segment of an HL7 v2 message in one pass
+ * 
+ * Segments are separated by \r, \n or \r\n; blank lines are skipped but
+ * still counted for line numbers. Each segment gets the checks of
+ * hl7val_validate_segment. A valid MSH segment sets the delimiters for
+ * the segments that follow it.
+ * 
+ * @param message Message text (need not be null-terminated)
+ * @param message_len Length of message
+ * @param results Output array for per-segment results (may be NULL if capacity is 0)
+ * @param capacity Number of entries available in results
+ * @param segment_count On output: total number of segments in the message
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_TOO_LARGE if segment_count > capacity
+ *         (the first capacity results are still filled in)
+ */
+int hl7val_parse_message(const char *message, size_t message_len, hl7val_segment_result_t *results,
+                         size_t capacity, size_t *segment_count);
+
+/** @brief hl7val_parse_message with the delimiters to use before the first MSH */
+int hl7val_parse_message_ex(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                            hl7val_segment_result_t *results, size_t capacity, size_t *segment_count);
+
+/**
+ * @brief Validate an HL7 v2 message, stopping at the first invalid segment
+ * 
+ * @param message Message text (need not be null-terminated)
+ * @param message_len Length of message
+ * @param error_msg Output buffer for "Line N: ..." (min 256 bytes), can be NULL
+ * @return HL7VAL_SUCCESS, the first failing segment's error code, or
+ *         HL7VAL_ERR_INVALID_FMT if the message has no segments
+ */
+int hl7val_validate_message(const char *message, size_t message_len, char *error_msg);
+
+/** @brief hl7val_validate_message with the delimiters to use before the first MSH */
+int hl7val_validate_message_ex(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                               char *error_msg);
+
+/* ---- File validation ---- */
+
+/** One invalid segment found by hl7val_validate_buffer or hl7val_validate_file */
+typedef struct {
+    uint64_t offset;         /**< Byte offset of the segment in the input */
+    uint64_t segment_index;  /**< 0-based index of the segment among all segments */
+    uint64_t line;           /**< 1-based line number */
+    char id[4];              /**< Segment ID as written (first 3 bytes) */
+    int status;              /**< The segment's error code */
+} hl7val_file_error_t;
+
+/** Totals for one validated input */
+typedef struct {
+    uint64_t bytes;     /**< Input size */
+    uint64_t segments;  /**< Segments validated */
+    uint64_t errors;    /**< Invalid segments, including any past the error capacity */
+} hl7val_file_report_t;
+
+/**
+ * @brief Validate every segment of a large input, such as a batch or
+ *        archive file, across threads
+ * 
+ * The input is split into chunks at line boundaries and the chunks are
+ * validated in parallel. The result is the same as hl7val_parse_message
+ * over the whole input, delimiters carried from each MSH included.
+ * 
+ * @param data Input bytes (need not be null-terminated)
+ * @param len Length of data
+ * @param num_threads Worker threads, 0 for one per online CPU (at most 64)
+ * @param errors Output array for invalid segments, in input order
+ *               (may be NULL if capacity is 0)
+ * @param capacity Number of entries available in errors
+ * @param report On output: input totals
+ * @return HL7VAL_SUCCESS, HL7VAL_ERR_TOO_LARGE if report->errors > capacity
+ *         (the first capacity errors are still filled in), or
+ *         HL7VAL_ERR_NO_MEMORY
+ */
+int hl7val_validate_buffer(const char *data, size_t len, unsigned int num_threads, hl7val_file_error_t *errors,
+                           size_t capacity, hl7val_file_report_t *report);
+
+/**
+ * @brief hl7val_validate_buffer over a file, mapped with mmap
+ * 
+ * @return As hl7val_validate_buffer, or HL7VAL_ERR_IO with errno set if
+ *         the file cannot be opened or mapped
+ */
+int hl7val_validate_file(const char *path, unsigned int num_threads, hl7val_file_error_t *errors,
+                         size_t capacity, hl7val_file_report_t *report);
+
+/**
+ * @brief Name of the separator scanning kernel selected for this CPU
+ * 
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char* hl7val_scan_impl(void);
+
+/**
+ * @brief Force a specific scanning kernel (for tests and benchmarks)
+ * 
+ * Not thread-safe with respect to concurrent parsing.
+ * 
+ * @param name Kernel name as returned by hl7val_scan_impl, or NULL for auto
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_INVALID_FMT if unavailable on this CPU
+ */
+int hl7val_scan_force_impl(const char *name);
+
+/* ---- MLLP framing ---- */
+
+#define HL7VAL_MLLP_START_BLOCK 0x0B
+#define HL7VAL_MLLP_END_BLOCK   0x1C
+#define HL7VAL_MLLP_DEFAULT_MAX_MESSAGE (1024 * 1024)
+
+/** Streaming MLLP framer; one per connection, not thread-safe */
+typedef struct hl7val_mllp hl7val_mllp_t;
+
+/**
+ * Called once per frame, in stream order.
+ * 
+ * @param ctx Context passed to hl7val_mllp_new
+ * @param message Message bytes without framing; valid only during the call
+ *                (NULL for a frame that was dropped)
+ * @param message_len Length of message
+ * @param status HL7VAL_SUCCESS, the message's validation error, or
+ *               HL7VAL_ERR_TOO_LARGE / HL7VAL_ERR_INVALID_FMT for a frame
+ *               that was dropped (oversized, interrupted or missing its
+ *               trailing carriage return)
+ * @param error_msg Description of the failure, NULL on success
+ */
+typedef void (*hl7val_mllp_message_fn)(void *ctx, const char *message, size_t message_len, int status,
+                                       const char *error_msg);
+
+/** Framer counters since creation or the last reset */
+typedef struct {
+    uint64_t messages;        /**< Frames that validated */
+    uint64_t invalid;         /**< Frames that failed validation */
+    uint64_t dropped;         /**< Oversized or malformed frames */
+    uint64_t discarded_bytes; /**< Bytes outside any frame */
+} hl7val_mllp_stats_t;
+
+/**
+ * @brief Create an MLLP framer
+ * 
+ * The receive buffer (max_message_size bytes) is allocated here; feeding
+ * data never allocates.
+ * 
+ * @param max_message_size Largest accepted message, 0 for HL7VAL_MLLP_DEFAULT_MAX_MESSAGE
+ * @param on_message Callback for each complete frame
+ * @param ctx Passed to on_message
+ * @param out Receives the framer
+ * @return HL7VAL_SUCCESS, or a negative error code
+ */
+int hl7val_mllp_new(size_t max_message_size, hl7val_mllp_message_fn on_message, void *ctx,
+                    hl7val_mllp_t **out);
+
+/** @brief Free a framer (NULL is ignored) */
+void hl7val_mllp_free(hl7val_mllp_t *mllp);
+
+/**
+ * @brief Feed bytes as received from the socket
+ * 
+ * Chunks may split frames anywhere. Every frame completed by this chunk is
+ * validated (hl7val_validate_message) and passed to the callback before
+ * this returns. Frames contained in a single chunk are delivered straight
+ * from data without copying. Bytes outside frames are skipped; a start
+ * block inside a frame drops the partial frame and starts a new one.
+ * 
+ * @param mllp Framer
+ * @param data Received bytes
+ * @param len Number of bytes
+ * @return Number of frames delivered, or a negative error code
+ */
+int hl7val_mllp_feed(hl7val_mllp_t *mllp, const char *data, size_t len);
+
+/** @brief Drop any partial frame and zero the counters (e.g. for a new connection) */
+void hl7val_mllp_reset(hl7val_mllp_t *mllp);
+
+/** @brief Read the framer's counters */
+void hl7val_mllp_get_stats(const hl7val_mllp_t *mllp, hl7val_mllp_stats_t *out);
+
+/**
+ * @brief Build an MLLP-framed ACK (MSH + MSA) for a received message
+ * 
+ * The reply uses the message's delimiters. It swaps MSH-3/4 with MSH-5/6,
+ * echoes MSH-10 (control ID) in MSH-10 and MSA-2, copies MSH-11/12, and
+ * stamps MSH-7 with the current UTC time. A message whose MSH cannot be
+ * parsed still gets a reply, with those fields empty, so that it can be
+ * rejected with "AR".
+ * 
+ * @param message Received message (as passed to the framer callback)
+ * @param message_len Length of message
+ * @param ack_code "AA", "AE" or "AR" (or the commit codes "CA", "CE", "CR")
+ * @param text MSA-3 text (escaped as needed), or NULL
+ * @param out Output buffer
+ * @param out_size Size of out
+ * @param out_len Receives the reply length, framing included
+ * @return HL7VAL_SUCCESS, HL7VAL_ERR_INVALID_FMT for an unknown code, or
+ *         HL7VAL_ERR_TOO_LARGE if out is too small
+ */
+int hl7val_mllp_build_ack(const char *message, size_t message_len, const char *ack_code, const char *text,
+                          char *out, size_t out_size, size_t *out_len);
+
+/* ---- Parsed message cache ---- */
+
+#define HL7VAL_CACHE_DEFAULT_BYTES (16 * 1024 * 1024)
+
+/** One segment of a cached message index */
+typedef struct {
+    uint32_t offset;       /**< Byte offset of the segment in the message */
+    uint32_t len;          /**< Segment length */
+    char id[4];            /**< Segment ID as written (first 3 bytes) */
+    int status;            /**< HL7VAL_SUCCESS or the segment's error code */
+    uint32_t field_count;  /**< Highest field number present (0 if the segment does not tokenize) */
+    uint32_t first_field;  /**< Position of the segment's field 0 in hl7val_message_index_t.fields */
+} hl7val_index_segment_t;
+
+/**
+ * Segment and field index of one message, owned by the cache.
+ * 
+ * Field spans are offsets from the start of the message, in HL7 numbering
+ * as in hl7val_parse_segment. Segments that tokenize have fields even when
+ * they fail the schema checks (status says which); others have none.
+ */
+typedef struct {
+    size_t message_len;
+    size_t segment_count;
+    const hl7val_index_segment_t *segments;
+    const hl7val_span_t *fields;
+} hl7val_message_index_t;
+
+/** Bounded LRU cache of message indexes; not thread-safe */
+typedef struct hl7val_cache hl7val_cache_t;
+
+/** Cache counters */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;  /**< Entries dropped to stay within the budget */
+    size_t entries;
+    size_t bytes;        /**< Memory held by entries and the hash table */
+    size_t max_bytes;
+} hl7val_cache_stats_t;
+
+/**
+ * @brief Create a parsed message cache
+ * 
+ * @param max_bytes Memory budget, 0 for HL7VAL_CACHE_DEFAULT_BYTES
+ * @param out Receives the cache
+ * @return HL7VAL_SUCCESS, HL7VAL_ERR_NULL_INPUT or HL7VAL_ERR_NO_MEMORY
+ */
+int hl7val_cache_new(size_t max_bytes, hl7val_cache_t **out);
+
+/** @brief Free a cache and every index it handed out (NULL-safe) */
+void hl7val_cache_free(hl7val_cache_t *cache);
+
+/**
+ * @brief Get the index of a message, parsing it only on a miss
+ * 
+ * Messages are keyed by their XXH3 hash and delimiters, and compared in
+ * full on a hit. The message is split and validated as by
+ * hl7val_parse_message, then the fields of every segment that tokenizes
+ * are indexed.
+ * The least recently used entries are evicted to stay within the budget;
+ * an index larger than the whole budget is returned but not kept.
+ * 
+ * @param cache Cache from hl7val_cache_new
+ * @param message Message text (need not be null-terminated)
+ * @param message_len Length of message (at most 4 GiB)
+ * @param delims Delimiters before the first MSH, or NULL for the default
+ * @param out Receives the index, valid until the next call on this cache
+ * @return HL7VAL_SUCCESS, HL7VAL_ERR_TOO_LARGE or HL7VAL_ERR_NO_MEMORY
+ */
+int hl7val_cache_get(hl7val_cache_t *cache, const char *message, size_t message_len, const hl7val_delims_t *delims,
+                     const hl7val_message_index_t **out);
+
+/**
+ * @brief Look up a field of one segment of a message index (O(1))
+ * 
+ * @return HL7VAL_SUCCESS, or HL7VAL_ERR_FIELD_COUNT if the segment does
+ *         not tokenize or has no such field
+ */
+int hl7val_index_field(const hl7val_message_index_t *index, size_t segment, int field_num, hl7val_span_t *out);
+
+/** @brief Drop every entry; the counters are kept */
+void hl7val_cache_clear(hl7val_cache_t *cache);
+
+/** @brief Read the cache counters */
+void hl7val_cache_get_stats(const hl7val_cache_t *cache, hl7val_cache_stats_t *out);
+
+/* ---- Columnar OBX extraction ---- */
+
+/** String column in Arrow large_string layout: row i is data[offsets[i] .. offsets[i + 1]) */
+typedef struct {
+    int64_t *offsets;  /**< rows + 1 entries, offsets[0] = 0 */
+    char *data;        /**< UTF-8 bytes of every row, back to back */
+    size_t data_len;
+} hl7val_str_column_t;
+
+/**
+ * OBX observations as struct-of-arrays, one row per OBX segment, in input
+ * order. Every buffer is 64-byte aligned and can be handed to NumPy or
+ * Arrow without copying.
+ */
+typedef struct {
+    size_t rows;
+    uint32_t *record;            /**< Index of the input text the row came from */
+    double *value;               /**< OBX-5 as a number, 0 where null */
+    uint8_t *value_valid;        /**< Validity bitmap for value, LSB first (Arrow layout) */
+    size_t value_null_count;     /**< Rows whose OBX-5 is not a plain number */
+    hl7val_str_column_t code;    /**< OBX-3 first component (observation identifier) */
+    hl7val_str_column_t units;   /**< OBX-6 first component */
+    hl7val_str_column_t flags;   /**< OBX-8 abnormal flags, as written */
+} hl7val_obx_columns_t;
+
+/**
+ * @brief Extract OBX-3, OBX-5, OBX-6 and OBX-8 from many stored texts at once
+ * 
+ * Each text holds segments separated by \r, \n or \r\n, in the default
+ * delimiters; lines that are not OBX segments are skipped. Texts are
+ * expected to have been validated when stored, so only the requested
+ * fields are located. OBX-5 is parsed as a number when it is one in the NM
+ * form ([+-]digits[.digits]) and is null otherwise. Texts are split into
+ * ranges and processed across threads.
+ * 
+ * @param texts Input texts (a NULL data pointer is an empty text)
+ * @param count Number of texts (at most UINT32_MAX)
+ * @param num_threads Worker threads, 0 for one per online CPU (at most 64)
+ * @param out Receives the columns; release with hl7val_obx_columns_free
+ * @return HL7VAL_SUCCESS, HL7VAL_ERR_NULL_INPUT, HL7VAL_ERR_TOO_LARGE or
+ *         HL7VAL_ERR_NO_MEMORY
+ */
+int hl7val_obx_columns(const hl7val_view_t *texts, size_t count, unsigned int num_threads,
+                       hl7val_obx_columns_t *out);
+
+/** @brief Release the buffers of hl7val_obx_columns and zero the struct (NULL-safe) */
+void hl7val_obx_columns_free(hl7val_obx_columns_t *cols);
+
+/*
+ * Instrumentation
+ *
+ * With -DHOSPITAL_NATIVE_STATS=ON (shared with libcutils) segment and
+ * message validation and parsing, field extraction, buffer/file
+ * validation, the MLLP framer, the segment cache and OBX column extraction
+ * count their calls per thread without locking. A call counts once, under
+ * the API the caller entered: the framer validating a message, a cache miss
+ * parsing segments or hl7val_validate_file checking its mapping (counted as
+ * validate_buffer) add no further calls. Field views and single-field
+ * extraction are too short to time.
+ */
+#define HL7VAL_STATS_ERROR_CODES     16
+#define HL7VAL_STATS_LATENCY_BUCKETS 32
+
+/** Counters of one API since start or the last reset */
+typedef struct {
+    const char *name;    /**< API name, e.g. "validate_message" */
+    uint64_t calls;
+    uint64_t bytes;      /**< Input bytes */
+    uint64_t total_ns;   /**< Summed latency */
+    /** errors[i]: calls that returned -i; the last slot also counts lower codes */
+    uint64_t errors[HL7VAL_STATS_ERROR_CODES];
+    /** latency[i]: calls that took [2^i, 2^(i+1)) ns; the last bucket is unbounded */
+    uint64_t latency[HL7VAL_STATS_LATENCY_BUCKETS];
+} hl7val_stats_t;
+
+/** @brief Whether the library was built with HOSPITAL_NATIVE_STATS */
+int hl7val_stats_enabled(void);
+
+/**
+ * @brief Snapshot the per-API counters, summed over all threads
+ *
+ * Thread-safe; threads keep recording while the snapshot is taken.
+ *
+ * @param out Receives up to capacity entries (may be NULL to query the count)
+ * @param capacity Number of entries out can hold
+ * @return Number of instrumented APIs (0 without HOSPITAL_NATIVE_STATS)
+ */
+size_t hl7val_stats_snapshot(hl7val_stats_t *out, size_t capacity);
+
+/** @brief Zero every counter; calls in flight may land before or after */
+void hl7val_stats_reset(void);
+
 /**
  * @brief Get error message for error code
  * 
@@ -8,17 +8,76 @@ try:
     # Re-export for convenience
     aes_gcm_encrypt = _cutils.aes_gcm_encrypt
     aes_gcm_decrypt = _cutils.aes_gcm_decrypt
+    aes_gcm_encrypt_many = _cutils.aes_gcm_encrypt_many
+    aes_gcm_decrypt_many = _cutils.aes_gcm_decrypt_many
+    reencrypt_batch = _cutils.reencrypt_batch
+    AesKey = _cutils.AesKey
     sha256 = _cutils.sha256
+    Sha256 = _cutils.Sha256
+    sha256_hex_many = _cutils.sha256_hex_many
+    Pseudonymizer = _cutils.Pseudonymizer
     generate_token = _cutils.generate_token
+    generate_tokens = _cutils.generate_tokens
     hex_encode = _cutils.hex_encode
+    hex_decode = _cutils.hex_decode
+    xxh3_64 = _cutils.xxh3_64
+    xxh3_128 = _cutils.xxh3_128
+    Xxh3 = _cutils.Xxh3
+    AuditLog = _cutils.AuditLog
+    audit_verify = _cutils.audit_verify
+    RateLimiter = _cutils.RateLimiter
+    ratelimit_unlink = _cutils.ratelimit_unlink
+    IpSet = _cutils.IpSet
     
     validate_hl7_segment = _hl7val.validate_segment
     extract_hl7_field = _hl7val.extract_field
-    
-    # Note: _authz and _bill C extensions to be added in future
-    # For now, use the Django wrapper functions in apps.core.utils
-    
+    extract_hl7_fields = _hl7val.extract_fields
+    validate_hl7_message = _hl7val.validate_message
+    parse_hl7_message = _hl7val.parse_message
+    hl7_delimiters_from_msh = _hl7val.delimiters_from_msh
+    MllpFramer = _hl7val.MllpFramer
+    build_hl7_ack = _hl7val.build_ack
+    validate_hl7_file = _hl7val.validate_file
+    SegmentCache = _hl7val.SegmentCache
+    obx_columns = _hl7val.obx_columns
+    ObxColumns = _hl7val.ObxColumns
+
+    STATS_ENABLED = _cutils.STATS_ENABLED or _hl7val.STATS_ENABLED
+
+    def stats():
+        """
+        Native call counters since start or reset_stats(), per library and API:
+        {"cutils": {"aes_gcm_decrypt": {...}, ...}, "hl7val": {...}}.
+
+        Each API has calls, bytes (input), total_ns, errors ({error code: count})
+        and latency, a list where entry i counts calls of [2**i, 2**(i+1)) ns.
+        Empty unless the libraries were built with -DHOSPITAL_NATIVE_STATS=ON.
+        """
+        return {"cutils": _cutils.stats(), "hl7val": _hl7val.stats()}
+
+    def reset_stats():
+        """Zero the counters reported by stats()."""
+        _cutils.reset_stats()
+        _hl7val.reset_stats()
+
 except ImportError as e:
     # Fallback message if C extensions not built
     import warnings
     warnings.warn(f"C extensions not available: {e}. Some features will be limited.")
+
+# Newer extensions are optional on their own: a missing one only disables its features
+try:
+    from . import _bill
+
+    invoice_totals = _bill.invoice_totals
+except ImportError as e:
+    import warnings
+    warnings.warn(f"C billing extension not available: {e}. Invoice totals use Python.")
+
+try:
+    from . import _authz
+
+    Policy = _authz.Policy
+except ImportError as e:
+    import warnings
+    warnings.warn(f"C authorization extension not available: {e}. Policies use Python.")
@@ -0,0 +1,587 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "libauthz.h"
+#include "fastcall.h"
+
+/*
+ * Policy: roles, (resource, action) permissions and object states by name,
+ * compiled once into an authz_policy_t. A Policy is never changed after
+ * construction; replace() applies grant changes to a copy, so a reader
+ * keeps a consistent policy however the current one is swapped out, and no
+ * lock is needed with or without a GIL.
+ *
+ * Decisions cost less than converting their arguments, so the GIL is never
+ * released: there is nothing to overlap.
+ */
+
+#define NO_STATE 0xff  /* Past AUTHZ_MAX_STATES: never allowed */
+
+typedef struct {
+    PyObject_HEAD
+    authz_policy_t *policy;
+    PyObject *roles;          /* (name, ...) */
+    PyObject *permissions;    /* ((resource, action), ...) */
+    PyObject *states;         /* (name, ...) */
+    PyObject *role_bits;      /* {name: bit} */
+    PyObject *permission_ids; /* {resource: {action: number}} */
+    PyObject *state_bits;     /* {name: bit} */
+} PolicyObject;
+
+/* Names of a sequence of str as a tuple and a {name: position} dict; what names them in errors */
+static int name_table(PyObject *names, size_t max, const char *what, PyObject **tuple, PyObject **index) {
+    *tuple = PySequence_Tuple(names);
+    *index = *tuple ? PyDict_New() : NULL;
+    if (!*index) {
+        return -1;
+    }
+    Py_ssize_t n = PyTuple_Size(*tuple);
+    if ((size_t)n > max) {
+        PyErr_Format(PyExc_ValueError, "at most %zu %s", max, what);
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *name = PyTuple_GetItem(*tuple, i);
+        if (!PyUnicode_Check(name)) {
+            PyErr_Format(PyExc_TypeError, "%s must be str, not %R", what, name);
+            return -1;
+        }
+        if (PyDict_GetItemWithError(*index, name)) {
+            PyErr_Format(PyExc_ValueError, "duplicate name in %s: %R", what, name);
+            return -1;
+        }
+        PyObject *position = PyErr_Occurred() ? NULL : PyLong_FromSsize_t(i);
+        int rc = position ? PyDict_SetItem(*index, name, position) : -1;
+        Py_XDECREF(position);
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* ((resource, action), ...) and {resource: {action: number}} */
+static int permission_table(PyObject *permissions, PyObject **tuple, PyObject **index) {
+    *tuple = PySequence_Tuple(permissions);
+    *index = *tuple ? PyDict_New() : NULL;
+    if (!*index) {
+        return -1;
+    }
+    Py_ssize_t n = PyTuple_Size(*tuple);
+    if ((size_t)n > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "too many permissions");
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *pair = PyTuple_GetItem(*tuple, i);
+        PyObject *resource = PyTuple_Check(pair) && PyTuple_Size(pair) == 2 ? PyTuple_GetItem(pair, 0) : NULL;
+        PyObject *action = resource ? PyTuple_GetItem(pair, 1) : NULL;
+        if (!action || !PyUnicode_Check(resource) || !PyUnicode_Check(action)) {
+            PyErr_Format(PyExc_TypeError, "permissions must be (resource, action) tuples of str, not %R", pair);
+            return -1;
+        }
+        PyObject *actions = PyDict_GetItemWithError(*index, resource);
+        if (!actions) {
+            if (PyErr_Occurred()) {
+                return -1;
+            }
+            actions = PyDict_New();
+            int rc = actions ? PyDict_SetItem(*index, resource, actions) : -1;
+            Py_XDECREF(actions);  /* The index holds it */
+            if (rc < 0) {
+                return -1;
+            }
+        }
+        if (PyDict_GetItemWithError(actions, action)) {
+            PyErr_Format(PyExc_ValueError, "duplicate permission: %R", pair);
+            return -1;
+        }
+        PyObject *number = PyErr_Occurred() ? NULL : PyLong_FromSsize_t(i);
+        int rc = number ? PyDict_SetItem(actions, action, number) : -1;
+        Py_XDECREF(number);
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Position of name in index; 1 if absent, -1 on error */
+static int lookup(PyObject *index, PyObject *name, uint32_t *out) {
+    PyObject *position = PyDict_GetItemWithError(index, name);
+    if (!position) {
+        return PyErr_Occurred() ? -1 : 1;
+    }
+    *out = (uint32_t)PyLong_AsUnsignedLong(position);
+    return 0;
+}
+
+static int permission_number(PolicyObject *self, PyObject *action, PyObject *resource, uint32_t *out) {
+    PyObject *actions = PyDict_GetItemWithError(self->permission_ids, resource);
+    if (!actions) {
+        return PyErr_Occurred() ? -1 : 1;
+    }
+    return lookup(actions, action, out);
+}
+
+/* A role name or an iterable of them as a role mask; unknown roles hold nothing */
+static int role_mask(PolicyObject *self, PyObject *roles, uint64_t *out) {
+    uint32_t bit;
+    *out = 0;
+    if (PyUnicode_Check(roles)) {
+        int rc = lookup(self->role_bits, roles, &bit);
+        if (rc == 0) {
+            *out = UINT64_C(1) << bit;
+        }
+        return rc < 0 ? -1 : 0;
+    }
+    PyObject *seq = PySequence_Fast(roles, "roles must be a role name or an iterable of them");
+    if (!seq) {
+        return -1;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *role = PySequence_Fast_GET_ITEM(seq, i);
+        int rc = lookup(self->role_bits, role, &bit);
+        if (rc < 0) {
+            Py_DECREF(seq);
+            return -1;
+        }
+        if (rc == 0) {
+            *out |= UINT64_C(1) << bit;
+        }
+    }
+    Py_DECREF(seq);
+    return 0;
+}
+
+/* A grant's states: None (all) or an iterable of state names */
+static int state_mask(PolicyObject *self, PyObject *states, uint64_t *out) {
+    if (states == Py_None) {
+        *out = AUTHZ_ALL_STATES;
+        return 0;
+    }
+    if (PyUnicode_Check(states)) {
+        PyErr_Format(PyExc_TypeError, "grant states must be None or an iterable of state names, not %R", states);
+        return -1;
+    }
+    PyObject *seq = PySequence_Fast(states, "grant states must be None or an iterable of state names");
+    if (!seq) {
+        return -1;
+    }
+    *out = 0;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *state = PySequence_Fast_GET_ITEM(seq, i);
+        uint32_t bit;
+        int rc = lookup(self->state_bits, state, &bit);
+        if (rc != 0) {
+            if (rc > 0) {
+                PyErr_Format(PyExc_ValueError, "unknown state: %R", state);
+            }
+            Py_DECREF(seq);
+            return -1;
+        }
+        *out |= UINT64_C(1) << bit;
+    }
+    Py_DECREF(seq);
+    return 0;
+}
+
+/* (role, resource, action[, states[, own_states]]) */
+static int grant_arg(PolicyObject *self, PyObject *item, authz_grant_t *out) {
+    PyObject *seq = PySequence_Fast(item, "grants must be (role, resource, action[, states[, own_states]])");
+    if (!seq) {
+        return -1;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    int rc = -1;
+    if (n < 3 || n > 5) {
+        PyErr_Format(PyExc_TypeError, "grants must be (role, resource, action[, states[, own_states]]), not %R",
+                     item);
+        goto done;
+    }
+    PyObject *role = PySequence_Fast_GET_ITEM(seq, 0);
+    PyObject *resource = PySequence_Fast_GET_ITEM(seq, 1);
+    PyObject *action = PySequence_Fast_GET_ITEM(seq, 2);
+    int found = lookup(self->role_bits, role, &out->role);
+    if (found > 0) {
+        PyErr_Format(PyExc_ValueError, "unknown role: %R", role);
+    }
+    if (found != 0) {
+        goto done;
+    }
+    found = permission_number(self, action, resource, &out->permission);
+    if (found > 0) {
+        PyErr_Format(PyExc_ValueError, "unknown permission: (%R, %R)", resource, action);
+    }
+    if (found != 0) {
+        goto done;
+    }
+    out->states = AUTHZ_ALL_STATES;
+    out->own_states = 0;
+    if ((n > 3 && state_mask(self, PySequence_Fast_GET_ITEM(seq, 3), &out->states) < 0) ||
+        (n > 4 && state_mask(self, PySequence_Fast_GET_ITEM(seq, 4), &out->own_states) < 0)) {
+        goto done;
+    }
+    rc = 0;
+
+done:
+    Py_DECREF(seq);
+    return rc;
+}
+
+static int policy_error(int result) {
+    if (result == AUTHZ_ERR_MEMORY) {
+        PyErr_NoMemory();
+    } else {
+        PyErr_SetString(PyExc_ValueError, authz_error_string(result));
+    }
+    return -1;
+}
+
+/* Apply grants to self->policy, all or none */
+static int apply_grants(PolicyObject *self, PyObject *grants) {
+    PyObject *seq = PySequence_Fast(grants, "grants must be iterable");
+    if (!seq) {
+        return -1;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    authz_grant_t *parsed = PyMem_Calloc(n ? (size_t)n : 1, sizeof(*parsed));
+    if (!parsed) {
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return -1;
+    }
+    int rc = 0;
+    for (Py_ssize_t i = 0; i < n && rc == 0; i++) {
+        rc = grant_arg(self, PySequence_Fast_GET_ITEM(seq, i), &parsed[i]);
+    }
+    if (rc == 0) {
+        int result = authz_policy_set(self->policy, parsed, (size_t)n);
+        rc = result == AUTHZ_SUCCESS ? 0 : policy_error(result);
+    }
+    PyMem_Free(parsed);
+    Py_DECREF(seq);
+    return rc;
+}
+
+static PyObject* Policy_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"roles", "permissions", "states", "grants", NULL};
+    PyObject *roles;
+    PyObject *permissions;
+    PyObject *states = NULL;
+    PyObject *grants = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OO", kwlist, &roles, &permissions, &states, &grants)) {
+        return NULL;
+    }
+    PolicyObject *self = (PolicyObject*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        return NULL;
+    }
+    PyObject *no_states = states ? NULL : PyTuple_New(0);
+    if ((!states && !no_states) ||
+        name_table(roles, AUTHZ_MAX_ROLES, "roles", &self->roles, &self->role_bits) < 0 ||
+        permission_table(permissions, &self->permissions, &self->permission_ids) < 0 ||
+        name_table(states ? states : no_states, AUTHZ_MAX_STATES, "states", &self->states, &self->state_bits) < 0) {
+        Py_XDECREF(no_states);
+        Py_DECREF(self);
+        return NULL;
+    }
+    Py_XDECREF(no_states);
+    if (PyTuple_Size(self->roles) == 0 || PyTuple_Size(self->permissions) == 0) {
+        PyErr_SetString(PyExc_ValueError, "a policy needs at least one role and one permission");
+        Py_DECREF(self);
+        return NULL;
+    }
+    int result = authz_policy_new((size_t)PyTuple_Size(self->roles), (size_t)PyTuple_Size(self->permissions),
+                                  &self->policy);
+    if (result != AUTHZ_SUCCESS || (grants && apply_grants(self, grants) < 0)) {
+        if (result != AUTHZ_SUCCESS) {
+            policy_error(result);
+        }
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject*)self;
+}
+
+static void Policy_dealloc(PolicyObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    authz_policy_free(self->policy);
+    Py_XDECREF(self->roles);
+    Py_XDECREF(self->permissions);
+    Py_XDECREF(self->states);
+    Py_XDECREF(self->role_bits);
+    Py_XDECREF(self->permission_ids);
+    Py_XDECREF(self->state_bits);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+/* Bind (roles, action, resource) and resolve them; *known is 0 for an unknown permission */
+static int decision_args(PolicyObject *self, const char *fname, PyObject *const *args, Py_ssize_t nargs,
+                         PyObject *kwnames, const char *const *names, Py_ssize_t count, Py_ssize_t required,
+                         PyObject **argv, uint64_t *roles, uint32_t *permission, int *known) {
+    if (fastcall_bind(fname, args, nargs, kwnames, names, count, required, argv) < 0 ||
+        role_mask(self, argv[0], roles) < 0) {
+        return -1;
+    }
+    int rc = permission_number(self, argv[1], argv[2], permission);
+    *known = rc == 0;
+    return rc < 0 ? -1 : 0;
+}
+
+static PyObject* Policy_can(PolicyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"roles", "action", "resource"};
+    PyObject *argv[3];
+    uint64_t roles;
+    uint32_t permission = 0;
+    int known;
+
+    if (decision_args(self, "can", args, nargs, kwnames, names, 3, 3, argv, &roles, &permission, &known) < 0) {
+        return NULL;
+    }
+    return PyBool_FromLong(known && authz_can(self->policy, roles, permission));
+}
+
+/* The state names of a mask as a frozenset */
+static PyObject* state_names(PolicyObject *self, uint64_t mask) {
+    PyObject *names = PyFrozenSet_New(NULL);
+    Py_ssize_t n = PyTuple_Size(self->states);
+    for (Py_ssize_t i = 0; names && i < n; i++) {
+        if (((mask >> i) & 1) && PySet_Add(names, PyTuple_GetItem(self->states, i)) < 0) {
+            Py_CLEAR(names);
+        }
+    }
+    return names;
+}
+
+static PyObject* Policy_scope(PolicyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"roles", "action", "resource"};
+    PyObject *argv[3];
+    uint64_t roles;
+    uint32_t permission = 0;
+    int known;
+    uint64_t states = 0;
+    uint64_t own_states = 0;
+
+    if (decision_args(self, "scope", args, nargs, kwnames, names, 3, 3, argv, &roles, &permission, &known) < 0) {
+        return NULL;
+    }
+    if (known) {
+        authz_scope(self->policy, roles, permission, &states, &own_states);
+    }
+    PyObject *any = state_names(self, states);
+    PyObject *own = any ? state_names(self, own_states) : NULL;
+    PyObject *result = own ? PyTuple_Pack(2, any, own) : NULL;
+    Py_XDECREF(any);
+    Py_XDECREF(own);
+    return result;
+}
+
+/* An owner or subject: an int, or None for nobody */
+static int owner_arg(PyObject *arg, int64_t *out) {
+    if (!arg || arg == Py_None) {
+        *out = AUTHZ_NO_OWNER;
+        return 0;
+    }
+    long long v = PyLong_AsLongLong(arg);
+    if (v == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static PyObject* Policy_filter(PolicyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"roles", "action", "resource", "states", "owners", "subject"};
+    PyObject *argv[6];
+    uint64_t roles;
+    uint32_t permission = 0;
+    int known;
+    int64_t subject;
+
+    if (decision_args(self, "filter", args, nargs, kwnames, names, 6, 4, argv, &roles, &permission, &known) < 0 ||
+        owner_arg(argv[5], &subject) < 0) {
+        return NULL;
+    }
+    PyObject *states = PySequence_Fast(argv[3], "states must be a sequence");
+    if (!states) {
+        return NULL;
+    }
+    PyObject *owners = NULL;
+    if (argv[4] && argv[4] != Py_None) {
+        owners = PySequence_Fast(argv[4], "owners must be a sequence or None");
+        if (!owners) {
+            Py_DECREF(states);
+            return NULL;
+        }
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(states);
+    PyObject *result = NULL;
+    uint8_t *state_ids = NULL;
+    int64_t *owner_ids = NULL;
+    uint64_t *allowed = NULL;
+    if (owners && PySequence_Fast_GET_SIZE(owners) != n) {
+        PyErr_SetString(PyExc_ValueError, "states and owners must have the same length");
+        goto done;
+    }
+
+    state_ids = PyMem_Malloc(n ? (size_t)n : 1);
+    owner_ids = owners ? PyMem_Malloc((n ? (size_t)n : 1) * sizeof(*owner_ids)) : NULL;
+    allowed = PyMem_Malloc(((size_t)n / 64 + 1) * sizeof(*allowed));
+    if (!state_ids || (owners && !owner_ids) || !allowed) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < n; i++) {
+        uint32_t bit;
+        int rc = lookup(self->state_bits, PySequence_Fast_GET_ITEM(states, i), &bit);
+        if (rc < 0 || (owners && owner_arg(PySequence_Fast_GET_ITEM(owners, i), &owner_ids[i]) < 0)) {
+            goto done;
+        }
+        state_ids[i] = rc == 0 ? (uint8_t)bit : NO_STATE;
+    }
+
+    size_t count = 0;
+    if (known) {
+        authz_filter(self->policy, roles, permission, subject, state_ids, owner_ids, (size_t)n, allowed, &count);
+    }
+    result = PyList_New((Py_ssize_t)count);
+    for (Py_ssize_t i = 0, k = 0; result && k < (Py_ssize_t)count; i++) {
+        if ((allowed[i / 64] >> (i % 64)) & 1) {
+            PyObject *index = PyLong_FromSsize_t(i);
+            if (!index) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, k++, index);
+        }
+    }
+
+done:
+    PyMem_Free(state_ids);
+    PyMem_Free(owner_ids);
+    PyMem_Free(allowed);
+    Py_XDECREF(owners);
+    Py_DECREF(states);
+    return result;
+}
+
+static PyObject* Policy_replace(PolicyObject *self, PyObject *grants) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    PolicyObject *copy = (PolicyObject*)PyType_GenericAlloc(type, 0);
+    if (!copy) {
+        return NULL;
+    }
+    int result = authz_policy_copy(self->policy, &copy->policy);
+    if (result != AUTHZ_SUCCESS) {
+        policy_error(result);
+        Py_DECREF(copy);
+        return NULL;
+    }
+    /* The name tables are never modified, so the copy shares them */
+    copy->roles = Py_NewRef(self->roles);
+    copy->permissions = Py_NewRef(self->permissions);
+    copy->states = Py_NewRef(self->states);
+    copy->role_bits = Py_NewRef(self->role_bits);
+    copy->permission_ids = Py_NewRef(self->permission_ids);
+    copy->state_bits = Py_NewRef(self->state_bits);
+    if (apply_grants(copy, grants) < 0) {
+        Py_DECREF(copy);
+        return NULL;
+    }
+    return (PyObject*)copy;
+}
+
+static PyObject* Policy_get_roles(PolicyObject *self, void *closure) {
+    return Py_NewRef(self->roles);
+}
+
+static PyObject* Policy_get_permissions(PolicyObject *self, void *closure) {
+    return Py_NewRef(self->permissions);
+}
+
+static PyObject* Policy_get_states(PolicyObject *self, void *closure) {
+    return Py_NewRef(self->states);
+}
+
+static PyMethodDef PolicyMethods[] = {
+    {"can", (PyCFunction)(void(*)(void))Policy_can, METH_FASTCALL | METH_KEYWORDS,
+     "can(roles, action, resource): whether any of the roles (a name or an iterable of names) holds the "
+     "permission, on at least some objects; False for an unknown permission"},
+    {"scope", (PyCFunction)(void(*)(void))Policy_scope, METH_FASTCALL | METH_KEYWORDS,
+     "scope(roles, action, resource): (states, own_states), frozensets of the states of objects the roles may "
+     "act on, and of further states allowed on objects the user owns"},
+    {"filter", (PyCFunction)(void(*)(void))Policy_filter, METH_FASTCALL | METH_KEYWORDS,
+     "filter(roles, action, resource, states, owners=None, subject=None): indexes of the allowed objects, given "
+     "each object's state and owner (None: no owner)"},
+    {"replace", (PyCFunction)Policy_replace, METH_O,
+     "A new Policy with the grants of the (role, resource, action) cells named replaced; an empty states and "
+     "own_states revokes"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef PolicyGetSet[] = {
+    {"roles", (getter)Policy_get_roles, NULL, NULL, NULL},
+    {"permissions", (getter)Policy_get_permissions, NULL, NULL, NULL},
+    {"states", (getter)Policy_get_states, NULL, NULL, NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot PolicySlots[] = {
+    {Py_tp_doc, "Immutable role/permission policy: Policy(roles, permissions, states=(), grants=()), with "
+                "permissions as (resource, action) and grants as (role, resource, action[, states[, own_states]]); "
+                "states None or omitted: every state"},
+    {Py_tp_new, Policy_new},
+    {Py_tp_dealloc, Policy_dealloc},
+    {Py_tp_methods, PolicyMethods},
+    {Py_tp_getset, PolicyGetSet},
+    {0, NULL}
+};
+
+static PyType_Spec PolicySpec = {
+    .name = "hospital_native._authz.Policy",
+    .basicsize = sizeof(PolicyObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = PolicySlots,
+};
+
+/* The type is created per module object (multi-phase init), so the module can be loaded in several interpreters */
+static int authz_exec(PyObject *m) {
+    PyObject *type = PyType_FromModuleAndSpec(m, &PolicySpec, NULL);
+    if (!type) {
+        return -1;
+    }
+    int rc = PyModule_AddType(m, (PyTypeObject*)type);
+    Py_DECREF(type);
+    if (rc < 0 || PyModule_AddIntConstant(m, "MAX_ROLES", AUTHZ_MAX_ROLES) < 0 ||
+        PyModule_AddIntConstant(m, "MAX_STATES", AUTHZ_MAX_STATES) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot authz_slots[] = {
+    {Py_mod_exec, authz_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL}
+};
+
+static struct PyModuleDef authzmodule = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "_authz",
+    .m_doc = "Role/permission policy decisions",
+    .m_size = 0,
+    .m_slots = authz_slots,
+};
+
+PyMODINIT_FUNC PyInit__authz(void) {
+    return PyModuleDef_Init(&authzmodule);
+}
@@ -1,11 +1,25 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include "libcutils.h"
+#include "fastcall.h"
+#include "native_stats.h"
+#include <stdio.h>
+#include <string.h>
 
-static PyObject* py_aes_gcm_encrypt(PyObject* self, PyObject* args) {
+/*
+ * Inputs at or below this size are processed without releasing the GIL;
+ * the release/reacquire round-trip costs more than encrypting an SSN.
+ */
+#define CUTILS_GIL_RELEASE_THRESHOLD 4096
+
+static PyObject* py_aes_gcm_encrypt(PyObject* self, PyObject *const *args, Py_ssize_t nargs) {
     Py_buffer plaintext_buf, key_buf;
     
-    if (!PyArg_ParseTuple(args, "y*y*", &plaintext_buf, &key_buf)) {
+    if (fastcall_nargs("aes_gcm_encrypt", nargs, 2, 2) < 0 || fastcall_buffer(args[0], &plaintext_buf) < 0) {
+        return NULL;
+    }
+    if (fastcall_buffer(args[1], &key_buf) < 0) {
+        PyBuffer_Release(&plaintext_buf);
         return NULL;
     }
     
@@ -24,8 +38,9 @@ static PyObject* py_aes_gcm_encrypt(PyObject* self, PyObject* args) {
         return PyErr_NoMemory();
     }
     
+    int result;
     Py_BEGIN_ALLOW_THREADS
-    int result = cutils_aes_gcm_encrypt(
+    result = cutils_aes_gcm_encrypt(
         plaintext_buf.buf, plaintext_buf.len,
         key_buf.buf, output, &output_len
     );
@@ -45,10 +60,14 @@ static PyObject* py_aes_gcm_encrypt(PyObject* self, PyObject* args) {
     return ret;
 }
 
-static PyObject* py_aes_gcm_decrypt(PyObject* self, PyObject* args) {
+static PyObject* py_aes_gcm_decrypt(PyObject* self, PyObject *const *args, Py_ssize_t nargs) {
     Py_buffer ciphertext_buf, key_buf;
     
-    if (!PyArg_ParseTuple(args, "y*y*", &ciphertext_buf, &key_buf)) {
+    if (fastcall_nargs("aes_gcm_decrypt", nargs, 2, 2) < 0 || fastcall_buffer(args[0], &ciphertext_buf) < 0) {
+        return NULL;
+    }
+    if (fastcall_buffer(args[1], &key_buf) < 0) {
+        PyBuffer_Release(&ciphertext_buf);
         return NULL;
     }
     
@@ -67,8 +86,9 @@ static PyObject* py_aes_gcm_decrypt(PyObject* self, PyObject* args) {
         return PyErr_NoMemory();
     }
     
+    int result;
     Py_BEGIN_ALLOW_THREADS
-    int result = cutils_aes_gcm_decrypt(
+    result = cutils_aes_gcm_decrypt(
         ciphertext_buf.buf, ciphertext_buf.len,
         key_buf.buf, output, &output_len
     );
@@ -88,18 +108,246 @@ static PyObject* py_aes_gcm_decrypt(PyObject* self, PyObject* args) {
     return ret;
 }
 
-static PyObject* py_sha256(PyObject* self, PyObject* args) {
+/*
+ * Shared implementation of the *_many entry points: collect buffers for
+ * every item, run the whole batch in one native call with the GIL released,
+ * then build the result list (None for records that failed).
+ */
+static PyObject* gcm_many(PyObject *items, int encrypt,
+                          const uint8_t *raw_key, const cutils_key_t *handle) {
+    PyObject *seq = PySequence_Fast(items, "expected a sequence of bytes-like objects");
+    if (!seq) {
+        return NULL;
+    }
+
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    Py_buffer *bufs = PyMem_Calloc(count ? count : 1, sizeof(Py_buffer));
+    cutils_buf_t *inputs = PyMem_Calloc(count ? count : 1, sizeof(cutils_buf_t));
+    cutils_batch_result_t *results = PyMem_Calloc(count ? count : 1, sizeof(cutils_batch_result_t));
+    uint8_t *arena = NULL;
+    size_t arena_size = 0;
+    PyObject *ret = NULL;
+    Py_ssize_t acquired = 0;
+    int result;
+
+    if (!bufs || !inputs || !results) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    for (; acquired < count; acquired++) {
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, acquired), &bufs[acquired], PyBUF_SIMPLE) < 0) {
+            goto cleanup;
+        }
+        inputs[acquired].data = bufs[acquired].buf;
+        inputs[acquired].len = bufs[acquired].len;
+    }
+
+    arena_size = cutils_aes_gcm_batch_size(encrypt, inputs, count);
+    arena = PyMem_Malloc(arena_size ? arena_size : 1);
+    if (!arena) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    if (handle) {
+        result = encrypt
+            ? cutils_key_encrypt_many(handle, inputs, count, arena, arena_size, results)
+            : cutils_key_decrypt_many(handle, inputs, count, arena, arena_size, results);
+    } else {
+        result = encrypt
+            ? cutils_aes_gcm_encrypt_many(raw_key, inputs, count, arena, arena_size, results)
+            : cutils_aes_gcm_decrypt_many(raw_key, inputs, count, arena, arena_size, results);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        goto cleanup;
+    }
+
+    ret = PyList_New(count);
+    if (!ret) {
+        goto cleanup;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item;
+        if (results[i].status == CUTILS_SUCCESS) {
+            item = PyBytes_FromStringAndSize((char*)arena + results[i].offset, results[i].len);
+            if (!item) {
+                Py_CLEAR(ret);
+                goto cleanup;
+            }
+        } else {
+            item = Py_NewRef(Py_None);
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+
+cleanup:
+    for (Py_ssize_t i = 0; i < acquired; i++) {
+        PyBuffer_Release(&bufs[i]);
+    }
+    if (arena && !encrypt) {
+        /* Plaintext copies now live in the result bytes; wipe the arena */
+        memset(arena, 0, arena_size);
+    }
+    PyMem_Free(arena);
+    PyMem_Free(results);
+    PyMem_Free(inputs);
+    PyMem_Free(bufs);
+    Py_DECREF(seq);
+    return ret;
+}
+
+static PyObject* py_aes_gcm_many(const char *fname, PyObject *const *args, Py_ssize_t nargs, int encrypt) {
+    Py_buffer key_buf;
+
+    if (fastcall_nargs(fname, nargs, 2, 2) < 0 || fastcall_buffer(args[1], &key_buf) < 0) {
+        return NULL;
+    }
+    PyObject *items = args[0];
+
+    if (key_buf.len != CUTILS_AES_KEY_SIZE) {
+        PyBuffer_Release(&key_buf);
+        PyErr_SetString(PyExc_ValueError, "Key must be 32 bytes");
+        return NULL;
+    }
+
+    PyObject *ret = gcm_many(items, encrypt, key_buf.buf, NULL);
+    PyBuffer_Release(&key_buf);
+    return ret;
+}
+
+static PyObject* py_aes_gcm_encrypt_many(PyObject* self, PyObject *const *args, Py_ssize_t nargs) {
+    return py_aes_gcm_many("aes_gcm_encrypt_many", args, nargs, 1);
+}
+
+static PyObject* py_aes_gcm_decrypt_many(PyObject* self, PyObject *const *args, Py_ssize_t nargs) {
+    return py_aes_gcm_many("aes_gcm_decrypt_many", args, nargs, 0);
+}
+
+static PyObject* py_reencrypt_batch(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"items", "old_key", "new_key", "threads"};
+    PyObject *argv[4];
+    Py_buffer old_buf, new_buf;
+    unsigned int threads = 0;
+
+    if (fastcall_bind("reencrypt_batch", args, nargs, kwnames, names, 4, 3, argv) < 0 ||
+        fastcall_uint(argv[3], &threads) < 0 || fastcall_buffer(argv[1], &old_buf) < 0) {
+        return NULL;
+    }
+    if (fastcall_buffer(argv[2], &new_buf) < 0) {
+        PyBuffer_Release(&old_buf);
+        return NULL;
+    }
+    PyObject *items = argv[0];
+
+    PyObject *seq = NULL;
+    Py_buffer *bufs = NULL;
+    cutils_buf_t *inputs = NULL;
+    cutils_batch_result_t *results = NULL;
+    uint8_t *output = NULL;
+    size_t output_size = 0;
+    Py_ssize_t count = 0;
+    Py_ssize_t acquired = 0;
+    PyObject *ret = NULL;
+    int result;
+
+    if (old_buf.len != CUTILS_AES_KEY_SIZE || new_buf.len != CUTILS_AES_KEY_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "Key must be 32 bytes");
+        goto cleanup;
+    }
+
+    seq = PySequence_Fast(items, "expected a sequence of bytes-like objects");
+    if (!seq) {
+        goto cleanup;
+    }
+    count = PySequence_Fast_GET_SIZE(seq);
+
+    bufs = PyMem_Calloc(count ? count : 1, sizeof(Py_buffer));
+    inputs = PyMem_Calloc(count ? count : 1, sizeof(cutils_buf_t));
+    results = PyMem_Calloc(count ? count : 1, sizeof(cutils_batch_result_t));
+    if (!bufs || !inputs || !results) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    for (; acquired < count; acquired++) {
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, acquired), &bufs[acquired], PyBUF_SIMPLE) < 0) {
+            goto cleanup;
+        }
+        inputs[acquired].data = bufs[acquired].buf;
+        inputs[acquired].len = bufs[acquired].len;
+        output_size += bufs[acquired].len;
+    }
+
+    output = PyMem_Malloc(output_size ? output_size : 1);
+    if (!output) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = cutils_reencrypt_batch(old_buf.buf, new_buf.buf, inputs, count,
+                                    output, output_size, results, threads);
+    Py_END_ALLOW_THREADS
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        goto cleanup;
+    }
+
+    ret = PyList_New(count);
+    if (!ret) {
+        goto cleanup;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item;
+        if (results[i].status == CUTILS_SUCCESS) {
+            item = PyBytes_FromStringAndSize((char*)output + results[i].offset, results[i].len);
+            if (!item) {
+                Py_CLEAR(ret);
+                goto cleanup;
+            }
+        } else {
+            item = Py_NewRef(Py_None);
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+
+cleanup:
+    for (Py_ssize_t i = 0; i < acquired; i++) {
+        PyBuffer_Release(&bufs[i]);
+    }
+    PyMem_Free(output);
+    PyMem_Free(results);
+    PyMem_Free(inputs);
+    PyMem_Free(bufs);
+    Py_XDECREF(seq);
+    PyBuffer_Release(&old_buf);
+    PyBuffer_Release(&new_buf);
+    return ret;
+}
+
+static PyObject* py_sha256(PyObject* self, PyObject* arg) {
     Py_buffer data_buf;
     
-    if (!PyArg_ParseTuple(args, "y*", &data_buf)) {
+    if (fastcall_buffer(arg, &data_buf) < 0) {
         return NULL;
     }
     
     uint8_t output[CUTILS_SHA256_SIZE];
     
-    Py_BEGIN_ALLOW_THREADS
-    int result = cutils_sha256(data_buf.buf, data_buf.len, output);
-    Py_END_ALLOW_THREADS
+    int result;
+    if (data_buf.len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_sha256(data_buf.buf, data_buf.len, output);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_sha256(data_buf.buf, data_buf.len, output);
+    }
     
     PyBuffer_Release(&data_buf);
     
@@ -111,12 +359,197 @@ static PyObject* py_sha256(PyObject* self, PyObject* args) {
     return PyBytes_FromStringAndSize((char*)output, CUTILS_SHA256_SIZE);
 }
 
+/*
+ * The values argument of a batch call as a tuple. A list is copied: the
+ * GIL may be released while the batch runs, and another thread could
+ * replace a str item, freeing the UTF-8 data collect_values borrowed.
+ */
+static PyObject* values_tuple(PyObject *values) {
+    PyObject *seq = PySequence_Fast(values, "expected a sequence of str or bytes-like objects");
+    if (!seq || PyTuple_CheckExact(seq)) {
+        return seq;
+    }
+    PyObject *copy = PyList_AsTuple(seq);
+    Py_DECREF(seq);
+    return copy;
+}
+
+/*
+ * Borrow the bytes of every str (as UTF-8) or bytes-like object in seq,
+ * a tuple. The UTF-8 form is cached on each str and the tuple keeps it
+ * alive, so only the buffers need releasing (release_value_buffers, also
+ * on failure).
+ */
+static int collect_values(PyObject *seq, Py_buffer *bufs, cutils_buf_t *inputs) {
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+        if (PyUnicode_Check(item)) {
+            Py_ssize_t len;
+            const char *utf8 = PyUnicode_AsUTF8AndSize(item, &len);
+            if (!utf8) {
+                return -1;
+            }
+            inputs[i].data = (const uint8_t*)utf8;
+            inputs[i].len = len;
+        } else {
+            if (PyObject_GetBuffer(item, &bufs[i], PyBUF_SIMPLE) < 0) {
+                return -1;
+            }
+            inputs[i].data = bufs[i].buf;
+            inputs[i].len = bufs[i].len;
+        }
+    }
+    return 0;
+}
+
+static void release_value_buffers(Py_buffer *bufs, Py_ssize_t count) {
+    for (Py_ssize_t i = 0; bufs && i < count; i++) {
+        PyBuffer_Release(&bufs[i]);
+    }
+}
+
+/*
+ * Hex of len bytes as a new str. With the full API the encoder writes
+ * straight into a compact ASCII str (room for the NUL it appends); the
+ * limited API has no such access, so the hex goes through a scratch buffer.
+ */
+static PyObject* hex_str(const uint8_t *data, Py_ssize_t len) {
+    if (len > PY_SSIZE_T_MAX / 2 - 1) {
+        return PyErr_NoMemory();
+    }
+#ifdef Py_LIMITED_API
+    char *output = PyMem_Malloc(len * 2 + 1);
+    if (!output) {
+        return PyErr_NoMemory();
+    }
+#else
+    PyObject *ret = PyUnicode_New(len * 2, 127);
+    if (!ret) {
+        return NULL;
+    }
+    char *output = (char*)PyUnicode_DATA(ret);
+#endif
+
+    if (len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        cutils_hex_encode(data, len, output);
+        Py_END_ALLOW_THREADS
+    } else {
+        cutils_hex_encode(data, len, output);
+    }
+
+#ifdef Py_LIMITED_API
+    PyObject *ret = PyUnicode_FromStringAndSize(output, len * 2);
+    PyMem_Free(output);
+#endif
+    return ret;
+}
+
+/* List of hex str for count consecutive SHA-256-sized digests */
+static PyObject* digests_to_hex_list(const uint8_t *digests, Py_ssize_t count) {
+    PyObject *ret = PyList_New(count);
+    if (!ret) {
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *hex = hex_str(digests + i * CUTILS_SHA256_SIZE, CUTILS_SHA256_SIZE);
+        if (!hex) {
+            Py_DECREF(ret);
+            return NULL;
+        }
+        PyList_SET_ITEM(ret, i, hex);
+    }
+    return ret;
+}
+
+/*
+ * sha256_hex_many(values, salt=None): hex SHA-256 of salt || value for every
+ * str (UTF-8) or bytes-like value, hashed in one native call. The hex is
+ * written straight into the result str objects.
+ */
+static PyObject* py_sha256_hex_many(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"values", "salt"};
+    PyObject *argv[2];
+
+    if (fastcall_bind("sha256_hex_many", args, nargs, kwnames, names, 2, 1, argv) < 0) {
+        return NULL;
+    }
+    PyObject *values = argv[0];
+    PyObject *salt_obj = argv[1] ? argv[1] : Py_None;
+
+    PyObject *seq = values_tuple(values);
+    if (!seq) {
+        return NULL;
+    }
+
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    Py_buffer salt_buf = {0};
+    Py_buffer *bufs = PyMem_Calloc(count ? count : 1, sizeof(Py_buffer));
+    cutils_buf_t *inputs = PyMem_Calloc(count ? count : 1, sizeof(cutils_buf_t));
+    uint8_t *digests = PyMem_Malloc(count ? count * CUTILS_SHA256_SIZE : 1);
+    const uint8_t *salt = NULL;
+    size_t salt_len = 0;
+    PyObject *ret = NULL;
+    int result;
+
+    if (!bufs || !inputs || !digests) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+
+    if (salt_obj != Py_None) {
+        if (PyUnicode_Check(salt_obj)) {
+            Py_ssize_t len;
+            salt = (const uint8_t*)PyUnicode_AsUTF8AndSize(salt_obj, &len);
+            if (!salt) {
+                goto cleanup;
+            }
+            salt_len = len;
+        } else {
+            if (PyObject_GetBuffer(salt_obj, &salt_buf, PyBUF_SIMPLE) < 0) {
+                goto cleanup;
+            }
+            salt = salt_buf.buf;
+            salt_len = salt_buf.len;
+        }
+    }
+
+    if (collect_values(seq, bufs, inputs) < 0) {
+        goto cleanup;
+    }
+
+    if (count > 64) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_sha256_many(inputs, count, salt, salt_len, digests);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_sha256_many(inputs, count, salt, salt_len, digests);
+    }
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        goto cleanup;
+    }
+
+    ret = digests_to_hex_list(digests, count);
+
+cleanup:
+    release_value_buffers(bufs, count);
+    PyBuffer_Release(&salt_buf);
+    PyMem_Free(digests);
+    PyMem_Free(inputs);
+    PyMem_Free(bufs);
+    Py_DECREF(seq);
+    return ret;
+}
+
 static PyObject* py_generate_token(PyObject* self, PyObject* args) {
     uint8_t output[CUTILS_TOKEN_SIZE];
     
-    Py_BEGIN_ALLOW_THREADS
+    /* Served from the per-thread pool: not worth dropping the GIL */
     int result = cutils_generate_token(output);
-    Py_END_ALLOW_THREADS
     
     if (result != CUTILS_SUCCESS) {
         PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
@@ -126,50 +559,1531 @@ static PyObject* py_generate_token(PyObject* self, PyObject* args) {
     return PyBytes_FromStringAndSize((char*)output, CUTILS_TOKEN_SIZE);
 }
 
-static PyObject* py_hex_encode(PyObject* self, PyObject* args) {
+/*
+ * generate_tokens(n, size=32, hex=True): n random tokens from one pooled
+ * CSPRNG draw, returned as hex str (encoded in place) or bytes.
+ */
+static PyObject* py_generate_tokens(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"n", "size", "hex"};
+    PyObject *argv[3];
+    Py_ssize_t count;
+    Py_ssize_t size = CUTILS_TOKEN_SIZE;
+    int as_hex = 1;
+
+    if (fastcall_bind("generate_tokens", args, nargs, kwnames, names, 3, 1, argv) < 0 ||
+        fastcall_ssize(argv[0], &count) < 0 || fastcall_ssize(argv[1], &size) < 0 ||
+        fastcall_bool(argv[2], &as_hex) < 0) {
+        return NULL;
+    }
+    if (count < 0 || size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "n must be >= 0 and size must be > 0");
+        return NULL;
+    }
+    if (count && size > PY_SSIZE_T_MAX / 2 / count) {
+        return PyErr_NoMemory();
+    }
+
+    size_t total = (size_t)count * (size_t)size;
+    uint8_t *raw = PyMem_Malloc(total ? total : 1);
+    if (!raw) {
+        return PyErr_NoMemory();
+    }
+
+    int result;
+    if (total > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_random_bytes(raw, total);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_random_bytes(raw, total);
+    }
+
+    PyObject *ret = NULL;
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        goto cleanup;
+    }
+
+    ret = PyList_New(count);
+    if (!ret) {
+        goto cleanup;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        const uint8_t *token = raw + (size_t)i * (size_t)size;
+        PyObject *item;
+        if (as_hex) {
+            item = hex_str(token, size);
+        } else {
+            item = PyBytes_FromStringAndSize((const char*)token, size);
+        }
+        if (!item) {
+            Py_CLEAR(ret);
+            goto cleanup;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+
+cleanup:
+    /* Tokens now live only in the result objects */
+    memset(raw, 0, total);
+    PyMem_Free(raw);
+    return ret;
+}
+
+static PyObject* py_hex_encode(PyObject* self, PyObject* arg) {
     Py_buffer data_buf;
     
-    if (!PyArg_ParseTuple(args, "y*", &data_buf)) {
+    if (PyObject_GetBuffer(arg, &data_buf, PyBUF_SIMPLE) < 0) {
         return NULL;
     }
     
-    char *output = PyMem_Malloc(data_buf.len * 2 + 1);
-    if (!output) {
+    PyObject *ret = hex_str(data_buf.buf, data_buf.len);
+    PyBuffer_Release(&data_buf);
+    return ret;
+}
+
+static PyObject* py_hex_decode(PyObject* self, PyObject* arg) {
+    Py_buffer data_buf = {0};
+    const char *hex;
+    Py_ssize_t hex_len;
+
+    if (PyUnicode_Check(arg)) {
+#ifdef Py_LIMITED_API
+        /* UTF-8 is one byte per character only for ASCII */
+        hex = PyUnicode_AsUTF8AndSize(arg, &hex_len);
+        if (!hex) {
+            return NULL;
+        }
+        if (hex_len != PyUnicode_GetLength(arg)) {
+#else
+        hex = (const char*)PyUnicode_DATA(arg);
+        hex_len = PyUnicode_GET_LENGTH(arg);
+        if (!PyUnicode_IS_ASCII(arg)) {
+#endif
+            PyErr_SetString(PyExc_ValueError, "Invalid hex string");
+            return NULL;
+        }
+    } else {
+        if (PyObject_GetBuffer(arg, &data_buf, PyBUF_SIMPLE) < 0) {
+            return NULL;
+        }
+        hex = data_buf.buf;
+        hex_len = data_buf.len;
+    }
+
+    if (hex_len % 2 != 0) {
         PyBuffer_Release(&data_buf);
-        return PyErr_NoMemory();
+        PyErr_SetString(PyExc_ValueError, "Hex string must have even length");
+        return NULL;
+    }
+
+    PyObject *ret = PyBytes_FromStringAndSize(NULL, hex_len / 2);
+    if (!ret) {
+        PyBuffer_Release(&data_buf);
+        return NULL;
+    }
+
+    int result;
+    uint8_t *output = (uint8_t*)PyBytes_AS_STRING(ret);
+    if (hex_len > CUTILS_GIL_RELEASE_THRESHOLD && data_buf.obj) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_hex_decode_len(hex, hex_len, output, NULL);
+        Py_END_ALLOW_THREADS
+    } else {
+        /* str data must not be touched without the GIL */
+        result = cutils_hex_decode_len(hex, hex_len, output, NULL);
     }
-    
-    int result = cutils_hex_encode(data_buf.buf, data_buf.len, output);
     PyBuffer_Release(&data_buf);
-    
+
+    if (result != CUTILS_SUCCESS) {
+        Py_DECREF(ret);
+        PyErr_SetString(PyExc_ValueError, "Invalid hex string");
+        return NULL;
+    }
+
+    return ret;
+}
+
+/* AesKey: AES-256-GCM key with the key schedule expanded once */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_key_t *key;
+} AesKeyObject;
+
+/* The key is set once here: encrypt/decrypt may be using it without the GIL */
+static PyObject* AesKey_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"key", NULL};
+    Py_buffer key_buf;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*", kwlist, &key_buf)) {
+        return NULL;
+    }
+
+    if (key_buf.len != CUTILS_AES_KEY_SIZE) {
+        PyBuffer_Release(&key_buf);
+        PyErr_SetString(PyExc_ValueError, "Key must be 32 bytes");
+        return NULL;
+    }
+
+    AesKeyObject *self = (AesKeyObject*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        PyBuffer_Release(&key_buf);
+        return NULL;
+    }
+
+    int result = cutils_key_new(key_buf.buf, &self->key);
+    PyBuffer_Release(&key_buf);
+
     if (result != CUTILS_SUCCESS) {
-        PyMem_Free(output);
         PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        Py_DECREF(self);
         return NULL;
     }
-    
-    PyObject *ret = PyUnicode_FromString(output);
-    PyMem_Free(output);
+    return (PyObject*)self;
+}
+
+static void AesKey_dealloc(AesKeyObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    cutils_key_free(self->key);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static PyObject* AesKey_encrypt(AesKeyObject *self, PyObject *arg) {
+    Py_buffer plaintext_buf;
+
+    if (PyObject_GetBuffer(arg, &plaintext_buf, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    size_t output_len = plaintext_buf.len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE;
+    PyObject *ret = PyBytes_FromStringAndSize(NULL, output_len);
+    if (!ret) {
+        PyBuffer_Release(&plaintext_buf);
+        return NULL;
+    }
+
+    int result;
+    uint8_t *output = (uint8_t*)PyBytes_AS_STRING(ret);
+    if (plaintext_buf.len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_key_encrypt(self->key, plaintext_buf.buf, plaintext_buf.len,
+                                    output, &output_len);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_key_encrypt(self->key, plaintext_buf.buf, plaintext_buf.len,
+                                    output, &output_len);
+    }
+
+    PyBuffer_Release(&plaintext_buf);
+
+    if (result != CUTILS_SUCCESS) {
+        Py_DECREF(ret);
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        return NULL;
+    }
+
     return ret;
 }
 
-static PyMethodDef CutilsMethods[] = {
-    {"aes_gcm_encrypt", py_aes_gcm_encrypt, METH_VARARGS, "Encrypt with AES-256-GCM"},
-    {"aes_gcm_decrypt", py_aes_gcm_decrypt, METH_VARARGS, "Decrypt with AES-256-GCM"},
-    {"sha256", py_sha256, METH_VARARGS, "Compute SHA-256 hash"},
-    {"generate_token", py_generate_token, METH_NOARGS, "Generate random token"},
-    {"hex_encode", py_hex_encode, METH_VARARGS, "Encode bytes as hex"},
-    {NULL, NULL, 0, NULL}
+static PyObject* AesKey_decrypt(AesKeyObject *self, PyObject *arg) {
+    Py_buffer ciphertext_buf;
+
+    if (PyObject_GetBuffer(arg, &ciphertext_buf, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    if (ciphertext_buf.len < CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE) {
+        PyBuffer_Release(&ciphertext_buf);
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(CUTILS_ERR_INVALID_SIZE));
+        return NULL;
+    }
+
+    size_t output_len = ciphertext_buf.len - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE;
+    PyObject *ret = PyBytes_FromStringAndSize(NULL, output_len);
+    if (!ret) {
+        PyBuffer_Release(&ciphertext_buf);
+        return NULL;
+    }
+
+    int result;
+    uint8_t *output = (uint8_t*)PyBytes_AS_STRING(ret);
+    if (ciphertext_buf.len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_key_decrypt(self->key, ciphertext_buf.buf, ciphertext_buf.len,
+                                    output, &output_len);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_key_decrypt(self->key, ciphertext_buf.buf, ciphertext_buf.len,
+                                    output, &output_len);
+    }
+
+    PyBuffer_Release(&ciphertext_buf);
+
+    if (result != CUTILS_SUCCESS) {
+        Py_DECREF(ret);
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        return NULL;
+    }
+
+    return ret;
+}
+
+static PyObject* AesKey_encrypt_many(AesKeyObject *self, PyObject *items) {
+    return gcm_many(items, 1, NULL, self->key);
+}
+
+static PyObject* AesKey_decrypt_many(AesKeyObject *self, PyObject *items) {
+    return gcm_many(items, 0, NULL, self->key);
+}
+
+static PyMethodDef AesKeyMethods[] = {
+    {"encrypt", (PyCFunction)AesKey_encrypt, METH_O, "Encrypt with AES-256-GCM"},
+    {"decrypt", (PyCFunction)AesKey_decrypt, METH_O, "Decrypt with AES-256-GCM"},
+    {"encrypt_many", (PyCFunction)AesKey_encrypt_many, METH_O, "Encrypt a sequence of records in one call"},
+    {"decrypt_many", (PyCFunction)AesKey_decrypt_many, METH_O, "Decrypt a sequence of records in one call (None on failure)"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot AesKeySlots[] = {
+    {Py_tp_doc, "AES-256-GCM key with a pre-expanded key schedule"},
+    {Py_tp_new, AesKey_new},
+    {Py_tp_dealloc, AesKey_dealloc},
+    {Py_tp_methods, AesKeyMethods},
+    {0, NULL}
+};
+
+static PyType_Spec AesKeySpec = {
+    .name = "hospital_native._cutils.AesKey",
+    .basicsize = sizeof(AesKeyObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = AesKeySlots,
+};
+
+/* XXH3: non-cryptographic 64/128-bit hashing */
+
+static PyObject* xxh128_to_long(cutils_xxh128_t h) {
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)h.high, (unsigned long long)h.low);
+    return PyLong_FromString(hex, NULL, 16);
+}
+
+static PyObject* py_xxh3_64(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"data", "seed"};
+    PyObject *argv[2];
+    Py_buffer data_buf;
+    unsigned long long seed = 0;
+
+    if (fastcall_bind("xxh3_64", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_ulonglong(argv[1], &seed) < 0 || fastcall_buffer(argv[0], &data_buf) < 0) {
+        return NULL;
+    }
+
+    uint64_t h;
+    if (data_buf.len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        h = cutils_xxh3_64(data_buf.buf, data_buf.len, seed);
+        Py_END_ALLOW_THREADS
+    } else {
+        h = cutils_xxh3_64(data_buf.buf, data_buf.len, seed);
+    }
+
+    PyBuffer_Release(&data_buf);
+    return PyLong_FromUnsignedLongLong(h);
+}
+
+static PyObject* py_xxh3_128(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"data", "seed"};
+    PyObject *argv[2];
+    Py_buffer data_buf;
+    unsigned long long seed = 0;
+
+    if (fastcall_bind("xxh3_128", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_ulonglong(argv[1], &seed) < 0 || fastcall_buffer(argv[0], &data_buf) < 0) {
+        return NULL;
+    }
+
+    cutils_xxh128_t h;
+    if (data_buf.len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        h = cutils_xxh3_128(data_buf.buf, data_buf.len, seed);
+        Py_END_ALLOW_THREADS
+    } else {
+        h = cutils_xxh3_128(data_buf.buf, data_buf.len, seed);
+    }
+
+    PyBuffer_Release(&data_buf);
+    return xxh128_to_long(h);
+}
+
+static PyObject* py_xxh3_impl(PyObject* self, PyObject* Py_UNUSED(ignored)) {
+    return PyUnicode_FromString(cutils_xxh3_impl());
+}
+
+/*
+ * Xxh3: streaming hasher. Large updates run without the GIL, so the state
+ * is guarded by its own lock (same scheme as hashlib objects).
+ */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_xxh3_state_t state;
+    PyThread_type_lock lock;
+} Xxh3Object;
+
+static void Xxh3_acquire(Xxh3Object *self) {
+    if (!PyThread_acquire_lock(self->lock, 0)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+static PyObject* Xxh3_update_impl(Xxh3Object *self, Py_buffer *data_buf) {
+    Xxh3_acquire(self);
+    if (data_buf->len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        cutils_xxh3_update(&self->state, data_buf->buf, data_buf->len);
+        Py_END_ALLOW_THREADS
+    } else {
+        cutils_xxh3_update(&self->state, data_buf->buf, data_buf->len);
+    }
+    PyThread_release_lock(self->lock);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Xxh3_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"data", "seed", NULL};
+    Py_buffer data_buf = {0};
+    unsigned long long seed = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|y*K", kwlist, &data_buf, &seed)) {
+        return NULL;
+    }
+
+    Xxh3Object *self = (Xxh3Object*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        PyBuffer_Release(&data_buf);
+        return NULL;
+    }
+
+    self->lock = PyThread_allocate_lock();
+    if (!self->lock) {
+        PyBuffer_Release(&data_buf);
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+
+    cutils_xxh3_init(&self->state, seed);
+    if (data_buf.obj) {
+        PyObject *r = Xxh3_update_impl(self, &data_buf);
+        Py_XDECREF(r);
+        PyBuffer_Release(&data_buf);
+    }
+    return (PyObject*)self;
+}
+
+static void Xxh3_dealloc(Xxh3Object *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    if (self->lock) {
+        PyThread_free_lock(self->lock);
+    }
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static PyObject* Xxh3_update(Xxh3Object *self, PyObject *arg) {
+    Py_buffer data_buf;
+
+    if (PyObject_GetBuffer(arg, &data_buf, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    PyObject *ret = Xxh3_update_impl(self, &data_buf);
+    PyBuffer_Release(&data_buf);
+    return ret;
+}
+
+static uint64_t Xxh3_digest64(Xxh3Object *self) {
+    Xxh3_acquire(self);
+    uint64_t h = cutils_xxh3_digest(&self->state);
+    PyThread_release_lock(self->lock);
+    return h;
+}
+
+static cutils_xxh128_t Xxh3_digest128(Xxh3Object *self) {
+    Xxh3_acquire(self);
+    cutils_xxh128_t h = cutils_xxh3_128_digest(&self->state);
+    PyThread_release_lock(self->lock);
+    return h;
+}
+
+static PyObject* Xxh3_intdigest(Xxh3Object *self, PyObject *Py_UNUSED(ignored)) {
+    return PyLong_FromUnsignedLongLong(Xxh3_digest64(self));
+}
+
+static PyObject* Xxh3_intdigest128(Xxh3Object *self, PyObject *Py_UNUSED(ignored)) {
+    return xxh128_to_long(Xxh3_digest128(self));
+}
+
+static PyObject* Xxh3_hexdigest(Xxh3Object *self, PyObject *Py_UNUSED(ignored)) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)Xxh3_digest64(self));
+    return PyUnicode_FromString(hex);
+}
+
+static PyObject* Xxh3_hexdigest128(Xxh3Object *self, PyObject *Py_UNUSED(ignored)) {
+    char hex[33];
+    cutils_xxh128_t h = Xxh3_digest128(self);
+    snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)h.high, (unsigned long long)h.low);
+    return PyUnicode_FromString(hex);
+}
+
+static PyObject* Xxh3_copy(Xxh3Object *self, PyObject *Py_UNUSED(ignored)) {
+    Xxh3Object *copy = (Xxh3Object*)PyType_GenericAlloc(Py_TYPE((PyObject*)self), 0);
+    if (!copy) {
+        return NULL;
+    }
+
+    copy->lock = PyThread_allocate_lock();
+    if (!copy->lock) {
+        Py_DECREF(copy);
+        return PyErr_NoMemory();
+    }
+
+    Xxh3_acquire(self);
+    copy->state = self->state;
+    PyThread_release_lock(self->lock);
+    return (PyObject*)copy;
+}
+
+static PyObject* Xxh3_reset(Xxh3Object *self, PyObject *Py_UNUSED(ignored)) {
+    Xxh3_acquire(self);
+    cutils_xxh3_init(&self->state, self->state.seed);
+    PyThread_release_lock(self->lock);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef Xxh3Methods[] = {
+    {"update", (PyCFunction)Xxh3_update, METH_O, "Feed more data into the hash"},
+    {"intdigest", (PyCFunction)Xxh3_intdigest, METH_NOARGS, "64-bit digest as an int"},
+    {"intdigest128", (PyCFunction)Xxh3_intdigest128, METH_NOARGS, "128-bit digest as an int"},
+    {"hexdigest", (PyCFunction)Xxh3_hexdigest, METH_NOARGS, "64-bit digest as 16 hex characters"},
+    {"hexdigest128", (PyCFunction)Xxh3_hexdigest128, METH_NOARGS, "128-bit digest as 32 hex characters"},
+    {"copy", (PyCFunction)Xxh3_copy, METH_NOARGS, "Return an independent copy of the hasher"},
+    {"reset", (PyCFunction)Xxh3_reset, METH_NOARGS, "Discard all input, keeping the seed"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot Xxh3Slots[] = {
+    {Py_tp_doc, "Streaming XXH3 hasher: Xxh3(data=b'', seed=0)"},
+    {Py_tp_new, Xxh3_new},
+    {Py_tp_dealloc, Xxh3_dealloc},
+    {Py_tp_methods, Xxh3Methods},
+    {0, NULL}
+};
+
+static PyType_Spec Xxh3Spec = {
+    .name = "hospital_native._cutils.Xxh3",
+    .basicsize = sizeof(Xxh3Object),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Xxh3Slots,
+};
+
+/*
+ * Sha256: streaming SHA-256 with a hashlib-compatible interface. update()
+ * takes any buffer-protocol object without copying; large updates run
+ * without the GIL under the object's own lock.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_sha256_ctx_t *ctx;
+    PyThread_type_lock lock;
+} Sha256Object;
+
+static void Sha256_acquire(Sha256Object *self) {
+    if (!PyThread_acquire_lock(self->lock, 0)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+static Sha256Object* Sha256_alloc(PyTypeObject *type) {
+    Sha256Object *self = (Sha256Object*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        return NULL;
+    }
+
+    self->lock = PyThread_allocate_lock();
+    if (!self->lock) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    int result = cutils_sha256_new(&self->ctx);
+    if (result != CUTILS_SUCCESS) {
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        return NULL;
+    }
+    return self;
+}
+
+static int Sha256_update_impl(Sha256Object *self, Py_buffer *data_buf) {
+    int result;
+    Sha256_acquire(self);
+    if (data_buf->len > CUTILS_GIL_RELEASE_THRESHOLD) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_sha256_update(self->ctx, data_buf->buf, data_buf->len);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_sha256_update(self->ctx, data_buf->buf, data_buf->len);
+    }
+    PyThread_release_lock(self->lock);
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* Sha256_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"data", NULL};
+    Py_buffer data_buf = {0};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|y*", kwlist, &data_buf)) {
+        return NULL;
+    }
+
+    Sha256Object *self = Sha256_alloc(type);
+    if (self && data_buf.obj && Sha256_update_impl(self, &data_buf) < 0) {
+        Py_CLEAR(self);
+    }
+    PyBuffer_Release(&data_buf);
+    return (PyObject*)self;
+}
+
+static void Sha256_dealloc(Sha256Object *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    cutils_sha256_free(self->ctx);
+    if (self->lock) {
+        PyThread_free_lock(self->lock);
+    }
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static PyObject* Sha256_update(Sha256Object *self, PyObject *arg) {
+    Py_buffer data_buf;
+
+    if (PyObject_GetBuffer(arg, &data_buf, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    int rc = Sha256_update_impl(self, &data_buf);
+    PyBuffer_Release(&data_buf);
+    if (rc < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static int Sha256_peek(Sha256Object *self, uint8_t *digest) {
+    Sha256_acquire(self);
+    int result = cutils_sha256_peek(self->ctx, digest);
+    PyThread_release_lock(self->lock);
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* Sha256_digest(Sha256Object *self, PyObject *Py_UNUSED(ignored)) {
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    if (Sha256_peek(self, digest) < 0) {
+        return NULL;
+    }
+    return PyBytes_FromStringAndSize((char*)digest, CUTILS_SHA256_SIZE);
+}
+
+static PyObject* Sha256_hexdigest(Sha256Object *self, PyObject *Py_UNUSED(ignored)) {
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    if (Sha256_peek(self, digest) < 0) {
+        return NULL;
+    }
+    return hex_str(digest, CUTILS_SHA256_SIZE);
+}
+
+static PyObject* Sha256_copy(Sha256Object *self, PyObject *Py_UNUSED(ignored)) {
+    Sha256Object *copy = Sha256_alloc(Py_TYPE((PyObject*)self));
+    if (!copy) {
+        return NULL;
+    }
+
+    Sha256_acquire(self);
+    int result = cutils_sha256_copy(copy->ctx, self->ctx);
+    PyThread_release_lock(self->lock);
+
+    if (result != CUTILS_SUCCESS) {
+        Py_DECREF(copy);
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        return NULL;
+    }
+    return (PyObject*)copy;
+}
+
+static PyObject* Sha256_get_name(Sha256Object *self, void *closure) {
+    return PyUnicode_FromString("sha256");
+}
+
+static PyObject* Sha256_get_digest_size(Sha256Object *self, void *closure) {
+    return PyLong_FromLong(CUTILS_SHA256_SIZE);
+}
+
+static PyObject* Sha256_get_block_size(Sha256Object *self, void *closure) {
+    return PyLong_FromLong(64);
+}
+
+static PyMethodDef Sha256Methods[] = {
+    {"update", (PyCFunction)Sha256_update, METH_O, "Feed more data into the hash"},
+    {"digest", (PyCFunction)Sha256_digest, METH_NOARGS, "Digest of the data so far as bytes"},
+    {"hexdigest", (PyCFunction)Sha256_hexdigest, METH_NOARGS, "Digest of the data so far as hex"},
+    {"copy", (PyCFunction)Sha256_copy, METH_NOARGS, "Return an independent copy of the hasher"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Sha256GetSet[] = {
+    {"name", (getter)Sha256_get_name, NULL, NULL, NULL},
+    {"digest_size", (getter)Sha256_get_digest_size, NULL, NULL, NULL},
+    {"block_size", (getter)Sha256_get_block_size, NULL, NULL, NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot Sha256Slots[] = {
+    {Py_tp_doc, "Streaming SHA-256 hasher: Sha256(data=b'')"},
+    {Py_tp_new, Sha256_new},
+    {Py_tp_dealloc, Sha256_dealloc},
+    {Py_tp_methods, Sha256Methods},
+    {Py_tp_getset, Sha256GetSet},
+    {0, NULL}
+};
+
+static PyType_Spec Sha256Spec = {
+    .name = "hospital_native._cutils.Sha256",
+    .basicsize = sizeof(Sha256Object),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Sha256Slots,
+};
+
+/*
+ * Pseudonymizer: keyed HMAC-SHA256 tokens for de-identified extracts. The
+ * native handle is created in tp_new and never replaced, so no per-object
+ * lock is needed to use it without the GIL.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_pseudonymizer_t *ps;
+} PseudonymizerObject;
+
+static PyObject* Pseudonymizer_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"key", NULL};
+    Py_buffer key_buf;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*", kwlist, &key_buf)) {
+        return NULL;
+    }
+
+    if (key_buf.len == 0) {
+        PyBuffer_Release(&key_buf);
+        PyErr_SetString(PyExc_ValueError, "Key must not be empty");
+        return NULL;
+    }
+
+    PseudonymizerObject *self = (PseudonymizerObject*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        PyBuffer_Release(&key_buf);
+        return NULL;
+    }
+
+    int result = cutils_pseudonymizer_new(key_buf.buf, key_buf.len, &self->ps);
+    PyBuffer_Release(&key_buf);
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject*)self;
+}
+
+static void Pseudonymizer_dealloc(PseudonymizerObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    cutils_pseudonymizer_free(self->ps);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static PyObject* Pseudonymizer_pseudonymize(PseudonymizerObject *self, PyObject *arg) {
+
+    PyObject *seq = PyTuple_Pack(1, arg);
+    if (!seq) {
+        return NULL;
+    }
+
+    Py_buffer buf = {0};
+    cutils_buf_t input;
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    PyObject *ret = NULL;
+
+    if (collect_values(seq, &buf, &input) == 0) {
+        int result = cutils_pseudonymize(self->ps, input.data, input.len, digest);
+        if (result == CUTILS_SUCCESS) {
+            ret = hex_str(digest, sizeof(digest));
+        } else {
+            PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        }
+    }
+
+    release_value_buffers(&buf, 1);
+    Py_DECREF(seq);
+    return ret;
+}
+
+static PyObject* Pseudonymizer_pseudonymize_many(PseudonymizerObject *self, PyObject *const *args,
+                                                 Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"values", "threads"};
+    PyObject *argv[2];
+    unsigned int num_threads = 0;
+
+    if (fastcall_bind("pseudonymize_many", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_uint(argv[1], &num_threads) < 0) {
+        return NULL;
+    }
+    PyObject *values = argv[0];
+
+    PyObject *seq = values_tuple(values);
+    if (!seq) {
+        return NULL;
+    }
+
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    Py_buffer *bufs = PyMem_Calloc(count ? count : 1, sizeof(Py_buffer));
+    cutils_buf_t *inputs = PyMem_Calloc(count ? count : 1, sizeof(cutils_buf_t));
+    uint8_t *digests = PyMem_Malloc(count ? count * CUTILS_SHA256_SIZE : 1);
+    PyObject *ret = NULL;
+    int result;
+
+    if (!bufs || !inputs || !digests) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    if (collect_values(seq, bufs, inputs) < 0) {
+        goto cleanup;
+    }
+
+    /* Small batches are not worth a GIL round trip or extra threads */
+    if (count > 64) {
+        Py_BEGIN_ALLOW_THREADS
+        result = cutils_pseudonymize_many(self->ps, inputs, count, digests, num_threads);
+        Py_END_ALLOW_THREADS
+    } else {
+        result = cutils_pseudonymize_many(self->ps, inputs, count, digests, 1);
+    }
+
+    if (result != CUTILS_SUCCESS) {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+        goto cleanup;
+    }
+
+    ret = digests_to_hex_list(digests, count);
+
+cleanup:
+    release_value_buffers(bufs, count);
+    PyMem_Free(digests);
+    PyMem_Free(inputs);
+    PyMem_Free(bufs);
+    Py_DECREF(seq);
+    return ret;
+}
+
+static PyMethodDef PseudonymizerMethods[] = {
+    {"pseudonymize", (PyCFunction)Pseudonymizer_pseudonymize, METH_O,
+     "Hex HMAC-SHA256 token for one str (UTF-8) or bytes-like value"},
+    {"pseudonymize_many", (PyCFunction)(void(*)(void))Pseudonymizer_pseudonymize_many, METH_FASTCALL | METH_KEYWORDS,
+     "Hex tokens for every value, hashed by a native worker pool (threads=0: all CPUs)"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot PseudonymizerSlots[] = {
+    {Py_tp_doc, "Keyed HMAC-SHA256 pseudonymizer: Pseudonymizer(key)"},
+    {Py_tp_new, Pseudonymizer_new},
+    {Py_tp_dealloc, Pseudonymizer_dealloc},
+    {Py_tp_methods, PseudonymizerMethods},
+    {0, NULL}
+};
+
+static PyType_Spec PseudonymizerSpec = {
+    .name = "hospital_native._cutils.Pseudonymizer",
+    .basicsize = sizeof(PseudonymizerObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = PseudonymizerSlots,
+};
+
+/*
+ * AuditLog: hash-chained append-only audit file. append() only queues (the
+ * native writer thread hashes and writes), so it runs with the GIL held;
+ * flush() and close() wait for the writer without it. The object lock keeps
+ * close() from freeing the log under a flush in progress.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_audit_t *log;
+    PyThread_type_lock lock;
+} AuditLogObject;
+
+static void AuditLog_acquire(AuditLogObject *self) {
+    if (!PyThread_acquire_lock(self->lock, 0)) {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, 1);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+/* Exception for a failed audit call; errno is only meaningful for open/verify */
+static PyObject* audit_error(int result, PyObject *path) {
+    if (result == CUTILS_ERR_IO && path) {
+        return PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+    }
+    if (result == CUTILS_ERR_IO) {
+        PyErr_SetString(PyExc_OSError, "audit log write failed");
+    } else if (result == CUTILS_ERR_BUFFER_SIZE) {
+        PyErr_SetString(PyExc_BlockingIOError, "audit queue is full");
+    } else if (result == CUTILS_ERR_INVALID_SIZE || result == CUTILS_ERR_INTEGRITY) {
+        PyErr_SetString(PyExc_ValueError, cutils_error_string(result));
+    } else {
+        PyErr_SetString(PyExc_RuntimeError, cutils_error_string(result));
+    }
+    return NULL;
+}
+
+/* Optional 32-byte seed: NULL for None */
+static int audit_seed(Py_buffer *seed_buf, const uint8_t **seed) {
+    *seed = NULL;
+    if (!seed_buf->obj) {
+        return 0;
+    }
+    if (seed_buf->len != CUTILS_SHA256_SIZE) {
+        PyErr_SetString(PyExc_ValueError, "seed must be 32 bytes");
+        return -1;
+    }
+    *seed = seed_buf->buf;
+    return 0;
+}
+
+static PyObject* AuditLog_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"path", "seed", "sync", NULL};
+    PyObject *path_arg;
+    PyObject *path = NULL;
+    Py_buffer seed_buf = {0};
+    int sync = 0;
+    const uint8_t *seed;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|z*p", kwlist, &path_arg, &seed_buf, &sync)) {
+        return NULL;
+    }
+
+    AuditLogObject *self = NULL;
+    if (audit_seed(&seed_buf, &seed) < 0 || !PyUnicode_FSConverter(path_arg, &path)) {
+        goto done;
+    }
+    self = (AuditLogObject*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        goto done;
+    }
+    self->lock = PyThread_allocate_lock();
+    if (!self->lock) {
+        Py_CLEAR(self);
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = cutils_audit_open(PyBytes_AS_STRING(path), seed, sync ? CUTILS_AUDIT_SYNC : 0, &self->log);
+    Py_END_ALLOW_THREADS
+    if (result != CUTILS_SUCCESS) {
+        audit_error(result, path_arg);
+        Py_CLEAR(self);
+    }
+
+done:
+    PyBuffer_Release(&seed_buf);
+    Py_XDECREF(path);
+    return (PyObject*)self;
+}
+
+static void AuditLog_dealloc(AuditLogObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    /* The writer never needs the GIL, so waiting for it here is safe */
+    cutils_audit_close(self->log);
+    if (self->lock) {
+        PyThread_free_lock(self->lock);
+    }
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static int AuditLog_check(AuditLogObject *self) {
+    if (!self->log) {
+        PyErr_SetString(PyExc_ValueError, "AuditLog is closed");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* AuditLog_append(AuditLogObject *self, PyObject *arg) {
+    if (AuditLog_check(self) < 0) {
+        return NULL;
+    }
+
+    int result;
+    if (PyUnicode_Check(arg)) {
+        Py_ssize_t len;
+        const char *data = PyUnicode_AsUTF8AndSize(arg, &len);
+        if (!data) {
+            return NULL;
+        }
+        result = cutils_audit_append(self->log, (const uint8_t*)data, (size_t)len);
+    } else {
+        Py_buffer buf;
+        if (PyObject_GetBuffer(arg, &buf, PyBUF_SIMPLE) < 0) {
+            return NULL;
+        }
+        result = cutils_audit_append(self->log, buf.buf, (size_t)buf.len);
+        PyBuffer_Release(&buf);
+    }
+
+    if (result != CUTILS_SUCCESS) {
+        return audit_error(result, NULL);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* AuditLog_flush(AuditLogObject *self, PyObject *Py_UNUSED(ignored)) {
+    AuditLog_acquire(self);
+    if (AuditLog_check(self) < 0) {
+        PyThread_release_lock(self->lock);
+        return NULL;
+    }
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = cutils_audit_flush(self->log);
+    Py_END_ALLOW_THREADS
+    PyThread_release_lock(self->lock);
+
+    if (result != CUTILS_SUCCESS) {
+        return audit_error(result, NULL);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* AuditLog_head(AuditLogObject *self, PyObject *Py_UNUSED(ignored)) {
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    uint64_t count;
+
+    if (AuditLog_check(self) < 0) {
+        return NULL;
+    }
+    int result = cutils_audit_head(self->log, digest, &count);
+    if (result != CUTILS_SUCCESS) {
+        return audit_error(result, NULL);
+    }
+    return Py_BuildValue("(Ky#)", (unsigned long long)count, (const char*)digest, (Py_ssize_t)sizeof(digest));
+}
+
+static PyObject* AuditLog_close(AuditLogObject *self, PyObject *Py_UNUSED(ignored)) {
+    /* Detach first: appends from here on see a closed log */
+    cutils_audit_t *log = self->log;
+    self->log = NULL;
+    if (!log) {
+        Py_RETURN_NONE;
+    }
+
+    int result;
+    AuditLog_acquire(self);
+    Py_BEGIN_ALLOW_THREADS
+    result = cutils_audit_close(log);
+    Py_END_ALLOW_THREADS
+    PyThread_release_lock(self->lock);
+
+    if (result != CUTILS_SUCCESS) {
+        return audit_error(result, NULL);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* AuditLog_enter(AuditLogObject *self, PyObject *Py_UNUSED(ignored)) {
+    if (AuditLog_check(self) < 0) {
+        return NULL;
+    }
+    return Py_NewRef((PyObject*)self);
+}
+
+static PyObject* AuditLog_exit(AuditLogObject *self, PyObject *args) {
+    return AuditLog_close(self, NULL);
+}
+
+static PyMethodDef AuditLogMethods[] = {
+    {"append", (PyCFunction)AuditLog_append, METH_O,
+     "Queue one entry (str as UTF-8, or bytes-like); the writer thread chains and writes it"},
+    {"flush", (PyCFunction)AuditLog_flush, METH_NOARGS, "Wait until every entry appended so far is written"},
+    {"head", (PyCFunction)AuditLog_head, METH_NOARGS,
+     "(records written, digest of the last one) -- anchor it elsewhere to detect truncation"},
+    {"close", (PyCFunction)AuditLog_close, METH_NOARGS, "Write out queued entries and close the file"},
+    {"__enter__", (PyCFunction)AuditLog_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)AuditLog_exit, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot AuditLogSlots[] = {
+    {Py_tp_doc, "Tamper-evident audit log: AuditLog(path, seed=None, sync=False); one writer per file"},
+    {Py_tp_new, AuditLog_new},
+    {Py_tp_dealloc, AuditLog_dealloc},
+    {Py_tp_methods, AuditLogMethods},
+    {0, NULL}
+};
+
+static PyType_Spec AuditLogSpec = {
+    .name = "hospital_native._cutils.AuditLog",
+    .basicsize = sizeof(AuditLogObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = AuditLogSlots,
+};
+
+static PyObject* py_audit_verify(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"path", "seed"};
+    PyObject *argv[2];
+    PyObject *path;
+    Py_buffer seed_buf = {0};
+    const uint8_t *seed;
+
+    if (fastcall_bind("audit_verify", args, nargs, kwnames, names, 2, 1, argv) < 0) {
+        return NULL;
+    }
+    if (argv[1] && argv[1] != Py_None && fastcall_buffer(argv[1], &seed_buf) < 0) {
+        return NULL;
+    }
+    if (audit_seed(&seed_buf, &seed) < 0 || !PyUnicode_FSConverter(argv[0], &path)) {
+        PyBuffer_Release(&seed_buf);
+        return NULL;
+    }
+
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    uint64_t count;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = cutils_audit_verify(PyBytes_AS_STRING(path), seed, digest, &count);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&seed_buf);
+
+    PyObject *ret = NULL;
+    if (result == CUTILS_ERR_INTEGRITY) {
+        PyErr_Format(PyExc_ValueError, "audit chain broken at record %llu", (unsigned long long)count);
+    } else if (result != CUTILS_SUCCESS) {
+        audit_error(result, argv[0]);
+    } else {
+        ret = Py_BuildValue("(Ky#)", (unsigned long long)count, (const char*)digest, (Py_ssize_t)sizeof(digest));
+    }
+    Py_DECREF(path);
+    return ret;
+}
+
+/* A str (as UTF-8) or bytes-like key; release *buf when done (it is left empty for str) */
+static int key_bytes(PyObject *arg, Py_buffer *buf, const uint8_t **data, size_t *len) {
+    buf->obj = NULL;
+    if (PyUnicode_Check(arg)) {
+        Py_ssize_t n;
+        const char *utf8 = PyUnicode_AsUTF8AndSize(arg, &n);
+        if (!utf8) {
+            return -1;
+        }
+        *data = (const uint8_t*)utf8;
+        *len = (size_t)n;
+        return 0;
+    }
+    if (PyObject_GetBuffer(arg, buf, PyBUF_SIMPLE) < 0) {
+        return -1;
+    }
+    *data = buf->buf;
+    *len = (size_t)buf->len;
+    return 0;
+}
+
+/*
+ * RateLimiter: rate buckets in shared memory, shared by every process that
+ * opens the same name. Calls are lock-free and take well under a
+ * microsecond, so they keep the GIL; the table is only unmapped on dealloc.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_ratelimit_t *rl;
+} RateLimiterObject;
+
+static PyObject* ratelimit_error(int result, PyObject *name) {
+    if (result == CUTILS_ERR_IO) {
+        return name ? PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, name) : PyErr_SetFromErrno(PyExc_OSError);
+    }
+    PyErr_SetString(result == CUTILS_ERR_INVALID_SIZE || result == CUTILS_ERR_INTEGRITY ? PyExc_ValueError
+                                                                                       : PyExc_RuntimeError,
+                    cutils_error_string(result));
+    return NULL;
+}
+
+static PyObject* RateLimiter_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"name", "slots", NULL};
+    PyObject *name_arg = Py_None;
+    Py_ssize_t slots = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|On", kwlist, &name_arg, &slots)) {
+        return NULL;
+    }
+    const char *name = NULL;
+    if (name_arg != Py_None && !(name = PyUnicode_AsUTF8AndSize(name_arg, NULL))) {
+        return NULL;
+    }
+    if (slots < 0) {
+        PyErr_SetString(PyExc_ValueError, "slots must not be negative");
+        return NULL;
+    }
+
+    RateLimiterObject *self = (RateLimiterObject*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        return NULL;
+    }
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = cutils_ratelimit_open(name, (size_t)slots, &self->rl);
+    Py_END_ALLOW_THREADS
+    if (result != CUTILS_SUCCESS) {
+        ratelimit_error(result, name ? name_arg : NULL);
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject*)self;
+}
+
+static void RateLimiter_dealloc(RateLimiterObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    cutils_ratelimit_close(self->rl);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static PyObject* RateLimiter_hit(RateLimiterObject *self, PyObject *const *args, Py_ssize_t nargs,
+                                 PyObject *kwnames) {
+    static const char *const names[] = {"key", "limit", "window"};
+    PyObject *argv[3];
+    unsigned int limit;
+
+    if (fastcall_bind("hit", args, nargs, kwnames, names, 3, 3, argv) < 0 || fastcall_uint(argv[1], &limit) < 0) {
+        return NULL;
+    }
+    double window = PyFloat_AsDouble(argv[2]);
+    if (window == -1.0 && PyErr_Occurred()) {
+        return NULL;
+    }
+    if (!(window >= 1e-9 && window <= 1e9) || limit == 0) {
+        PyErr_SetString(PyExc_ValueError, "limit must be positive and window between 1 ns and 1e9 s");
+        return NULL;
+    }
+
+    Py_buffer buf;
+    const uint8_t *key;
+    size_t key_len;
+    if (key_bytes(argv[0], &buf, &key, &key_len) < 0) {
+        return NULL;
+    }
+    uint64_t retry_ns;
+    int result = cutils_ratelimit_hit(self->rl, key, key_len, limit, (uint64_t)(window * 1e9), &retry_ns);
+    PyBuffer_Release(&buf);
+    if (result != CUTILS_SUCCESS) {
+        return ratelimit_error(result, NULL);
+    }
+    return PyFloat_FromDouble((double)retry_ns / 1e9);
+}
+
+static PyObject* RateLimiter_reset(RateLimiterObject *self, PyObject *arg) {
+    Py_buffer buf;
+    const uint8_t *key;
+    size_t key_len;
+    if (key_bytes(arg, &buf, &key, &key_len) < 0) {
+        return NULL;
+    }
+    int result = cutils_ratelimit_reset(self->rl, key, key_len);
+    PyBuffer_Release(&buf);
+    if (result != CUTILS_SUCCESS) {
+        return ratelimit_error(result, NULL);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef RateLimiterMethods[] = {
+    {"hit", (PyCFunction)(void(*)(void))RateLimiter_hit, METH_FASTCALL | METH_KEYWORDS,
+     "hit(key, limit, window): count a hit allowing limit per window seconds; 0.0 if allowed, else seconds to "
+     "wait (a denied hit is not counted)"},
+    {"reset", (PyCFunction)RateLimiter_reset, METH_O, "Refill a key's bucket"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot RateLimiterSlots[] = {
+    {Py_tp_doc, "Shared-memory rate buckets: RateLimiter(name=None, slots=0); name is a POSIX shm name such as "
+                "'/hospital-ratelimit', None keeps the table to this process and its later forks"},
+    {Py_tp_new, RateLimiter_new},
+    {Py_tp_dealloc, RateLimiter_dealloc},
+    {Py_tp_methods, RateLimiterMethods},
+    {0, NULL}
+};
+
+static PyType_Spec RateLimiterSpec = {
+    .name = "hospital_native._cutils.RateLimiter",
+    .basicsize = sizeof(RateLimiterObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = RateLimiterSlots,
+};
+
+static PyObject* py_ratelimit_unlink(PyObject* self, PyObject *arg) {
+    const char *name = PyUnicode_AsUTF8AndSize(arg, NULL);
+    if (!name) {
+        return NULL;
+    }
+    int result = cutils_ratelimit_unlink(name);
+    if (result != CUTILS_SUCCESS) {
+        return ratelimit_error(result, arg);
+    }
+    Py_RETURN_NONE;
+}
+
+/*
+ * IpSet: immutable set of IPv4/IPv6 networks, built once from strings.
+ * Being read-only after construction, lookups need no lock.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    cutils_ipset_t *set;
+} IpSetObject;
+
+static PyObject* IpSet_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"networks", NULL};
+    PyObject *networks = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &networks)) {
+        return NULL;
+    }
+    IpSetObject *self = (IpSetObject*)PyType_GenericAlloc(type, 0);
+    if (!self) {
+        return NULL;
+    }
+    if (cutils_ipset_new(&self->set) != CUTILS_SUCCESS) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    if (!networks) {
+        return (PyObject*)self;
+    }
+
+    PyObject *iter = PyObject_GetIter(networks);
+    if (!iter) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    PyObject *item;
+    while ((item = PyIter_Next(iter))) {
+        const char *text = PyUnicode_Check(item) ? PyUnicode_AsUTF8AndSize(item, NULL) : NULL;
+        uint8_t addr[16];
+        size_t addr_len;
+        unsigned int prefix_len;
+        int result = text ? cutils_ip_parse(text, addr, &addr_len, &prefix_len) : CUTILS_ERR_INVALID_SIZE;
+        if (result == CUTILS_SUCCESS) {
+            result = cutils_ipset_add(self->set, addr, addr_len, prefix_len);
+        }
+        if (result != CUTILS_SUCCESS) {
+            if (!PyErr_Occurred()) {
+                if (result == CUTILS_ERR_INVALID_SIZE) {
+                    PyErr_Format(PyExc_ValueError, "invalid network: %R", item);
+                } else {
+                    PyErr_NoMemory();
+                }
+            }
+            Py_DECREF(item);
+            break;
+        }
+        Py_DECREF(item);
+    }
+    Py_DECREF(iter);
+    if (PyErr_Occurred()) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject*)self;
+}
+
+static void IpSet_dealloc(IpSetObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    cutils_ipset_free(self->set);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+/* `ip in set`: False for anything but an address string */
+static int IpSet_contains(IpSetObject *self, PyObject *arg) {
+    if (!PyUnicode_Check(arg)) {
+        return 0;
+    }
+    const char *text = PyUnicode_AsUTF8AndSize(arg, NULL);
+    if (!text) {
+        return -1;
+    }
+    uint8_t addr[16];
+    size_t addr_len;
+    unsigned int prefix_len;
+    int found = 0;
+    if (cutils_ip_parse(text, addr, &addr_len, &prefix_len) != CUTILS_SUCCESS || prefix_len != addr_len * 8) {
+        return 0;
+    }
+    cutils_ipset_contains(self->set, addr, addr_len, &found);
+    return found;
+}
+
+static PyType_Slot IpSetSlots[] = {
+    {Py_tp_doc, "Immutable set of IP networks: IpSet(['10.0.0.0/8', '2001:db8::/32', '203.0.113.9']); "
+                "'10.1.2.3' in s"},
+    {Py_tp_new, IpSet_new},
+    {Py_tp_dealloc, IpSet_dealloc},
+    {Py_sq_contains, IpSet_contains},
+    {0, NULL}
+};
+
+static PyType_Spec IpSetSpec = {
+    .name = "hospital_native._cutils.IpSet",
+    .basicsize = sizeof(IpSetObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = IpSetSlots,
+};
+
+/* Instrumentation counters (built with HOSPITAL_NATIVE_STATS) as {api: counters} */
+static PyObject* py_stats(PyObject* self, PyObject* Py_UNUSED(ignored)) {
+    size_t n = cutils_stats_snapshot(NULL, 0);
+    cutils_stats_t *entries = PyMem_Calloc(n ? n : 1, sizeof(*entries));
+    if (!entries) {
+        return PyErr_NoMemory();
+    }
+    n = cutils_stats_snapshot(entries, n);
+
+    PyObject *result = PyDict_New();
+    for (size_t i = 0; result && i < n; i++) {
+        const cutils_stats_t *e = &entries[i];
+        PyObject *entry = native_stats_entry(e->calls, e->bytes, e->total_ns, e->errors, CUTILS_STATS_ERROR_CODES,
+                                             e->latency, CUTILS_STATS_LATENCY_BUCKETS);
+        if (!entry || PyDict_SetItemString(result, e->name, entry) < 0) {
+            Py_CLEAR(result);
+        }
+        Py_XDECREF(entry);
+    }
+    PyMem_Free(entries);
+    return result;
+}
+
+static PyObject* py_reset_stats(PyObject* self, PyObject* Py_UNUSED(ignored)) {
+    cutils_stats_reset();
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef CutilsMethods[] = {
+    {"aes_gcm_encrypt", (PyCFunction)(void(*)(void))py_aes_gcm_encrypt, METH_FASTCALL, "Encrypt with AES-256-GCM"},
+    {"aes_gcm_decrypt", (PyCFunction)(void(*)(void))py_aes_gcm_decrypt, METH_FASTCALL, "Decrypt with AES-256-GCM"},
+    {"aes_gcm_encrypt_many", (PyCFunction)(void(*)(void))py_aes_gcm_encrypt_many, METH_FASTCALL,
+     "Encrypt a sequence of records with AES-256-GCM"},
+    {"aes_gcm_decrypt_many", (PyCFunction)(void(*)(void))py_aes_gcm_decrypt_many, METH_FASTCALL,
+     "Decrypt a sequence of records (None on failure)"},
+    {"reencrypt_batch", (PyCFunction)(void(*)(void))py_reencrypt_batch, METH_FASTCALL | METH_KEYWORDS,
+     "Re-encrypt records from old_key to new_key using a native worker pool (None on failure)"},
+    {"sha256", py_sha256, METH_O, "Compute SHA-256 hash"},
+    {"sha256_hex_many", (PyCFunction)(void(*)(void))py_sha256_hex_many, METH_FASTCALL | METH_KEYWORDS,
+     "Hex SHA-256 of salt + value for every value in one call"},
+    {"generate_token", py_generate_token, METH_NOARGS, "Generate random token"},
+    {"generate_tokens", (PyCFunction)(void(*)(void))py_generate_tokens, METH_FASTCALL | METH_KEYWORDS,
+     "Generate n random tokens of size bytes (hex str by default) in one call"},
+    {"hex_encode", py_hex_encode, METH_O, "Encode bytes as hex"},
+    {"hex_decode", py_hex_decode, METH_O, "Decode a hex str or bytes-like object to bytes"},
+    {"xxh3_64", (PyCFunction)(void(*)(void))py_xxh3_64, METH_FASTCALL | METH_KEYWORDS,
+     "64-bit XXH3 hash of data (non-cryptographic)"},
+    {"xxh3_128", (PyCFunction)(void(*)(void))py_xxh3_128, METH_FASTCALL | METH_KEYWORDS,
+     "128-bit XXH3 hash of data as an int (non-cryptographic)"},
+    {"xxh3_impl", py_xxh3_impl, METH_NOARGS, "Name of the XXH3 kernel selected for this CPU"},
+    {"audit_verify", (PyCFunction)(void(*)(void))py_audit_verify, METH_FASTCALL | METH_KEYWORDS,
+     "Recompute an AuditLog file's chain: (records, head digest); ValueError at the first broken record"},
+    {"ratelimit_unlink", py_ratelimit_unlink, METH_O,
+     "Remove a named RateLimiter table (processes attached to it keep their mapping)"},
+    {"stats", py_stats, METH_NOARGS,
+     "Per-API call, byte, error and latency counters since start or reset_stats() (empty unless the library "
+     "was built with HOSPITAL_NATIVE_STATS)"},
+    {"reset_stats", py_reset_stats, METH_NOARGS, "Zero the stats() counters"},
+    {NULL, NULL, 0, NULL}
+};
+
+/*
+ * The types are created per module object (multi-phase init) and hold no
+ * global state, so the module can be loaded in several interpreters.
+ */
+static int cutils_exec(PyObject *m) {
+    PyType_Spec *specs[] = {&AesKeySpec, &Xxh3Spec, &Sha256Spec, &PseudonymizerSpec, &AuditLogSpec,
+                            &RateLimiterSpec, &IpSetSpec};
+
+    for (size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); i++) {
+        PyObject *type = PyType_FromModuleAndSpec(m, specs[i], NULL);
+        if (!type) {
+            return -1;
+        }
+        int rc = PyModule_AddType(m, (PyTypeObject*)type);
+        Py_DECREF(type);
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    if (PyModule_AddObjectRef(m, "STATS_ENABLED", cutils_stats_enabled() ? Py_True : Py_False) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot cutils_slots[] = {
+    {Py_mod_exec, cutils_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+    {0, NULL}
 };
 
 static struct PyModuleDef cutilsmodule = {
     PyModuleDef_HEAD_INIT,
-    "_cutils",
-    "Cryptographic utilities",
-    -1,
-    CutilsMethods
+    .m_name = "_cutils",
+    .m_doc = "Cryptographic utilities",
+    .m_size = 0,
+    .m_methods = CutilsMethods,
+    .m_slots = cutils_slots,
 };
 
 PyMODINIT_FUNC PyInit__cutils(void) {
-    return PyModule_Create(&cutilsmodule);
+    return PyModuleDef_Init(&cutilsmodule);
 }
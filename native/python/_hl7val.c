@@ -1,20 +1,151 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include "libhl7val.h"
+#include "fastcall.h"
+#include "native_stats.h"
+#include <string.h>
 
-static PyObject* py_validate_segment(PyObject* self, PyObject* args) {
-    const char *segment;
-    Py_ssize_t segment_len;
+/*
+ * The module is multi-phase initialised with its types created per module
+ * object, so it can be loaded in several interpreters and, on free-threaded
+ * builds, without the GIL.
+ */
+typedef struct {
+    PyTypeObject *segment_result_type;
+    PyTypeObject *mllp_framer_type;
+    PyTypeObject *segment_cache_type;
+    PyTypeObject *obx_columns_type;
+    PyTypeObject *column_buffer_type;
+} hl7val_state_t;
+
+static hl7val_state_t* module_state(PyObject *module) {
+    return PyModule_GetState(module);
+}
+
+/*
+ * Parsing runs without the GIL. With a GIL, inputs below GIL_RELEASE_MIN_BYTES
+ * keep it: for a typical segment the release costs more than the parse, and
+ * a waiting thread would take the GIL and make the caller queue for a whole
+ * switch interval to get it back. Free-threaded builds always detach.
+ */
+#ifdef Py_GIL_DISABLED
+#define GIL_RELEASE_MIN_BYTES 0
+#else
+#define GIL_RELEASE_MIN_BYTES 4096
+#endif
+
+#define BEGIN_PARSE(len) { \
+    PyThreadState *_parse_save = (size_t)(len) >= GIL_RELEASE_MIN_BYTES ? PyEval_SaveThread() : NULL;
+#define END_PARSE \
+    if (_parse_save) { \
+        PyEval_RestoreThread(_parse_save); \
+    } \
+    }
+
+/*
+ * The framer and the cache are not thread-safe. With a GIL, holding it is
+ * what serialises them; free-threaded builds lock the object instead.
+ */
+#ifdef Py_GIL_DISABLED
+#define OBJECT_LOCK_FIELD PyMutex lock;
+#define LOCK_OBJECT(obj) PyMutex_Lock(&(obj)->lock)
+#define UNLOCK_OBJECT(obj) PyMutex_Unlock(&(obj)->lock)
+#else
+#define OBJECT_LOCK_FIELD
+#define LOCK_OBJECT(obj) ((void)0)
+#define UNLOCK_OBJECT(obj) ((void)0)
+#endif
+
+/*
+ * Zero-copy access to a text argument: the UTF-8 form of a str (cached by
+ * the str itself) or the buffer of a bytes-like object. The argument must
+ * stay referenced until text_arg_release.
+ */
+typedef struct {
+    const char *data;
+    Py_ssize_t len;
+    int is_str;
+    Py_buffer buf;
+} text_arg_t;
+
+static int text_arg_get(PyObject *obj, text_arg_t *t) {
+    t->is_str = PyUnicode_Check(obj);
+    if (t->is_str) {
+        t->data = PyUnicode_AsUTF8AndSize(obj, &t->len);
+        return t->data ? 0 : -1;
+    }
+    if (PyObject_GetBuffer(obj, &t->buf, PyBUF_SIMPLE) < 0) {
+        return -1;
+    }
+    t->data = t->buf.buf;
+    t->len = t->buf.len;
+    return 0;
+}
+
+static void text_arg_release(text_arg_t *t) {
+    if (!t->is_str) {
+        PyBuffer_Release(&t->buf);
+    }
+}
+
+/* Slice [start, start + len) of a bytes-like object, as a memoryview sharing its memory */
+static PyObject* memoryview_slice(PyObject *source_view, Py_ssize_t start, Py_ssize_t len) {
+    PyObject *lo = PyLong_FromSsize_t(start);
+    PyObject *hi = lo ? PyLong_FromSsize_t(start + len) : NULL;
+    PyObject *slice = hi ? PySlice_New(lo, hi, NULL) : NULL;
+    Py_XDECREF(lo);
+    Py_XDECREF(hi);
+    PyObject *item = slice ? PyObject_GetItem(source_view, slice) : NULL;
+    Py_XDECREF(slice);
+    return item;
+}
+
+/*
+ * Resolve the optional `delimiters` argument ("|^~\\&" style: MSH-1 then
+ * MSH-2). Sets *out to NULL for the defaults. Returns -1 with ValueError set.
+ */
+static int parse_delimiters(const char *chars, Py_ssize_t len, hl7val_delims_t *storage,
+                            const hl7val_delims_t **out) {
+    *out = NULL;
+    if (!chars) {
+        return 0;
+    }
+    if (hl7val_delims_init(storage, chars, (size_t)len) != HL7VAL_SUCCESS) {
+        PyErr_SetString(PyExc_ValueError, "Invalid HL7 delimiters");
+        return -1;
+    }
+    *out = storage;
+    return 0;
+}
+
+static PyObject* py_validate_segment(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"segment", "delimiters"};
+    PyObject *argv[2];
+    const char *delim_chars = NULL;
+    Py_ssize_t delim_len = 0;
     
-    if (!PyArg_ParseTuple(args, "s#", &segment, &segment_len)) {
+    if (fastcall_bind("validate_segment", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_opt_str(argv[1], "delimiters", &delim_chars, &delim_len) < 0) {
+        return NULL;
+    }
+    PyObject *segment_obj = argv[0];
+    hl7val_delims_t storage;
+    const hl7val_delims_t *delims;
+    if (parse_delimiters(delim_chars, delim_len, &storage, &delims) < 0) {
+        return NULL;
+    }
+    text_arg_t segment;
+    if (text_arg_get(segment_obj, &segment) < 0) {
         return NULL;
     }
     
     char error_msg[256] = {0};
     
-    Py_BEGIN_ALLOW_THREADS
-    int result = hl7val_validate_segment(segment, segment_len, error_msg);
-    Py_END_ALLOW_THREADS
+    int result;
+    BEGIN_PARSE(segment.len)
+    result = hl7val_validate_segment_ex(segment.data, segment.len, delims, error_msg);
+    END_PARSE
+    text_arg_release(&segment);
     
     if (result != HL7VAL_SUCCESS) {
         PyErr_SetString(PyExc_ValueError, error_msg[0] ? error_msg : hl7val_error_string(result));
@@ -24,39 +155,1296 @@ static PyObject* py_validate_segment(PyObject* self, PyObject* args) {
     Py_RETURN_NONE;
 }
 
-static PyObject* py_extract_field(PyObject* self, PyObject* args) {
-    const char *segment;
+static PyObject* py_extract_field(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"segment", "field_num", "delimiters"};
+    PyObject *argv[3];
     int field_num;
+    const char *delim_chars = NULL;
+    Py_ssize_t delim_len = 0;
     
-    if (!PyArg_ParseTuple(args, "si", &segment, &field_num)) {
+    if (fastcall_bind("extract_field", args, nargs, kwnames, names, 3, 2, argv) < 0 ||
+        fastcall_int(argv[1], &field_num) < 0 ||
+        fastcall_opt_str(argv[2], "delimiters", &delim_chars, &delim_len) < 0) {
+        return NULL;
+    }
+    PyObject *segment_obj = argv[0];
+    hl7val_delims_t storage;
+    const hl7val_delims_t *delims;
+    if (parse_delimiters(delim_chars, delim_len, &storage, &delims) < 0) {
+        return NULL;
+    }
+    text_arg_t segment;
+    if (text_arg_get(segment_obj, &segment) < 0) {
         return NULL;
     }
     
-    char output[256];
-    int result = hl7val_extract_field(segment, field_num, output, sizeof(output));
+    hl7val_view_t view;
+    int result;
+    BEGIN_PARSE(segment.len)
+    result = hl7val_field_view(segment.data, segment.len, field_num, delims, &view);
+    END_PARSE
     
+    PyObject *ret = NULL;
     if (result != HL7VAL_SUCCESS) {
         PyErr_SetString(PyExc_ValueError, hl7val_error_string(result));
+    } else if (segment.is_str) {
+        /* Delimiters are ASCII, so a field of valid UTF-8 is valid UTF-8 */
+        ret = PyUnicode_DecodeUTF8(view.data, view.len, NULL);
+    } else {
+        PyObject *source_view = PyMemoryView_FromObject(segment_obj);
+        if (source_view) {
+            ret = memoryview_slice(source_view, view.data ? view.data - segment.data : 0, (Py_ssize_t)view.len);
+            Py_DECREF(source_view);
+        }
+    }
+    text_arg_release(&segment);
+    return ret;
+}
+
+#define EXTRACT_STACK_FIELDS 32
+
+static PyObject* py_extract_fields(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"segment", "fields", "delimiters"};
+    PyObject *argv[3];
+    const char *delim_chars = NULL;
+    Py_ssize_t delim_len = 0;
+
+    if (fastcall_bind("extract_fields", args, nargs, kwnames, names, 3, 2, argv) < 0 ||
+        fastcall_opt_str(argv[2], "delimiters", &delim_chars, &delim_len) < 0) {
         return NULL;
     }
-    
-    return PyUnicode_FromString(output);
+    PyObject *segment_obj = argv[0];
+    PyObject *fields_obj = argv[1];
+    hl7val_delims_t storage;
+    const hl7val_delims_t *delims;
+    if (parse_delimiters(delim_chars, delim_len, &storage, &delims) < 0) {
+        return NULL;
+    }
+
+    /* str yields str values; bytes-like input yields memoryview slices of it */
+    text_arg_t segment;
+    if (text_arg_get(segment_obj, &segment) < 0) {
+        return NULL;
+    }
+
+    PyObject *ret = NULL;
+    PyObject *source_view = NULL;
+    PyObject *fast = PySequence_Fast(fields_obj, "fields must be a sequence of field numbers");
+    if (!fast) {
+        goto cleanup_buffer;
+    }
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+
+    int stack_nums[EXTRACT_STACK_FIELDS];
+    hl7val_view_t stack_views[EXTRACT_STACK_FIELDS];
+    int *nums = stack_nums;
+    hl7val_view_t *views = stack_views;
+    if (count > EXTRACT_STACK_FIELDS) {
+        nums = PyMem_Malloc(count * sizeof(int));
+        views = PyMem_Malloc(count * sizeof(hl7val_view_t));
+        if (!nums || !views) {
+            PyErr_NoMemory();
+            goto cleanup;
+        }
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        long num = PyLong_AsLong(PySequence_Fast_GET_ITEM(fast, i));
+        if (num == -1 && PyErr_Occurred()) {
+            goto cleanup;
+        }
+        /* Out-of-range numbers are rejected by hl7val_extract_fields */
+        nums[i] = num < 0 ? 0 : num > HL7VAL_MAX_FIELDS ? HL7VAL_MAX_FIELDS : (int)num;
+    }
+
+    int result;
+    BEGIN_PARSE(segment.len)
+    result = hl7val_extract_fields(segment.data, segment.len, nums, count, delims, views);
+    END_PARSE
+    if (result != HL7VAL_SUCCESS) {
+        PyErr_SetString(PyExc_ValueError, hl7val_error_string(result));
+        goto cleanup;
+    }
+
+    if (!segment.is_str) {
+        source_view = PyMemoryView_FromObject(segment_obj);
+        if (!source_view) {
+            goto cleanup;
+        }
+    }
+
+    ret = PyList_New(count);
+    if (!ret) {
+        goto cleanup;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item;
+        if (!views[i].data) {
+            /* Absent, as opposed to present but empty */
+            item = Py_None;
+            Py_INCREF(item);
+        } else if (segment.is_str) {
+            item = PyUnicode_DecodeUTF8(views[i].data, views[i].len, NULL);
+        } else {
+            item = memoryview_slice(source_view, views[i].data - segment.data, (Py_ssize_t)views[i].len);
+        }
+        if (!item) {
+            Py_CLEAR(ret);
+            goto cleanup;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+
+cleanup:
+    if (nums != stack_nums) {
+        PyMem_Free(nums);
+    }
+    if (views != stack_views) {
+        PyMem_Free(views);
+    }
+    Py_XDECREF(source_view);
+    Py_DECREF(fast);
+cleanup_buffer:
+    text_arg_release(&segment);
+    return ret;
+}
+
+static PyObject* py_validate_message(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"message", "delimiters"};
+    PyObject *argv[2];
+    const char *delim_chars = NULL;
+    Py_ssize_t delim_len = 0;
+
+    if (fastcall_bind("validate_message", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_opt_str(argv[1], "delimiters", &delim_chars, &delim_len) < 0) {
+        return NULL;
+    }
+    PyObject *message_obj = argv[0];
+    hl7val_delims_t storage;
+    const hl7val_delims_t *delims;
+    if (parse_delimiters(delim_chars, delim_len, &storage, &delims) < 0) {
+        return NULL;
+    }
+    text_arg_t message;
+    if (text_arg_get(message_obj, &message) < 0) {
+        return NULL;
+    }
+
+    char error_msg[256] = {0};
+
+    int result;
+    BEGIN_PARSE(message.len)
+    result = hl7val_validate_message_ex(message.data, message.len, delims, error_msg);
+    END_PARSE
+    text_arg_release(&message);
+
+    if (result != HL7VAL_SUCCESS) {
+        PyErr_SetString(PyExc_ValueError, error_msg[0] ? error_msg : hl7val_error_string(result));
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+/* parse_message result entries: one per segment, in message order */
+
+static PyStructSequence_Field segment_result_fields[] = {
+    {"line", "1-based line number"},
+    {"segment_id", "Segment ID as written"},
+    {"offset", "Byte offset of the segment in the UTF-8 message"},
+    {"length", "Segment length in bytes"},
+    {"field_count", "Highest field number present (0 if invalid)"},
+    {"error", "Validation error message, or None if the segment is valid"},
+    {NULL, NULL}
+};
+
+static PyStructSequence_Desc segment_result_desc = {
+    "hospital_native._hl7val.SegmentResult",
+    "Validation result for one HL7 segment",
+    segment_result_fields,
+    6,
+};
+
+static PyObject* segment_result_new(PyTypeObject *type, const char *message, const hl7val_segment_result_t *r,
+                                    const hl7val_delims_t *delims) {
+    PyObject *error = Py_None;
+    Py_INCREF(error);
+    if (r->status != HL7VAL_SUCCESS) {
+        /* Rare: re-run the segment check to get its message */
+        char error_msg[256] = {0};
+        hl7val_validate_segment_ex(message + r->offset, r->len, delims, error_msg);
+        Py_DECREF(error);
+        error = PyUnicode_FromString(error_msg[0] ? error_msg : hl7val_error_string(r->status));
+        if (!error) {
+            return NULL;
+        }
+    }
+
+    PyObject *item = PyStructSequence_New(type);
+    if (!item) {
+        Py_DECREF(error);
+        return NULL;
+    }
+    PyStructSequence_SET_ITEM(item, 0, PyLong_FromUnsignedLong(r->line));
+    PyStructSequence_SET_ITEM(item, 1, PyUnicode_DecodeUTF8(r->id, strnlen(r->id, 3), "replace"));
+    PyStructSequence_SET_ITEM(item, 2, PyLong_FromSize_t(r->offset));
+    PyStructSequence_SET_ITEM(item, 3, PyLong_FromUnsignedLong(r->len));
+    PyStructSequence_SET_ITEM(item, 4, PyLong_FromLong(r->field_count));
+    PyStructSequence_SET_ITEM(item, 5, error);
+    for (Py_ssize_t i = 0; i < 5; i++) {
+        if (!PyStructSequence_GET_ITEM(item, i)) {
+            Py_DECREF(item);
+            return NULL;
+        }
+    }
+    return item;
+}
+
+static PyObject* py_parse_message(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"message", "delimiters"};
+    PyObject *argv[2];
+    const char *delim_chars = NULL;
+    Py_ssize_t delim_len = 0;
+
+    if (fastcall_bind("parse_message", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_opt_str(argv[1], "delimiters", &delim_chars, &delim_len) < 0) {
+        return NULL;
+    }
+    PyObject *message_obj = argv[0];
+    hl7val_delims_t storage;
+    const hl7val_delims_t *delims;
+    if (parse_delimiters(delim_chars, delim_len, &storage, &delims) < 0) {
+        return NULL;
+    }
+    text_arg_t message;
+    if (text_arg_get(message_obj, &message) < 0) {
+        return NULL;
+    }
+
+    /* Most messages fit the stack array; larger ones get a second pass */
+    hl7val_segment_result_t stack_results[64];
+    hl7val_segment_result_t *results = stack_results;
+    size_t capacity = 64;
+    size_t count = 0;
+
+    int result;
+    BEGIN_PARSE(message.len)
+    result = hl7val_parse_message_ex(message.data, message.len, delims, results, capacity, &count);
+    END_PARSE
+
+    if (result == HL7VAL_ERR_TOO_LARGE) {
+        results = PyMem_Malloc(count * sizeof(hl7val_segment_result_t));
+        if (!results) {
+            text_arg_release(&message);
+            return PyErr_NoMemory();
+        }
+        capacity = count;
+        BEGIN_PARSE(message.len)
+        result = hl7val_parse_message_ex(message.data, message.len, delims, results, capacity, &count);
+        END_PARSE
+    }
+
+    PyObject *ret = NULL;
+    if (result != HL7VAL_SUCCESS) {
+        PyErr_SetString(PyExc_ValueError, hl7val_error_string(result));
+        goto cleanup;
+    }
+
+    PyTypeObject *type = module_state(self)->segment_result_type;
+    ret = PyList_New(count);
+    if (!ret) {
+        goto cleanup;
+    }
+    /* Track the context the way the library does, for error messages */
+    hl7val_delims_t current = delims ? *delims : *hl7val_default_delims();
+    for (size_t i = 0; i < count; i++) {
+        PyObject *item = segment_result_new(type, message.data, &results[i], &current);
+        if (!item) {
+            Py_CLEAR(ret);
+            goto cleanup;
+        }
+        PyList_SET_ITEM(ret, i, item);
+        if (results[i].status == HL7VAL_SUCCESS && memcmp(results[i].id, "MSH", 3) == 0) {
+            hl7val_delims_from_msh(message.data + results[i].offset, results[i].len, &current);
+        }
+    }
+
+cleanup:
+    if (results != stack_results) {
+        PyMem_Free(results);
+    }
+    text_arg_release(&message);
+    return ret;
+}
+
+static PyObject* py_delimiters_from_msh(PyObject* self, PyObject* arg) {
+    text_arg_t msh;
+    if (text_arg_get(arg, &msh) < 0) {
+        return NULL;
+    }
+
+    hl7val_delims_t d;
+    int result = hl7val_delims_from_msh(msh.data, msh.len, &d);
+    text_arg_release(&msh);
+    if (result != HL7VAL_SUCCESS) {
+        PyErr_SetString(PyExc_ValueError, "Invalid MSH encoding characters");
+        return NULL;
+    }
+
+    const char chars[5] = {d.field, d.component, d.repetition, d.escape, d.subcomponent};
+    return PyUnicode_FromStringAndSize(chars, strnlen(chars, sizeof(chars)));
+}
+
+/*
+ * MllpFramer: one per connection. Frames completed by a feed() come back as
+ * (message, error) tuples; message is None for a frame that was dropped.
+ * feed() keeps the GIL, since every completed frame becomes a Python object
+ * straight from the framer's callback.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    hl7val_mllp_t *mllp;
+    PyObject *pending;  /* list being filled by the callback during feed() */
+    OBJECT_LOCK_FIELD
+} MllpFramerObject;
+
+static void mllp_framer_collect(void *ctx, const char *message, size_t len, int status, const char *error_msg) {
+    MllpFramerObject *self = ctx;
+    (void)status;
+    if (!self->pending) {
+        return;  /* an earlier frame in this feed failed to convert */
+    }
+    PyObject *item = NULL;
+    PyObject *data = message ? PyBytes_FromStringAndSize(message, len) : Py_NewRef(Py_None);
+    PyObject *error = error_msg ? PyUnicode_FromString(error_msg) : Py_NewRef(Py_None);
+    if (data && error) {
+        item = PyTuple_Pack(2, data, error);
+    }
+    Py_XDECREF(data);
+    Py_XDECREF(error);
+    if (!item || PyList_Append(self->pending, item) < 0) {
+        Py_CLEAR(self->pending);
+    }
+    Py_XDECREF(item);
+}
+
+static int MllpFramer_init(MllpFramerObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"max_message_size", NULL};
+    Py_ssize_t max_message_size = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &max_message_size)) {
+        return -1;
+    }
+    if (max_message_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_message_size must not be negative");
+        return -1;
+    }
+
+    hl7val_mllp_t *mllp = NULL;
+    int result = hl7val_mllp_new((size_t)max_message_size, mllp_framer_collect, self, &mllp);
+    if (result != HL7VAL_SUCCESS) {
+        if (result == HL7VAL_ERR_NO_MEMORY) {
+            PyErr_NoMemory();
+        } else {
+            PyErr_SetString(PyExc_RuntimeError, hl7val_error_string(result));
+        }
+        return -1;
+    }
+
+    LOCK_OBJECT(self);
+    hl7val_mllp_t *old = self->mllp;
+    self->mllp = mllp;
+    UNLOCK_OBJECT(self);
+    hl7val_mllp_free(old);
+    return 0;
+}
+
+static void MllpFramer_dealloc(MllpFramerObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    hl7val_mllp_free(self->mllp);
+    Py_XDECREF(self->pending);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+/* Call with the object locked */
+static int MllpFramer_check(MllpFramerObject *self) {
+    if (!self->mllp) {
+        PyErr_SetString(PyExc_ValueError, "MllpFramer is not initialized");
+        return -1;
+    }
+    if (self->pending) {
+        PyErr_SetString(PyExc_RuntimeError, "MllpFramer is already in use");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* MllpFramer_feed(MllpFramerObject *self, PyObject *arg) {
+    Py_buffer buf;
+    if (PyObject_GetBuffer(arg, &buf, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+
+    PyObject *frames = NULL;
+    LOCK_OBJECT(self);
+    if (MllpFramer_check(self) == 0) {
+        self->pending = PyList_New(0);
+        if (self->pending) {
+            hl7val_mllp_feed(self->mllp, buf.buf, buf.len);
+            /* NULL here means a conversion failed and the exception is set */
+            frames = self->pending;
+            self->pending = NULL;
+        }
+    }
+    UNLOCK_OBJECT(self);
+    PyBuffer_Release(&buf);
+    return frames;
+}
+
+static PyObject* MllpFramer_reset(MllpFramerObject *self, PyObject *Py_UNUSED(ignored)) {
+    LOCK_OBJECT(self);
+    int ok = MllpFramer_check(self) == 0;
+    if (ok) {
+        hl7val_mllp_reset(self->mllp);
+    }
+    UNLOCK_OBJECT(self);
+    if (!ok) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* MllpFramer_stats(MllpFramerObject *self, PyObject *Py_UNUSED(ignored)) {
+    hl7val_mllp_stats_t stats;
+    LOCK_OBJECT(self);
+    int ok = MllpFramer_check(self) == 0;
+    if (ok) {
+        hl7val_mllp_get_stats(self->mllp, &stats);
+    }
+    UNLOCK_OBJECT(self);
+    if (!ok) {
+        return NULL;
+    }
+    return Py_BuildValue("{s:K,s:K,s:K,s:K}", "messages", (unsigned long long)stats.messages,
+                         "invalid", (unsigned long long)stats.invalid, "dropped", (unsigned long long)stats.dropped,
+                         "discarded_bytes", (unsigned long long)stats.discarded_bytes);
+}
+
+static PyMethodDef MllpFramerMethods[] = {
+    {"feed", (PyCFunction)MllpFramer_feed, METH_O,
+     "Feed received bytes; returns a (message, error) tuple per completed frame"},
+    {"reset", (PyCFunction)MllpFramer_reset, METH_NOARGS, "Drop any partial frame and zero the counters"},
+    {"stats", (PyCFunction)MllpFramer_stats, METH_NOARGS, "Frame counters as a dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot MllpFramerSlots[] = {
+    {Py_tp_doc, "Streaming MLLP framer and validator: MllpFramer(max_message_size=0)"},
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, MllpFramer_init},
+    {Py_tp_dealloc, MllpFramer_dealloc},
+    {Py_tp_methods, MllpFramerMethods},
+    {0, NULL}
+};
+
+static PyType_Spec MllpFramerSpec = {
+    .name = "hospital_native._hl7val.MllpFramer",
+    .basicsize = sizeof(MllpFramerObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = MllpFramerSlots,
+};
+
+static PyObject* py_build_ack(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"message", "code", "text"};
+    PyObject *argv[3];
+    text_arg_t message;
+    const char *code = "AA";
+    const char *text = NULL;
+
+    if (fastcall_bind("build_ack", args, nargs, kwnames, names, 3, 1, argv) < 0 ||
+        fastcall_cstr(argv[1], "code", 0, &code) < 0 || fastcall_cstr(argv[2], "text", 1, &text) < 0 ||
+        text_arg_get(argv[0], &message) < 0) {
+        return NULL;
+    }
+
+    /* Routing fields are bounded by the MSH; the text is the only large part */
+    size_t text_len = text ? strlen(text) : 0;
+    size_t cap = 1024 + 3 * text_len + (size_t)message.len;
+    char stack_out[2048];
+    char *out = cap <= sizeof(stack_out) ? stack_out : PyMem_Malloc(cap);
+    if (!out) {
+        text_arg_release(&message);
+        return PyErr_NoMemory();
+    }
+
+    size_t out_len = 0;
+    int result;
+    BEGIN_PARSE(message.len)
+    result = hl7val_mllp_build_ack(message.data, message.len, code, text, out,
+                                   out == stack_out ? sizeof(stack_out) : cap, &out_len);
+    END_PARSE
+    text_arg_release(&message);
+
+    PyObject *ret = NULL;
+    if (result == HL7VAL_SUCCESS) {
+        ret = PyBytes_FromStringAndSize(out, out_len);
+    } else {
+        PyErr_SetString(PyExc_ValueError, result == HL7VAL_ERR_INVALID_FMT ? "Unknown acknowledgment code" :
+                        hl7val_error_string(result));
+    }
+    if (out != stack_out) {
+        PyMem_Free(out);
+    }
+    return ret;
+}
+
+/*
+ * SegmentCache: bounded LRU cache of parsed message indexes. The cache is
+ * used, and the returned index read, with the object locked; a miss parses
+ * while holding the GIL, since the cache is shared state the GIL protects.
+ */
+typedef struct {
+    PyObject_HEAD
+    hl7val_cache_t *cache;
+    OBJECT_LOCK_FIELD
+} SegmentCacheObject;
+
+static int SegmentCache_init(SegmentCacheObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"max_bytes", NULL};
+    Py_ssize_t max_bytes = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &max_bytes)) {
+        return -1;
+    }
+    if (max_bytes < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_bytes must not be negative");
+        return -1;
+    }
+
+    hl7val_cache_t *cache = NULL;
+    int result = hl7val_cache_new((size_t)max_bytes, &cache);
+    if (result != HL7VAL_SUCCESS) {
+        if (result == HL7VAL_ERR_NO_MEMORY) {
+            PyErr_NoMemory();
+        } else {
+            PyErr_SetString(PyExc_RuntimeError, hl7val_error_string(result));
+        }
+        return -1;
+    }
+
+    LOCK_OBJECT(self);
+    hl7val_cache_t *old = self->cache;
+    self->cache = cache;
+    UNLOCK_OBJECT(self);
+    hl7val_cache_free(old);
+    return 0;
+}
+
+static void SegmentCache_dealloc(SegmentCacheObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    hl7val_cache_free(self->cache);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+/* Call with the object locked */
+static int SegmentCache_check(SegmentCacheObject *self) {
+    if (!self->cache) {
+        PyErr_SetString(PyExc_ValueError, "SegmentCache is not initialized");
+        return -1;
+    }
+    return 0;
+}
+
+/* Tuple of the requested fields of one indexed segment; absent fields are None */
+static PyObject* segment_cache_row(const hl7val_message_index_t *index, size_t segment, const char *message,
+                                   int as_str, const int *nums, Py_ssize_t count) {
+    PyObject *row = PyTuple_New(count);
+    if (!row) {
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        hl7val_span_t span;
+        PyObject *value;
+        if (hl7val_index_field(index, segment, nums[i], &span) != HL7VAL_SUCCESS) {
+            value = Py_NewRef(Py_None);
+        } else if (as_str) {
+            value = PyUnicode_DecodeUTF8(message + span.start, span.len, NULL);
+        } else {
+            value = PyBytes_FromStringAndSize(message + span.start, span.len);
+        }
+        if (!value) {
+            Py_DECREF(row);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(row, i, value);
+    }
+    return row;
+}
+
+static PyObject* SegmentCache_fields(SegmentCacheObject *self, PyObject *const *args, Py_ssize_t nargs,
+                                     PyObject *kwnames) {
+    static const char *const names[] = {"message", "fields", "delimiters"};
+    PyObject *argv[3];
+    const char *delim_chars = NULL;
+    Py_ssize_t delim_len = 0;
+
+    if (fastcall_bind("fields", args, nargs, kwnames, names, 3, 2, argv) < 0 ||
+        fastcall_opt_str(argv[2], "delimiters", &delim_chars, &delim_len) < 0) {
+        return NULL;
+    }
+    PyObject *message_obj = argv[0];
+    PyObject *fields_obj = argv[1];
+    hl7val_delims_t storage;
+    const hl7val_delims_t *delims;
+    if (parse_delimiters(delim_chars, delim_len, &storage, &delims) < 0) {
+        return NULL;
+    }
+
+    /* str yields str values, bytes-like input yields bytes */
+    text_arg_t message;
+    if (text_arg_get(message_obj, &message) < 0) {
+        return NULL;
+    }
+
+    PyObject *ret = NULL;
+    PyObject *fast = PySequence_Fast(fields_obj, "fields must be a sequence of field numbers");
+    if (!fast) {
+        goto cleanup_buffer;
+    }
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+    int stack_nums[EXTRACT_STACK_FIELDS];
+    int *nums = count > EXTRACT_STACK_FIELDS ? PyMem_Malloc(count * sizeof(int)) : stack_nums;
+    if (!nums) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        long num = PyLong_AsLong(PySequence_Fast_GET_ITEM(fast, i));
+        if (num == -1 && PyErr_Occurred()) {
+            goto cleanup;
+        }
+        if (num < 0 || num >= HL7VAL_MAX_FIELDS) {
+            PyErr_SetString(PyExc_ValueError, "Invalid field number");
+            goto cleanup;
+        }
+        nums[i] = (int)num;
+    }
+
+    LOCK_OBJECT(self);
+    if (SegmentCache_check(self) < 0) {
+        goto unlock;
+    }
+    const hl7val_message_index_t *index;
+    int result = hl7val_cache_get(self->cache, message.data, (size_t)message.len, delims, &index);
+    if (result != HL7VAL_SUCCESS) {
+        if (result == HL7VAL_ERR_NO_MEMORY) {
+            PyErr_NoMemory();
+        } else {
+            PyErr_SetString(PyExc_ValueError, hl7val_error_string(result));
+        }
+        goto unlock;
+    }
+
+    ret = PyList_New(index->segment_count);
+    if (!ret) {
+        goto unlock;
+    }
+    for (size_t i = 0; i < index->segment_count; i++) {
+        PyObject *row = index->segments[i].field_count ?
+                        segment_cache_row(index, i, message.data, message.is_str, nums, count) :
+                        Py_NewRef(Py_None);
+        if (!row) {
+            Py_CLEAR(ret);
+            goto unlock;
+        }
+        PyList_SET_ITEM(ret, i, row);
+    }
+unlock:
+    UNLOCK_OBJECT(self);
+
+cleanup:
+    if (nums && nums != stack_nums) {
+        PyMem_Free(nums);
+    }
+    Py_DECREF(fast);
+cleanup_buffer:
+    text_arg_release(&message);
+    return ret;
+}
+
+static PyObject* SegmentCache_clear(SegmentCacheObject *self, PyObject *Py_UNUSED(ignored)) {
+    LOCK_OBJECT(self);
+    int ok = SegmentCache_check(self) == 0;
+    if (ok) {
+        hl7val_cache_clear(self->cache);
+    }
+    UNLOCK_OBJECT(self);
+    if (!ok) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* SegmentCache_stats(SegmentCacheObject *self, PyObject *Py_UNUSED(ignored)) {
+    hl7val_cache_stats_t stats;
+    LOCK_OBJECT(self);
+    int ok = SegmentCache_check(self) == 0;
+    if (ok) {
+        hl7val_cache_get_stats(self->cache, &stats);
+    }
+    UNLOCK_OBJECT(self);
+    if (!ok) {
+        return NULL;
+    }
+    return Py_BuildValue("{s:K,s:K,s:K,s:n,s:n,s:n}", "hits", (unsigned long long)stats.hits,
+                         "misses", (unsigned long long)stats.misses,
+                         "evictions", (unsigned long long)stats.evictions, "entries", (Py_ssize_t)stats.entries,
+                         "bytes", (Py_ssize_t)stats.bytes, "max_bytes", (Py_ssize_t)stats.max_bytes);
+}
+
+static PyMethodDef SegmentCacheMethods[] = {
+    {"fields", (PyCFunction)(void(*)(void))SegmentCache_fields, METH_FASTCALL | METH_KEYWORDS,
+     "fields(message, fields, delimiters=None): per segment, a tuple of the requested fields (None where "
+     "absent), or None for a segment that does not tokenize; values are returned whether or not they pass the "
+     "schema checks. Field 0 is the segment ID. Parses only on a cache miss"},
+    {"clear", (PyCFunction)SegmentCache_clear, METH_NOARGS, "Drop every entry, keeping the counters"},
+    {"stats", (PyCFunction)SegmentCache_stats, METH_NOARGS, "Cache counters as a dict"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot SegmentCacheSlots[] = {
+    {Py_tp_doc, "Bounded LRU cache of parsed HL7 messages keyed by content hash: SegmentCache(max_bytes=0)"},
+    {Py_tp_new, PyType_GenericNew},
+    {Py_tp_init, SegmentCache_init},
+    {Py_tp_dealloc, SegmentCache_dealloc},
+    {Py_tp_methods, SegmentCacheMethods},
+    {0, NULL}
+};
+
+static PyType_Spec SegmentCacheSpec = {
+    .name = "hospital_native._hl7val.SegmentCache",
+    .basicsize = sizeof(SegmentCacheObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = SegmentCacheSlots,
+};
+
+static PyObject* py_validate_file(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"path", "threads", "max_errors"};
+    PyObject *argv[3];
+    PyObject *path;
+    unsigned int threads = 0;
+    Py_ssize_t max_errors = 100;
+
+    if (fastcall_bind("validate_file", args, nargs, kwnames, names, 3, 1, argv) < 0 ||
+        fastcall_uint(argv[1], &threads) < 0 || fastcall_ssize(argv[2], &max_errors) < 0) {
+        return NULL;
+    }
+    PyObject *path_arg = argv[0];
+    if (max_errors < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_errors must be >= 0");
+        return NULL;
+    }
+    if (!PyUnicode_FSConverter(path_arg, &path)) {
+        return NULL;
+    }
+
+    hl7val_file_error_t *errors = NULL;
+    if (max_errors > 0) {
+        errors = PyMem_Malloc((size_t)max_errors * sizeof(hl7val_file_error_t));
+        if (!errors) {
+            Py_DECREF(path);
+            return PyErr_NoMemory();
+        }
+    }
+
+    hl7val_file_report_t report;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = hl7val_validate_file(PyBytes_AS_STRING(path), threads, errors, (size_t)max_errors, &report);
+    Py_END_ALLOW_THREADS
+
+    PyObject *ret = NULL;
+    PyObject *list = NULL;
+    if (result == HL7VAL_ERR_IO) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path_arg);
+        goto cleanup;
+    }
+    if (result != HL7VAL_SUCCESS && result != HL7VAL_ERR_TOO_LARGE) {
+        PyErr_SetString(PyExc_ValueError, hl7val_error_string(result));
+        goto cleanup;
+    }
+
+    size_t shown = report.errors < (uint64_t)max_errors ? (size_t)report.errors : (size_t)max_errors;
+    list = PyList_New(shown);
+    if (!list) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < shown; i++) {
+        const hl7val_file_error_t *e = &errors[i];
+        PyObject *item = Py_BuildValue("(KKKs#s)", (unsigned long long)e->offset,
+                                       (unsigned long long)e->segment_index, (unsigned long long)e->line,
+                                       e->id, (Py_ssize_t)strnlen(e->id, 3), hl7val_error_string(e->status));
+        if (!item) {
+            goto cleanup;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    ret = Py_BuildValue("{s:K,s:K,s:K,s:O}", "bytes", (unsigned long long)report.bytes,
+                        "segments", (unsigned long long)report.segments,
+                        "invalid", (unsigned long long)report.errors, "errors", list);
+
+cleanup:
+    Py_XDECREF(list);
+    Py_DECREF(path);
+    PyMem_Free(errors);
+    return ret;
+}
+
+/*
+ * ObxColumns: the result of obx_columns, owning the C column buffers.
+ * buffer(name) exports one of them as a memoryview through a ColumnBuffer,
+ * which keeps the ObxColumns alive for as long as the view exists.
+ */
+typedef struct {
+    PyObject_HEAD
+    hl7val_obx_columns_t cols;
+} ObxColumnsObject;
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *owner;
+    void *buf;
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+    const char *format;
+} ColumnBufferObject;
+
+static void ColumnBuffer_dealloc(ColumnBufferObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    Py_XDECREF(self->owner);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static int ColumnBuffer_getbuffer(ColumnBufferObject *self, Py_buffer *view, int flags) {
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "ObxColumns buffers are read-only");
+        return -1;
+    }
+    view->obj = Py_NewRef((PyObject*)self);
+    view->buf = self->buf;
+    view->itemsize = self->strides[0];
+    view->len = self->shape[0] * self->strides[0];
+    view->readonly = 1;
+    view->ndim = 1;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)self->format : NULL;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyType_Slot ColumnBufferSlots[] = {
+    {Py_tp_doc, "Read-only buffer exporter for one ObxColumns array"},
+    {Py_tp_dealloc, ColumnBuffer_dealloc},
+    {Py_bf_getbuffer, ColumnBuffer_getbuffer},
+    {0, NULL}
+};
+
+static PyType_Spec ColumnBufferSpec = {
+    .name = "hospital_native._hl7val.ColumnBuffer",
+    .basicsize = sizeof(ColumnBufferObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = ColumnBufferSlots,
+};
+
+static void ObxColumns_dealloc(ObxColumnsObject *self) {
+    PyTypeObject *type = Py_TYPE((PyObject*)self);
+    hl7val_obx_columns_free(&self->cols);
+    TYPE_FREE(type)((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static Py_ssize_t ObxColumns_len(ObxColumnsObject *self) {
+    return (Py_ssize_t)self->cols.rows;
+}
+
+static PyObject* ObxColumns_buffer(ObxColumnsObject *self, PyObject *arg) {
+    const char *name = PyUnicode_Check(arg) ? PyUnicode_AsUTF8AndSize(arg, NULL) : NULL;
+    if (!name) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_TypeError, "buffer name must be a str");
+        }
+        return NULL;
+    }
+
+    const hl7val_obx_columns_t *c = &self->cols;
+    const hl7val_str_column_t *str = NULL;
+    void *buf;
+    Py_ssize_t count;
+    Py_ssize_t itemsize;
+    const char *format;
+    if (strcmp(name, "record") == 0) {
+        buf = c->record, count = (Py_ssize_t)c->rows, itemsize = sizeof(uint32_t), format = "I";
+    } else if (strcmp(name, "value") == 0) {
+        buf = c->value, count = (Py_ssize_t)c->rows, itemsize = sizeof(double), format = "d";
+    } else if (strcmp(name, "value_valid") == 0) {
+        buf = c->value_valid, count = (Py_ssize_t)((c->rows + 7) / 8), itemsize = 1, format = "B";
+    } else {
+        size_t prefix = strcspn(name, "_");
+        if (strncmp(name, "code", prefix) == 0 && prefix == 4) {
+            str = &c->code;
+        } else if (strncmp(name, "units", prefix) == 0 && prefix == 5) {
+            str = &c->units;
+        } else if (strncmp(name, "flags", prefix) == 0 && prefix == 5) {
+            str = &c->flags;
+        }
+        if (str && strcmp(name + prefix, "_offsets") == 0) {
+            buf = str->offsets, count = (Py_ssize_t)c->rows + 1, itemsize = sizeof(int64_t), format = "q";
+        } else if (str && strcmp(name + prefix, "_data") == 0) {
+            buf = str->data, count = (Py_ssize_t)str->data_len, itemsize = 1, format = "B";
+        } else {
+            PyErr_Format(PyExc_KeyError, "no such buffer: %R", arg);
+            return NULL;
+        }
+    }
+
+    hl7val_state_t *state = PyType_GetModuleState(Py_TYPE((PyObject*)self));
+    ColumnBufferObject *exporter = PyObject_New(ColumnBufferObject, state->column_buffer_type);
+    if (!exporter) {
+        return NULL;
+    }
+    exporter->owner = Py_NewRef((PyObject*)self);
+    exporter->buf = buf;
+    exporter->shape[0] = count;
+    exporter->strides[0] = itemsize;
+    exporter->format = format;
+    PyObject *view = PyMemoryView_FromObject((PyObject*)exporter);
+    Py_DECREF(exporter);
+    return view;
+}
+
+static PyObject* obx_str_column(const hl7val_obx_columns_t *c, const hl7val_str_column_t *col) {
+    PyObject *list = PyList_New((Py_ssize_t)c->rows);
+    if (!list) {
+        return NULL;
+    }
+    for (size_t i = 0; i < c->rows; i++) {
+        PyObject *item = PyUnicode_DecodeUTF8(col->data + col->offsets[i],
+                                              (Py_ssize_t)(col->offsets[i + 1] - col->offsets[i]), "replace");
+        if (!item) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    return list;
+}
+
+static PyObject* ObxColumns_column(ObxColumnsObject *self, PyObject *arg) {
+    const char *name = PyUnicode_Check(arg) ? PyUnicode_AsUTF8AndSize(arg, NULL) : NULL;
+    if (!name) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_TypeError, "column name must be a str");
+        }
+        return NULL;
+    }
+
+    const hl7val_obx_columns_t *c = &self->cols;
+    if (strcmp(name, "code") == 0) {
+        return obx_str_column(c, &c->code);
+    }
+    if (strcmp(name, "units") == 0) {
+        return obx_str_column(c, &c->units);
+    }
+    if (strcmp(name, "flags") == 0) {
+        return obx_str_column(c, &c->flags);
+    }
+    int is_record = strcmp(name, "record") == 0;
+    if (!is_record && strcmp(name, "value") != 0) {
+        PyErr_Format(PyExc_KeyError, "no such column: %R", arg);
+        return NULL;
+    }
+
+    PyObject *list = PyList_New((Py_ssize_t)c->rows);
+    if (!list) {
+        return NULL;
+    }
+    for (size_t i = 0; i < c->rows; i++) {
+        PyObject *item;
+        if (is_record) {
+            item = PyLong_FromUnsignedLong(c->record[i]);
+        } else if (c->value_valid[i / 8] & (1u << (i % 8))) {
+            item = PyFloat_FromDouble(c->value[i]);
+        } else {
+            item = Py_NewRef(Py_None);
+        }
+        if (!item) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    return list;
+}
+
+static PyObject* ObxColumns_get_null_count(ObxColumnsObject *self, void *Py_UNUSED(closure)) {
+    return PyLong_FromSize_t(self->cols.value_null_count);
+}
+
+static PyMethodDef ObxColumnsMethods[] = {
+    {"buffer", (PyCFunction)ObxColumns_buffer, METH_O,
+     "buffer(name) -> read-only memoryview of one column array, without copying: record (I), value (d), "
+     "value_valid (B, LSB-first bitmap), or code/units/flags _offsets (q) and _data (B)"},
+    {"column", (PyCFunction)ObxColumns_column, METH_O,
+     "column(name) -> list: record (int), value (float, None where null), code, units or flags (str)"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef ObxColumnsGetSet[] = {
+    {"value_null_count", (getter)ObxColumns_get_null_count, NULL, "Rows whose OBX-5 is not a number", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot ObxColumnsSlots[] = {
+    {Py_tp_doc, "OBX observations as columns (Arrow layout), one row per OBX segment; see obx_columns"},
+    {Py_tp_dealloc, ObxColumns_dealloc},
+    {Py_sq_length, ObxColumns_len},
+    {Py_tp_methods, ObxColumnsMethods},
+    {Py_tp_getset, ObxColumnsGetSet},
+    {0, NULL}
+};
+
+static PyType_Spec ObxColumnsSpec = {
+    .name = "hospital_native._hl7val.ObxColumns",
+    .basicsize = sizeof(ObxColumnsObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = ObxColumnsSlots,
+};
+
+static PyObject* py_obx_columns(PyObject* self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+    static const char *const names[] = {"texts", "threads"};
+    PyObject *argv[2];
+    unsigned int threads = 0;
+
+    if (fastcall_bind("obx_columns", args, nargs, kwnames, names, 2, 1, argv) < 0 ||
+        fastcall_uint(argv[1], &threads) < 0) {
+        return NULL;
+    }
+    PyObject *fast = PySequence_Fast(argv[0], "texts must be a sequence of str or bytes-like objects");
+    if (fast && !PyTuple_CheckExact(fast)) {
+        /* Another thread could replace a str in a list while the GIL is released */
+        PyObject *copy = PyList_AsTuple(fast);
+        Py_DECREF(fast);
+        fast = copy;
+    }
+    if (!fast) {
+        return NULL;
+    }
+
+    /* The tuple keeps every text (and its cached UTF-8) alive while the GIL is released */
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(fast);
+    PyObject *ret = NULL;
+    Py_ssize_t held = 0;
+    hl7val_view_t *views = PyMem_Calloc(count ? (size_t)count : 1, sizeof(*views));
+    Py_buffer *buffers = PyMem_Calloc(count ? (size_t)count : 1, sizeof(*buffers));
+    if (!views || !buffers) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        if (item == Py_None) {
+            continue;
+        }
+        if (PyUnicode_Check(item)) {
+            Py_ssize_t len;
+            views[i].data = PyUnicode_AsUTF8AndSize(item, &len);
+            if (!views[i].data) {
+                goto cleanup;
+            }
+            views[i].len = (size_t)len;
+        } else {
+            if (PyObject_GetBuffer(item, &buffers[held], PyBUF_SIMPLE) < 0) {
+                goto cleanup;
+            }
+            views[i].data = buffers[held].buf;
+            views[i].len = (size_t)buffers[held].len;
+            held++;
+        }
+    }
+
+    ObxColumnsObject *result = PyObject_New(ObxColumnsObject, module_state(self)->obx_columns_type);
+    if (!result) {
+        goto cleanup;
+    }
+    memset(&result->cols, 0, sizeof(result->cols));
+
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = hl7val_obx_columns(views, (size_t)count, threads, &result->cols);
+    Py_END_ALLOW_THREADS
+
+    if (status != HL7VAL_SUCCESS) {
+        Py_DECREF(result);
+        if (status == HL7VAL_ERR_NO_MEMORY) {
+            PyErr_NoMemory();
+        } else {
+            PyErr_SetString(PyExc_ValueError, hl7val_error_string(status));
+        }
+        goto cleanup;
+    }
+    ret = (PyObject*)result;
+
+cleanup:
+    for (Py_ssize_t i = 0; i < held; i++) {
+        PyBuffer_Release(&buffers[i]);
+    }
+    PyMem_Free(buffers);
+    PyMem_Free(views);
+    Py_DECREF(fast);
+    return ret;
+}
+
+/* Instrumentation counters (built with HOSPITAL_NATIVE_STATS) as {api: counters} */
+static PyObject* py_stats(PyObject* self, PyObject* Py_UNUSED(ignored)) {
+    size_t n = hl7val_stats_snapshot(NULL, 0);
+    hl7val_stats_t *entries = PyMem_Calloc(n ? n : 1, sizeof(*entries));
+    if (!entries) {
+        return PyErr_NoMemory();
+    }
+    n = hl7val_stats_snapshot(entries, n);
+
+    PyObject *result = PyDict_New();
+    for (size_t i = 0; result && i < n; i++) {
+        const hl7val_stats_t *e = &entries[i];
+        PyObject *entry = native_stats_entry(e->calls, e->bytes, e->total_ns, e->errors, HL7VAL_STATS_ERROR_CODES,
+                                             e->latency, HL7VAL_STATS_LATENCY_BUCKETS);
+        if (!entry || PyDict_SetItemString(result, e->name, entry) < 0) {
+            Py_CLEAR(result);
+        }
+        Py_XDECREF(entry);
+    }
+    PyMem_Free(entries);
+    return result;
+}
+
+static PyObject* py_reset_stats(PyObject* self, PyObject* Py_UNUSED(ignored)) {
+    hl7val_stats_reset();
+    Py_RETURN_NONE;
 }
 
 static PyMethodDef HL7ValMethods[] = {
-    {"validate_segment", py_validate_segment, METH_VARARGS, "Validate HL7 v2 segment"},
-    {"extract_field", py_extract_field, METH_VARARGS, "Extract field from HL7 segment"},
+    {"validate_segment", (PyCFunction)(void(*)(void))py_validate_segment, METH_FASTCALL | METH_KEYWORDS,
+     "Validate HL7 v2 segment (delimiters: MSH-1 + MSH-2 characters, default \"|^~\\\\&\")"},
+    {"extract_field", (PyCFunction)(void(*)(void))py_extract_field, METH_FASTCALL | METH_KEYWORDS,
+     "Extract field from HL7 segment; str input gives str, bytes-like input gives a memoryview slice of it"},
+    {"extract_fields", (PyCFunction)(void(*)(void))py_extract_fields, METH_FASTCALL | METH_KEYWORDS,
+     "Extract several fields in one pass; str input gives str values, bytes-like input gives "
+     "memoryview slices of it, and absent fields are None"},
+    {"validate_message", (PyCFunction)(void(*)(void))py_validate_message, METH_FASTCALL | METH_KEYWORDS,
+     "Validate every segment of an HL7 message (raises ValueError naming the first bad line)"},
+    {"parse_message", (PyCFunction)(void(*)(void))py_parse_message, METH_FASTCALL | METH_KEYWORDS,
+     "Validate every segment of an HL7 message, returning a SegmentResult per segment"},
+    {"build_ack", (PyCFunction)(void(*)(void))py_build_ack, METH_FASTCALL | METH_KEYWORDS,
+     "Build an MLLP-framed ACK/NAK for a message: build_ack(message, code=\"AA\", text=None) -> bytes"},
+    {"validate_file", (PyCFunction)(void(*)(void))py_validate_file, METH_FASTCALL | METH_KEYWORDS,
+     "Validate a file of HL7 messages across threads: validate_file(path, threads=0, max_errors=100) -> "
+     "{bytes, segments, invalid, errors: [(offset, segment_index, line, segment_id, error), ...]}"},
+    {"obx_columns", (PyCFunction)(void(*)(void))py_obx_columns, METH_FASTCALL | METH_KEYWORDS,
+     "Extract OBX-3/5/6/8 from many stored OBX texts across threads: obx_columns(texts, threads=0) -> "
+     "ObxColumns (None entries count as empty texts)"},
+    {"delimiters_from_msh", py_delimiters_from_msh, METH_O,
+     "Return the delimiters declared by an MSH segment as a string, e.g. \"|^~\\\\&\""},
+    {"stats", py_stats, METH_NOARGS,
+     "Per-API call, byte, error and latency counters since start or reset_stats() (empty unless the library "
+     "was built with HOSPITAL_NATIVE_STATS)"},
+    {"reset_stats", py_reset_stats, METH_NOARGS, "Zero the stats() counters"},
     {NULL, NULL, 0, NULL}
 };
 
+static int hl7val_exec(PyObject *m) {
+    hl7val_state_t *state = module_state(m);
+
+    state->segment_result_type = PyStructSequence_NewType(&segment_result_desc);
+    if (!state->segment_result_type || PyModule_AddType(m, state->segment_result_type) < 0) {
+        return -1;
+    }
+
+    state->mllp_framer_type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &MllpFramerSpec, NULL);
+    if (!state->mllp_framer_type || PyModule_AddType(m, state->mllp_framer_type) < 0) {
+        return -1;
+    }
+    state->segment_cache_type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &SegmentCacheSpec, NULL);
+    if (!state->segment_cache_type || PyModule_AddType(m, state->segment_cache_type) < 0) {
+        return -1;
+    }
+    state->obx_columns_type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &ObxColumnsSpec, NULL);
+    if (!state->obx_columns_type || PyModule_AddType(m, state->obx_columns_type) < 0) {
+        return -1;
+    }
+    if (PyModule_AddObjectRef(m, "STATS_ENABLED", hl7val_stats_enabled() ? Py_True : Py_False) < 0) {
+        return -1;
+    }
+    /* Only reached through ObxColumns.buffer(), so not exported */
+    state->column_buffer_type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &ColumnBufferSpec, NULL);
+    if (!state->column_buffer_type) {
+        return -1;
+    }
+    return 0;
+}
+
+static int hl7val_traverse(PyObject *m, visitproc visit, void *arg) {
+    hl7val_state_t *state = module_state(m);
+    Py_VISIT(state->segment_result_type);
+    Py_VISIT(state->mllp_framer_type);
+    Py_VISIT(state->segment_cache_type);
+    Py_VISIT(state->obx_columns_type);
+    Py_VISIT(state->column_buffer_type);
+    return 0;
+}
+
+static int hl7val_clear(PyObject *m) {
+    hl7val_state_t *state = module_state(m);
+    Py_CLEAR(state->segment_result_type);
+    Py_CLEAR(state->mllp_framer_type);
+    Py_CLEAR(state->segment_cache_type);
+    Py_CLEAR(state->obx_columns_type);
+    Py_CLEAR(state->column_buffer_type);
+    return 0;
+}
+
+static void hl7val_free(void *m) {
+    hl7val_clear((PyObject*)m);
+}
+
+static PyModuleDef_Slot hl7val_slots[] = {
+    {Py_mod_exec, hl7val_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL}
+};
+
 static struct PyModuleDef hl7valmodule = {
     PyModuleDef_HEAD_INIT,
-    "_hl7val",
-    "HL7 v2 validation",
-    -1,
-    HL7ValMethods
+    .m_name = "_hl7val",
+    .m_doc = "HL7 v2 validation",
+    .m_size = sizeof(hl7val_state_t),
+    .m_methods = HL7ValMethods,
+    .m_slots = hl7val_slots,
+    .m_traverse = hl7val_traverse,
+    .m_clear = hl7val_clear,
+    .m_free = hl7val_free,
 };
 
 PyMODINIT_FUNC PyInit__hl7val(void) {
-    return PyModule_Create(&hl7valmodule);
+    return PyModuleDef_Init(&hl7valmodule);
 }
@@ -0,0 +1,210 @@
+/*
+ * Argument handling shared by the extension modules.
+ *
+ * Module functions use METH_FASTCALL, which receives arguments as a C array
+ * instead of a freshly built tuple (and dict for keywords). CPython's own
+ * fast parser is private, so parameters are bound here and converted with
+ * the small helpers below. Everything in this file keeps to the limited
+ * API, as do the modules when built with HOSPITAL_NATIVE_ABI3=1 (setup.py);
+ * the shims at the end cover the macros the limited API leaves out.
+ */
+#ifndef HOSPITAL_NATIVE_FASTCALL_H
+#define HOSPITAL_NATIVE_FASTCALL_H
+
+#include <Python.h>
+#include <limits.h>
+#include <string.h>
+
+/*
+ * Bind the arguments of a METH_FASTCALL | METH_KEYWORDS call to the
+ * parameters `names`, in order. The first `required` must be passed; out[i]
+ * is a borrowed reference, or NULL for an optional parameter not passed.
+ * Returns -1 with TypeError set.
+ */
+static inline int fastcall_bind(const char *fname, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames,
+                                const char *const *names, Py_ssize_t count, Py_ssize_t required,
+                                PyObject **out) {
+    if (nargs > count) {
+        PyErr_Format(PyExc_TypeError, "%s() takes at most %zd arguments (%zd given)", fname, count, nargs);
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        out[i] = i < nargs ? args[i] : NULL;
+    }
+
+    Py_ssize_t nkw = kwnames ? PyTuple_Size(kwnames) : 0;
+    for (Py_ssize_t k = 0; k < nkw; k++) {
+        PyObject *key = PyTuple_GetItem(kwnames, k);
+        Py_ssize_t i = 0;
+        while (i < count && PyUnicode_CompareWithASCIIString(key, names[i]) != 0) {
+            i++;
+        }
+        if (i == count) {
+            PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%U'", fname, key);
+            return -1;
+        }
+        if (out[i]) {
+            PyErr_Format(PyExc_TypeError, "%s() got multiple values for argument '%s'", fname, names[i]);
+            return -1;
+        }
+        out[i] = args[nargs + k];
+    }
+
+    for (Py_ssize_t i = 0; i < required; i++) {
+        if (!out[i]) {
+            PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s' (pos %zd)", fname, names[i],
+                         i + 1);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Check the argument count of a positional-only METH_FASTCALL call */
+static inline int fastcall_nargs(const char *fname, Py_ssize_t nargs, Py_ssize_t min, Py_ssize_t max) {
+    if (nargs < min || nargs > max) {
+        if (min == max) {
+            PyErr_Format(PyExc_TypeError, "%s() takes exactly %zd arguments (%zd given)", fname, min, nargs);
+        } else {
+            PyErr_Format(PyExc_TypeError, "%s() takes from %zd to %zd arguments (%zd given)", fname, min, max,
+                         nargs);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Converters for bound arguments, matching the PyArg format units named.
+ * A NULL argument (optional, not passed) leaves *out at its default.
+ */
+
+/* "n" */
+static inline int fastcall_ssize(PyObject *arg, Py_ssize_t *out) {
+    if (!arg) {
+        return 0;
+    }
+    Py_ssize_t v = PyNumber_AsSsize_t(arg, PyExc_OverflowError);
+    if (v == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+/* "i" */
+static inline int fastcall_int(PyObject *arg, int *out) {
+    if (!arg) {
+        return 0;
+    }
+    long v = PyLong_AsLong(arg);
+    if (v == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (v < INT_MIN || v > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "signed integer is out of range for C int");
+        return -1;
+    }
+    *out = (int)v;
+    return 0;
+}
+
+/* "I": no overflow check, like the format unit */
+static inline int fastcall_uint(PyObject *arg, unsigned int *out) {
+    if (!arg) {
+        return 0;
+    }
+    unsigned long v = PyLong_AsUnsignedLongMask(arg);
+    if (v == (unsigned long)-1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = (unsigned int)v;
+    return 0;
+}
+
+/* "K": no overflow check, like the format unit */
+static inline int fastcall_ulonglong(PyObject *arg, unsigned long long *out) {
+    if (!arg) {
+        return 0;
+    }
+    unsigned long long v = PyLong_AsUnsignedLongLongMask(arg);
+    if (v == (unsigned long long)-1 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+/* "p" */
+static inline int fastcall_bool(PyObject *arg, int *out) {
+    if (!arg) {
+        return 0;
+    }
+    int v = PyObject_IsTrue(arg);
+    if (v < 0) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+/* "z#" restricted to str or None: UTF-8 data and length, NULL for None */
+static inline int fastcall_opt_str(PyObject *arg, const char *param, const char **out, Py_ssize_t *len) {
+    if (!arg || arg == Py_None) {
+        return 0;
+    }
+    if (!PyUnicode_Check(arg)) {
+        PyErr_Format(PyExc_TypeError, "argument '%s' must be str or None", param);
+        return -1;
+    }
+    *out = PyUnicode_AsUTF8AndSize(arg, len);
+    return *out ? 0 : -1;
+}
+
+/* "s" / "z": NUL-terminated UTF-8, rejecting embedded NULs; None only if allow_none */
+static inline int fastcall_cstr(PyObject *arg, const char *param, int allow_none, const char **out) {
+    if (!arg || (allow_none && arg == Py_None)) {
+        return 0;
+    }
+    if (!PyUnicode_Check(arg)) {
+        PyErr_Format(PyExc_TypeError, "argument '%s' must be str%s", param, allow_none ? " or None" : "");
+        return -1;
+    }
+    Py_ssize_t len;
+    const char *s = PyUnicode_AsUTF8AndSize(arg, &len);
+    if (!s) {
+        return -1;
+    }
+    if (strlen(s) != (size_t)len) {
+        PyErr_SetString(PyExc_ValueError, "embedded null character");
+        return -1;
+    }
+    *out = s;
+    return 0;
+}
+
+/* "y*": a contiguous buffer; release with PyBuffer_Release */
+static inline int fastcall_buffer(PyObject *arg, Py_buffer *out) {
+    return PyObject_GetBuffer(arg, out, PyBUF_SIMPLE);
+}
+
+#ifdef Py_LIMITED_API
+/* Function forms of macros the limited API does not provide */
+#undef PyList_SET_ITEM
+#define PyList_SET_ITEM(op, i, v) ((void)PyList_SetItem((op), (i), (v)))
+#undef PyTuple_SET_ITEM
+#define PyTuple_SET_ITEM(op, i, v) ((void)PyTuple_SetItem((op), (i), (v)))
+#define PyStructSequence_SET_ITEM(op, i, v) PyStructSequence_SetItem((op), (i), (v))
+#define PyStructSequence_GET_ITEM(op, i) PyStructSequence_GetItem((op), (i))
+#undef PySequence_Fast_GET_SIZE
+#define PySequence_Fast_GET_SIZE(o) PySequence_Size(o)
+#undef PySequence_Fast_GET_ITEM
+#define PySequence_Fast_GET_ITEM(o, i) (PyList_Check(o) ? PyList_GetItem((o), (i)) : PyTuple_GetItem((o), (i)))
+#define PyBytes_AS_STRING(op) PyBytes_AsString(op)
+#define PyObject_CallOneArg(callable, arg) PyObject_CallFunctionObjArgs((callable), (arg), NULL)
+#define TYPE_FREE(type) ((freefunc)PyType_GetSlot((type), Py_tp_free))
+#else
+#define TYPE_FREE(type) ((type)->tp_free)
+#endif
+
+#endif /* HOSPITAL_NATIVE_FASTCALL_H */
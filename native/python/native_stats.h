@@ -0,0 +1,56 @@
+/*
+ * Conversion of the libraries' instrumentation counters (cutils_stats_t,
+ * hl7val_stats_t) into the dicts returned by the modules' stats().
+ */
+#ifndef HOSPITAL_NATIVE_PY_STATS_H
+#define HOSPITAL_NATIVE_PY_STATS_H
+
+#include <Python.h>
+#include <stdint.h>
+#include "fastcall.h"
+
+/*
+ * {"calls", "bytes", "total_ns", "errors": {code: count} (non-zero only),
+ * "latency": [count per bucket]}, bucket i holding calls of [2^i, 2^(i+1)) ns
+ */
+static inline PyObject* native_stats_entry(uint64_t calls, uint64_t bytes, uint64_t total_ns,
+                                           const uint64_t *errors, size_t error_codes,
+                                           const uint64_t *latency, size_t buckets) {
+    PyObject *errs = PyDict_New();
+    PyObject *hist = PyList_New((Py_ssize_t)buckets);
+    if (!errs || !hist) {
+        goto fail;
+    }
+    for (size_t i = 1; i < error_codes; i++) {
+        if (!errors[i]) {
+            continue;
+        }
+        PyObject *code = PyLong_FromLong(-(long)i);
+        PyObject *count = PyLong_FromUnsignedLongLong(errors[i]);
+        int rc = code && count ? PyDict_SetItem(errs, code, count) : -1;
+        Py_XDECREF(code);
+        Py_XDECREF(count);
+        if (rc < 0) {
+            goto fail;
+        }
+    }
+    for (size_t i = 0; i < buckets; i++) {
+        PyObject *count = PyLong_FromUnsignedLongLong(latency[i]);
+        if (!count) {
+            goto fail;
+        }
+        PyList_SET_ITEM(hist, (Py_ssize_t)i, count);
+    }
+
+    /* "N" hands the dict and list over, on failure too */
+    return Py_BuildValue("{s:K,s:K,s:K,s:N,s:N}", "calls", (unsigned long long)calls,
+                         "bytes", (unsigned long long)bytes, "total_ns", (unsigned long long)total_ns,
+                         "errors", errs, "latency", hist);
+
+fail:
+    Py_XDECREF(errs);
+    Py_XDECREF(hist);
+    return NULL;
+}
+
+#endif /* HOSPITAL_NATIVE_PY_STATS_H */
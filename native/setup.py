@@ -1,19 +1,45 @@
 from setuptools import setup, Extension  # type: ignore[import-not-found]
 import os
 import subprocess
+import sysconfig
 
 # Build C libraries first
 native_dir = os.path.dirname(os.path.abspath(__file__))
 build_dir = os.path.join(native_dir, 'build')
 
+# HOSPITAL_NATIVE_STATS=1 builds the libraries with call counters and latency
+# histograms (hospital_native.stats()); they are compiled out otherwise.
+# HOSPITAL_NATIVE_LTO=1 links them with link-time optimization.
+cmake_args = []
+if os.environ.get('HOSPITAL_NATIVE_STATS') == '1':
+    cmake_args.append('-DHOSPITAL_NATIVE_STATS=ON')
+if os.environ.get('HOSPITAL_NATIVE_LTO') == '1':
+    cmake_args.append('-DHOSPITAL_NATIVE_LTO=ON')
+
+# HOSPITAL_NATIVE_PGO=1 builds them twice: instrumented, trained on
+# hospital_native_bench under every ISA level the build machine has (the
+# `pgo-train` target), then optimized with that profile. Kernel dispatch
+# stays at runtime, so the wheel still runs on every node type.
+pgo = os.environ.get('HOSPITAL_NATIVE_PGO') == '1'
+
 if not os.path.exists(build_dir):
     os.makedirs(build_dir)
-    subprocess.check_call(['cmake', '..'], cwd=build_dir)
+    if pgo:
+        subprocess.check_call(['cmake', '..', *cmake_args, '-DHOSPITAL_NATIVE_PGO=GENERATE'], cwd=build_dir)
+        subprocess.check_call(['make', 'pgo-train'], cwd=build_dir)
+        subprocess.check_call(['cmake', '..', '-DHOSPITAL_NATIVE_PGO=USE'], cwd=build_dir)
+    else:
+        subprocess.check_call(['cmake', '..', *cmake_args], cwd=build_dir)
     subprocess.check_call(['make'], cwd=build_dir)
 
+# HOSPITAL_NATIVE_ABI3=1 builds the extensions against the stable ABI, so one
+# cp312-abi3 wheel serves every later CPython at a small per-call cost (see
+# python/fastcall.h). Free-threaded interpreters have no stable ABI yet and
+# always get a version-specific build.
+abi3 = os.environ.get('HOSPITAL_NATIVE_ABI3') == '1' and not sysconfig.get_config_var('Py_GIL_DISABLED')
+abi3_args = {'define_macros': [('Py_LIMITED_API', '0x030C0000')], 'py_limited_api': True} if abi3 else {}
+
 # Python extensions
-# Note: Only _cutils and _hl7val are implemented for now
-# _authz and _bill extensions to be added later
 extensions = [
     Extension(
         'hospital_native._cutils',
@@ -22,6 +48,7 @@ extensions = [
         library_dirs=['build'],
         libraries=['cutils', 'ssl', 'crypto'],
         extra_compile_args=['-O3', '-fPIC'],
+        **abi3_args,
     ),
     Extension(
         'hospital_native._hl7val',
@@ -30,24 +57,26 @@ extensions = [
         library_dirs=['build'],
         libraries=['hl7val'],
         extra_compile_args=['-O3', '-fPIC'],
+        **abi3_args,
+    ),
+    Extension(
+        'hospital_native._bill',
+        sources=['python/_bill.c'],
+        include_dirs=['include'],
+        library_dirs=['build'],
+        libraries=['bill'],
+        extra_compile_args=['-O3', '-fPIC'],
+        **abi3_args,
+    ),
+    Extension(
+        'hospital_native._authz',
+        sources=['python/_authz.c'],
+        include_dirs=['include'],
+        library_dirs=['build'],
+        libraries=['authz'],
+        extra_compile_args=['-O3', '-fPIC'],
+        **abi3_args,
     ),
-    # TODO: Add _authz and _bill extensions when ready
-    # Extension(
-    #     'hospital_native._authz',
-    #     sources=['python/_authz.c'],
-    #     include_dirs=['include'],
-    #     library_dirs=['build'],
-    #     libraries=['authz'],
-    #     extra_compile_args=['-O3', '-fPIC'],
-    # ),
-    # Extension(
-    #     'hospital_native._bill',
-    #     sources=['python/_bill.c'],
-    #     include_dirs=['include'],
-    #     library_dirs=['build'],
-    #     libraries=['bill'],
-    #     extra_compile_args=['-O3', '-fPIC'],
-    # ),
 ]
 
 setup(
@@ -56,4 +85,5 @@ setup(
     ext_modules=extensions,
     packages=['hospital_native'],
     package_dir={'hospital_native': 'python'},
+    options={'bdist_wheel': {'py_limited_api': 'cp312'}} if abi3 else {},
 )
@@ -0,0 +1,100 @@
+#ifndef HOSPITAL_NATIVE_CPU_FEATURES_H
+#define HOSPITAL_NATIVE_CPU_FEATURES_H
+
+/*
+ * Internal helper shared by the native libraries: runtime CPU feature
+ * detection used to pick SIMD kernels once per process.
+ *
+ * x86-64: SSE2 is part of the baseline ABI, SSSE3/AVX2 are probed at runtime
+ *         (kernels are compiled with per-function target attributes).
+ * AArch64: NEON (Advanced SIMD) is mandatory.
+ *
+ * HOSPITAL_NATIVE_ISA=scalar|sse2|ssse3|avx2|neon caps the features reported,
+ * so one build can be made to run (and be trained, see HOSPITAL_NATIVE_PGO)
+ * the kernels an older node type would pick. Unknown values are ignored.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_ARCH_X86 1
+#include <immintrin.h>
+#define CPU_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define CPU_TARGET_AVX2  __attribute__((target("avx2")))
+#elif defined(__aarch64__)
+#define CPU_ARCH_ARM64 1
+#include <arm_neon.h>
+#endif
+
+#define CPU_FEATURE_SSE2   0x01u
+#define CPU_FEATURE_SSSE3  0x02u
+#define CPU_FEATURE_AVX2   0x04u
+#define CPU_FEATURE_NEON   0x08u
+
+/* Features allowed by $HOSPITAL_NATIVE_ISA (all when unset or unknown) */
+static inline unsigned int cpu_features_cap(void) {
+    static const struct {
+        const char *name;
+        unsigned int features;
+    } levels[] = {
+        {"scalar", 0},
+        {"sse2", CPU_FEATURE_SSE2},
+        {"ssse3", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3},
+        {"avx2", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_AVX2},
+        {"neon", CPU_FEATURE_NEON},
+    };
+    const char *isa = getenv("HOSPITAL_NATIVE_ISA");
+    if (isa) {
+        for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+            if (strcmp(isa, levels[i].name) == 0) {
+                return levels[i].features;
+            }
+        }
+    }
+    return ~0u;
+}
+
+static inline unsigned int cpu_features_detect(void) {
+    unsigned int features = 0;
+#if defined(CPU_ARCH_X86)
+    __builtin_cpu_init();
+#if defined(__SSE2__)
+    features |= CPU_FEATURE_SSE2;
+#else
+    if (__builtin_cpu_supports("sse2")) {
+        features |= CPU_FEATURE_SSE2;
+    }
+#endif
+    if (__builtin_cpu_supports("ssse3")) {
+        features |= CPU_FEATURE_SSSE3;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        features |= CPU_FEATURE_AVX2;
+    }
+#elif defined(CPU_ARCH_ARM64)
+    features |= CPU_FEATURE_NEON;
+#endif
+    return features & cpu_features_cap();
+}
+
+/*
+ * First entry of a kernel table (fastest first, with `required` feature
+ * bits; the last entry needs none) that `features` can run, or with
+ * `want` the entry of that name if runnable, else NULL.
+ */
+#define CPU_KERNEL_PICK(table, features, want, out) \
+    do { \
+        const unsigned int cpu_have_ = (features); \
+        const char *cpu_want_ = (want); \
+        (out) = NULL; \
+        for (size_t cpu_i_ = 0; cpu_i_ < sizeof(table) / sizeof((table)[0]); cpu_i_++) { \
+            if (((table)[cpu_i_].required & cpu_have_) == (table)[cpu_i_].required && \
+                (!cpu_want_ || strcmp((table)[cpu_i_].name, cpu_want_) == 0)) { \
+                (out) = &(table)[cpu_i_]; \
+                break; \
+            } \
+        } \
+    } while (0)
+
+#endif /* HOSPITAL_NATIVE_CPU_FEATURES_H */
@@ -0,0 +1,634 @@
+/*
+ * Hash-chained audit log for libcutils.
+ *
+ * Appenders copy the entry into a node and push it onto an intrusive MPSC
+ * queue (Vyukov): one atomic exchange on the head, then a store linking the
+ * previous node, no lock. A writer thread pops up to AUDIT_BATCH nodes at a
+ * time, fills in each record's header and chained digest in place, and
+ * hands the whole batch to one writev. The writer only sleeps on the
+ * condition variable once the queue is empty; the first append after that
+ * wakes it.
+ *
+ * Flushing pushes a barrier node from the caller's stack and waits until
+ * the writer reaches it, so everything appended before the flush is on
+ * disk by then.
+ *
+ * A fork child inherits the handle but not the writer thread; a fork
+ * counter bumped by an atfork handler lets it refuse work there instead of
+ * waiting forever.
+ */
+#include "libcutils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define AUDIT_MAGIC_LEN (sizeof(CUTILS_AUDIT_MAGIC) - 1)
+#define AUDIT_HEADER    12                  /* u32 len | u64 seq */
+#define AUDIT_DIGEST    CUTILS_SHA256_SIZE
+#define AUDIT_BATCH     256                 /* Records per writev, well under IOV_MAX */
+#define AUDIT_BARRIER   SIZE_MAX            /* Node len of a flush barrier */
+
+typedef struct audit_node {
+    struct audit_node *_Atomic next;
+    size_t len;          /* Entry length, AUDIT_BARRIER for a flush barrier */
+    int *done;           /* Barrier: set by the writer once it is reached */
+    uint8_t record[];    /* Header | entry | digest; header and digest are filled by the writer */
+} audit_node_t;
+
+struct cutils_audit {
+    int fd;
+    unsigned int flags;
+    unsigned int generation;          /* audit_forks when opened */
+
+    /* Queue: producers exchange head; tail and stub belong to the writer */
+    audit_node_t *_Atomic head;
+    audit_node_t *tail;
+    audit_node_t *stub;
+    _Atomic size_t pending;
+    _Atomic int sleeping;             /* Writer is (about to be) waiting on wake */
+    _Atomic int error;                /* First write failure, sticky */
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t flushed;
+    pthread_t thread;
+    int stop;                         /* Under lock */
+
+    /* Writer state: chain digest and sequence of the next record */
+    cutils_sha256_ctx_t *sha;
+    uint8_t chain[AUDIT_DIGEST];
+    uint64_t seq;
+
+    /* Under lock: what the file holds */
+    uint8_t head_digest[AUDIT_DIGEST];
+    uint64_t written;
+};
+
+/* Fork children seen by this process; a log opened before one has no writer */
+static _Atomic unsigned int audit_forks = 0;
+static pthread_once_t audit_once = PTHREAD_ONCE_INIT;
+
+static void audit_atfork_child(void) {
+    atomic_fetch_add_explicit(&audit_forks, 1, memory_order_relaxed);
+}
+
+static void audit_global_init(void) {
+    pthread_atfork(NULL, NULL, audit_atfork_child);
+}
+
+static int audit_forked(const cutils_audit_t *log) {
+    return atomic_load_explicit(&audit_forks, memory_order_relaxed) != log->generation;
+}
+
+/* ---- Record format ---- */
+
+static void audit_header_write(uint8_t *h, uint32_t len, uint64_t seq) {
+    for (int i = 0; i < 4; i++) {
+        h[i] = (uint8_t)(len >> (8 * i));
+    }
+    for (int i = 0; i < 8; i++) {
+        h[4 + i] = (uint8_t)(seq >> (8 * i));
+    }
+}
+
+static void audit_header_read(const uint8_t *h, uint32_t *len, uint64_t *seq) {
+    *len = 0;
+    *seq = 0;
+    for (int i = 0; i < 4; i++) {
+        *len |= (uint32_t)h[i] << (8 * i);
+    }
+    for (int i = 0; i < 8; i++) {
+        *seq |= (uint64_t)h[4 + i] << (8 * i);
+    }
+}
+
+/* digest = SHA-256(prev || header || entry), header and entry contiguous in record */
+static int audit_chain(cutils_sha256_ctx_t *sha, const uint8_t *prev, const uint8_t *record, size_t len,
+                       uint8_t *digest) {
+    int ret = cutils_sha256_init(sha);
+    if (ret == CUTILS_SUCCESS) {
+        ret = cutils_sha256_update(sha, prev, AUDIT_DIGEST);
+    }
+    if (ret == CUTILS_SUCCESS) {
+        ret = cutils_sha256_update(sha, record, AUDIT_HEADER + len);
+    }
+    if (ret == CUTILS_SUCCESS) {
+        ret = cutils_sha256_final(sha, digest);
+    }
+    return ret;
+}
+
+/* Read up to n bytes; returns the count read (short only at end of file) or -1 */
+static ssize_t audit_read_full(int fd, uint8_t *buf, size_t n, off_t offset) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t r = offset >= 0 ? pread(fd, buf + done, n - done, offset + (off_t)done)
+                                : read(fd, buf + done, n - done);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (r == 0) {
+            break;
+        }
+        done += (size_t)r;
+    }
+    return (ssize_t)done;
+}
+
+static int audit_writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Find the end of an existing log without rehashing it: walk the record
+ * headers, trim a torn last record and pick up the last digest and the
+ * next sequence number. A new (or torn-at-creation) file gets the magic.
+ */
+static int audit_recover(int fd, uint8_t *chain, uint64_t *next_seq) {
+    struct stat st;
+    uint8_t buf[AUDIT_HEADER];
+    if (fstat(fd, &st) < 0) {
+        return CUTILS_ERR_IO;
+    }
+    off_t size = st.st_size;
+
+    if (size < (off_t)AUDIT_MAGIC_LEN) {
+        if (audit_read_full(fd, buf, (size_t)size, 0) != (ssize_t)size) {
+            return CUTILS_ERR_IO;
+        }
+        if (memcmp(buf, CUTILS_AUDIT_MAGIC, (size_t)size) != 0) {
+            return CUTILS_ERR_INTEGRITY;
+        }
+        struct iovec iov = {CUTILS_AUDIT_MAGIC, AUDIT_MAGIC_LEN};
+        if (ftruncate(fd, 0) < 0 || audit_writev_all(fd, &iov, 1) < 0) {
+            return CUTILS_ERR_IO;
+        }
+        *next_seq = 0;
+        return CUTILS_SUCCESS;
+    }
+
+    if (audit_read_full(fd, buf, AUDIT_MAGIC_LEN, 0) != (ssize_t)AUDIT_MAGIC_LEN) {
+        return CUTILS_ERR_IO;
+    }
+    if (memcmp(buf, CUTILS_AUDIT_MAGIC, AUDIT_MAGIC_LEN) != 0) {
+        return CUTILS_ERR_INTEGRITY;
+    }
+
+    off_t offset = (off_t)AUDIT_MAGIC_LEN;
+    uint64_t seq = 0;
+    while (size - offset >= AUDIT_HEADER) {
+        uint32_t len;
+        uint64_t rseq;
+        if (audit_read_full(fd, buf, AUDIT_HEADER, offset) != AUDIT_HEADER) {
+            return CUTILS_ERR_IO;
+        }
+        audit_header_read(buf, &len, &rseq);
+        if (rseq != seq || len > CUTILS_AUDIT_MAX_ENTRY) {
+            return CUTILS_ERR_INTEGRITY;
+        }
+        off_t record = (off_t)(AUDIT_HEADER + len + AUDIT_DIGEST);
+        if (size - offset < record) {
+            break;
+        }
+        offset += record;
+        seq++;
+    }
+    if (offset < size && ftruncate(fd, offset) < 0) {
+        return CUTILS_ERR_IO;
+    }
+    if (seq > 0 && audit_read_full(fd, chain, AUDIT_DIGEST, offset - AUDIT_DIGEST) != AUDIT_DIGEST) {
+        return CUTILS_ERR_IO;
+    }
+    *next_seq = seq;
+    return CUTILS_SUCCESS;
+}
+
+/* ---- Queue ---- */
+
+static void audit_push(cutils_audit_t *log, audit_node_t *node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    audit_node_t *prev = atomic_exchange(&log->head, node);
+    /* seq_cst: pairs with the writer's store to sleeping before it checks the queue */
+    atomic_store(&prev->next, node);
+}
+
+/* Wake the writer if it went to sleep; only the first append after that pays for it */
+static void audit_wake(cutils_audit_t *log) {
+    if (atomic_load(&log->sleeping) && atomic_exchange(&log->sleeping, 0)) {
+        pthread_mutex_lock(&log->lock);
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+    }
+}
+
+/* Oldest node, or NULL if empty or the oldest push has not linked yet (writer only) */
+static audit_node_t* audit_pop(cutils_audit_t *log) {
+    audit_node_t *tail = log->tail;
+    audit_node_t *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (tail == log->stub) {
+        if (!next) {
+            return NULL;
+        }
+        log->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+    if (next) {
+        log->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load(&log->head)) {
+        return NULL;
+    }
+    /* tail is the last node: queue the stub behind it so it can be handed out */
+    audit_push(log, log->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        log->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/*
+ * Whether audit_pop would return a node. A push caught between its exchange
+ * and its link reads as empty: its own audit_wake will follow.
+ */
+static int audit_ready(cutils_audit_t *log) {
+    audit_node_t *tail = log->tail;
+    if (atomic_load(&tail->next)) {
+        return 1;
+    }
+    return tail != log->stub && atomic_load(&log->head) == tail;
+}
+
+/* ---- Writer ---- */
+
+static void audit_write_batch(cutils_audit_t *log, audit_node_t **batch, size_t count) {
+    struct iovec iov[AUDIT_BATCH];
+    int iovcnt = 0;
+    int error = atomic_load(&log->error);
+
+    for (size_t i = 0; i < count && !error; i++) {
+        audit_node_t *node = batch[i];
+        if (node->len == AUDIT_BARRIER) {
+            continue;
+        }
+        audit_header_write(node->record, (uint32_t)node->len, log->seq);
+        uint8_t *digest = node->record + AUDIT_HEADER + node->len;
+        error = audit_chain(log->sha, log->chain, node->record, node->len, digest);
+        memcpy(log->chain, digest, AUDIT_DIGEST);
+        log->seq++;
+        iov[iovcnt].iov_base = node->record;
+        iov[iovcnt].iov_len = AUDIT_HEADER + node->len + AUDIT_DIGEST;
+        iovcnt++;
+    }
+    if (!error && iovcnt > 0 &&
+        (audit_writev_all(log->fd, iov, iovcnt) < 0 ||
+         ((log->flags & CUTILS_AUDIT_SYNC) && fdatasync(log->fd) < 0))) {
+        error = CUTILS_ERR_IO;
+    }
+    if (error) {
+        int expected = 0;
+        atomic_compare_exchange_strong(&log->error, &expected, error);
+    }
+
+    /* Written (or dropped) entries are done with; barriers stay queued in batch */
+    size_t entries = 0;
+    size_t barriers = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (batch[i]->len == AUDIT_BARRIER) {
+            batch[barriers++] = batch[i];
+        } else {
+            free(batch[i]);
+            entries++;
+        }
+    }
+
+    pthread_mutex_lock(&log->lock);
+    if (!error) {
+        log->written += (uint64_t)iovcnt;
+        memcpy(log->head_digest, log->chain, AUDIT_DIGEST);
+    }
+    /* Barriers live on their flusher's stack: not touched once marked */
+    for (size_t i = 0; i < barriers; i++) {
+        *batch[i]->done = 1;
+    }
+    pthread_cond_broadcast(&log->flushed);
+    pthread_mutex_unlock(&log->lock);
+    atomic_fetch_sub(&log->pending, entries);
+}
+
+static void* audit_writer(void *arg) {
+    cutils_audit_t *log = arg;
+    audit_node_t *batch[AUDIT_BATCH];
+
+    for (;;) {
+        size_t count = 0;
+        audit_node_t *node;
+        while (count < AUDIT_BATCH && (node = audit_pop(log)) != NULL) {
+            batch[count++] = node;
+        }
+        if (count > 0) {
+            audit_write_batch(log, batch, count);
+            continue;
+        }
+
+        pthread_mutex_lock(&log->lock);
+        for (;;) {
+            /* seq_cst store then load: either this sees the link or the pusher sees sleeping */
+            atomic_store(&log->sleeping, 1);
+            if (audit_ready(log) || log->stop) {
+                break;
+            }
+            pthread_cond_wait(&log->wake, &log->lock);
+        }
+        atomic_store(&log->sleeping, 0);
+        int stop = log->stop && !audit_ready(log);
+        pthread_mutex_unlock(&log->lock);
+        if (stop) {
+            return NULL;
+        }
+    }
+}
+
+/* ---- API ---- */
+
+static void audit_destroy(cutils_audit_t *log) {
+    if (log->fd >= 0) {
+        close(log->fd);
+    }
+    cutils_sha256_free(log->sha);
+    free(log->stub);
+    pthread_cond_destroy(&log->flushed);
+    pthread_cond_destroy(&log->wake);
+    pthread_mutex_destroy(&log->lock);
+    free(log);
+}
+
+int cutils_audit_open(const char *path, const uint8_t *seed, unsigned int flags, cutils_audit_t **out) {
+    if (!path || !out) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+    pthread_once(&audit_once, audit_global_init);
+
+    cutils_audit_t *log = calloc(1, sizeof(*log));
+    if (!log) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    log->flags = flags;
+    log->generation = atomic_load_explicit(&audit_forks, memory_order_relaxed);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    pthread_cond_init(&log->flushed, NULL);
+    if (seed) {
+        memcpy(log->chain, seed, AUDIT_DIGEST);
+    }
+
+    log->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (log->fd < 0) {
+        audit_destroy(log);
+        return CUTILS_ERR_IO;
+    }
+    if (flock(log->fd, LOCK_EX | LOCK_NB) < 0) {
+        int saved = errno;
+        audit_destroy(log);
+        errno = saved;
+        return CUTILS_ERR_IO;
+    }
+
+    int ret = audit_recover(log->fd, log->chain, &log->seq);
+    if (ret == CUTILS_SUCCESS) {
+        ret = cutils_sha256_new(&log->sha);
+    }
+    if (ret == CUTILS_SUCCESS) {
+        log->stub = calloc(1, sizeof(audit_node_t));
+        ret = log->stub ? CUTILS_SUCCESS : CUTILS_ERR_CRYPTO;
+    }
+    if (ret != CUTILS_SUCCESS) {
+        int saved = errno;
+        audit_destroy(log);
+        errno = saved;
+        return ret;
+    }
+
+    memcpy(log->head_digest, log->chain, AUDIT_DIGEST);
+    log->written = log->seq;
+    log->tail = log->stub;
+    atomic_init(&log->head, log->stub);
+
+    if (pthread_create(&log->thread, NULL, audit_writer, log) != 0) {
+        audit_destroy(log);
+        return CUTILS_ERR_CRYPTO;
+    }
+    *out = log;
+    return CUTILS_SUCCESS;
+}
+
+int cutils_audit_append(cutils_audit_t *log, const uint8_t *entry, size_t len) {
+    if (!log || (!entry && len > 0)) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (len > CUTILS_AUDIT_MAX_ENTRY) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    int error = atomic_load_explicit(&log->error, memory_order_relaxed);
+    if (error) {
+        return error;
+    }
+    if (audit_forked(log)) {
+        return CUTILS_ERR_IO;
+    }
+    if (atomic_fetch_add_explicit(&log->pending, 1, memory_order_relaxed) >= CUTILS_AUDIT_MAX_PENDING) {
+        atomic_fetch_sub_explicit(&log->pending, 1, memory_order_relaxed);
+        return CUTILS_ERR_BUFFER_SIZE;
+    }
+
+    audit_node_t *node = malloc(sizeof(*node) + AUDIT_HEADER + len + AUDIT_DIGEST);
+    if (!node) {
+        atomic_fetch_sub_explicit(&log->pending, 1, memory_order_relaxed);
+        return CUTILS_ERR_CRYPTO;
+    }
+    node->len = len;
+    node->done = NULL;
+    if (len > 0) {
+        memcpy(node->record + AUDIT_HEADER, entry, len);
+    }
+
+    audit_push(log, node);
+    audit_wake(log);
+    return CUTILS_SUCCESS;
+}
+
+int cutils_audit_flush(cutils_audit_t *log) {
+    if (!log) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (audit_forked(log)) {
+        return CUTILS_ERR_IO;
+    }
+
+    int done = 0;
+    audit_node_t barrier = {.len = AUDIT_BARRIER, .done = &done};
+    audit_push(log, &barrier);
+    audit_wake(log);
+
+    pthread_mutex_lock(&log->lock);
+    while (!done) {
+        pthread_cond_wait(&log->flushed, &log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+    return atomic_load(&log->error);
+}
+
+int cutils_audit_head(cutils_audit_t *log, uint8_t *digest, uint64_t *count) {
+    if (!log || !digest) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (audit_forked(log)) {
+        return CUTILS_ERR_IO;
+    }
+    pthread_mutex_lock(&log->lock);
+    memcpy(digest, log->head_digest, AUDIT_DIGEST);
+    if (count) {
+        *count = log->written;
+    }
+    pthread_mutex_unlock(&log->lock);
+    return CUTILS_SUCCESS;
+}
+
+int cutils_audit_close(cutils_audit_t *log) {
+    if (!log) {
+        return CUTILS_SUCCESS;
+    }
+    if (audit_forked(log)) {
+        /* The parent's queue and locks are its own: only let go of the memory and descriptor */
+        close(log->fd);
+        cutils_sha256_free(log->sha);
+        free(log->stub);
+        free(log);
+        return CUTILS_SUCCESS;
+    }
+
+    pthread_mutex_lock(&log->lock);
+    log->stop = 1;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->thread, NULL);
+
+    int error = atomic_load(&log->error);
+    int fd = log->fd;
+    log->fd = -1;
+    if (close(fd) < 0 && !error) {
+        error = CUTILS_ERR_IO;
+    }
+    audit_destroy(log);
+    return error;
+}
+
+int cutils_audit_verify(const char *path, const uint8_t *seed, uint8_t *digest, uint64_t *count) {
+    if (!path) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    uint8_t chain[AUDIT_DIGEST] = {0};
+    uint8_t expected[AUDIT_DIGEST];
+    uint64_t seq = 0;
+    if (seed) {
+        memcpy(chain, seed, AUDIT_DIGEST);
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return CUTILS_ERR_IO;
+    }
+    cutils_sha256_ctx_t *sha = NULL;
+    uint8_t *record = malloc(AUDIT_HEADER + CUTILS_AUDIT_MAX_ENTRY + AUDIT_DIGEST);
+    int ret = record ? cutils_sha256_new(&sha) : CUTILS_ERR_CRYPTO;
+
+    if (ret == CUTILS_SUCCESS) {
+        ssize_t n = audit_read_full(fd, record, AUDIT_MAGIC_LEN, -1);
+        if (n < 0) {
+            ret = CUTILS_ERR_IO;
+        } else if (n != (ssize_t)AUDIT_MAGIC_LEN || memcmp(record, CUTILS_AUDIT_MAGIC, AUDIT_MAGIC_LEN) != 0) {
+            ret = CUTILS_ERR_INTEGRITY;
+        }
+    }
+    while (ret == CUTILS_SUCCESS) {
+        ssize_t n = audit_read_full(fd, record, AUDIT_HEADER, -1);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            ret = CUTILS_ERR_IO;
+            break;
+        }
+        uint32_t len;
+        uint64_t rseq;
+        audit_header_read(record, &len, &rseq);
+        if (n != AUDIT_HEADER || rseq != seq || len > CUTILS_AUDIT_MAX_ENTRY) {
+            ret = CUTILS_ERR_INTEGRITY;
+            break;
+        }
+        n = audit_read_full(fd, record + AUDIT_HEADER, len + AUDIT_DIGEST, -1);
+        if (n < 0) {
+            ret = CUTILS_ERR_IO;
+            break;
+        }
+        if (n != (ssize_t)(len + AUDIT_DIGEST)) {
+            ret = CUTILS_ERR_INTEGRITY;
+            break;
+        }
+        ret = audit_chain(sha, chain, record, len, expected);
+        if (ret == CUTILS_SUCCESS && memcmp(expected, record + AUDIT_HEADER + len, AUDIT_DIGEST) != 0) {
+            ret = CUTILS_ERR_INTEGRITY;
+        }
+        if (ret == CUTILS_SUCCESS) {
+            memcpy(chain, expected, AUDIT_DIGEST);
+            seq++;
+        }
+    }
+
+    int saved = errno;
+    cutils_sha256_free(sha);
+    free(record);
+    close(fd);
+    errno = saved;
+
+    if (digest) {
+        memcpy(digest, chain, AUDIT_DIGEST);
+    }
+    if (count) {
+        *count = seq;
+    }
+    return ret;
+}
@@ -0,0 +1,297 @@
+/*
+ * Hex encode/decode for libcutils.
+ *
+ * Encoding splits each byte into nibbles and maps them through a 16-entry
+ * table with a byte shuffle; decoding validates and converts 16/32 chars per
+ * step and folds nibble pairs with a multiply-add. Kernels are picked once
+ * at runtime (AVX2 / SSSE3 on x86-64, NEON on AArch64, scalar otherwise);
+ * tails shorter than a vector go through the scalar table path.
+ */
+#include "libcutils.h"
+#include "cpu_features.h"
+#include <pthread.h>
+#include <string.h>
+
+#define HEX_INVALID 0xFF
+
+static const char hex_digits[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+};
+
+/* Character -> nibble value, HEX_INVALID for non-hex characters */
+static uint8_t hex_values[256];
+
+typedef void (*hex_encode_fn)(const uint8_t *data, size_t data_len, char *output);
+typedef int (*hex_decode_fn)(const char *hex, size_t out_len, uint8_t *output);
+
+typedef struct {
+    const char *name;
+    unsigned int required;  /* CPU_FEATURE_* bits, 0 for scalar */
+    hex_encode_fn encode;
+    hex_decode_fn decode;
+} hex_kernel_t;
+
+/* ---- Scalar ---- */
+
+static void hex_encode_scalar(const uint8_t *data, size_t data_len, char *output) {
+    for (size_t i = 0; i < data_len; i++) {
+        output[i * 2] = hex_digits[data[i] >> 4];
+        output[i * 2 + 1] = hex_digits[data[i] & 0x0F];
+    }
+}
+
+/* Decodes out_len bytes from 2 * out_len chars; returns 0, or -1 on a bad char */
+static int hex_decode_scalar(const char *hex, size_t out_len, uint8_t *output) {
+    uint8_t bad = 0;
+    for (size_t i = 0; i < out_len; i++) {
+        uint8_t hi = hex_values[(uint8_t)hex[i * 2]];
+        uint8_t lo = hex_values[(uint8_t)hex[i * 2 + 1]];
+        bad |= hi | lo;
+        output[i] = (uint8_t)((hi << 4) | (lo & 0x0F));
+    }
+    return (bad & 0xF0) ? -1 : 0;
+}
+
+/* ---- x86-64 ---- */
+
+#if defined(CPU_ARCH_X86)
+CPU_TARGET_SSSE3
+static void hex_encode_ssse3(const uint8_t *data, size_t data_len, char *output) {
+    const __m128i lut = _mm_loadu_si128((const __m128i*)hex_digits);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= data_len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(x, mask));
+        _mm_storeu_si128((__m128i*)(output + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(output + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    hex_encode_scalar(data + i, data_len - i, output + 2 * i);
+}
+
+/* Map 16 chars to nibble values; *ok gets 0xFF in every valid lane */
+CPU_TARGET_SSSE3
+static inline __m128i hex_nibbles_ssse3(__m128i c, __m128i *ok) {
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i d_ok = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    __m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i l_ok = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+    *ok = _mm_or_si128(d_ok, l_ok);
+    return _mm_or_si128(_mm_and_si128(d_ok, d),
+                        _mm_and_si128(l_ok, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+CPU_TARGET_SSSE3
+static int hex_decode_ssse3(const char *hex, size_t out_len, uint8_t *output) {
+    /* (hi, lo) byte pairs -> hi * 16 + lo in each 16-bit lane */
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i all_ok = _mm_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 16 <= out_len; i += 16) {
+        __m128i ok0, ok1;
+        __m128i v0 = hex_nibbles_ssse3(_mm_loadu_si128((const __m128i*)(hex + 2 * i)), &ok0);
+        __m128i v1 = hex_nibbles_ssse3(_mm_loadu_si128((const __m128i*)(hex + 2 * i + 16)), &ok1);
+        all_ok = _mm_and_si128(all_ok, _mm_and_si128(ok0, ok1));
+        __m128i w0 = _mm_maddubs_epi16(v0, weights);
+        __m128i w1 = _mm_maddubs_epi16(v1, weights);
+        _mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(w0, w1));
+    }
+    if (_mm_movemask_epi8(all_ok) != 0xFFFF) {
+        return -1;
+    }
+    return hex_decode_scalar(hex + 2 * i, out_len - i, output + i);
+}
+
+CPU_TARGET_AVX2
+static void hex_encode_avx2(const uint8_t *data, size_t data_len, char *output) {
+    const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)hex_digits));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= data_len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+        /* Unpacks work per 128-bit lane; swap the middle halves back */
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i*)(output + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)(output + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    /* The SSSE3 tail is legacy-SSE encoded: avoid the AVX-SSE transition stall */
+    _mm256_zeroupper();
+    hex_encode_ssse3(data + i, data_len - i, output + 2 * i);
+}
+
+CPU_TARGET_AVX2
+static inline __m256i hex_nibbles_avx2(__m256i c, __m256i *ok) {
+    __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i d_ok = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    __m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i l_ok = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+    *ok = _mm256_or_si256(d_ok, l_ok);
+    return _mm256_or_si256(_mm256_and_si256(d_ok, d),
+                           _mm256_and_si256(l_ok, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+}
+
+CPU_TARGET_AVX2
+static int hex_decode_avx2(const char *hex, size_t out_len, uint8_t *output) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    __m256i all_ok = _mm256_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 32 <= out_len; i += 32) {
+        __m256i ok0, ok1;
+        __m256i v0 = hex_nibbles_avx2(_mm256_loadu_si256((const __m256i*)(hex + 2 * i)), &ok0);
+        __m256i v1 = hex_nibbles_avx2(_mm256_loadu_si256((const __m256i*)(hex + 2 * i + 32)), &ok1);
+        all_ok = _mm256_and_si256(all_ok, _mm256_and_si256(ok0, ok1));
+        __m256i w0 = _mm256_maddubs_epi16(v0, weights);
+        __m256i w1 = _mm256_maddubs_epi16(v1, weights);
+        /* packus interleaves lanes: qwords come out as 0, 2, 1, 3 */
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(w0, w1), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*)(output + i), packed);
+    }
+    int ok = (unsigned int)_mm256_movemask_epi8(all_ok) == 0xFFFFFFFFu;
+    _mm256_zeroupper();
+    if (!ok) {
+        return -1;
+    }
+    return hex_decode_ssse3(hex + 2 * i, out_len - i, output + i);
+}
+#endif
+
+/* ---- AArch64 ---- */
+
+#if defined(CPU_ARCH_ARM64)
+static void hex_encode_neon(const uint8_t *data, size_t data_len, char *output) {
+    const uint8x16_t lut = vld1q_u8((const uint8_t*)hex_digits);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= data_len; i += 16) {
+        uint8x16_t x = vld1q_u8(data + i);
+        uint8x16x2_t chars;
+        chars.val[0] = vqtbl1q_u8(lut, vshrq_n_u8(x, 4));
+        chars.val[1] = vqtbl1q_u8(lut, vandq_u8(x, mask));
+        vst2q_u8((uint8_t*)output + 2 * i, chars);
+    }
+    hex_encode_scalar(data + i, data_len - i, output + 2 * i);
+}
+
+static inline uint8x16_t hex_nibbles_neon(uint8x16_t c, uint8x16_t *ok) {
+    uint8x16_t d = vsubq_u8(c, vdupq_n_u8('0'));
+    uint8x16_t d_ok = vcleq_u8(d, vdupq_n_u8(9));
+    uint8x16_t l = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    uint8x16_t l_ok = vcleq_u8(l, vdupq_n_u8(5));
+    *ok = vorrq_u8(d_ok, l_ok);
+    return vbslq_u8(d_ok, d, vaddq_u8(l, vdupq_n_u8(10)));
+}
+
+static int hex_decode_neon(const char *hex, size_t out_len, uint8_t *output) {
+    uint8x16_t all_ok = vdupq_n_u8(0xFF);
+    size_t i = 0;
+    for (; i + 16 <= out_len; i += 16) {
+        /* De-interleaving load: val[0] = high-nibble chars, val[1] = low */
+        uint8x16x2_t chars = vld2q_u8((const uint8_t*)hex + 2 * i);
+        uint8x16_t ok_hi, ok_lo;
+        uint8x16_t hi = hex_nibbles_neon(chars.val[0], &ok_hi);
+        uint8x16_t lo = hex_nibbles_neon(chars.val[1], &ok_lo);
+        all_ok = vandq_u8(all_ok, vandq_u8(ok_hi, ok_lo));
+        vst1q_u8(output + i, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    }
+    if (vminvq_u8(all_ok) != 0xFF) {
+        return -1;
+    }
+    return hex_decode_scalar(hex + 2 * i, out_len - i, output + i);
+}
+#endif
+
+static const hex_kernel_t hex_kernels[] = {
+#if defined(CPU_ARCH_X86)
+    {"avx2", CPU_FEATURE_AVX2 | CPU_FEATURE_SSSE3, hex_encode_avx2, hex_decode_avx2},
+    {"ssse3", CPU_FEATURE_SSSE3, hex_encode_ssse3, hex_decode_ssse3},
+#endif
+#if defined(CPU_ARCH_ARM64)
+    {"neon", CPU_FEATURE_NEON, hex_encode_neon, hex_decode_neon},
+#endif
+    {"scalar", 0, hex_encode_scalar, hex_decode_scalar},
+};
+
+static const hex_kernel_t *hex_kernel = NULL;
+static pthread_once_t hex_once = PTHREAD_ONCE_INIT;
+
+static void hex_select_kernel(void) {
+    /* Kernels are listed fastest first; scalar is always supported */
+    CPU_KERNEL_PICK(hex_kernels, cpu_features_detect(), (const char *)NULL, hex_kernel);
+}
+
+static void hex_global_init(void) {
+    memset(hex_values, HEX_INVALID, sizeof(hex_values));
+    for (int i = 0; i < 10; i++) {
+        hex_values['0' + i] = (uint8_t)i;
+    }
+    for (int i = 0; i < 6; i++) {
+        hex_values['a' + i] = (uint8_t)(10 + i);
+        hex_values['A' + i] = (uint8_t)(10 + i);
+    }
+    hex_select_kernel();
+}
+
+static inline const hex_kernel_t* hex_get_kernel(void) {
+    pthread_once(&hex_once, hex_global_init);
+    return hex_kernel;
+}
+
+const char* cutils_hex_impl(void) {
+    return hex_get_kernel()->name;
+}
+
+int cutils_hex_force_impl(const char *name) {
+    hex_get_kernel();
+    if (!name) {
+        hex_select_kernel();
+        return CUTILS_SUCCESS;
+    }
+    const hex_kernel_t *kernel;
+    CPU_KERNEL_PICK(hex_kernels, cpu_features_detect(), name, kernel);
+    if (!kernel) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    hex_kernel = kernel;
+    return CUTILS_SUCCESS;
+}
+
+int cutils_hex_encode(const uint8_t *data, size_t data_len, char *output) {
+    if (!data || !output) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    hex_get_kernel()->encode(data, data_len, output);
+    output[data_len * 2] = '\0';
+
+    return CUTILS_SUCCESS;
+}
+
+int cutils_hex_decode_len(const char *hex, size_t hex_len, uint8_t *output, size_t *output_len) {
+    if ((!hex || !output) && hex_len) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (hex_len % 2 != 0) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+
+    if (hex_len && hex_get_kernel()->decode(hex, hex_len / 2, output) != 0) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+
+    if (output_len) {
+        *output_len = hex_len / 2;
+    }
+    return CUTILS_SUCCESS;
+}
+
+int cutils_hex_decode(const char *hex, uint8_t *output, size_t *output_len) {
+    if (!hex || !output || !output_len) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    return cutils_hex_decode_len(hex, strlen(hex), output, output_len);
+}
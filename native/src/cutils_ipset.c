@@ -0,0 +1,193 @@
+/*
+ * IP network sets for libcutils.
+ *
+ * Two tries, IPv4 and IPv6, walked a nibble of the address at a time. A
+ * child entry is either empty, IPSET_MATCH (a network covers everything
+ * below) or the index of the next node. A network whose length is not a
+ * multiple of 4 fills the 2, 4 or 8 entries it spans in its last node, so
+ * lookups never backtrack. Adding a network under one already present is a
+ * no-op; adding one over existing entries replaces them by IPSET_MATCH and
+ * leaves the nodes below unreferenced, which only costs memory.
+ */
+#include "libcutils.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IPSET_EMPTY  0u
+#define IPSET_MATCH  1u   /* Never a node index: nodes 0 and 1 are the roots */
+#define IPSET_ROOT4  0u
+#define IPSET_ROOT6  1u
+
+typedef struct {
+    uint32_t child[16];
+} ipset_node_t;
+
+struct cutils_ipset {
+    ipset_node_t *nodes;
+    uint32_t count;
+    uint32_t capacity;
+    int match_all[2];     /* A /0 was added: [0] IPv4, [1] IPv6 */
+};
+
+static const uint8_t ipv4_mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+static unsigned int ipset_nibble(const uint8_t *addr, unsigned int i) {
+    return i & 1 ? addr[i / 2] & 0x0f : addr[i / 2] >> 4;
+}
+
+int cutils_ip_parse(const char *text, uint8_t addr[16], size_t *addr_len, unsigned int *prefix_len) {
+    if (!text || !addr || !addr_len || !prefix_len) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    char buf[INET6_ADDRSTRLEN];
+    const char *slash = strchr(text, '/');
+    size_t len = slash ? (size_t)(slash - text) : strlen(text);
+    if (len == 0 || len >= sizeof(buf)) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+
+    if (inet_pton(AF_INET, buf, addr) == 1) {
+        *addr_len = 4;
+    } else if (inet_pton(AF_INET6, buf, addr) == 1) {
+        *addr_len = 16;
+    } else {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+
+    unsigned int bits = (unsigned int)*addr_len * 8;
+    unsigned int prefix = bits;
+    if (slash) {
+        const char *p = slash + 1;
+        if (*p == '\0' || strlen(p) > 3) {
+            return CUTILS_ERR_INVALID_SIZE;
+        }
+        prefix = 0;
+        for (; *p; p++) {
+            if (*p < '0' || *p > '9') {
+                return CUTILS_ERR_INVALID_SIZE;
+            }
+            prefix = prefix * 10 + (unsigned int)(*p - '0');
+        }
+        if (prefix > bits) {
+            return CUTILS_ERR_INVALID_SIZE;
+        }
+    }
+    *prefix_len = prefix;
+    return CUTILS_SUCCESS;
+}
+
+static uint32_t ipset_alloc(cutils_ipset_t *set) {
+    if (set->count == set->capacity) {
+        uint32_t capacity = set->capacity * 2;
+        ipset_node_t *nodes = realloc(set->nodes, (size_t)capacity * sizeof(*nodes));
+        if (!nodes) {
+            return IPSET_EMPTY;
+        }
+        set->nodes = nodes;
+        set->capacity = capacity;
+    }
+    memset(&set->nodes[set->count], 0, sizeof(ipset_node_t));
+    return set->count++;
+}
+
+int cutils_ipset_new(cutils_ipset_t **out) {
+    if (!out) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+    cutils_ipset_t *set = calloc(1, sizeof(*set));
+    if (!set) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    set->capacity = 16;
+    set->nodes = calloc(set->capacity, sizeof(ipset_node_t));
+    if (!set->nodes) {
+        free(set);
+        return CUTILS_ERR_CRYPTO;
+    }
+    set->count = 2;  /* The roots */
+    *out = set;
+    return CUTILS_SUCCESS;
+}
+
+/* Point IPv4-mapped IPv6 input at the IPv4 trie; returns the address family index */
+static int ipset_family(const uint8_t **addr, size_t *addr_len, unsigned int *prefix_len) {
+    if (*addr_len == 16 && *prefix_len >= 96 && memcmp(*addr, ipv4_mapped, sizeof(ipv4_mapped)) == 0) {
+        *addr += 12;
+        *addr_len = 4;
+        *prefix_len -= 96;
+    }
+    return *addr_len == 16;
+}
+
+int cutils_ipset_add(cutils_ipset_t *set, const uint8_t *addr, size_t addr_len, unsigned int prefix_len) {
+    if (!set || !addr) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if ((addr_len != 4 && addr_len != 16) || prefix_len > addr_len * 8) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    int v6 = ipset_family(&addr, &addr_len, &prefix_len);
+    if (prefix_len == 0) {
+        set->match_all[v6] = 1;
+        return CUTILS_SUCCESS;
+    }
+
+    unsigned int last = (prefix_len - 1) / 4;       /* Nibble holding the last prefix bit */
+    uint32_t node = v6 ? IPSET_ROOT6 : IPSET_ROOT4;
+    for (unsigned int i = 0; i < last; i++) {
+        uint32_t next = set->nodes[node].child[ipset_nibble(addr, i)];
+        if (next == IPSET_MATCH) {
+            return CUTILS_SUCCESS;                  /* Already covered */
+        }
+        if (next == IPSET_EMPTY) {
+            next = ipset_alloc(set);                /* May move set->nodes */
+            if (next == IPSET_EMPTY) {
+                return CUTILS_ERR_CRYPTO;
+            }
+            set->nodes[node].child[ipset_nibble(addr, i)] = next;
+        }
+        node = next;
+    }
+
+    unsigned int span = 1u << (4 - (prefix_len - last * 4));
+    unsigned int first = ipset_nibble(addr, last) & ~(span - 1);
+    for (unsigned int c = first; c < first + span; c++) {
+        set->nodes[node].child[c] = IPSET_MATCH;
+    }
+    return CUTILS_SUCCESS;
+}
+
+int cutils_ipset_contains(const cutils_ipset_t *set, const uint8_t *addr, size_t addr_len, int *found) {
+    if (!set || !addr || !found) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (addr_len != 4 && addr_len != 16) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    unsigned int prefix_len = (unsigned int)addr_len * 8;
+    int v6 = ipset_family(&addr, &addr_len, &prefix_len);
+    *found = set->match_all[v6];
+
+    uint32_t node = v6 ? IPSET_ROOT6 : IPSET_ROOT4;
+    for (unsigned int i = 0; !*found && i < addr_len * 2; i++) {
+        uint32_t next = set->nodes[node].child[ipset_nibble(addr, i)];
+        if (next == IPSET_EMPTY) {
+            break;
+        }
+        *found = next == IPSET_MATCH;
+        node = next;
+    }
+    return CUTILS_SUCCESS;
+}
+
+void cutils_ipset_free(cutils_ipset_t *set) {
+    if (!set) {
+        return;
+    }
+    free(set->nodes);
+    free(set);
+}
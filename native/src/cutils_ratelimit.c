@@ -0,0 +1,254 @@
+/*
+ * Shared-memory rate buckets for libcutils.
+ *
+ * The segment is a 64-byte header followed by a power-of-two array of
+ * 16-byte slots: the key's XXH3 hash (0 = free) and its theoretical arrival
+ * time (TAT), a CLOCK_MONOTONIC timestamp in nanoseconds, which is the same
+ * clock in every process on the host. With emission interval T = window /
+ * limit, a hit at `now` moves the TAT to max(TAT, now) + T and is allowed
+ * while that stays within one window of now; a TAT in the past is a full
+ * bucket, so such slots are free to take over.
+ *
+ * Creation and attachment of a named segment are serialized with flock on
+ * the shared memory descriptor; after that only atomics on the slots are
+ * used, which stay lock-free (and so address-free) in a shared mapping.
+ */
+#include "libcutils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared-memory rate buckets need lock-free 64-bit atomics");
+
+#define RL_MAGIC_LEN (sizeof(CUTILS_RATELIMIT_MAGIC) - 1)
+#define RL_PROBE     8    /* Slots a key may occupy: two cache lines */
+#define RL_MIN_SLOTS 64
+
+typedef struct {
+    char magic[RL_MAGIC_LEN];
+    uint64_t slots;
+    uint8_t reserved[48];
+} rl_header_t;
+
+typedef struct {
+    _Atomic uint64_t key;
+    _Atomic uint64_t tat;
+} rl_slot_t;
+
+_Static_assert(sizeof(rl_header_t) == 64, "slots must start on a cache line");
+
+struct cutils_ratelimit {
+    void *map;
+    size_t map_size;
+    rl_slot_t *slots;
+    uint64_t mask;
+};
+
+static uint64_t rl_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rl_key(const uint8_t *key, size_t key_len) {
+    uint64_t h = cutils_xxh3_64(key, key_len, 0);
+    return h ? h : 1;
+}
+
+/* Lay out a new table, or check an existing one (fd -1: anonymous); the segment is locked by the caller */
+static int rl_map(int fd, size_t slots, cutils_ratelimit_t *rl) {
+    struct stat st = {0};
+    if (fd >= 0 && fstat(fd, &st) != 0) {
+        return CUTILS_ERR_IO;
+    }
+    int fresh = st.st_size == 0;
+    size_t size = fresh ? sizeof(rl_header_t) + slots * sizeof(rl_slot_t) : (size_t)st.st_size;
+    if (!fresh && size < sizeof(rl_header_t)) {
+        return CUTILS_ERR_INTEGRITY;
+    }
+    if (fresh && fd >= 0 && ftruncate(fd, (off_t)size) != 0) {
+        return CUTILS_ERR_IO;
+    }
+
+    void *map = fd < 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)
+                       : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return CUTILS_ERR_IO;
+    }
+    rl_header_t *header = map;
+    if (fresh) {
+        /* New pages read as zero: every slot is already free */
+        memcpy(header->magic, CUTILS_RATELIMIT_MAGIC, RL_MAGIC_LEN);
+        header->slots = slots;
+    } else if (memcmp(header->magic, CUTILS_RATELIMIT_MAGIC, RL_MAGIC_LEN) != 0 ||
+               header->slots < RL_MIN_SLOTS || (header->slots & (header->slots - 1)) ||
+               header->slots > (size - sizeof(rl_header_t)) / sizeof(rl_slot_t)) {
+        munmap(map, size);
+        return CUTILS_ERR_INTEGRITY;
+    }
+
+    rl->map = map;
+    rl->map_size = size;
+    rl->slots = (rl_slot_t*)(header + 1);
+    rl->mask = header->slots - 1;
+    return CUTILS_SUCCESS;
+}
+
+int cutils_ratelimit_open(const char *name, size_t slots, cutils_ratelimit_t **out) {
+    if (!out) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+    if (slots == 0) {
+        slots = CUTILS_RATELIMIT_DEFAULT_SLOTS;
+    }
+    if (slots > CUTILS_RATELIMIT_MAX_SLOTS) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    size_t rounded = RL_MIN_SLOTS;
+    while (rounded < slots) {
+        rounded <<= 1;
+    }
+
+    cutils_ratelimit_t *rl = calloc(1, sizeof(*rl));
+    if (!rl) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    int result;
+    if (!name) {
+        result = rl_map(-1, rounded, rl);
+    } else {
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            free(rl);
+            return CUTILS_ERR_IO;
+        }
+        if (flock(fd, LOCK_EX) != 0) {
+            result = CUTILS_ERR_IO;
+        } else {
+            result = rl_map(fd, rounded, rl);
+            /* Unlock explicitly: the mapping keeps the open file, and with it the lock, past close */
+            int saved = errno;
+            flock(fd, LOCK_UN);
+            errno = saved;
+        }
+        int saved = errno;
+        close(fd);
+        errno = saved;
+    }
+    if (result != CUTILS_SUCCESS) {
+        free(rl);
+        return result;
+    }
+    *out = rl;
+    return CUTILS_SUCCESS;
+}
+
+/* The key's slot, claiming or taking one over when it has none; NULL if it lost a race for the last one */
+static rl_slot_t* rl_slot(cutils_ratelimit_t *rl, uint64_t key, uint64_t now) {
+    rl_slot_t *victim = NULL;
+    uint64_t victim_tat = UINT64_MAX;
+
+    for (uint64_t i = 0; i < RL_PROBE; i++) {
+        rl_slot_t *slot = &rl->slots[(key + i) & rl->mask];
+        uint64_t held = atomic_load_explicit(&slot->key, memory_order_acquire);
+        if (held == 0) {
+            if (atomic_compare_exchange_strong_explicit(&slot->key, &held, key, memory_order_acq_rel,
+                                                        memory_order_acquire)) {
+                return slot;
+            }
+            /* Lost the slot: `held` now says to whom */
+        }
+        if (held == key) {
+            return slot;
+        }
+        uint64_t tat = atomic_load_explicit(&slot->tat, memory_order_relaxed);
+        if (tat < victim_tat) {
+            victim = slot;
+            victim_tat = tat;
+        }
+    }
+
+    /* All probed slots belong to other keys: take over the one closest to refilled */
+    uint64_t held = atomic_load_explicit(&victim->key, memory_order_relaxed);
+    if (held == key) {
+        return victim;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&victim->key, &held, key, memory_order_acq_rel,
+                                                 memory_order_relaxed)) {
+        return held == key ? victim : NULL;
+    }
+    /* The previous owner's backlog is not ours */
+    if (victim_tat > now) {
+        atomic_compare_exchange_strong_explicit(&victim->tat, &victim_tat, 0, memory_order_relaxed,
+                                                memory_order_relaxed);
+    }
+    return victim;
+}
+
+int cutils_ratelimit_hit(cutils_ratelimit_t *rl, const uint8_t *key, size_t key_len,
+                         uint32_t limit, uint64_t window_ns, uint64_t *retry_ns) {
+    if (!rl || (!key && key_len) || !retry_ns) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (limit == 0 || window_ns == 0) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    *retry_ns = 0;
+
+    uint64_t now = rl_now();
+    rl_slot_t *slot = rl_slot(rl, rl_key(key, key_len), now);
+    if (!slot) {
+        return CUTILS_SUCCESS;  /* Errs towards allowing, like a takeover */
+    }
+
+    uint64_t interval = window_ns / limit ? window_ns / limit : 1;
+    uint64_t tat = atomic_load_explicit(&slot->tat, memory_order_relaxed);
+    for (;;) {
+        uint64_t next = (tat > now ? tat : now) + interval;
+        if (next - now > window_ns) {
+            *retry_ns = next - now - window_ns;
+            return CUTILS_SUCCESS;
+        }
+        if (atomic_compare_exchange_weak_explicit(&slot->tat, &tat, next, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            return CUTILS_SUCCESS;
+        }
+    }
+}
+
+int cutils_ratelimit_reset(cutils_ratelimit_t *rl, const uint8_t *key, size_t key_len) {
+    if (!rl || (!key && key_len)) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    uint64_t hash = rl_key(key, key_len);
+    for (uint64_t i = 0; i < RL_PROBE; i++) {
+        rl_slot_t *slot = &rl->slots[(hash + i) & rl->mask];
+        if (atomic_load_explicit(&slot->key, memory_order_acquire) == hash) {
+            atomic_store_explicit(&slot->tat, 0, memory_order_relaxed);
+        }
+    }
+    return CUTILS_SUCCESS;
+}
+
+void cutils_ratelimit_close(cutils_ratelimit_t *rl) {
+    if (!rl) {
+        return;
+    }
+    munmap(rl->map, rl->map_size);
+    free(rl);
+}
+
+int cutils_ratelimit_unlink(const char *name) {
+    if (!name) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    return shm_unlink(name) == 0 ? CUTILS_SUCCESS : CUTILS_ERR_IO;
+}
@@ -0,0 +1,209 @@
+/*
+ * Per-thread call counters; see cutils_stats.h.
+ *
+ * A thread's first recorded call allocates its block and links it into the
+ * domain; the key destructor folds the block into the domain's retired
+ * totals when the thread exits. Registration, exit, snapshots and resets
+ * share one mutex, which recording never takes.
+ *
+ * Reset cannot write other threads' counters, so it bumps the domain epoch
+ * instead: snapshots skip blocks from an older epoch, and a thread zeroes
+ * its own block on its next call.
+ */
+#include "cutils_stats.h"
+
+#ifdef HOSPITAL_NATIVE_STATS
+
+#include <stdlib.h>
+#include <string.h>
+
+struct cutils_stats_block {
+    struct cutils_stats_block *prev;
+    struct cutils_stats_block *next;
+    cutils_stats_domain_t *domain;
+    _Atomic unsigned int epoch;
+    cutils_stats_counters_t counters[];
+};
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+
+/* A fork must not leave the child with the lock held by a thread it lacks */
+static void stats_atfork_prepare(void) {
+    pthread_mutex_lock(&stats_lock);
+}
+
+static void stats_atfork_release(void) {
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void stats_global_init(void) {
+    pthread_atfork(stats_atfork_prepare, stats_atfork_release, stats_atfork_release);
+}
+
+static inline void counter_add(_Atomic uint64_t *c, uint64_t v) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static void counters_zero(cutils_stats_counters_t *c, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        atomic_store_explicit(&c[i].calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&c[i].bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&c[i].total_ns, 0, memory_order_relaxed);
+        for (size_t e = 0; e < CUTILS_STATS_ERROR_CODES; e++) {
+            atomic_store_explicit(&c[i].errors[e], 0, memory_order_relaxed);
+        }
+        for (size_t b = 0; b < CUTILS_STATS_LATENCY_BUCKETS; b++) {
+            atomic_store_explicit(&c[i].latency[b], 0, memory_order_relaxed);
+        }
+    }
+}
+
+/* Add counters `src` into `dst`; `dst` is only touched under stats_lock */
+static void counters_merge(cutils_stats_counters_t *dst, const cutils_stats_counters_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        counter_add(&dst[i].calls, atomic_load_explicit(&src[i].calls, memory_order_relaxed));
+        counter_add(&dst[i].bytes, atomic_load_explicit(&src[i].bytes, memory_order_relaxed));
+        counter_add(&dst[i].total_ns, atomic_load_explicit(&src[i].total_ns, memory_order_relaxed));
+        for (size_t e = 0; e < CUTILS_STATS_ERROR_CODES; e++) {
+            counter_add(&dst[i].errors[e], atomic_load_explicit(&src[i].errors[e], memory_order_relaxed));
+        }
+        for (size_t b = 0; b < CUTILS_STATS_LATENCY_BUCKETS; b++) {
+            counter_add(&dst[i].latency[b], atomic_load_explicit(&src[i].latency[b], memory_order_relaxed));
+        }
+    }
+}
+
+static void block_destroy(void *ptr) {
+    struct cutils_stats_block *b = ptr;
+    cutils_stats_domain_t *d = b->domain;
+
+    pthread_mutex_lock(&stats_lock);
+    if (atomic_load_explicit(&b->epoch, memory_order_relaxed) == atomic_load(&d->epoch)) {
+        counters_merge(d->retired, b->counters, d->count);
+    }
+    if (b->prev) {
+        b->prev->next = b->next;
+    } else {
+        d->blocks = b->next;
+    }
+    if (b->next) {
+        b->next->prev = b->prev;
+    }
+    pthread_mutex_unlock(&stats_lock);
+    free(b);
+}
+
+static int domain_init(cutils_stats_domain_t *d) {
+    pthread_once(&stats_once, stats_global_init);
+
+    pthread_mutex_lock(&stats_lock);
+    int ok = atomic_load_explicit(&d->ready, memory_order_relaxed);
+    if (!ok && pthread_key_create(&d->key, block_destroy) == 0) {
+        atomic_store_explicit(&d->ready, 1, memory_order_release);
+        ok = 1;
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return ok;
+}
+
+static struct cutils_stats_block* block_get(cutils_stats_domain_t *d) {
+    if (!atomic_load_explicit(&d->ready, memory_order_acquire) && !domain_init(d)) {
+        return NULL;
+    }
+
+    struct cutils_stats_block *b = pthread_getspecific(d->key);
+    unsigned int epoch = atomic_load_explicit(&d->epoch, memory_order_acquire);
+    if (b) {
+        if (atomic_load_explicit(&b->epoch, memory_order_relaxed) != epoch) {
+            counters_zero(b->counters, d->count);
+            atomic_store_explicit(&b->epoch, epoch, memory_order_release);
+        }
+        return b;
+    }
+
+    b = calloc(1, sizeof(*b) + d->count * sizeof(cutils_stats_counters_t));
+    if (!b) {
+        return NULL;
+    }
+    b->domain = d;
+    if (pthread_setspecific(d->key, b) != 0) {
+        free(b);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    /* Taken under the lock so a reset since the load above cannot be missed */
+    atomic_init(&b->epoch, atomic_load(&d->epoch));
+    b->next = d->blocks;
+    if (d->blocks) {
+        d->blocks->prev = b;
+    }
+    d->blocks = b;
+    pthread_mutex_unlock(&stats_lock);
+    return b;
+}
+
+void cutils_stats_record(cutils_stats_domain_t *domain, size_t api, uint64_t ns, uint64_t bytes, int status) {
+    struct cutils_stats_block *b = block_get(domain);
+    if (!b) {
+        return;
+    }
+
+    cutils_stats_counters_t *c = &b->counters[api];
+    counter_add(&c->calls, 1);
+    counter_add(&c->bytes, bytes);
+    counter_add(&c->total_ns, ns);
+    if (status < 0) {
+        unsigned int code = (unsigned int)-(int64_t)status;
+        counter_add(&c->errors[code < CUTILS_STATS_ERROR_CODES ? code : CUTILS_STATS_ERROR_CODES - 1], 1);
+    }
+    unsigned int bucket = 63 - (unsigned int)__builtin_clzll(ns | 1);
+    counter_add(&c->latency[bucket < CUTILS_STATS_LATENCY_BUCKETS ? bucket : CUTILS_STATS_LATENCY_BUCKETS - 1], 1);
+}
+
+static void entry_add(cutils_stats_t *out, const cutils_stats_counters_t *c) {
+    out->calls += atomic_load_explicit(&c->calls, memory_order_relaxed);
+    out->bytes += atomic_load_explicit(&c->bytes, memory_order_relaxed);
+    out->total_ns += atomic_load_explicit(&c->total_ns, memory_order_relaxed);
+    for (size_t e = 0; e < CUTILS_STATS_ERROR_CODES; e++) {
+        out->errors[e] += atomic_load_explicit(&c->errors[e], memory_order_relaxed);
+    }
+    for (size_t b = 0; b < CUTILS_STATS_LATENCY_BUCKETS; b++) {
+        out->latency[b] += atomic_load_explicit(&c->latency[b], memory_order_relaxed);
+    }
+}
+
+size_t cutils_stats_collect(cutils_stats_domain_t *domain, cutils_stats_t *out, size_t capacity) {
+    size_t n = capacity < domain->count ? capacity : domain->count;
+    if (!out) {
+        return domain->count;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    unsigned int epoch = atomic_load(&domain->epoch);
+    for (size_t i = 0; i < n; i++) {
+        memset(&out[i], 0, sizeof(out[i]));
+        out[i].name = domain->names[i];
+        entry_add(&out[i], &domain->retired[i]);
+    }
+    for (struct cutils_stats_block *b = domain->blocks; b; b = b->next) {
+        if (atomic_load_explicit(&b->epoch, memory_order_acquire) != epoch) {
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            entry_add(&out[i], &b->counters[i]);
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return domain->count;
+}
+
+void cutils_stats_clear(cutils_stats_domain_t *domain) {
+    pthread_mutex_lock(&stats_lock);
+    atomic_fetch_add(&domain->epoch, 1);
+    counters_zero(domain->retired, domain->count);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+#endif /* HOSPITAL_NATIVE_STATS */
@@ -0,0 +1,81 @@
+/*
+ * Call instrumentation shared by libcutils and libhl7val.
+ *
+ * Built only with -DHOSPITAL_NATIVE_STATS=ON. Each library keeps a domain, a
+ * fixed table of API names; every thread records into its own block of
+ * counters (calls, input bytes, errors by code, log2 latency buckets), so
+ * the hot path takes no lock and writes no shared cache line. Snapshots sum
+ * the live blocks plus the totals left by exited threads.
+ *
+ * Without the option STATS_CALL() is a plain return and nothing here is
+ * compiled in.
+ */
+#ifndef HOSPITAL_NATIVE_CUTILS_STATS_H
+#define HOSPITAL_NATIVE_CUTILS_STATS_H
+
+#include "libcutils.h"
+
+#ifdef HOSPITAL_NATIVE_STATS
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Written only by the owning thread; atomic so snapshots never read torn values */
+typedef struct {
+    _Atomic uint64_t calls;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t errors[CUTILS_STATS_ERROR_CODES];
+    _Atomic uint64_t latency[CUTILS_STATS_LATENCY_BUCKETS];
+} cutils_stats_counters_t;
+
+struct cutils_stats_block;
+
+typedef struct {
+    const char *const *names;
+    size_t count;
+    cutils_stats_counters_t *retired;    /* Exited threads, since the last reset */
+    struct cutils_stats_block *blocks;   /* Live threads */
+    pthread_key_t key;
+    _Atomic int ready;
+    _Atomic unsigned int epoch;          /* Bumped by reset; older blocks read as zero */
+} cutils_stats_domain_t;
+
+/* Define domain `name` (external, for libraries instrumenting several files) */
+#define CUTILS_STATS_DOMAIN(name, api_names, api_count) \
+    static cutils_stats_counters_t name##_retired[api_count]; \
+    cutils_stats_domain_t name = {.names = (api_names), .count = (api_count), .retired = name##_retired}
+
+/* Record one call of API `api` that took `ns` and returned `status` */
+void cutils_stats_record(cutils_stats_domain_t *domain, size_t api, uint64_t ns, uint64_t bytes, int status);
+
+/* Sum the domain's counters into out[0..capacity); returns the number of APIs */
+size_t cutils_stats_collect(cutils_stats_domain_t *domain, cutils_stats_t *out, size_t capacity);
+
+/* Zero the domain's counters */
+void cutils_stats_clear(cutils_stats_domain_t *domain);
+
+static inline uint64_t cutils_stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* `return call;`, timing it and recording the result against `api` */
+#define STATS_CALL(domain, api, bytes, call) \
+    do { \
+        uint64_t stats_start_ = cutils_stats_now(); \
+        int stats_ret_ = (call); \
+        cutils_stats_record((domain), (api), cutils_stats_now() - stats_start_, (bytes), stats_ret_); \
+        return stats_ret_; \
+    } while (0)
+
+#else
+
+#define STATS_CALL(domain, api, bytes, call) return (call)
+
+#endif /* HOSPITAL_NATIVE_STATS */
+
+#endif /* HOSPITAL_NATIVE_CUTILS_STATS_H */
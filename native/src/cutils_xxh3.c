@@ -0,0 +1,741 @@
+/*
+ * XXH3 64/128-bit hashing for libcutils.
+ *
+ * Bit-compatible with the reference xxHash 0.8 XXH3 implementation (default
+ * secret, optional 64-bit seed). Short inputs (<= 240 bytes) use the scalar
+ * mixers; long inputs run the stripe accumulator through a SIMD kernel
+ * chosen once at runtime (AVX2 / SSE2 on x86-64, NEON on AArch64, scalar
+ * otherwise).
+ */
+#include "libcutils.h"
+#include "cpu_features.h"
+#include <pthread.h>
+#include <string.h>
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define XXH_STRIPE_LEN            64
+#define XXH_SECRET_CONSUME_RATE   8
+#define XXH_ACC_NB                8
+#define XXH_SECRET_MERGEACCS_START 11
+#define XXH_SECRET_LASTACC_START  7
+#define XXH_SECRET_SIZE_MIN       136
+#define XXH_MIDSIZE_MAX           240
+#define XXH_STRIPES_PER_BLOCK     ((CUTILS_XXH3_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE)
+#define XXH_BUFFER_STRIPES        (CUTILS_XXH3_BUFFER_SIZE / XXH_STRIPE_LEN)
+
+static const uint8_t xxh3_default_secret[CUTILS_XXH3_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static const uint64_t xxh3_init_acc[XXH_ACC_NB] = {
+    XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+    XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1,
+};
+
+/* ---- Scalar primitives ---- */
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline void write64(uint8_t *p, uint64_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint32_t rotl32(uint32_t v, int r) {
+    return (v << r) | (v >> (32 - r));
+}
+
+static inline cutils_xxh128_t mult64to128(uint64_t lhs, uint64_t rhs) {
+    __uint128_t product = (__uint128_t)lhs * rhs;
+    cutils_xxh128_t r = {(uint64_t)product, (uint64_t)(product >> 64)};
+    return r;
+}
+
+static inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs) {
+    cutils_xxh128_t product = mult64to128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= (h >> 35) + len;
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= h >> 28;
+    return h;
+}
+
+static inline uint64_t mix16b(const uint8_t *input, const uint8_t *secret, uint64_t seed) {
+    uint64_t lo = read64(input);
+    uint64_t hi = read64(input + 8);
+    return mul128_fold64(lo ^ (read64(secret) + seed), hi ^ (read64(secret + 8) - seed));
+}
+
+static inline void mix32b(cutils_xxh128_t *acc, const uint8_t *input1, const uint8_t *input2,
+                          const uint8_t *secret, uint64_t seed) {
+    acc->low += mix16b(input1, secret, seed);
+    acc->low ^= read64(input2) + read64(input2 + 8);
+    acc->high += mix16b(input2, secret + 16, seed);
+    acc->high ^= read64(input1) + read64(input1 + 8);
+}
+
+/* ---- Stripe kernels ---- */
+
+typedef void (*xxh3_accumulate_fn)(uint64_t *acc, const uint8_t *input,
+                                   const uint8_t *secret, size_t nb_stripes);
+typedef void (*xxh3_scramble_fn)(uint64_t *acc, const uint8_t *secret);
+
+typedef struct {
+    const char *name;
+    unsigned int required;  /* CPU_FEATURE_* bits, 0 for scalar */
+    xxh3_accumulate_fn accumulate;
+    xxh3_scramble_fn scramble;
+} xxh3_kernel_t;
+
+static inline void accumulate_512_scalar(uint64_t *acc, const uint8_t *input, const uint8_t *secret) {
+    for (int i = 0; i < XXH_ACC_NB; i++) {
+        uint64_t data_val = read64(input + 8 * i);
+        uint64_t data_key = data_val ^ read64(secret + 8 * i);
+        acc[i ^ 1] += data_val;
+        acc[i] += (uint64_t)(uint32_t)data_key * (data_key >> 32);
+    }
+}
+
+static void xxh3_accumulate_scalar(uint64_t *acc, const uint8_t *input,
+                                   const uint8_t *secret, size_t nb_stripes) {
+    for (size_t n = 0; n < nb_stripes; n++) {
+        accumulate_512_scalar(acc, input + n * XXH_STRIPE_LEN, secret + n * XXH_SECRET_CONSUME_RATE);
+    }
+}
+
+static void xxh3_scramble_scalar(uint64_t *acc, const uint8_t *secret) {
+    for (int i = 0; i < XXH_ACC_NB; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        acc[i] = a * XXH_PRIME32_1;
+    }
+}
+
+#if defined(CPU_ARCH_X86) && defined(__SSE2__)
+static void xxh3_accumulate_sse2(uint64_t *acc, const uint8_t *input,
+                                 const uint8_t *secret, size_t nb_stripes) {
+    __m128i a[4];
+    for (int i = 0; i < 4; i++) {
+        a[i] = _mm_loadu_si128((const __m128i*)(acc + 2 * i));
+    }
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const uint8_t *in = input + n * XXH_STRIPE_LEN;
+        const uint8_t *sec = secret + n * XXH_SECRET_CONSUME_RATE;
+        for (int i = 0; i < 4; i++) {
+            __m128i data_vec = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+            __m128i key_vec = _mm_loadu_si128((const __m128i*)(sec + 16 * i));
+            __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+            __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+            __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+            __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, data_swap));
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i*)(acc + 2 * i), a[i]);
+    }
+}
+
+static void xxh3_scramble_sse2(uint64_t *acc, const uint8_t *secret) {
+    const __m128i prime32 = _mm_set1_epi32((int)XXH_PRIME32_1);
+    for (int i = 0; i < 4; i++) {
+        __m128i acc_vec = _mm_loadu_si128((const __m128i*)(acc + 2 * i));
+        __m128i data_vec = _mm_xor_si128(acc_vec, _mm_srli_epi64(acc_vec, 47));
+        __m128i key_vec = _mm_loadu_si128((const __m128i*)(secret + 16 * i));
+        __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+        __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+        __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+        _mm_storeu_si128((__m128i*)(acc + 2 * i), _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+    }
+}
+#endif
+
+#if defined(CPU_ARCH_X86)
+CPU_TARGET_AVX2
+static void xxh3_accumulate_avx2(uint64_t *acc, const uint8_t *input,
+                                 const uint8_t *secret, size_t nb_stripes) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const uint8_t *in = input + n * XXH_STRIPE_LEN;
+        const uint8_t *sec = secret + n * XXH_SECRET_CONSUME_RATE;
+
+        __m256i d0 = _mm256_loadu_si256((const __m256i*)in);
+        __m256i d1 = _mm256_loadu_si256((const __m256i*)(in + 32));
+        __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*)sec));
+        __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*)(sec + 32)));
+        __m256i p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+        __m256i p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+        __m256i s0 = _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2));
+        __m256i s1 = _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, s0));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, s1));
+    }
+    _mm256_storeu_si256((__m256i*)acc, a0);
+    _mm256_storeu_si256((__m256i*)(acc + 4), a1);
+}
+
+CPU_TARGET_AVX2
+static void xxh3_scramble_avx2(uint64_t *acc, const uint8_t *secret) {
+    const __m256i prime32 = _mm256_set1_epi32((int)XXH_PRIME32_1);
+    for (int i = 0; i < 2; i++) {
+        __m256i acc_vec = _mm256_loadu_si256((const __m256i*)(acc + 4 * i));
+        __m256i data_vec = _mm256_xor_si256(acc_vec, _mm256_srli_epi64(acc_vec, 47));
+        __m256i key_vec = _mm256_loadu_si256((const __m256i*)(secret + 32 * i));
+        __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+        __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+        __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+        __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+        _mm256_storeu_si256((__m256i*)(acc + 4 * i), _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+    }
+}
+#endif
+
+#if defined(CPU_ARCH_ARM64)
+static void xxh3_accumulate_neon(uint64_t *acc, const uint8_t *input,
+                                 const uint8_t *secret, size_t nb_stripes) {
+    uint64x2_t a[4];
+    for (int i = 0; i < 4; i++) {
+        a[i] = vld1q_u64(acc + 2 * i);
+    }
+    for (size_t n = 0; n < nb_stripes; n++) {
+        const uint8_t *in = input + n * XXH_STRIPE_LEN;
+        const uint8_t *sec = secret + n * XXH_SECRET_CONSUME_RATE;
+        for (int i = 0; i < 4; i += 2) {
+            uint64x2_t data_vec_1 = vreinterpretq_u64_u8(vld1q_u8(in + 16 * i));
+            uint64x2_t data_vec_2 = vreinterpretq_u64_u8(vld1q_u8(in + 16 * (i + 1)));
+            uint64x2_t key_vec_1 = vreinterpretq_u64_u8(vld1q_u8(sec + 16 * i));
+            uint64x2_t key_vec_2 = vreinterpretq_u64_u8(vld1q_u8(sec + 16 * (i + 1)));
+            uint64x2_t data_swap_1 = vextq_u64(data_vec_1, data_vec_1, 1);
+            uint64x2_t data_swap_2 = vextq_u64(data_vec_2, data_vec_2, 1);
+            uint64x2_t data_key_1 = veorq_u64(data_vec_1, key_vec_1);
+            uint64x2_t data_key_2 = veorq_u64(data_vec_2, key_vec_2);
+            /* De-interleave: lo = low 32 bits of each lane, hi = high 32 bits */
+            uint32x4x2_t unzipped = vuzpq_u32(vreinterpretq_u32_u64(data_key_1),
+                                              vreinterpretq_u32_u64(data_key_2));
+            uint64x2_t sum_1 = vmlal_u32(data_swap_1, vget_low_u32(unzipped.val[0]),
+                                         vget_low_u32(unzipped.val[1]));
+            uint64x2_t sum_2 = vmlal_high_u32(data_swap_2, unzipped.val[0], unzipped.val[1]);
+            a[i] = vaddq_u64(a[i], sum_1);
+            a[i + 1] = vaddq_u64(a[i + 1], sum_2);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        vst1q_u64(acc + 2 * i, a[i]);
+    }
+}
+
+static void xxh3_scramble_neon(uint64_t *acc, const uint8_t *secret) {
+    const uint32x2_t prime_lo = vdup_n_u32(XXH_PRIME32_1);
+    const uint32x4_t prime_hi = vreinterpretq_u32_u64(vdupq_n_u64((uint64_t)XXH_PRIME32_1 << 32));
+    for (int i = 0; i < 4; i++) {
+        uint64x2_t acc_vec = vld1q_u64(acc + 2 * i);
+        uint64x2_t data_vec = veorq_u64(acc_vec, vshrq_n_u64(acc_vec, 47));
+        uint64x2_t key_vec = vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i));
+        uint64x2_t data_key = veorq_u64(data_vec, key_vec);
+        uint32x4_t prod_hi = vmulq_u32(vreinterpretq_u32_u64(data_key), prime_hi);
+        uint32x2_t data_key_lo = vmovn_u64(data_key);
+        vst1q_u64(acc + 2 * i, vmlal_u32(vreinterpretq_u64_u32(prod_hi), data_key_lo, prime_lo));
+    }
+}
+#endif
+
+static const xxh3_kernel_t xxh3_kernels[] = {
+#if defined(CPU_ARCH_X86)
+    {"avx2", CPU_FEATURE_AVX2, xxh3_accumulate_avx2, xxh3_scramble_avx2},
+#endif
+#if defined(CPU_ARCH_X86) && defined(__SSE2__)
+    {"sse2", CPU_FEATURE_SSE2, xxh3_accumulate_sse2, xxh3_scramble_sse2},
+#endif
+#if defined(CPU_ARCH_ARM64)
+    {"neon", CPU_FEATURE_NEON, xxh3_accumulate_neon, xxh3_scramble_neon},
+#endif
+    {"scalar", 0, xxh3_accumulate_scalar, xxh3_scramble_scalar},
+};
+
+static const xxh3_kernel_t *xxh3_kernel = NULL;
+static pthread_once_t xxh3_once = PTHREAD_ONCE_INIT;
+
+static void xxh3_select_kernel(void) {
+    /* Kernels are listed fastest first; scalar is always supported */
+    CPU_KERNEL_PICK(xxh3_kernels, cpu_features_detect(), (const char *)NULL, xxh3_kernel);
+}
+
+static inline const xxh3_kernel_t* xxh3_get_kernel(void) {
+    pthread_once(&xxh3_once, xxh3_select_kernel);
+    return xxh3_kernel;
+}
+
+const char* cutils_xxh3_impl(void) {
+    return xxh3_get_kernel()->name;
+}
+
+int cutils_xxh3_force_impl(const char *name) {
+    xxh3_get_kernel();
+    if (!name) {
+        xxh3_select_kernel();
+        return CUTILS_SUCCESS;
+    }
+    const xxh3_kernel_t *kernel;
+    CPU_KERNEL_PICK(xxh3_kernels, cpu_features_detect(), name, kernel);
+    if (!kernel) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+    xxh3_kernel = kernel;
+    return CUTILS_SUCCESS;
+}
+
+/* ---- Long input (> 240 bytes) ---- */
+
+static void xxh3_hash_long_loop(const xxh3_kernel_t *k, uint64_t *acc, const uint8_t *input,
+                                size_t len, const uint8_t *secret, size_t secret_size) {
+    size_t nb_stripes_per_block = (secret_size - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE;
+    size_t block_len = XXH_STRIPE_LEN * nb_stripes_per_block;
+    size_t nb_blocks = (len - 1) / block_len;
+
+    for (size_t n = 0; n < nb_blocks; n++) {
+        k->accumulate(acc, input + n * block_len, secret, nb_stripes_per_block);
+        k->scramble(acc, secret + secret_size - XXH_STRIPE_LEN);
+    }
+
+    /* Last partial block */
+    size_t nb_stripes = ((len - 1) - block_len * nb_blocks) / XXH_STRIPE_LEN;
+    k->accumulate(acc, input + nb_blocks * block_len, secret, nb_stripes);
+
+    /* Last stripe */
+    k->accumulate(acc, input + len - XXH_STRIPE_LEN,
+                  secret + secret_size - XXH_STRIPE_LEN - XXH_SECRET_LASTACC_START, 1);
+}
+
+static uint64_t xxh3_merge_accs(const uint64_t *acc, const uint8_t *secret, uint64_t start) {
+    uint64_t result = start;
+    for (int i = 0; i < 4; i++) {
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i),
+                                acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+static void xxh3_init_custom_secret(uint8_t *custom, uint64_t seed) {
+    for (int i = 0; i < CUTILS_XXH3_SECRET_SIZE / 16; i++) {
+        write64(custom + 16 * i, read64(xxh3_default_secret + 16 * i) + seed);
+        write64(custom + 16 * i + 8, read64(xxh3_default_secret + 16 * i + 8) - seed);
+    }
+}
+
+static const uint8_t* xxh3_long_secret(uint64_t seed, uint8_t *custom) {
+    if (seed == 0) {
+        return xxh3_default_secret;
+    }
+    xxh3_init_custom_secret(custom, seed);
+    return custom;
+}
+
+static uint64_t xxh3_64_long(const uint8_t *input, size_t len, uint64_t seed) {
+    uint8_t custom[CUTILS_XXH3_SECRET_SIZE];
+    const uint8_t *secret = xxh3_long_secret(seed, custom);
+    uint64_t acc[XXH_ACC_NB];
+    memcpy(acc, xxh3_init_acc, sizeof(acc));
+    xxh3_hash_long_loop(xxh3_get_kernel(), acc, input, len, secret, CUTILS_XXH3_SECRET_SIZE);
+    return xxh3_merge_accs(acc, secret + XXH_SECRET_MERGEACCS_START, (uint64_t)len * XXH_PRIME64_1);
+}
+
+static cutils_xxh128_t xxh3_128_long(const uint8_t *input, size_t len, uint64_t seed) {
+    uint8_t custom[CUTILS_XXH3_SECRET_SIZE];
+    const uint8_t *secret = xxh3_long_secret(seed, custom);
+    uint64_t acc[XXH_ACC_NB];
+    memcpy(acc, xxh3_init_acc, sizeof(acc));
+    xxh3_hash_long_loop(xxh3_get_kernel(), acc, input, len, secret, CUTILS_XXH3_SECRET_SIZE);
+    cutils_xxh128_t h;
+    h.low = xxh3_merge_accs(acc, secret + XXH_SECRET_MERGEACCS_START, (uint64_t)len * XXH_PRIME64_1);
+    h.high = xxh3_merge_accs(acc, secret + CUTILS_XXH3_SECRET_SIZE - sizeof(acc) - XXH_SECRET_MERGEACCS_START,
+                             ~((uint64_t)len * XXH_PRIME64_2));
+    return h;
+}
+
+/* ---- 64-bit short inputs ---- */
+
+static uint64_t xxh3_64_0to16(const uint8_t *input, size_t len, const uint8_t *secret, uint64_t seed) {
+    if (len > 8) {
+        uint64_t flip1 = (read64(secret + 24) ^ read64(secret + 32)) + seed;
+        uint64_t flip2 = (read64(secret + 40) ^ read64(secret + 48)) - seed;
+        uint64_t lo = read64(input) ^ flip1;
+        uint64_t hi = read64(input + len - 8) ^ flip2;
+        uint64_t acc = len + __builtin_bswap64(lo) + hi + mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t)__builtin_bswap32((uint32_t)seed) << 32;
+        uint32_t in1 = read32(input);
+        uint32_t in2 = read32(input + len - 4);
+        uint64_t flip = (read64(secret + 8) ^ read64(secret + 16)) - seed;
+        uint64_t in64 = in2 + ((uint64_t)in1 << 32);
+        return xxh3_rrmxmx(in64 ^ flip, len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t)input[0] << 16) | ((uint32_t)input[len >> 1] << 24) |
+                            (uint32_t)input[len - 1] | ((uint32_t)len << 8);
+        uint64_t flip = (read32(secret) ^ read32(secret + 4)) + seed;
+        return xxh64_avalanche(combined ^ flip);
+    }
+    return xxh64_avalanche(seed ^ (read64(secret + 56) ^ read64(secret + 64)));
+}
+
+static uint64_t xxh3_64_17to128(const uint8_t *input, size_t len, const uint8_t *secret, uint64_t seed) {
+    uint64_t acc = len * XXH_PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16b(input + 48, secret + 96, seed);
+                acc += mix16b(input + len - 64, secret + 112, seed);
+            }
+            acc += mix16b(input + 32, secret + 64, seed);
+            acc += mix16b(input + len - 48, secret + 80, seed);
+        }
+        acc += mix16b(input + 16, secret + 32, seed);
+        acc += mix16b(input + len - 32, secret + 48, seed);
+    }
+    acc += mix16b(input, secret, seed);
+    acc += mix16b(input + len - 16, secret + 16, seed);
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_64_129to240(const uint8_t *input, size_t len, const uint8_t *secret, uint64_t seed) {
+    uint64_t acc = len * XXH_PRIME64_1;
+    size_t nb_rounds = len / 16;
+    size_t i;
+    for (i = 0; i < 8; i++) {
+        acc += mix16b(input + 16 * i, secret + 16 * i, seed);
+    }
+    acc = xxh3_avalanche(acc);
+    for (; i < nb_rounds; i++) {
+        acc += mix16b(input + 16 * i, secret + 16 * (i - 8) + 3, seed);
+    }
+    acc += mix16b(input + len - 16, secret + XXH_SECRET_SIZE_MIN - 17, seed);
+    return xxh3_avalanche(acc);
+}
+
+uint64_t cutils_xxh3_64(const uint8_t *data, size_t data_len, uint64_t seed) {
+    if (!data) {
+        data = (const uint8_t*)"";
+        data_len = 0;
+    }
+    if (data_len <= 16) {
+        return xxh3_64_0to16(data, data_len, xxh3_default_secret, seed);
+    }
+    if (data_len <= 128) {
+        return xxh3_64_17to128(data, data_len, xxh3_default_secret, seed);
+    }
+    if (data_len <= XXH_MIDSIZE_MAX) {
+        return xxh3_64_129to240(data, data_len, xxh3_default_secret, seed);
+    }
+    return xxh3_64_long(data, data_len, seed);
+}
+
+uint64_t cutils_xxh3(const uint8_t *data, size_t data_len) {
+    if (!data) {
+        return 0;
+    }
+    return cutils_xxh3_64(data, data_len, 0);
+}
+
+/* ---- 128-bit short inputs ---- */
+
+static cutils_xxh128_t xxh3_128_0to16(const uint8_t *input, size_t len, const uint8_t *secret, uint64_t seed) {
+    cutils_xxh128_t h;
+    if (len > 8) {
+        uint64_t flip_lo = (read64(secret + 32) ^ read64(secret + 40)) - seed;
+        uint64_t flip_hi = (read64(secret + 48) ^ read64(secret + 56)) + seed;
+        uint64_t in_lo = read64(input);
+        uint64_t in_hi = read64(input + len - 8);
+        cutils_xxh128_t m = mult64to128(in_lo ^ in_hi ^ flip_lo, XXH_PRIME64_1);
+        m.low += (uint64_t)(len - 1) << 54;
+        in_hi ^= flip_hi;
+        m.high += in_hi + (uint64_t)(uint32_t)in_hi * (XXH_PRIME32_2 - 1);
+        m.low ^= __builtin_bswap64(m.high);
+        h = mult64to128(m.low, XXH_PRIME64_2);
+        h.high += m.high * XXH_PRIME64_2;
+        h.low = xxh3_avalanche(h.low);
+        h.high = xxh3_avalanche(h.high);
+        return h;
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t)__builtin_bswap32((uint32_t)seed) << 32;
+        uint32_t in_lo = read32(input);
+        uint32_t in_hi = read32(input + len - 4);
+        uint64_t in64 = in_lo + ((uint64_t)in_hi << 32);
+        uint64_t flip = (read64(secret + 16) ^ read64(secret + 24)) + seed;
+        h = mult64to128(in64 ^ flip, XXH_PRIME64_1 + (len << 2));
+        h.high += h.low << 1;
+        h.low ^= h.high >> 3;
+        h.low ^= h.low >> 35;
+        h.low *= 0x9FB21C651E98DF25ULL;
+        h.low ^= h.low >> 28;
+        h.high = xxh3_avalanche(h.high);
+        return h;
+    }
+    if (len > 0) {
+        uint32_t combined_lo = ((uint32_t)input[0] << 16) | ((uint32_t)input[len >> 1] << 24) |
+                               (uint32_t)input[len - 1] | ((uint32_t)len << 8);
+        uint32_t combined_hi = rotl32(__builtin_bswap32(combined_lo), 13);
+        uint64_t flip_lo = (read32(secret) ^ read32(secret + 4)) + seed;
+        uint64_t flip_hi = (read32(secret + 8) ^ read32(secret + 12)) - seed;
+        h.low = xxh64_avalanche(combined_lo ^ flip_lo);
+        h.high = xxh64_avalanche(combined_hi ^ flip_hi);
+        return h;
+    }
+    h.low = xxh64_avalanche(seed ^ (read64(secret + 64) ^ read64(secret + 72)));
+    h.high = xxh64_avalanche(seed ^ (read64(secret + 80) ^ read64(secret + 88)));
+    return h;
+}
+
+static cutils_xxh128_t xxh3_128_finalize(cutils_xxh128_t acc, size_t len, uint64_t seed) {
+    cutils_xxh128_t h;
+    h.low = xxh3_avalanche(acc.low + acc.high);
+    h.high = 0 - xxh3_avalanche(acc.low * XXH_PRIME64_1 + acc.high * XXH_PRIME64_4 +
+                                ((uint64_t)len - seed) * XXH_PRIME64_2);
+    return h;
+}
+
+static cutils_xxh128_t xxh3_128_17to128(const uint8_t *input, size_t len, const uint8_t *secret, uint64_t seed) {
+    cutils_xxh128_t acc = {len * XXH_PRIME64_1, 0};
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                mix32b(&acc, input + 48, input + len - 64, secret + 96, seed);
+            }
+            mix32b(&acc, input + 32, input + len - 48, secret + 64, seed);
+        }
+        mix32b(&acc, input + 16, input + len - 32, secret + 32, seed);
+    }
+    mix32b(&acc, input, input + len - 16, secret, seed);
+    return xxh3_128_finalize(acc, len, seed);
+}
+
+static cutils_xxh128_t xxh3_128_129to240(const uint8_t *input, size_t len, const uint8_t *secret, uint64_t seed) {
+    cutils_xxh128_t acc = {len * XXH_PRIME64_1, 0};
+    size_t nb_rounds = len / 32;
+    size_t i;
+    for (i = 0; i < 4; i++) {
+        mix32b(&acc, input + 32 * i, input + 32 * i + 16, secret + 32 * i, seed);
+    }
+    acc.low = xxh3_avalanche(acc.low);
+    acc.high = xxh3_avalanche(acc.high);
+    for (; i < nb_rounds; i++) {
+        mix32b(&acc, input + 32 * i, input + 32 * i + 16, secret + 3 + 32 * (i - 4), seed);
+    }
+    mix32b(&acc, input + len - 16, input + len - 32, secret + XXH_SECRET_SIZE_MIN - 17 - 16, 0 - seed);
+    return xxh3_128_finalize(acc, len, seed);
+}
+
+cutils_xxh128_t cutils_xxh3_128(const uint8_t *data, size_t data_len, uint64_t seed) {
+    if (!data) {
+        data = (const uint8_t*)"";
+        data_len = 0;
+    }
+    if (data_len <= 16) {
+        return xxh3_128_0to16(data, data_len, xxh3_default_secret, seed);
+    }
+    if (data_len <= 128) {
+        return xxh3_128_17to128(data, data_len, xxh3_default_secret, seed);
+    }
+    if (data_len <= XXH_MIDSIZE_MAX) {
+        return xxh3_128_129to240(data, data_len, xxh3_default_secret, seed);
+    }
+    return xxh3_128_long(data, data_len, seed);
+}
+
+/* ---- Streaming ---- */
+
+static size_t xxh3_consume_stripes(const xxh3_kernel_t *k, uint64_t *acc, size_t nb_stripes_acc,
+                                   const uint8_t *input, size_t nb_stripes, const uint8_t *secret) {
+    if (XXH_STRIPES_PER_BLOCK - nb_stripes_acc <= nb_stripes) {
+        size_t to_end = XXH_STRIPES_PER_BLOCK - nb_stripes_acc;
+        size_t after_end = nb_stripes - to_end;
+        k->accumulate(acc, input, secret + nb_stripes_acc * XXH_SECRET_CONSUME_RATE, to_end);
+        k->scramble(acc, secret + CUTILS_XXH3_SECRET_SIZE - XXH_STRIPE_LEN);
+        k->accumulate(acc, input + to_end * XXH_STRIPE_LEN, secret, after_end);
+        return after_end;
+    }
+    k->accumulate(acc, input, secret + nb_stripes_acc * XXH_SECRET_CONSUME_RATE, nb_stripes);
+    return nb_stripes_acc + nb_stripes;
+}
+
+int cutils_xxh3_init(cutils_xxh3_state_t *state, uint64_t seed) {
+    if (!state) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    memcpy(state->acc, xxh3_init_acc, sizeof(state->acc));
+    if (seed == 0) {
+        memcpy(state->secret, xxh3_default_secret, sizeof(state->secret));
+    } else {
+        xxh3_init_custom_secret(state->secret, seed);
+    }
+    state->buffered_size = 0;
+    state->nb_stripes_acc = 0;
+    state->total_len = 0;
+    state->seed = seed;
+    return CUTILS_SUCCESS;
+}
+
+int cutils_xxh3_update(cutils_xxh3_state_t *state, const uint8_t *data, size_t data_len) {
+    if (!state || (!data && data_len)) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    state->total_len += data_len;
+
+    /* Small input: just buffer it */
+    if (state->buffered_size + data_len <= CUTILS_XXH3_BUFFER_SIZE) {
+        if (data_len) {
+            memcpy(state->buffer + state->buffered_size, data, data_len);
+        }
+        state->buffered_size += data_len;
+        return CUTILS_SUCCESS;
+    }
+
+    const xxh3_kernel_t *k = xxh3_get_kernel();
+
+    /* Complete and consume the partially filled buffer */
+    if (state->buffered_size) {
+        size_t fill = CUTILS_XXH3_BUFFER_SIZE - state->buffered_size;
+        memcpy(state->buffer + state->buffered_size, data, fill);
+        data += fill;
+        data_len -= fill;
+        state->nb_stripes_acc = xxh3_consume_stripes(k, state->acc, state->nb_stripes_acc,
+                                                     state->buffer, XXH_BUFFER_STRIPES, state->secret);
+        state->buffered_size = 0;
+    }
+
+    /* Consume full buffers directly from the input, keeping at least one byte */
+    if (data_len > CUTILS_XXH3_BUFFER_SIZE) {
+        do {
+            state->nb_stripes_acc = xxh3_consume_stripes(k, state->acc, state->nb_stripes_acc,
+                                                         data, XXH_BUFFER_STRIPES, state->secret);
+            data += CUTILS_XXH3_BUFFER_SIZE;
+            data_len -= CUTILS_XXH3_BUFFER_SIZE;
+        } while (data_len > CUTILS_XXH3_BUFFER_SIZE);
+        /* Keep the last consumed stripe for the final catch-up */
+        memcpy(state->buffer + CUTILS_XXH3_BUFFER_SIZE - XXH_STRIPE_LEN, data - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+    }
+
+    memcpy(state->buffer, data, data_len);
+    state->buffered_size = data_len;
+    return CUTILS_SUCCESS;
+}
+
+static void xxh3_digest_long(const cutils_xxh3_state_t *state, uint64_t *acc) {
+    const xxh3_kernel_t *k = xxh3_get_kernel();
+    memcpy(acc, state->acc, sizeof(state->acc));
+
+    if (state->buffered_size >= XXH_STRIPE_LEN) {
+        size_t nb_stripes = (state->buffered_size - 1) / XXH_STRIPE_LEN;
+        xxh3_consume_stripes(k, acc, state->nb_stripes_acc, state->buffer, nb_stripes, state->secret);
+        k->accumulate(acc, state->buffer + state->buffered_size - XXH_STRIPE_LEN,
+                      state->secret + CUTILS_XXH3_SECRET_SIZE - XXH_STRIPE_LEN - XXH_SECRET_LASTACC_START, 1);
+    } else {
+        /* Last stripe straddles the previous buffer contents */
+        uint8_t last_stripe[XXH_STRIPE_LEN];
+        size_t catchup = XXH_STRIPE_LEN - state->buffered_size;
+        memcpy(last_stripe, state->buffer + CUTILS_XXH3_BUFFER_SIZE - catchup, catchup);
+        memcpy(last_stripe + catchup, state->buffer, state->buffered_size);
+        k->accumulate(acc, last_stripe,
+                      state->secret + CUTILS_XXH3_SECRET_SIZE - XXH_STRIPE_LEN - XXH_SECRET_LASTACC_START, 1);
+    }
+}
+
+uint64_t cutils_xxh3_digest(const cutils_xxh3_state_t *state) {
+    if (!state) {
+        return 0;
+    }
+    if (state->total_len > XXH_MIDSIZE_MAX) {
+        uint64_t acc[XXH_ACC_NB];
+        xxh3_digest_long(state, acc);
+        return xxh3_merge_accs(acc, state->secret + XXH_SECRET_MERGEACCS_START,
+                               state->total_len * XXH_PRIME64_1);
+    }
+    return cutils_xxh3_64(state->buffer, state->buffered_size, state->seed);
+}
+
+cutils_xxh128_t cutils_xxh3_128_digest(const cutils_xxh3_state_t *state) {
+    if (!state) {
+        cutils_xxh128_t zero = {0, 0};
+        return zero;
+    }
+    if (state->total_len > XXH_MIDSIZE_MAX) {
+        uint64_t acc[XXH_ACC_NB];
+        xxh3_digest_long(state, acc);
+        cutils_xxh128_t h;
+        h.low = xxh3_merge_accs(acc, state->secret + XXH_SECRET_MERGEACCS_START,
+                                state->total_len * XXH_PRIME64_1);
+        h.high = xxh3_merge_accs(acc, state->secret + CUTILS_XXH3_SECRET_SIZE - sizeof(acc) - XXH_SECRET_MERGEACCS_START,
+                                 ~(state->total_len * XXH_PRIME64_2));
+        return h;
+    }
+    return cutils_xxh3_128(state->buffer, state->buffered_size, state->seed);
+}
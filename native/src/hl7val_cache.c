@@ -0,0 +1,366 @@
+/*
+ * Parsed-message cache for libhl7val.
+ *
+ * Entries are keyed by the XXH3 hash of the message bytes, seeded with the
+ * delimiters it was parsed under, and hold the message's segment and field
+ * index in one allocation together with a copy of the bytes, so a hash
+ * collision can never return another message's index. Entries sit on a
+ * chained hash table and a doubly linked LRU list. Least recently used
+ * entries are evicted to keep the total, hash table included, within the
+ * memory budget given at creation.
+ */
+#include "libhl7val.h"
+#include "libcutils.h"
+#include "hl7val_split.h"
+#include "hl7val_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_INITIAL_BUCKETS 64
+
+typedef struct cache_entry cache_entry_t;
+
+struct cache_entry {
+    cache_entry_t *hash_next;
+    cache_entry_t *prev;  /* towards the most recently used */
+    cache_entry_t *next;
+    uint64_t hash;
+    size_t bytes;
+    hl7val_delims_t delims;
+    const char *message;  /* copy of the indexed bytes */
+    hl7val_message_index_t index;
+    /* Followed by the segments, the field spans and the message */
+};
+
+struct hl7val_cache {
+    size_t max_bytes;
+    size_t bytes;
+    size_t entries;
+    cache_entry_t **buckets;
+    size_t bucket_count;  /* power of two */
+    cache_entry_t *head;  /* most recently used */
+    cache_entry_t *tail;
+    cache_entry_t *uncached;  /* last index too large to keep */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    /* Scratch for indexing a message, reused across misses */
+    hl7val_segment_t *parsed;
+    hl7val_index_segment_t *segments;
+    size_t segment_capacity;
+    hl7val_span_t *fields;
+    size_t field_capacity;
+};
+
+typedef struct {
+    hl7val_cache_t *cache;
+    const char *message;
+    hl7val_delims_t delims;  /* in effect for the next segment */
+    size_t segment_count;
+    size_t field_count;
+} index_build_t;
+
+static uint64_t delims_seed(const hl7val_delims_t *d) {
+    return (uint64_t)(unsigned char)d->field | (uint64_t)(unsigned char)d->component << 8 |
+           (uint64_t)(unsigned char)d->repetition << 16 | (uint64_t)(unsigned char)d->escape << 24 |
+           (uint64_t)(unsigned char)d->subcomponent << 32;
+}
+
+/* Make room for `needed` items; returns the (possibly moved) buffer, or NULL leaving it intact */
+static void *grow(void *buf, size_t *capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) {
+        return buf;
+    }
+    size_t capacity_new = *capacity ? *capacity : 16;
+    while (capacity_new < needed) {
+        capacity_new *= 2;
+    }
+    void *p = realloc(buf, capacity_new * item_size);
+    if (p) {
+        *capacity = capacity_new;
+    }
+    return p;
+}
+
+static int index_segment(void *arg, const hl7val_segment_result_t *r, const char *error_msg) {
+    (void)error_msg;
+    index_build_t *b = arg;
+    hl7val_cache_t *c = b->cache;
+
+    hl7val_index_segment_t *segments = grow(c->segments, &c->segment_capacity, b->segment_count + 1,
+                                            sizeof(*segments));
+    if (!segments) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    c->segments = segments;
+    hl7val_index_segment_t *s = &c->segments[b->segment_count++];
+    s->offset = (uint32_t)r->offset;
+    s->len = r->len;
+    memcpy(s->id, r->id, sizeof(s->id));
+    s->status = r->status;
+    s->field_count = 0;
+    s->first_field = (uint32_t)b->field_count;
+
+    /* Index any segment that tokenizes: a value the schema rejects can still be read */
+    hl7val_segment_t *parsed = c->parsed;
+    int ret = hl7_parse_segment(b->message + r->offset, r->len, &b->delims, parsed);
+    if (ret != HL7VAL_SUCCESS) {
+        if (s->status == HL7VAL_SUCCESS) {
+            s->status = ret;
+        }
+        return HL7VAL_SUCCESS;
+    }
+    if (r->status == HL7VAL_SUCCESS && memcmp(r->id, "MSH", 3) == 0) {
+        b->delims = parsed->delims;  /* as in hl7_split_message, only a valid MSH switches */
+    }
+
+    size_t n = (size_t)parsed->field_count + 1;
+    hl7val_span_t *fields = grow(c->fields, &c->field_capacity, b->field_count + n, sizeof(*fields));
+    if (!fields) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    c->fields = fields;
+    hl7val_span_t *out = &c->fields[b->field_count];
+    for (size_t i = 0; i < n; i++) {
+        out[i].start = (uint32_t)r->offset + parsed->fields[i].start;
+        out[i].len = parsed->fields[i].len;
+    }
+    s->field_count = (uint32_t)parsed->field_count;
+    b->field_count += n;
+    return HL7VAL_SUCCESS;
+}
+
+static void lru_unlink(hl7val_cache_t *c, cache_entry_t *e) {
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        c->head = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        c->tail = e->prev;
+    }
+}
+
+static void lru_push_front(hl7val_cache_t *c, cache_entry_t *e) {
+    e->prev = NULL;
+    e->next = c->head;
+    if (c->head) {
+        c->head->prev = e;
+    } else {
+        c->tail = e;
+    }
+    c->head = e;
+}
+
+static void evict(hl7val_cache_t *c, cache_entry_t *e) {
+    cache_entry_t **link = &c->buckets[e->hash & (c->bucket_count - 1)];
+    while (*link != e) {
+        link = &(*link)->hash_next;
+    }
+    *link = e->hash_next;
+    lru_unlink(c, e);
+    c->bytes -= e->bytes;
+    c->entries--;
+    free(e);
+}
+
+/*
+ * Double the table before it would hold more entries than buckets, as long
+ * as the table stays within a quarter of the budget. Keeps the old table if
+ * allocation fails.
+ */
+static void maybe_grow_table(hl7val_cache_t *c) {
+    size_t count = c->bucket_count * 2;
+    if (c->entries < c->bucket_count || count * sizeof(*c->buckets) > c->max_bytes / 4) {
+        return;
+    }
+    cache_entry_t **buckets = calloc(count, sizeof(*buckets));
+    if (!buckets) {
+        return;
+    }
+    for (size_t i = 0; i < c->bucket_count; i++) {
+        for (cache_entry_t *e = c->buckets[i], *next; e; e = next) {
+            next = e->hash_next;
+            cache_entry_t **slot = &buckets[e->hash & (count - 1)];
+            e->hash_next = *slot;
+            *slot = e;
+        }
+    }
+    free(c->buckets);
+    c->bytes += (count - c->bucket_count) * sizeof(*buckets);
+    c->buckets = buckets;
+    c->bucket_count = count;
+}
+
+int hl7val_cache_new(size_t max_bytes, hl7val_cache_t **out) {
+    if (!out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+
+    hl7val_cache_t *c = calloc(1, sizeof(*c));
+    if (!c) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    c->buckets = calloc(CACHE_INITIAL_BUCKETS, sizeof(*c->buckets));
+    c->parsed = malloc(sizeof(*c->parsed));
+    if (!c->buckets || !c->parsed) {
+        hl7val_cache_free(c);
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    c->bucket_count = CACHE_INITIAL_BUCKETS;
+    c->bytes = CACHE_INITIAL_BUCKETS * sizeof(*c->buckets);
+    c->max_bytes = max_bytes ? max_bytes : HL7VAL_CACHE_DEFAULT_BYTES;
+    *out = c;
+    return HL7VAL_SUCCESS;
+}
+
+void hl7val_cache_clear(hl7val_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    for (cache_entry_t *e = cache->head, *next; e; e = next) {
+        next = e->next;
+        free(e);
+    }
+    free(cache->uncached);
+    cache->uncached = NULL;
+    cache->head = cache->tail = NULL;
+    memset(cache->buckets, 0, cache->bucket_count * sizeof(*cache->buckets));
+    cache->bytes = cache->bucket_count * sizeof(*cache->buckets);
+    cache->entries = 0;
+}
+
+void hl7val_cache_free(hl7val_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    if (cache->buckets) {
+        hl7val_cache_clear(cache);
+    }
+    free(cache->buckets);
+    free(cache->parsed);
+    free(cache->segments);
+    free(cache->fields);
+    free(cache);
+}
+
+static int cache_get_impl(hl7val_cache_t *cache, const char *message, size_t message_len, const hl7val_delims_t *delims,
+                          const hl7val_message_index_t **out) {
+    if (!cache || !message || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    if (message_len > UINT32_MAX) {
+        return HL7VAL_ERR_TOO_LARGE;
+    }
+    const hl7val_delims_t *d = delims ? delims : hl7val_default_delims();
+    uint64_t hash = cutils_xxh3_64((const uint8_t *)message, message_len, delims_seed(d));
+
+    cache_entry_t *e = cache->buckets[hash & (cache->bucket_count - 1)];
+    for (; e; e = e->hash_next) {
+        if (e->hash == hash && e->index.message_len == message_len && memcmp(&e->delims, d, sizeof(*d)) == 0 &&
+            memcmp(e->message, message, message_len) == 0) {
+            break;
+        }
+    }
+    if (e) {
+        cache->hits++;
+        if (e != cache->head) {
+            lru_unlink(cache, e);
+            lru_push_front(cache, e);
+        }
+        *out = &e->index;
+        return HL7VAL_SUCCESS;
+    }
+    cache->misses++;
+
+    index_build_t b = {cache, message, *d, 0, 0};
+    int ret = hl7_split_message(message, message_len, d, index_segment, &b, 0, NULL);
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+
+    size_t segments_bytes = b.segment_count * sizeof(hl7val_index_segment_t);
+    size_t fields_bytes = b.field_count * sizeof(hl7val_span_t);
+    size_t bytes = sizeof(cache_entry_t) + segments_bytes + fields_bytes + message_len;
+    e = malloc(bytes);
+    if (!e) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    char *p = (char *)(e + 1);
+    hl7val_index_segment_t *segments = (hl7val_index_segment_t *)p;
+    hl7val_span_t *fields = (hl7val_span_t *)(p + segments_bytes);
+    char *copy = p + segments_bytes + fields_bytes;
+    memcpy(segments, cache->segments, segments_bytes);
+    memcpy(fields, cache->fields, fields_bytes);
+    memcpy(copy, message, message_len);
+
+    e->hash = hash;
+    e->bytes = bytes;
+    e->delims = *d;
+    e->message = copy;
+    e->index.message_len = message_len;
+    e->index.segment_count = b.segment_count;
+    e->index.segments = segments;
+    e->index.fields = fields;
+    *out = &e->index;
+
+    free(cache->uncached);
+    cache->uncached = NULL;
+    maybe_grow_table(cache);
+
+    /* An index that could never fit is handed out but not kept */
+    size_t table_bytes = cache->bucket_count * sizeof(*cache->buckets);
+    if (table_bytes >= cache->max_bytes || bytes > cache->max_bytes - table_bytes) {
+        cache->uncached = e;
+        return HL7VAL_SUCCESS;
+    }
+
+    while (cache->tail && cache->bytes + bytes > cache->max_bytes) {
+        evict(cache, cache->tail);
+        cache->evictions++;
+    }
+    cache_entry_t **slot = &cache->buckets[hash & (cache->bucket_count - 1)];
+    e->hash_next = *slot;
+    *slot = e;
+    lru_push_front(cache, e);
+    cache->bytes += bytes;
+    cache->entries++;
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_cache_get(hl7val_cache_t *cache, const char *message, size_t message_len, const hl7val_delims_t *delims,
+                     const hl7val_message_index_t **out) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_CACHE_GET, message_len,
+               cache_get_impl(cache, message, message_len, delims, out));
+}
+
+int hl7val_index_field(const hl7val_message_index_t *index, size_t segment, int field_num, hl7val_span_t *out) {
+    if (!index || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    if (segment >= index->segment_count) {
+        return HL7VAL_ERR_FIELD_COUNT;
+    }
+    const hl7val_index_segment_t *s = &index->segments[segment];
+    if (s->field_count == 0 || field_num < 0 || (uint32_t)field_num > s->field_count) {
+        return HL7VAL_ERR_FIELD_COUNT;
+    }
+    *out = index->fields[s->first_field + (uint32_t)field_num];
+    return HL7VAL_SUCCESS;
+}
+
+void hl7val_cache_get_stats(const hl7val_cache_t *cache, hl7val_cache_stats_t *out) {
+    if (!cache || !out) {
+        return;
+    }
+    out->hits = cache->hits;
+    out->misses = cache->misses;
+    out->evictions = cache->evictions;
+    out->entries = cache->entries;
+    out->bytes = cache->bytes;
+    out->max_bytes = cache->max_bytes;
+}
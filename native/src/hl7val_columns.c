@@ -0,0 +1,375 @@
+/*
+ * Columnar OBX extraction for libhl7val.
+ *
+ * Texts are cut into contiguous ranges; workers pull ranges off a shared
+ * counter and append each OBX row to the range's own growable columns.
+ * Once every range is done the columns are concatenated, in input order,
+ * into 64-byte aligned arrays in the Arrow layout: a double array with a
+ * validity bitmap for OBX-5 and offset/data pairs for the string fields.
+ */
+#include "libhl7val.h"
+#include "hl7val_workers.h"
+#include "hl7val_stats.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COLUMNS_MIN_RANGE 256
+#define COLUMNS_ALIGN     64
+
+/* Growable array of fixed-size items */
+typedef struct {
+    void *items;
+    size_t len;
+    size_t capacity;
+} vec_t;
+
+/* A string column while it is being built: end offset per row, relative to the range */
+typedef struct {
+    vec_t ends;  /* int64_t */
+    vec_t data;  /* char */
+} str_builder_t;
+
+typedef struct {
+    size_t begin;
+    size_t end;
+    size_t rows;
+    vec_t record;  /* uint32_t */
+    vec_t value;   /* double */
+    vec_t valid;   /* uint8_t, one per row */
+    str_builder_t code;
+    str_builder_t units;
+    str_builder_t flags;
+    int status;
+} columns_range_t;
+
+typedef struct {
+    const hl7val_view_t *texts;
+    columns_range_t *ranges;
+    size_t range_count;
+    _Atomic size_t next;
+} columns_job_t;
+
+static int vec_push(vec_t *v, const void *item, size_t item_size, size_t n) {
+    if (v->len + n > v->capacity) {
+        size_t capacity = v->capacity ? v->capacity * 2 : 64;
+        while (capacity < v->len + n) {
+            capacity *= 2;
+        }
+        void *items = realloc(v->items, capacity * item_size);
+        if (!items) {
+            return HL7VAL_ERR_NO_MEMORY;
+        }
+        v->items = items;
+        v->capacity = capacity;
+    }
+    memcpy((char *)v->items + v->len * item_size, item, n * item_size);
+    v->len += n;
+    return HL7VAL_SUCCESS;
+}
+
+static int str_push(str_builder_t *b, const char *p, size_t len) {
+    if (len && vec_push(&b->data, p, 1, len) != HL7VAL_SUCCESS) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    int64_t end = (int64_t)b->data.len;
+    return vec_push(&b->ends, &end, sizeof(end), 1);
+}
+
+static void range_free(columns_range_t *r) {
+    free(r->record.items);
+    free(r->value.items);
+    free(r->valid.items);
+    free(r->code.ends.items);
+    free(r->code.data.items);
+    free(r->units.ends.items);
+    free(r->units.data.items);
+    free(r->flags.ends.items);
+    free(r->flags.data.items);
+}
+
+/* Length of the first component of a field ('^', or the first '~' repetition) */
+static size_t first_component(const hl7val_view_t *v) {
+    for (size_t i = 0; i < v->len; i++) {
+        if (v->data[i] == '^' || v->data[i] == '~') {
+            return i;
+        }
+    }
+    return v->len;
+}
+
+/*
+ * Parse an NM value ([+-]digits[.digits]). Values whose digits fit in 53
+ * bits with at most 22 decimals are converted exactly (one correctly
+ * rounded division); longer ones go through strtod.
+ */
+static int parse_number(const char *p, size_t len, double *out) {
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    size_t i = 0;
+    int negative = 0;
+    if (i < len && (p[i] == '+' || p[i] == '-')) {
+        negative = p[i] == '-';
+        i++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int decimals = 0;
+    int dot = 0;
+    int exact = 1;
+    for (; i < len; i++) {
+        char c = p[i];
+        if (c >= '0' && c <= '9') {
+            if (mantissa > ((UINT64_C(1) << 53) - 10) / 10) {
+                exact = 0;
+            } else {
+                mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            }
+            digits++;
+            decimals += dot;
+        } else if (c == '.' && !dot) {
+            dot = 1;
+        } else {
+            return 0;
+        }
+    }
+    if (digits == 0) {
+        return 0;
+    }
+
+    if (exact && decimals <= 22) {
+        double v = (double)mantissa / pow10[decimals];
+        *out = negative ? -v : v;
+        return 1;
+    }
+    char buf[64];
+    if (len >= sizeof(buf)) {
+        return 0;
+    }
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    *out = strtod(buf, NULL);
+    return 1;
+}
+
+static int append_obx(columns_range_t *r, uint32_t record, const char *seg, size_t len) {
+    static const int fields[] = {3, 5, 6, 8};
+    hl7val_view_t views[4];
+    if (hl7_extract_fields(seg, len, fields, 4, NULL, views) != HL7VAL_SUCCESS) {
+        return HL7VAL_SUCCESS;  /* not a well-formed segment; skipped */
+    }
+
+    double value = 0.0;
+    uint8_t valid = (uint8_t)parse_number(views[1].data, views[1].len, &value);
+    if (!valid) {
+        value = 0.0;
+    }
+    if (vec_push(&r->record, &record, sizeof(record), 1) != HL7VAL_SUCCESS ||
+        vec_push(&r->value, &value, sizeof(value), 1) != HL7VAL_SUCCESS ||
+        vec_push(&r->valid, &valid, 1, 1) != HL7VAL_SUCCESS ||
+        str_push(&r->code, views[0].data, first_component(&views[0])) != HL7VAL_SUCCESS ||
+        str_push(&r->units, views[2].data, first_component(&views[2])) != HL7VAL_SUCCESS ||
+        str_push(&r->flags, views[3].data, views[3].len) != HL7VAL_SUCCESS) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    r->rows++;
+    return HL7VAL_SUCCESS;
+}
+
+static int extract_text(columns_range_t *r, uint32_t record, const hl7val_view_t *text) {
+    const char *p = text->data;
+    size_t len = p ? text->len : 0;
+    size_t start = 0;
+    while (start < len) {
+        size_t end = start;
+        while (end < len && p[end] != '\r' && p[end] != '\n') {
+            end++;
+        }
+        /* Blanks around a segment are not part of it, as in hl7val_parse_message */
+        size_t s = start;
+        size_t e = end;
+        while (s < e && (p[s] == ' ' || p[s] == '\t')) {
+            s++;
+        }
+        while (e > s && (p[e - 1] == ' ' || p[e - 1] == '\t')) {
+            e--;
+        }
+        if (e - s >= 4 && memcmp(p + s, "OBX|", 4) == 0) {
+            int ret = append_obx(r, record, p + s, e - s);
+            if (ret != HL7VAL_SUCCESS) {
+                return ret;
+            }
+        }
+        start = end + 1;
+    }
+    return HL7VAL_SUCCESS;
+}
+
+static void *columns_worker(void *arg) {
+    columns_job_t *job = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->range_count) {
+            return NULL;
+        }
+        columns_range_t *r = &job->ranges[i];
+        for (size_t t = r->begin; t < r->end && r->status == HL7VAL_SUCCESS; t++) {
+            r->status = extract_text(r, (uint32_t)t, &job->texts[t]);
+        }
+    }
+}
+
+static void *aligned_array(size_t n, size_t item_size) {
+    void *p = NULL;
+    size_t bytes = n * item_size;
+    bytes = (bytes + COLUMNS_ALIGN - 1) / COLUMNS_ALIGN * COLUMNS_ALIGN;
+    if (posix_memalign(&p, COLUMNS_ALIGN, bytes ? bytes : COLUMNS_ALIGN) != 0) {
+        return NULL;
+    }
+    return p;
+}
+
+static int str_column_alloc(hl7val_str_column_t *col, size_t rows, size_t data_len) {
+    col->offsets = aligned_array(rows + 1, sizeof(int64_t));
+    col->data = aligned_array(data_len, 1);
+    col->data_len = data_len;
+    if (!col->offsets || !col->data) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    col->offsets[0] = 0;
+    return HL7VAL_SUCCESS;
+}
+
+static void str_column_append(hl7val_str_column_t *col, const str_builder_t *b, size_t row, size_t rows,
+                              int64_t *base) {
+    const int64_t *ends = b->ends.items;
+    for (size_t i = 0; i < rows; i++) {
+        col->offsets[row + i + 1] = *base + ends[i];
+    }
+    if (b->data.len) {
+        memcpy(col->data + *base, b->data.items, b->data.len);
+    }
+    *base += (int64_t)b->data.len;
+}
+
+/* Input bytes of a request, for the counters */
+static inline uint64_t stats_view_bytes(const hl7val_view_t *texts, size_t count) {
+    uint64_t total = 0;
+    for (size_t i = 0; texts && i < count; i++) {
+        total += texts[i].len;
+    }
+    return total;
+}
+
+static int obx_columns_impl(const hl7val_view_t *texts, size_t count, unsigned int num_threads,
+                            hl7val_obx_columns_t *out) {
+    if (!out || (!texts && count > 0)) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    memset(out, 0, sizeof(*out));
+    if (count > UINT32_MAX) {
+        return HL7VAL_ERR_TOO_LARGE;
+    }
+
+    /* About eight ranges per thread, so one slow range does not hold up the rest */
+    num_threads = hl7_resolve_threads(num_threads);
+    size_t range_size = count / ((size_t)num_threads * 8);
+    if (range_size < COLUMNS_MIN_RANGE) {
+        range_size = COLUMNS_MIN_RANGE;
+    }
+    size_t range_count = (count + range_size - 1) / range_size;
+    columns_range_t *ranges = calloc(range_count ? range_count : 1, sizeof(*ranges));
+    if (!ranges) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    for (size_t i = 0; i < range_count; i++) {
+        ranges[i].begin = i * range_size;
+        ranges[i].end = i + 1 < range_count ? (i + 1) * range_size : count;
+    }
+
+    columns_job_t job = {texts, ranges, range_count, 0};
+    hl7_run_workers(columns_worker, &job, num_threads, range_count);
+
+    int ret = HL7VAL_SUCCESS;
+    size_t rows = 0;
+    size_t code_len = 0;
+    size_t units_len = 0;
+    size_t flags_len = 0;
+    for (size_t i = 0; i < range_count && ret == HL7VAL_SUCCESS; i++) {
+        ret = ranges[i].status;
+        rows += ranges[i].rows;
+        code_len += ranges[i].code.data.len;
+        units_len += ranges[i].units.data.len;
+        flags_len += ranges[i].flags.data.len;
+    }
+
+    if (ret == HL7VAL_SUCCESS) {
+        out->rows = rows;
+        out->record = aligned_array(rows, sizeof(uint32_t));
+        out->value = aligned_array(rows, sizeof(double));
+        out->value_valid = aligned_array((rows + 7) / 8, 1);
+        if (!out->record || !out->value || !out->value_valid ||
+            str_column_alloc(&out->code, rows, code_len) != HL7VAL_SUCCESS ||
+            str_column_alloc(&out->units, rows, units_len) != HL7VAL_SUCCESS ||
+            str_column_alloc(&out->flags, rows, flags_len) != HL7VAL_SUCCESS) {
+            ret = HL7VAL_ERR_NO_MEMORY;
+        }
+    }
+
+    if (ret == HL7VAL_SUCCESS) {
+        memset(out->value_valid, 0, (rows + 7) / 8);
+        size_t row = 0;
+        int64_t code_base = 0;
+        int64_t units_base = 0;
+        int64_t flags_base = 0;
+        for (size_t i = 0; i < range_count; i++) {
+            const columns_range_t *r = &ranges[i];
+            if (r->rows == 0) {
+                continue;
+            }
+            memcpy(out->record + row, r->record.items, r->rows * sizeof(uint32_t));
+            memcpy(out->value + row, r->value.items, r->rows * sizeof(double));
+            const uint8_t *valid = r->valid.items;
+            for (size_t k = 0; k < r->rows; k++) {
+                out->value_valid[(row + k) / 8] |= (uint8_t)(valid[k] << ((row + k) % 8));
+                out->value_null_count += !valid[k];
+            }
+            str_column_append(&out->code, &r->code, row, r->rows, &code_base);
+            str_column_append(&out->units, &r->units, row, r->rows, &units_base);
+            str_column_append(&out->flags, &r->flags, row, r->rows, &flags_base);
+            row += r->rows;
+        }
+    }
+
+    for (size_t i = 0; i < range_count; i++) {
+        range_free(&ranges[i]);
+    }
+    free(ranges);
+    if (ret != HL7VAL_SUCCESS) {
+        hl7val_obx_columns_free(out);
+    }
+    return ret;
+}
+
+int hl7val_obx_columns(const hl7val_view_t *texts, size_t count, unsigned int num_threads,
+                       hl7val_obx_columns_t *out) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_OBX_COLUMNS, stats_view_bytes(texts, count),
+               obx_columns_impl(texts, count, num_threads, out));
+}
+
+void hl7val_obx_columns_free(hl7val_obx_columns_t *cols) {
+    if (!cols) {
+        return;
+    }
+    free(cols->record);
+    free(cols->value);
+    free(cols->value_valid);
+    free(cols->code.offsets);
+    free(cols->code.data);
+    free(cols->units.offsets);
+    free(cols->units.data);
+    free(cols->flags.offsets);
+    free(cols->flags.data);
+    memset(cols, 0, sizeof(*cols));
+}
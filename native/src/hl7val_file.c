@@ -0,0 +1,313 @@
+/*
+ * Parallel validation of large HL7 files for libhl7val.
+ *
+ * The input is cut into chunks at line boundaries and workers pull chunks
+ * off a shared counter, running the ordinary message splitter over each.
+ * Chunks are validated as if they started with the default delimiters;
+ * errors are kept in two lists per chunk, split at the chunk's first valid
+ * MSH. Once every chunk is done, a serial pass carries the delimiters from
+ * chunk to chunk and re-validates the leading part of any chunk that
+ * actually started under an MSH with other delimiters. Segment indices and
+ * line numbers are made global from per-chunk counts, so the report is
+ * identical to a single-threaded hl7val_parse_message over the whole input.
+ */
+#include "libhl7val.h"
+#include "hl7val_split.h"
+#include "hl7val_stats.h"
+#include "hl7val_workers.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_MIN_CHUNK   (256 * 1024)
+#define FILE_MAX_CHUNK   (8 * 1024 * 1024)
+
+typedef struct {
+    hl7val_file_error_t *items;
+    size_t count;      /* entries stored, at most the caller's capacity */
+    size_t allocated;
+    uint64_t total;    /* invalid segments seen, stored or not */
+} error_list_t;
+
+typedef struct {
+    size_t start;
+    size_t end;
+    uint64_t segments;
+    uint64_t lines;              /* line separators in the chunk */
+    int has_msh;
+    size_t prefix_end;           /* chunk offset of the first valid MSH, or its length */
+    hl7val_delims_t out_delims;  /* from the last valid MSH */
+    error_list_t prefix;         /* errors before the first valid MSH */
+    error_list_t body;
+    int status;
+} file_chunk_t;
+
+typedef struct {
+    const char *data;
+    file_chunk_t *chunks;
+    size_t chunk_count;
+    size_t limit;
+    _Atomic size_t next;
+} file_job_t;
+
+typedef struct {
+    const char *base;  /* start of the chunk */
+    file_chunk_t *chunk;
+    size_t limit;
+} chunk_sink_t;
+
+static void error_list_free(error_list_t *list) {
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+static int error_list_push(error_list_t *list, size_t limit, const hl7val_segment_result_t *r, uint64_t index) {
+    list->total++;
+    if (list->count >= limit) {
+        return HL7VAL_SUCCESS;
+    }
+    if (list->count == list->allocated) {
+        size_t allocated = list->allocated ? list->allocated * 2 : 16;
+        if (allocated > limit) {
+            allocated = limit;
+        }
+        hl7val_file_error_t *items = realloc(list->items, allocated * sizeof(*items));
+        if (!items) {
+            return HL7VAL_ERR_NO_MEMORY;
+        }
+        list->items = items;
+        list->allocated = allocated;
+    }
+    hl7val_file_error_t *e = &list->items[list->count++];
+    e->offset = r->offset;
+    e->segment_index = index;
+    e->line = r->line;
+    memcpy(e->id, r->id, sizeof(e->id));
+    e->status = r->status;
+    return HL7VAL_SUCCESS;
+}
+
+static int chunk_sink(void *arg, const hl7val_segment_result_t *r, const char *error_msg) {
+    (void)error_msg;
+    chunk_sink_t *cs = arg;
+    file_chunk_t *chunk = cs->chunk;
+    uint64_t index = chunk->segments++;
+
+    if (r->status == HL7VAL_SUCCESS) {
+        if (memcmp(r->id, "MSH", 3) == 0) {
+            if (!chunk->has_msh) {
+                chunk->has_msh = 1;
+                chunk->prefix_end = r->offset;
+            }
+            hl7val_delims_from_msh(cs->base + r->offset, r->len, &chunk->out_delims);
+        }
+        return HL7VAL_SUCCESS;
+    }
+    return error_list_push(chunk->has_msh ? &chunk->body : &chunk->prefix, cs->limit, r, index);
+}
+
+static void validate_chunk(const char *data, file_chunk_t *chunk, size_t limit) {
+    chunk_sink_t cs = {data + chunk->start, chunk, limit};
+    uint32_t lines = 0;
+    chunk->prefix_end = chunk->end - chunk->start;
+    chunk->status = hl7_split_message(cs.base, chunk->end - chunk->start, NULL, chunk_sink, &cs, 0, &lines);
+    chunk->lines = lines;
+}
+
+static void *file_worker(void *arg) {
+    file_job_t *job = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->chunk_count) {
+            return NULL;
+        }
+        validate_chunk(job->data, &job->chunks[i], job->limit);
+    }
+}
+
+/* First chunk boundary at or after `at`: just past the line separator, never between \r and \n */
+static size_t next_line_start(const char *data, size_t len, size_t at) {
+    while (at < len && data[at] != '\r' && data[at] != '\n') {
+        at++;
+    }
+    if (at < len && data[at] == '\r' && at + 1 < len && data[at + 1] == '\n') {
+        at++;
+    }
+    return at < len ? at + 1 : len;
+}
+
+/* Re-validate a chunk's segments before its first MSH under the delimiters it inherits */
+static int revalidate_prefix(const char *data, file_chunk_t *chunk, const hl7val_delims_t *delims, size_t limit) {
+    file_chunk_t scratch = {0};
+    chunk_sink_t cs = {data + chunk->start, &scratch, limit};
+    int ret = hl7_split_message(cs.base, chunk->prefix_end, delims, chunk_sink, &cs, 0, NULL);
+    if (ret != HL7VAL_SUCCESS) {
+        error_list_free(&scratch.prefix);
+        return ret;
+    }
+    error_list_free(&chunk->prefix);
+    chunk->prefix = scratch.prefix;
+    return HL7VAL_SUCCESS;
+}
+
+static void copy_errors(const error_list_t *list, const file_chunk_t *chunk, uint64_t segment_base,
+                        uint64_t line_base, hl7val_file_error_t *errors, size_t capacity, size_t *stored) {
+    for (size_t i = 0; i < list->count && *stored < capacity; i++) {
+        hl7val_file_error_t *e = &errors[(*stored)++];
+        *e = list->items[i];
+        e->offset += chunk->start;
+        e->segment_index += segment_base;
+        e->line += line_base;
+    }
+}
+
+unsigned int hl7_resolve_threads(unsigned int num_threads) {
+    if (num_threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = ncpu > 0 ? (unsigned int)ncpu : 1;
+    }
+    return num_threads > HL7_MAX_THREADS ? HL7_MAX_THREADS : num_threads;
+}
+
+void hl7_run_workers(void *(*worker)(void *), void *job, unsigned int num_threads, size_t chunks) {
+    num_threads = hl7_resolve_threads(num_threads);
+    if (num_threads > chunks) {
+        num_threads = chunks ? (unsigned int)chunks : 1;
+    }
+
+    pthread_t threads[HL7_MAX_THREADS];
+    unsigned int started = 0;
+    for (unsigned int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[started], NULL, worker, job) != 0) {
+            break;
+        }
+        started++;
+    }
+    worker(job);
+    for (unsigned int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+static int validate_buffer_impl(const char *data, size_t len, unsigned int num_threads, hl7val_file_error_t *errors,
+                                size_t capacity, hl7val_file_report_t *report) {
+    if (!data || !report || (!errors && capacity > 0)) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    memset(report, 0, sizeof(*report));
+    report->bytes = len;
+
+    num_threads = hl7_resolve_threads(num_threads);
+
+    /* About eight chunks per thread, so a slow chunk does not hold up the rest */
+    size_t chunk_size = len / ((size_t)num_threads * 8);
+    if (chunk_size < FILE_MIN_CHUNK) {
+        chunk_size = FILE_MIN_CHUNK;
+    } else if (chunk_size > FILE_MAX_CHUNK) {
+        chunk_size = FILE_MAX_CHUNK;
+    }
+    size_t max_chunks = len / chunk_size + 1;
+    file_chunk_t *chunks = calloc(max_chunks, sizeof(*chunks));
+    if (!chunks) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+
+    size_t chunk_count = 0;
+    for (size_t start = 0; start < len;) {
+        size_t end = len - start > chunk_size ? next_line_start(data, len, start + chunk_size) : len;
+        chunks[chunk_count].start = start;
+        chunks[chunk_count].end = end;
+        chunk_count++;
+        start = end;
+    }
+
+    file_job_t job = {data, chunks, chunk_count, capacity, 0};
+    hl7_run_workers(file_worker, &job, num_threads, chunk_count);
+
+    /* Carry delimiters across chunks and merge in input order */
+    int ret = HL7VAL_SUCCESS;
+    hl7val_delims_t delims = *hl7val_default_delims();
+    uint64_t segment_base = 0;
+    uint64_t line_base = 0;
+    size_t stored = 0;
+    for (size_t i = 0; i < chunk_count && ret == HL7VAL_SUCCESS; i++) {
+        file_chunk_t *chunk = &chunks[i];
+        ret = chunk->status;
+        if (ret == HL7VAL_SUCCESS && chunk->prefix_end > 0 &&
+            memcmp(&delims, hl7val_default_delims(), sizeof(delims)) != 0) {
+            ret = revalidate_prefix(data, chunk, &delims, capacity);
+        }
+        if (chunk->has_msh) {
+            delims = chunk->out_delims;
+        }
+        copy_errors(&chunk->prefix, chunk, segment_base, line_base, errors, capacity, &stored);
+        copy_errors(&chunk->body, chunk, segment_base, line_base, errors, capacity, &stored);
+        report->errors += chunk->prefix.total + chunk->body.total;
+        segment_base += chunk->segments;
+        line_base += chunk->lines;
+    }
+    report->segments = segment_base;
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        error_list_free(&chunks[i].prefix);
+        error_list_free(&chunks[i].body);
+    }
+    free(chunks);
+
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+    return report->errors > capacity ? HL7VAL_ERR_TOO_LARGE : HL7VAL_SUCCESS;
+}
+
+int hl7val_validate_buffer(const char *data, size_t len, unsigned int num_threads, hl7val_file_error_t *errors,
+                           size_t capacity, hl7val_file_report_t *report) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_VALIDATE_BUFFER, len,
+               validate_buffer_impl(data, len, num_threads, errors, capacity, report));
+}
+
+int hl7val_validate_file(const char *path, unsigned int num_threads, hl7val_file_error_t *errors,
+                         size_t capacity, hl7val_file_report_t *report) {
+    if (!path || !report) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return HL7VAL_ERR_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        int saved = errno;
+        if (saved == 0 || S_ISDIR(st.st_mode)) {
+            saved = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+        }
+        close(fd);
+        errno = saved;
+        return HL7VAL_ERR_IO;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return hl7val_validate_buffer("", 0, num_threads, errors, capacity, report);
+    }
+
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = saved;
+        return HL7VAL_ERR_IO;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    int ret = hl7val_validate_buffer(map, len, num_threads, errors, capacity, report);
+    munmap(map, len);
+    return ret;
+}
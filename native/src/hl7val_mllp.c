@@ -0,0 +1,363 @@
+/*
+ * MLLP framing for libhl7val.
+ *
+ * Frames are <VT> message <FS><CR> (0x0B ... 0x1C 0x0D). The framer is a
+ * small state machine over arbitrary chunks: start and end blocks are found
+ * with the separator scanner, and a frame that lies entirely inside one
+ * chunk is validated and delivered in place. Only frames split across
+ * chunks are copied, into a buffer sized once at creation.
+ */
+#include "libhl7val.h"
+#include "hl7val_scan.h"
+#include "hl7val_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+    MLLP_IDLE,      /* between frames, skipping to a start block */
+    MLLP_IN_FRAME,  /* reading a message */
+    MLLP_SAW_END,   /* end block seen as the last byte of a chunk */
+    MLLP_OVERSIZED, /* frame exceeded the buffer, skipping to its end */
+};
+
+struct hl7val_mllp {
+    hl7val_mllp_message_fn on_message;
+    void *ctx;
+    char *buf;       /* partial frame carried across chunks */
+    size_t cap;
+    size_t len;
+    int state;
+    hl7val_mllp_stats_t stats;
+};
+
+int hl7val_mllp_new(size_t max_message_size, hl7val_mllp_message_fn on_message, void *ctx,
+                    hl7val_mllp_t **out) {
+    if (!on_message || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+
+    hl7val_mllp_t *mllp = calloc(1, sizeof(*mllp));
+    if (!mllp) {
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    mllp->cap = max_message_size ? max_message_size : HL7VAL_MLLP_DEFAULT_MAX_MESSAGE;
+    mllp->buf = malloc(mllp->cap);
+    if (!mllp->buf) {
+        free(mllp);
+        return HL7VAL_ERR_NO_MEMORY;
+    }
+    mllp->on_message = on_message;
+    mllp->ctx = ctx;
+    mllp->state = MLLP_IDLE;
+    *out = mllp;
+    return HL7VAL_SUCCESS;
+}
+
+void hl7val_mllp_free(hl7val_mllp_t *mllp) {
+    if (mllp) {
+        free(mllp->buf);
+        free(mllp);
+    }
+}
+
+void hl7val_mllp_reset(hl7val_mllp_t *mllp) {
+    if (mllp) {
+        mllp->len = 0;
+        mllp->state = MLLP_IDLE;
+        memset(&mllp->stats, 0, sizeof(mllp->stats));
+    }
+}
+
+void hl7val_mllp_get_stats(const hl7val_mllp_t *mllp, hl7val_mllp_stats_t *out) {
+    if (mllp && out) {
+        *out = mllp->stats;
+    }
+}
+
+/* Offset of the first start or end block in p[0 .. len), or len */
+static size_t find_block_byte(const char *p, size_t len) {
+    static const hl7_scan_set_t set = {{HL7VAL_MLLP_START_BLOCK, HL7VAL_MLLP_END_BLOCK}, 2};
+    uint64_t bitmap[HL7_SCAN_WORDS];
+    for (size_t base = 0; base < len; base += HL7_SCAN_BLOCK) {
+        size_t n = len - base < HL7_SCAN_BLOCK ? len - base : HL7_SCAN_BLOCK;
+        hl7_scan_block(p + base, n, &set, bitmap);
+        for (size_t w = 0; w < (n + 63) / 64; w++) {
+            if (bitmap[w]) {
+                return base + 64 * w + (size_t)__builtin_ctzll(bitmap[w]);
+            }
+        }
+    }
+    return len;
+}
+
+static void deliver(hl7val_mllp_t *mllp, const char *message, size_t len) {
+    char error_msg[256] = {0};
+    int status = hl7_validate_message(message, len, NULL, error_msg);
+    if (status == HL7VAL_SUCCESS) {
+        mllp->stats.messages++;
+    } else {
+        mllp->stats.invalid++;
+    }
+    mllp->on_message(mllp->ctx, message, len, status,
+                     status == HL7VAL_SUCCESS ? NULL : error_msg[0] ? error_msg : hl7val_error_string(status));
+}
+
+static void drop(hl7val_mllp_t *mllp, int status, const char *reason) {
+    mllp->stats.dropped++;
+    mllp->len = 0;
+    mllp->on_message(mllp->ctx, NULL, 0, status, reason);
+}
+
+/* Buffer part of a frame; returns 0 (and drops the frame) if it overflows */
+static int append(hl7val_mllp_t *mllp, const char *p, size_t n) {
+    if (n > mllp->cap - mllp->len) {
+        mllp->len = 0;
+        mllp->state = MLLP_OVERSIZED;
+        return 0;
+    }
+    memcpy(mllp->buf + mllp->len, p, n);
+    mllp->len += n;
+    return 1;
+}
+
+static const char oversized_reason[] = "MLLP frame exceeds maximum message size";
+
+static int mllp_feed_impl(hl7val_mllp_t *mllp, const char *data, size_t len) {
+    if (!mllp || (!data && len)) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+
+    int delivered = 0;
+    size_t i = 0;
+    while (i < len) {
+        switch (mllp->state) {
+        case MLLP_IDLE: {
+            const char *start = memchr(data + i, HL7VAL_MLLP_START_BLOCK, len - i);
+            size_t at = start ? (size_t)(start - data) : len;
+            mllp->stats.discarded_bytes += at - i;
+            if (start) {
+                mllp->state = MLLP_IN_FRAME;
+                mllp->len = 0;
+                at++;
+            }
+            i = at;
+            break;
+        }
+
+        case MLLP_IN_FRAME: {
+            size_t at = i + find_block_byte(data + i, len - i);
+            if (at == len) {
+                append(mllp, data + i, len - i);
+                i = len;
+                break;
+            }
+
+            if (data[at] == HL7VAL_MLLP_START_BLOCK) {
+                /* The sender restarted: the partial frame is lost */
+                drop(mllp, HL7VAL_ERR_INVALID_FMT, "MLLP frame interrupted by a new start block");
+                delivered++;
+                i = at + 1;
+                break;
+            }
+
+            if (at + 1 < len && data[at + 1] != '\r') {
+                drop(mllp, HL7VAL_ERR_INVALID_FMT, "MLLP end block not followed by a carriage return");
+                delivered++;
+                mllp->state = MLLP_IDLE;
+                i = at + 1;
+                break;
+            }
+
+            size_t n = at - i;
+            if (at + 1 < len && mllp->len == 0 && n <= mllp->cap) {
+                /* Whole frame in this chunk: validate it in place */
+                deliver(mllp, data + i, n);
+                mllp->state = MLLP_IDLE;
+            } else if (!append(mllp, data + i, n)) {
+                drop(mllp, HL7VAL_ERR_TOO_LARGE, oversized_reason);
+                mllp->state = MLLP_IDLE;
+            } else if (at + 1 < len) {
+                deliver(mllp, mllp->buf, mllp->len);
+                mllp->state = MLLP_IDLE;
+            } else {
+                /* The carriage return is in the next chunk */
+                mllp->state = MLLP_SAW_END;
+                i = len;
+                break;
+            }
+            delivered++;
+            i = at + 2;
+            break;
+        }
+
+        case MLLP_SAW_END:
+            if (data[i] == '\r') {
+                deliver(mllp, mllp->buf, mllp->len);
+                i++;
+            } else {
+                drop(mllp, HL7VAL_ERR_INVALID_FMT, "MLLP end block not followed by a carriage return");
+            }
+            delivered++;
+            mllp->state = MLLP_IDLE;
+            break;
+
+        case MLLP_OVERSIZED: {
+            size_t at = i + find_block_byte(data + i, len - i);
+            if (at == len) {
+                i = len;
+                break;
+            }
+            drop(mllp, HL7VAL_ERR_TOO_LARGE, oversized_reason);
+            delivered++;
+            /* A start block begins the next frame; an end block's CR is skipped as noise */
+            mllp->state = data[at] == HL7VAL_MLLP_START_BLOCK ? MLLP_IN_FRAME : MLLP_IDLE;
+            i = at + 1;
+            break;
+        }
+        }
+    }
+    return delivered;
+}
+
+int hl7val_mllp_feed(hl7val_mllp_t *mllp, const char *data, size_t len) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_MLLP_FEED, len, mllp_feed_impl(mllp, data, len));
+}
+
+/* ---- ACK builder ---- */
+
+typedef struct {
+    char *out;
+    size_t cap;
+    size_t len;
+    int overflow;
+} writer_t;
+
+static void put(writer_t *w, const char *p, size_t n) {
+    if (w->overflow || n > w->cap - w->len) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->out + w->len, p, n);
+    w->len += n;
+}
+
+static void put_char(writer_t *w, char c) {
+    put(w, &c, 1);
+}
+
+static void put_field(writer_t *w, const hl7val_segment_t *msh, int field) {
+    hl7val_span_t span;
+    put_char(w, msh->delims.field);
+    if (msh->data && hl7val_field_at(msh, field, &span) == HL7VAL_SUCCESS) {
+        put(w, msh->data + span.start, span.len);
+    }
+}
+
+/* Write text with delimiters replaced by HL7 escape sequences */
+static void put_escaped(writer_t *w, const char *text, const hl7val_delims_t *d) {
+    const char esc = d->escape ? d->escape : '\\';
+    for (; *text; text++) {
+        char c = *text;
+        char code = c == d->field ? 'F' : c == d->component ? 'S' : c == d->repetition ? 'R' :
+                    c == d->subcomponent ? 'T' : c == esc ? 'E' : 0;
+        if (code) {
+            const char seq[3] = {esc, code, esc};
+            put(w, seq, 3);
+        } else if (c == '\r' || c == '\n') {
+            put_char(w, ' ');
+        } else {
+            put_char(w, c);
+        }
+    }
+}
+
+static int mllp_build_ack_impl(const char *message, size_t message_len, const char *ack_code, const char *text,
+                               char *out, size_t out_size, size_t *out_len) {
+    if (!ack_code || !out || !out_len || (!message && message_len)) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    static const char *codes[] = {"AA", "AE", "AR", "CA", "CE", "CR"};
+    int known = 0;
+    for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+        known |= strcmp(ack_code, codes[i]) == 0;
+    }
+    if (!known) {
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+
+    /* The MSH is the first segment; without a usable one, reply with empty fields */
+    static hl7val_segment_t empty_msh = {.delims = HL7VAL_DEFAULT_DELIMS_INIT};
+    hl7val_segment_t msh;
+    const hl7val_segment_t *m = &empty_msh;
+    size_t msh_len = 0;
+    while (msh_len < message_len && message[msh_len] != '\r' && message[msh_len] != '\n') {
+        msh_len++;
+    }
+    if (msh_len >= 4 && memcmp(message, "MSH", 3) == 0 &&
+        hl7_parse_segment(message, msh_len, NULL, &msh) == HL7VAL_SUCCESS) {
+        m = &msh;
+    }
+    const hl7val_delims_t *d = &m->delims;
+
+    char timestamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d%H%M%S+0000", &tm);
+
+    writer_t w = {out, out_size, 0, 0};
+    put_char(&w, HL7VAL_MLLP_START_BLOCK);
+    put(&w, "MSH", 3);
+    put_char(&w, d->field);
+    const char encoding[4] = {d->component, d->repetition, d->escape, d->subcomponent};
+    put(&w, encoding, strnlen(encoding, sizeof(encoding)));
+    put_field(&w, m, 5);  /* sending application: the original receiver */
+    put_field(&w, m, 6);
+    put_field(&w, m, 3);
+    put_field(&w, m, 4);
+    put_char(&w, d->field);
+    put(&w, timestamp, strlen(timestamp));
+    put_char(&w, d->field);
+
+    /* MSH-9: ACK^<original trigger event>^ACK */
+    put_char(&w, d->field);
+    put(&w, "ACK", 3);
+    hl7val_span_t trigger;
+    if (m->data && d->component && hl7val_component_at(m, 9, 1, 2, &trigger) == HL7VAL_SUCCESS && trigger.len) {
+        put_char(&w, d->component);
+        put(&w, m->data + trigger.start, trigger.len);
+        put_char(&w, d->component);
+        put(&w, "ACK", 3);
+    }
+    put_field(&w, m, 10);
+    put_field(&w, m, 11);
+    put_field(&w, m, 12);
+    put_char(&w, '\r');
+
+    put(&w, "MSA", 3);
+    put_char(&w, d->field);
+    put(&w, ack_code, 2);
+    put_field(&w, m, 10);
+    if (text && *text) {
+        put_char(&w, d->field);
+        put_escaped(&w, text, d);
+    }
+    put_char(&w, '\r');
+    put_char(&w, HL7VAL_MLLP_END_BLOCK);
+    put_char(&w, '\r');
+
+    if (w.overflow) {
+        return HL7VAL_ERR_TOO_LARGE;
+    }
+    *out_len = w.len;
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_mllp_build_ack(const char *message, size_t message_len, const char *ack_code, const char *text,
+                          char *out, size_t out_size, size_t *out_len) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_MLLP_BUILD_ACK, message_len,
+               mllp_build_ack_impl(message, message_len, ack_code, text, out, out_size, out_len));
+}
@@ -0,0 +1,194 @@
+/*
+ * HL7 separator scanning for libhl7val.
+ *
+ * Each kernel compares 64 bytes at a time against every separator in the
+ * set and packs the hits into one 64-bit word: SSE2 and NEON in four
+ * 16-byte steps, AVX2 in two 32-byte steps. A final partial word is
+ * scanned from a zero-padded copy (separators are never NUL). The kernel
+ * is picked once at runtime.
+ */
+#include "libhl7val.h"
+#include "hl7val_scan.h"
+#include "cpu_features.h"
+#include <pthread.h>
+#include <string.h>
+
+typedef void (*scan_block_fn)(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap);
+
+typedef struct {
+    const char *name;
+    unsigned int required;  /* CPU_FEATURE_* bits, 0 for scalar */
+    scan_block_fn block;
+} scan_kernel_t;
+
+/*
+ * Runs WORD (an expression over the 64-byte pointer `src`) for every full
+ * word of the block, then once more over a zero-padded copy of the tail.
+ */
+#define SCAN_BLOCK_LOOP(WORD)                          \
+    do {                                               \
+        size_t full_ = len / 64;                       \
+        for (size_t w_ = 0; w_ < full_; w_++) {        \
+            const char *src = p + 64 * w_;             \
+            bitmap[w_] = (WORD);                       \
+        }                                              \
+        size_t rest_ = len % 64;                       \
+        if (rest_) {                                   \
+            char tail_[64] = {0};                      \
+            memcpy(tail_, p + 64 * full_, rest_);      \
+            const char *src = tail_;                   \
+            bitmap[full_] = (WORD);                    \
+        }                                              \
+    } while (0)
+
+/* ---- Scalar ---- */
+
+static inline uint64_t scan_word_scalar(const char *src, const uint64_t member[4]) {
+    uint64_t mask = 0;
+    for (int b = 0; b < 64; b++) {
+        unsigned char c = (unsigned char)src[b];
+        mask |= ((member[c >> 6] >> (c & 63)) & 1) << b;
+    }
+    return mask;
+}
+
+static void scan_block_scalar(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap) {
+    uint64_t member[4] = {0, 0, 0, 0};
+    for (int k = 0; k < set->count; k++) {
+        member[set->chars[k] >> 6] |= 1ULL << (set->chars[k] & 63);
+    }
+    SCAN_BLOCK_LOOP(scan_word_scalar(src, member));
+}
+
+/* ---- x86-64 ---- */
+
+#if defined(CPU_ARCH_X86)
+static inline uint64_t scan_word_sse2(const char *src, const __m128i *c, int count) {
+    uint64_t mask = 0;
+    for (int j = 0; j < 4; j++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + 16 * j));
+        __m128i hit = _mm_cmpeq_epi8(v, c[0]);
+        for (int k = 1; k < count; k++) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, c[k]));
+        }
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << (16 * j);
+    }
+    return mask;
+}
+
+static void scan_block_sse2(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap) {
+    __m128i c[HL7_SCAN_MAX_CHARS];
+    /* Sets are never empty; setting c[0] unconditionally lets the compiler see it initialized */
+    c[0] = _mm_set1_epi8((char)set->chars[0]);
+    for (int k = 1; k < set->count; k++) {
+        c[k] = _mm_set1_epi8((char)set->chars[k]);
+    }
+    SCAN_BLOCK_LOOP(scan_word_sse2(src, c, set->count));
+}
+
+CPU_TARGET_AVX2
+static inline uint64_t scan_word_avx2(const char *src, const __m256i *c, int count) {
+    __m256i lo = _mm256_loadu_si256((const __m256i*)src);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(src + 32));
+    __m256i hit_lo = _mm256_cmpeq_epi8(lo, c[0]);
+    __m256i hit_hi = _mm256_cmpeq_epi8(hi, c[0]);
+    for (int k = 1; k < count; k++) {
+        hit_lo = _mm256_or_si256(hit_lo, _mm256_cmpeq_epi8(lo, c[k]));
+        hit_hi = _mm256_or_si256(hit_hi, _mm256_cmpeq_epi8(hi, c[k]));
+    }
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(hit_lo) |
+           ((uint64_t)(uint32_t)_mm256_movemask_epi8(hit_hi) << 32);
+}
+
+CPU_TARGET_AVX2
+static void scan_block_avx2(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap) {
+    __m256i c[HL7_SCAN_MAX_CHARS];
+    /* Sets are never empty; setting c[0] unconditionally lets the compiler see it initialized */
+    c[0] = _mm256_set1_epi8((char)set->chars[0]);
+    for (int k = 1; k < set->count; k++) {
+        c[k] = _mm256_set1_epi8((char)set->chars[k]);
+    }
+    SCAN_BLOCK_LOOP(scan_word_avx2(src, c, set->count));
+    _mm256_zeroupper();
+}
+#endif
+
+/* ---- AArch64 ---- */
+
+#if defined(CPU_ARCH_ARM64)
+static inline uint64_t scan_word_neon(const char *src, const uint8x16_t *c, int count, uint8x16_t weights) {
+    uint8x16_t hits[4];
+    for (int j = 0; j < 4; j++) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)src + 16 * j);
+        uint8x16_t hit = vceqq_u8(v, c[0]);
+        for (int k = 1; k < count; k++) {
+            hit = vorrq_u8(hit, vceqq_u8(v, c[k]));
+        }
+        hits[j] = vandq_u8(hit, weights);
+    }
+
+    /* Three rounds of pairwise adds fold each 8-byte group into one mask byte */
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(hits[0], hits[1]), vpaddq_u8(hits[2], hits[3]));
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+
+static void scan_block_neon(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap) {
+    static const uint8_t bit_weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weights = vld1q_u8(bit_weights);
+    uint8x16_t c[HL7_SCAN_MAX_CHARS];
+    /* Sets are never empty; setting c[0] unconditionally lets the compiler see it initialized */
+    c[0] = vdupq_n_u8(set->chars[0]);
+    for (int k = 1; k < set->count; k++) {
+        c[k] = vdupq_n_u8(set->chars[k]);
+    }
+    SCAN_BLOCK_LOOP(scan_word_neon(src, c, set->count, weights));
+}
+#endif
+
+static const scan_kernel_t scan_kernels[] = {
+#if defined(CPU_ARCH_X86)
+    {"avx2", CPU_FEATURE_AVX2, scan_block_avx2},
+    {"sse2", CPU_FEATURE_SSE2, scan_block_sse2},
+#endif
+#if defined(CPU_ARCH_ARM64)
+    {"neon", CPU_FEATURE_NEON, scan_block_neon},
+#endif
+    {"scalar", 0, scan_block_scalar},
+};
+
+static const scan_kernel_t *scan_kernel = NULL;
+static pthread_once_t scan_once = PTHREAD_ONCE_INIT;
+
+static void scan_select_kernel(void) {
+    /* Kernels are listed fastest first; scalar is always supported */
+    CPU_KERNEL_PICK(scan_kernels, cpu_features_detect(), (const char *)NULL, scan_kernel);
+}
+
+static inline const scan_kernel_t* scan_get_kernel(void) {
+    pthread_once(&scan_once, scan_select_kernel);
+    return scan_kernel;
+}
+
+const char* hl7val_scan_impl(void) {
+    return scan_get_kernel()->name;
+}
+
+int hl7val_scan_force_impl(const char *name) {
+    scan_get_kernel();
+    if (!name) {
+        scan_select_kernel();
+        return HL7VAL_SUCCESS;
+    }
+    const scan_kernel_t *kernel;
+    CPU_KERNEL_PICK(scan_kernels, cpu_features_detect(), name, kernel);
+    if (!kernel) {
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+    scan_kernel = kernel;
+    return HL7VAL_SUCCESS;
+}
+
+void hl7_scan_block(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap) {
+    scan_get_kernel()->block(p, len, set, bitmap);
+}
@@ -0,0 +1,32 @@
+#ifndef HOSPITAL_NATIVE_HL7VAL_SCAN_H
+#define HOSPITAL_NATIVE_HL7VAL_SCAN_H
+
+/*
+ * Internal delimiter scanner for libhl7val.
+ *
+ * hl7_scan_block marks every byte of a block that matches one of a small
+ * set of separator characters in a bitmap (bit i % 64 of word i / 64 for
+ * byte i), 16-32 bytes per step. Tokenizers then walk the set bits with
+ * count-trailing-zeros instead of testing each byte, and counters use
+ * popcount.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HL7_SCAN_MAX_CHARS 6
+#define HL7_SCAN_BLOCK     4096  /* max bytes per call */
+#define HL7_SCAN_WORDS     (HL7_SCAN_BLOCK / 64)
+
+typedef struct {
+    unsigned char chars[HL7_SCAN_MAX_CHARS];  /* non-zero separator bytes */
+    int count;
+} hl7_scan_set_t;
+
+/*
+ * Fill bitmap[0 .. (len + 63) / 64) for p[0 .. len), len <= HL7_SCAN_BLOCK.
+ * Bits past len in the last word are zero.
+ */
+void hl7_scan_block(const char *p, size_t len, const hl7_scan_set_t *set, uint64_t *bitmap);
+
+#endif /* HOSPITAL_NATIVE_HL7VAL_SCAN_H */
@@ -0,0 +1,331 @@
+/*
+ * HL7 v2.5 segment schema tables and datatype validators for libhl7val.
+ *
+ * Only the fields worth checking are listed; fields without a rule (or
+ * past rule_count) are accepted as-is. Segments not in the table get the
+ * generic structural checks only, so site-defined Z segments pass.
+ */
+#include "hl7val_schema.h"
+#include <string.h>
+
+#define RULES(table) ((uint8_t)(sizeof(table) / sizeof(table[0]) - 1)), table
+
+static const hl7_field_rule_t msh_rules[] = {
+    [1] = {HL7_DT_ST, 1, 1},    /* field separator */
+    [2] = {HL7_DT_ST, 1, 5},    /* encoding characters */
+    [3] = {HL7_DT_ANY, 0, 227}, /* sending application (HD) */
+    [4] = {HL7_DT_ANY, 0, 227}, /* sending facility (HD) */
+    [5] = {HL7_DT_ANY, 0, 227}, /* receiving application (HD) */
+    [6] = {HL7_DT_ANY, 0, 227}, /* receiving facility (HD) */
+    [7] = {HL7_DT_TS, 1, 26},   /* date/time of message */
+    [9] = {HL7_DT_ANY, 1, 15},  /* message type (MSG) */
+    [10] = {HL7_DT_ST, 1, 20},  /* message control ID */
+    [11] = {HL7_DT_ANY, 1, 3},  /* processing ID (PT) */
+    [12] = {HL7_DT_ANY, 1, 60}, /* version ID (VID) */
+    [13] = {HL7_DT_NM, 0, 15},  /* sequence number */
+};
+
+static const hl7_field_rule_t evn_rules[] = {
+    [2] = {HL7_DT_TS, 0, 26},   /* recorded date/time */
+    [3] = {HL7_DT_TS, 0, 26},   /* date/time planned event */
+    [6] = {HL7_DT_TS, 0, 26},   /* event occurred */
+};
+
+static const hl7_field_rule_t pid_rules[] = {
+    [1] = {HL7_DT_SI, 0, 4},    /* set ID */
+    [3] = {HL7_DT_ANY, 1, 250}, /* patient identifier list (CX) */
+    [5] = {HL7_DT_ANY, 1, 250}, /* patient name (XPN) */
+    [7] = {HL7_DT_TS, 0, 26},   /* date/time of birth */
+    [8] = {HL7_DT_ST, 0, 1},    /* administrative sex */
+    [29] = {HL7_DT_TS, 0, 26},  /* patient death date and time */
+};
+
+static const hl7_field_rule_t pv1_rules[] = {
+    [1] = {HL7_DT_SI, 0, 4},    /* set ID */
+    [2] = {HL7_DT_ST, 1, 1},    /* patient class */
+    [44] = {HL7_DT_TS, 0, 26},  /* admit date/time */
+    [45] = {HL7_DT_TS, 0, 26},  /* discharge date/time */
+};
+
+static const hl7_field_rule_t orc_rules[] = {
+    [1] = {HL7_DT_ST, 1, 2},    /* order control */
+    [9] = {HL7_DT_TS, 0, 26},   /* date/time of transaction */
+};
+
+static const hl7_field_rule_t obr_rules[] = {
+    [1] = {HL7_DT_SI, 0, 4},    /* set ID */
+    [4] = {HL7_DT_CE, 1, 250},  /* universal service identifier */
+    [6] = {HL7_DT_TS, 0, 26},   /* requested date/time */
+    [7] = {HL7_DT_TS, 0, 26},   /* observation date/time */
+    [8] = {HL7_DT_TS, 0, 26},   /* observation end date/time */
+    [14] = {HL7_DT_TS, 0, 26},  /* specimen received date/time */
+    [22] = {HL7_DT_TS, 0, 26},  /* results rpt/status chng date/time */
+    [25] = {HL7_DT_ST, 0, 1},   /* result status */
+};
+
+static const hl7_field_rule_t obx_rules[] = {
+    [1] = {HL7_DT_SI, 0, 4},      /* set ID */
+    [2] = {HL7_DT_ST, 0, 3},      /* value type */
+    [3] = {HL7_DT_CE, 1, 250},    /* observation identifier */
+    [4] = {HL7_DT_ST, 0, 20},     /* observation sub-ID */
+    [5] = {HL7_DT_VARIES, 0, 0},  /* observation value, typed by OBX-2 */
+    [6] = {HL7_DT_CE, 0, 250},    /* units */
+    [7] = {HL7_DT_ST, 0, 60},     /* references range */
+    [8] = {HL7_DT_ST, 0, 5},      /* abnormal flags */
+    [11] = {HL7_DT_ST, 0, 1},     /* observation result status */
+    [14] = {HL7_DT_TS, 0, 26},    /* date/time of the observation */
+    [19] = {HL7_DT_TS, 0, 26},    /* date/time of the analysis */
+};
+
+static const hl7_field_rule_t nte_rules[] = {
+    [1] = {HL7_DT_SI, 0, 4},    /* set ID */
+    [2] = {HL7_DT_ST, 0, 8},    /* source of comment */
+};
+
+/* Sorted by key for hl7_schema_lookup */
+static const hl7_segment_schema_t schemas[] = {
+    {HL7_SCHEMA_KEY('E', 'V', 'N'), 1, 0, RULES(evn_rules)},
+    {HL7_SCHEMA_KEY('M', 'S', 'H'), 12, 0, RULES(msh_rules)},
+    {HL7_SCHEMA_KEY('N', 'T', 'E'), 1, 0, RULES(nte_rules)},
+    {HL7_SCHEMA_KEY('O', 'B', 'R'), 4, 0, RULES(obr_rules)},
+    {HL7_SCHEMA_KEY('O', 'B', 'X'), 5, 2, RULES(obx_rules)},
+    {HL7_SCHEMA_KEY('O', 'R', 'C'), 1, 0, RULES(orc_rules)},
+    {HL7_SCHEMA_KEY('P', 'I', 'D'), 5, 0, RULES(pid_rules)},
+    {HL7_SCHEMA_KEY('P', 'V', '1'), 1, 0, RULES(pv1_rules)},
+};
+
+const hl7_segment_schema_t* hl7_schema_lookup(const char *id) {
+    uint32_t key = HL7_SCHEMA_KEY(id[0], id[1], id[2]);
+    size_t lo = 0;
+    size_t hi = sizeof(schemas) / sizeof(schemas[0]);
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (schemas[mid].key < key) {
+            lo = mid + 1;
+        } else if (schemas[mid].key > key) {
+            hi = mid;
+        } else {
+            return &schemas[mid];
+        }
+    }
+    return NULL;
+}
+
+hl7_datatype_t hl7_schema_varies_type(const char *code, size_t len) {
+    uint32_t key = len == 2 ? HL7_SCHEMA_KEY(code[0], code[1], ' ') :
+                   len == 3 ? HL7_SCHEMA_KEY(code[0], code[1], code[2]) : 0;
+    switch (key) {
+    case HL7_SCHEMA_KEY('N', 'M', ' '):
+        return HL7_DT_OBS_NM;
+    case HL7_SCHEMA_KEY('S', 'N', ' '):
+        return HL7_DT_SN;
+    case HL7_SCHEMA_KEY('S', 'I', ' '):
+        return HL7_DT_SI;
+    case HL7_SCHEMA_KEY('D', 'T', ' '):
+        return HL7_DT_DT;
+    case HL7_SCHEMA_KEY('T', 'S', ' '):
+    case HL7_SCHEMA_KEY('D', 'T', 'M'):
+        return HL7_DT_TS;
+    case HL7_SCHEMA_KEY('S', 'T', ' '):
+    case HL7_SCHEMA_KEY('T', 'X', ' '):
+    case HL7_SCHEMA_KEY('F', 'T', ' '):
+        return HL7_DT_ST;
+    case HL7_SCHEMA_KEY('C', 'E', ' '):
+        return HL7_DT_CE;
+    default:
+        return HL7_DT_ANY;
+    }
+}
+
+const char* hl7_schema_type_name(hl7_datatype_t type) {
+    static const char *names[] = {"ANY", "ST", "NM", "SI", "DT", "TS", "CE", "varies", "SN", "NM"};
+    return (unsigned)type < sizeof(names) / sizeof(names[0]) ? names[type] : "?";
+}
+
+/* ---- Validators ---- */
+
+static inline int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* n digits at p as an integer, or -1 */
+static int read_digits(const char *p, int n) {
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (!is_digit(p[i])) {
+            return -1;
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    return v;
+}
+
+static int check_nm(const char *p, size_t len) {
+    size_t i = 0;
+    if (i < len && (p[i] == '+' || p[i] == '-')) {
+        i++;
+    }
+    int digits = 0;
+    int dot = 0;
+    for (; i < len; i++) {
+        if (is_digit(p[i])) {
+            digits++;
+        } else if (p[i] == '.' && !dot) {
+            dot = 1;
+        } else {
+            return 0;
+        }
+    }
+    return digits > 0;
+}
+
+/* "<", ">", "<=", ">=", "=" or "<>" at the start of p; returns its length, 0 if none */
+static size_t comparator_len(const char *p, size_t len) {
+    if (len >= 2 && ((p[0] == '<' && (p[1] == '=' || p[1] == '>')) || (p[0] == '>' && p[1] == '='))) {
+        return 2;
+    }
+    return len >= 1 && (p[0] == '<' || p[0] == '>' || p[0] == '=') ? 1 : 0;
+}
+
+/*
+ * Structured numeric: "<5" or ">=1000" in one component, or the SN form
+ * <comparator>^<num1>^<separator/suffix>^<num2> ("<^5", "^1^:^128",
+ * "^10^+"). The component separator is the byte after the first component.
+ */
+static int check_sn(const char *p, size_t len, size_t first_len, int components) {
+    if (components == 1) {
+        size_t cmp = comparator_len(p, len);
+        return check_nm(p + cmp, len - cmp);
+    }
+    if (components > 4) {
+        return 0;
+    }
+    const char cs = p[first_len];
+    const char *parts[4] = {p};
+    size_t lens[4] = {first_len};
+    for (int i = 1; i < components; i++) {
+        parts[i] = parts[i - 1] + lens[i - 1] + 1;
+        const char *end = memchr(parts[i], cs, (size_t)(p + len - parts[i]));
+        lens[i] = (size_t)((end ? end : p + len) - parts[i]);
+    }
+    if (lens[0] && comparator_len(parts[0], lens[0]) != lens[0]) {
+        return 0;
+    }
+    if (!check_nm(parts[1], lens[1])) {
+        return 0;
+    }
+    if (components > 2 && lens[2] && (lens[2] != 1 || !memchr("-+/.:", parts[2][0], 5))) {
+        return 0;
+    }
+    return components < 4 || lens[3] == 0 || check_nm(parts[3], lens[3]);
+}
+
+static int check_si(const char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!is_digit(p[i])) {
+            return 0;
+        }
+    }
+    return len > 0;
+}
+
+/* YYYY[MM[DD]], with the day checked against the month */
+static int check_date(const char *p, size_t len) {
+    static const int days_in_month[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (len != 4 && len != 6 && len != 8) {
+        return 0;
+    }
+    int year = read_digits(p, 4);
+    if (year < 0) {
+        return 0;
+    }
+    if (len == 4) {
+        return 1;
+    }
+    int month = read_digits(p + 4, 2);
+    if (month < 1 || month > 12) {
+        return 0;
+    }
+    if (len == 6) {
+        return 1;
+    }
+    int day = read_digits(p + 6, 2);
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int max_day = month == 2 && !leap ? 28 : days_in_month[month - 1];
+    return day >= 1 && day <= max_day;
+}
+
+/* YYYY[MM[DD[HH[MM[SS[.S[S[S[S]]]]]]]]][+/-ZZZZ], parsed left to right */
+static int check_ts(const char *p, size_t len) {
+    static const int limits[] = {23, 59, 59};
+    if (len < 4) {
+        return 0;
+    }
+    size_t i = 4;
+    while (i < len && is_digit(p[i])) {
+        i++;
+    }
+    size_t digits = i;
+    if (digits < 4 || digits > 14 || digits % 2 || !check_date(p, digits < 8 ? digits : 8)) {
+        return 0;
+    }
+    for (size_t at = 8, k = 0; at < digits; at += 2, k++) {
+        if ((p[at] - '0') * 10 + (p[at + 1] - '0') > limits[k]) {
+            return 0;
+        }
+    }
+
+    /* Fractional seconds: 1-4 digits after a full HHMMSS */
+    if (i < len && p[i] == '.') {
+        size_t frac = ++i;
+        while (i < len && is_digit(p[i])) {
+            i++;
+        }
+        if (digits != 14 || i - frac < 1 || i - frac > 4) {
+            return 0;
+        }
+    }
+
+    /* Time zone offset */
+    if (i < len && (p[i] == '+' || p[i] == '-')) {
+        if (len - i != 5) {
+            return 0;
+        }
+        int hh = read_digits(p + i + 1, 2);
+        int mm = read_digits(p + i + 3, 2);
+        return hh >= 0 && hh <= 14 && mm >= 0 && mm <= 59;
+    }
+    return i == len;
+}
+
+int hl7_schema_check_value(hl7_datatype_t type, const char *p, size_t len, size_t first_len, int components) {
+    if (len == 2 && p[0] == '"' && p[1] == '"') {
+        return 1;
+    }
+
+    switch (type) {
+    case HL7_DT_ST:
+        for (size_t i = 0; i < len; i++) {
+            if ((unsigned char)p[i] < 0x20 || p[i] == 0x7f) {
+                return 0;
+            }
+        }
+        return 1;
+    case HL7_DT_NM:
+        return len == 0 || (components == 1 && check_nm(p, len));
+    case HL7_DT_SI:
+        return len == 0 || (components == 1 && check_si(p, len));
+    case HL7_DT_DT:
+        return len == 0 || (components == 1 && check_date(p, len));
+    case HL7_DT_TS:
+        /* The second component (degree of precision) is not checked */
+        return first_len == 0 || check_ts(p, first_len);
+    case HL7_DT_CE:
+        return components <= 6;
+    case HL7_DT_SN:
+    case HL7_DT_OBS_NM:
+        return len == 0 || check_sn(p, len, first_len, components);
+    default:
+        return 1;
+    }
+}
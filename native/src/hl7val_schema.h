@@ -0,0 +1,63 @@
+#ifndef HOSPITAL_NATIVE_HL7VAL_SCHEMA_H
+#define HOSPITAL_NATIVE_HL7VAL_SCHEMA_H
+
+/*
+ * Internal segment schema for libhl7val.
+ *
+ * Segment definitions are static tables keyed by the segment ID packed
+ * into an integer (HL7_SCHEMA_KEY), so finding a segment's rules is a
+ * binary search over a handful of integers and finding a field's rule is
+ * an array index. Each rule names a datatype, whether the field must be
+ * non-empty and a maximum length per repetition.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HL7_SCHEMA_KEY(a, b, c) \
+    (((uint32_t)(unsigned char)(a) << 16) | ((uint32_t)(unsigned char)(b) << 8) | (uint32_t)(unsigned char)(c))
+
+typedef enum {
+    HL7_DT_ANY = 0,  /* composite or unchecked */
+    HL7_DT_ST,       /* string: no control characters */
+    HL7_DT_NM,       /* numeric: [+-]digits[.digits] */
+    HL7_DT_SI,       /* sequence ID: unsigned integer */
+    HL7_DT_DT,       /* date: YYYY[MM[DD]] */
+    HL7_DT_TS,       /* time stamp: YYYY[MM[DD[HH[MM[SS[.S[S[S[S]]]]]]]]][+/-ZZZZ] */
+    HL7_DT_CE,       /* coded element: at most 6 components */
+    HL7_DT_VARIES,   /* datatype named by another field (OBX-5 by OBX-2) */
+    HL7_DT_SN,       /* structured numeric: [comparator]NM, or comparator^NM^separator^NM */
+    HL7_DT_OBS_NM,   /* NM observation value: checked as SN, since labs report "<5" in NM results */
+} hl7_datatype_t;
+
+typedef struct {
+    uint8_t type;      /* hl7_datatype_t */
+    uint8_t required;  /* must be present and non-empty */
+    uint16_t max_len;  /* per repetition, 0 = unlimited */
+} hl7_field_rule_t;
+
+typedef struct {
+    uint32_t key;                   /* HL7_SCHEMA_KEY of the segment ID */
+    uint8_t min_fields;             /* counting the segment ID as field 0 */
+    uint8_t type_field;             /* field naming the HL7_DT_VARIES type, 0 if none */
+    uint8_t rule_count;             /* rules[1 .. rule_count] */
+    const hl7_field_rule_t *rules;  /* indexed by HL7 field number */
+} hl7_segment_schema_t;
+
+/* Schema for a segment ID (3 bytes), or NULL if the segment has none */
+const hl7_segment_schema_t* hl7_schema_lookup(const char *id);
+
+/* Datatype named by a value type code such as "NM" or "CE" (OBX-2) */
+hl7_datatype_t hl7_schema_varies_type(const char *code, size_t len);
+
+/*
+ * Check one repetition of a field against a datatype, given the length of
+ * its first component and its component count (the caller has already
+ * found the separators). The HL7 null value "" is accepted for every type.
+ */
+int hl7_schema_check_value(hl7_datatype_t type, const char *p, size_t len, size_t first_len, int components);
+
+/* Datatype code for error messages ("NM", "TS", ...) */
+const char* hl7_schema_type_name(hl7_datatype_t type);
+
+#endif /* HOSPITAL_NATIVE_HL7VAL_SCHEMA_H */
@@ -0,0 +1,25 @@
+#ifndef HOSPITAL_NATIVE_HL7VAL_SPLIT_H
+#define HOSPITAL_NATIVE_HL7VAL_SPLIT_H
+
+/*
+ * Internal message splitter shared by libhl7val's message and file
+ * validators.
+ */
+
+#include "libhl7val.h"
+
+/* Called per segment; a non-zero return stops the split and is returned */
+typedef int (*hl7_segment_sink_fn)(void *ctx, const hl7val_segment_result_t *result, const char *error_msg);
+
+/*
+ * Split a message on \r, \n or \r\n and validate each non-blank line,
+ * calling emit() per segment. Lines are numbered from 1; a \r\n pair ends
+ * one line. Spaces and tabs around a segment are not part of it. Segments
+ * use delims (NULL = default) until an MSH segment sets its own. error_msg
+ * is only filled in when want_errors is set. line_count (may be NULL)
+ * receives the number of lines seen, including a final unterminated one.
+ */
+int hl7_split_message(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                      hl7_segment_sink_fn emit, void *ctx, int want_errors, uint32_t *line_count);
+
+#endif /* HOSPITAL_NATIVE_HL7VAL_SPLIT_H */
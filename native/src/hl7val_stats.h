@@ -0,0 +1,40 @@
+#ifndef HOSPITAL_NATIVE_HL7VAL_STATS_H
+#define HOSPITAL_NATIVE_HL7VAL_STATS_H
+
+/*
+ * Instrumented entry points of libhl7val (HOSPITAL_NATIVE_STATS, see
+ * cutils_stats.h). Library code that needs another instrumented API calls
+ * the hl7_* forms below, so a call counts once, under the API the caller
+ * entered.
+ */
+
+#include "libhl7val.h"
+#include "cutils_stats.h"
+
+enum {
+    HL7_STAT_VALIDATE_SEGMENT,
+    HL7_STAT_PARSE_SEGMENT,
+    HL7_STAT_EXTRACT_FIELDS,
+    HL7_STAT_VALIDATE_MESSAGE,
+    HL7_STAT_PARSE_MESSAGE,
+    HL7_STAT_VALIDATE_BUFFER,
+    HL7_STAT_MLLP_FEED,
+    HL7_STAT_MLLP_BUILD_ACK,
+    HL7_STAT_CACHE_GET,
+    HL7_STAT_OBX_COLUMNS,
+    HL7_STAT_COUNT
+};
+
+#ifdef HOSPITAL_NATIVE_STATS
+extern cutils_stats_domain_t hl7_api_stats;
+#endif
+
+/* Uncounted forms of hl7val_parse_segment_ex, hl7val_extract_fields and hl7val_validate_message_ex */
+int hl7_parse_segment(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                      hl7val_segment_t *out);
+int hl7_extract_fields(const char *segment, size_t len, const int *field_nums, size_t count,
+                       const hl7val_delims_t *delims, hl7val_view_t *out);
+int hl7_validate_message(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                         char *error_msg);
+
+#endif /* HOSPITAL_NATIVE_HL7VAL_STATS_H */
@@ -0,0 +1,23 @@
+#ifndef HOSPITAL_NATIVE_HL7VAL_WORKERS_H
+#define HOSPITAL_NATIVE_HL7VAL_WORKERS_H
+
+/*
+ * Internal thread runner for libhl7val's parallel entry points.
+ */
+
+#include <stddef.h>
+
+#define HL7_MAX_THREADS 64
+
+/* Worker threads to use for a request: 0 means one per online CPU, capped at HL7_MAX_THREADS */
+unsigned int hl7_resolve_threads(unsigned int num_threads);
+
+/*
+ * Run worker(job) on up to num_threads threads (resolved as above and
+ * capped at `chunks`), the calling thread being one of them. Workers pull
+ * their own work off the job; threads that fail to start are simply not
+ * used.
+ */
+void hl7_run_workers(void *(*worker)(void *), void *job, unsigned int num_threads, size_t chunks);
+
+#endif /* HOSPITAL_NATIVE_HL7VAL_WORKERS_H */
@@ -0,0 +1,183 @@
+/*
+ * Role/permission policy compiled to bitsets.
+ *
+ * Each (permission, role) cell holds the two state masks of its grant, and
+ * each permission the mask of roles with a non-empty cell, kept in step by
+ * authz_policy_set. A decision only ever visits the cells of roles that
+ * both the user has and the permission is granted to.
+ */
+#include "libauthz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t states;
+    uint64_t own_states;
+} authz_cell_t;
+
+struct authz_policy {
+    size_t role_count;
+    size_t permission_count;
+    uint64_t *holders;       /* [permission]: roles with a grant */
+    authz_cell_t *cells;     /* [permission * role_count + role] */
+};
+
+const char* authz_error_string(int error_code) {
+    switch (error_code) {
+        case AUTHZ_SUCCESS:
+            return "Success";
+        case AUTHZ_ERR_NULL_INPUT:
+            return "NULL input provided";
+        case AUTHZ_ERR_INVALID_SIZE:
+            return "Role, permission or count out of range";
+        case AUTHZ_ERR_MEMORY:
+            return "Memory allocation failed";
+        default:
+            return "Unknown error";
+    }
+}
+
+/* Header, holders and cells in one block, so a copy is a single memcpy */
+static size_t policy_size(size_t role_count, size_t permission_count) {
+    return sizeof(authz_policy_t) + permission_count * sizeof(uint64_t) +
+           permission_count * role_count * sizeof(authz_cell_t);
+}
+
+static void policy_layout(authz_policy_t *policy) {
+    policy->holders = (uint64_t*)(policy + 1);
+    policy->cells = (authz_cell_t*)(policy->holders + policy->permission_count);
+}
+
+int authz_policy_new(size_t role_count, size_t permission_count, authz_policy_t **out) {
+    if (!out) {
+        return AUTHZ_ERR_NULL_INPUT;
+    }
+    size_t permission_size = sizeof(uint64_t) + role_count * sizeof(authz_cell_t);
+    if (role_count == 0 || role_count > AUTHZ_MAX_ROLES || permission_count == 0 || permission_count > UINT32_MAX ||
+        permission_count > (SIZE_MAX - sizeof(authz_policy_t)) / permission_size) {
+        return AUTHZ_ERR_INVALID_SIZE;
+    }
+    authz_policy_t *policy = calloc(1, policy_size(role_count, permission_count));
+    if (!policy) {
+        return AUTHZ_ERR_MEMORY;
+    }
+    policy->role_count = role_count;
+    policy->permission_count = permission_count;
+    policy_layout(policy);
+    *out = policy;
+    return AUTHZ_SUCCESS;
+}
+
+int authz_policy_copy(const authz_policy_t *policy, authz_policy_t **out) {
+    if (!policy || !out) {
+        return AUTHZ_ERR_NULL_INPUT;
+    }
+    size_t size = policy_size(policy->role_count, policy->permission_count);
+    authz_policy_t *copy = malloc(size);
+    if (!copy) {
+        return AUTHZ_ERR_MEMORY;
+    }
+    memcpy(copy, policy, size);
+    policy_layout(copy);
+    *out = copy;
+    return AUTHZ_SUCCESS;
+}
+
+int authz_policy_set(authz_policy_t *policy, const authz_grant_t *grants, size_t count) {
+    if (!policy || (!grants && count)) {
+        return AUTHZ_ERR_NULL_INPUT;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (grants[i].role >= policy->role_count || grants[i].permission >= policy->permission_count) {
+            return AUTHZ_ERR_INVALID_SIZE;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        const authz_grant_t *grant = &grants[i];
+        uint64_t bit = UINT64_C(1) << grant->role;
+        authz_cell_t *cell = &policy->cells[grant->permission * policy->role_count + grant->role];
+        cell->states = grant->states;
+        cell->own_states = grant->own_states & ~grant->states;
+        if (cell->states | cell->own_states) {
+            policy->holders[grant->permission] |= bit;
+        } else {
+            policy->holders[grant->permission] &= ~bit;
+        }
+    }
+    return AUTHZ_SUCCESS;
+}
+
+void authz_policy_free(authz_policy_t *policy) {
+    free(policy);
+}
+
+int authz_can(const authz_policy_t *policy, uint64_t roles, uint32_t permission) {
+    if (!policy || permission >= policy->permission_count) {
+        return 0;
+    }
+    return (roles & policy->holders[permission]) != 0;
+}
+
+int authz_scope(const authz_policy_t *policy, uint64_t roles, uint32_t permission, uint64_t *states,
+                uint64_t *own_states) {
+    if (!policy || !states || !own_states) {
+        return AUTHZ_ERR_NULL_INPUT;
+    }
+    if (permission >= policy->permission_count) {
+        return AUTHZ_ERR_INVALID_SIZE;
+    }
+    const authz_cell_t *cells = &policy->cells[permission * policy->role_count];
+    uint64_t any = 0;
+    uint64_t own = 0;
+    for (uint64_t held = roles & policy->holders[permission]; held; held &= held - 1) {
+        const authz_cell_t *cell = &cells[__builtin_ctzll(held)];
+        any |= cell->states;
+        own |= cell->own_states;
+    }
+    *states = any;
+    *own_states = own & ~any;
+    return AUTHZ_SUCCESS;
+}
+
+int authz_filter(const authz_policy_t *policy, uint64_t roles, uint32_t permission, int64_t subject,
+                 const uint8_t *states, const int64_t *owners, size_t count, uint64_t *allowed,
+                 size_t *allowed_count) {
+    if (!policy || (!states && count) || (!allowed && count)) {
+        return AUTHZ_ERR_NULL_INPUT;
+    }
+    uint64_t any;
+    uint64_t own;
+    int result = authz_scope(policy, roles, permission, &any, &own);
+    if (result != AUTHZ_SUCCESS) {
+        return result;
+    }
+    if (!owners || subject == AUTHZ_NO_OWNER) {
+        own = 0;
+    }
+
+    /* Bit i of the state masks for every object, 64 objects to an output word */
+    size_t total = 0;
+    for (size_t base = 0; base < count; base += 64) {
+        size_t n = count - base < 64 ? count - base : 64;
+        uint64_t word = 0;
+        if (own) {
+            for (size_t j = 0; j < n; j++) {
+                unsigned int s = states[base + j];
+                uint64_t mask = any | (owners[base + j] == subject ? own : 0);
+                word |= (uint64_t)(s < AUTHZ_MAX_STATES && ((mask >> (s & 63)) & 1)) << j;
+            }
+        } else {
+            for (size_t j = 0; j < n; j++) {
+                unsigned int s = states[base + j];
+                word |= (uint64_t)(s < AUTHZ_MAX_STATES && ((any >> (s & 63)) & 1)) << j;
+            }
+        }
+        allowed[base / 64] = word;
+        total += (size_t)__builtin_popcountll(word);
+    }
+    if (allowed_count) {
+        *allowed_count = total;
+    }
+    return AUTHZ_SUCCESS;
+}
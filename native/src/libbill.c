@@ -0,0 +1,223 @@
+/*
+ * Fixed-point invoice totals.
+ *
+ * Amounts are int64 cents and rates millionths, so a proportional part is
+ * amount x rate / 10^6 computed exactly in 128 bits and rounded half away
+ * from zero once, the same single rounding Decimal's quantize applies to the
+ * exact product. Every sum and difference is overflow-checked; a result
+ * that cannot be represented is an error, never a wrapped value.
+ */
+#include "libbill.h"
+
+typedef unsigned __int128 bill_u128;
+
+#define U128_MAX (~(bill_u128)0)
+#define EXPONENT_CAP 100000  /* Far past any exponent an int64 at BILL_MAX_SCALE can use */
+
+const char* bill_error_string(int error_code) {
+    switch (error_code) {
+        case BILL_SUCCESS:
+            return "Success";
+        case BILL_ERR_NULL_INPUT:
+            return "NULL input provided";
+        case BILL_ERR_INVALID_SIZE:
+            return "Invoice index, rate or scale out of range";
+        case BILL_ERR_INVALID_FMT:
+            return "Not an exact decimal amount";
+        case BILL_ERR_OVERFLOW:
+            return "Amount out of range";
+        default:
+            return "Unknown error";
+    }
+}
+
+/* round(amount x rate / BILL_RATE_SCALE), ties away from zero; |result| <= |amount| as rate <= the scale */
+static int64_t rate_part(int64_t amount, uint32_t rate) {
+    __int128 product = (__int128)amount * rate;
+    bill_u128 magnitude = product < 0 ? -(bill_u128)product : (bill_u128)product;
+    int64_t part = (int64_t)((magnitude + BILL_RATE_SCALE / 2) / BILL_RATE_SCALE);
+    return product < 0 ? -part : part;
+}
+
+int bill_totals(const bill_invoice_t *invoices, size_t invoice_count, const bill_item_t *items,
+                size_t item_count, bill_totals_t *out) {
+    if ((!invoices && invoice_count) || (!items && item_count) || (!out && invoice_count)) {
+        return BILL_ERR_NULL_INPUT;
+    }
+    for (size_t i = 0; i < invoice_count; i++) {
+        out[i] = (bill_totals_t){0};
+    }
+
+    for (size_t i = 0; i < item_count; i++) {
+        const bill_item_t *item = &items[i];
+        if (item->invoice >= invoice_count) {
+            return BILL_ERR_INVALID_SIZE;
+        }
+        int64_t line;
+        int64_t *subtotal = &out[item->invoice].subtotal;
+        if (__builtin_mul_overflow((int64_t)item->quantity, item->unit_price, &line) ||
+            __builtin_add_overflow(*subtotal, line, subtotal)) {
+            return BILL_ERR_OVERFLOW;
+        }
+    }
+
+    for (size_t i = 0; i < invoice_count; i++) {
+        const bill_invoice_t *invoice = &invoices[i];
+        bill_totals_t *t = &out[i];
+        if (invoice->discount_rate > BILL_RATE_SCALE || invoice->tax_rate > BILL_RATE_SCALE) {
+            return BILL_ERR_INVALID_SIZE;
+        }
+        int64_t taxable;
+        if (__builtin_add_overflow(invoice->discount, rate_part(t->subtotal, invoice->discount_rate), &t->discount) ||
+            __builtin_sub_overflow(t->subtotal, t->discount, &taxable) ||
+            __builtin_add_overflow(invoice->tax, rate_part(taxable > 0 ? taxable : 0, invoice->tax_rate), &t->tax) ||
+            __builtin_add_overflow(t->subtotal, t->tax, &t->total) ||
+            __builtin_sub_overflow(t->total, t->discount, &t->total) ||
+            __builtin_sub_overflow(t->total, invoice->paid, &t->balance)) {
+            return BILL_ERR_OVERFLOW;
+        }
+    }
+    return BILL_SUCCESS;
+}
+
+/* *v *= 10^n; -1 if the result does not fit */
+static int mul_pow10(bill_u128 *v, unsigned int n) {
+    for (; n; n--) {
+        if (*v > U128_MAX / 10) {
+            return -1;
+        }
+        *v *= 10;
+    }
+    return 0;
+}
+
+int bill_parse_fixed(const char *text, size_t len, unsigned int scale, int64_t *out) {
+    if (!text || !out) {
+        return BILL_ERR_NULL_INPUT;
+    }
+    if (scale > BILL_MAX_SCALE) {
+        return BILL_ERR_INVALID_SIZE;
+    }
+
+    size_t i = 0;
+    int negative = 0;
+    if (i < len && (text[i] == '+' || text[i] == '-')) {
+        negative = text[i++] == '-';
+    }
+
+    /*
+     * Significant digits go into the mantissa; runs of zeros are held back
+     * and only multiplied in before a later non-zero digit, so trailing
+     * zeros ("0.50000...") never overflow and are folded into the exponent.
+     */
+    bill_u128 mantissa = 0;
+    long zeros = 0;
+    long fraction_digits = 0;
+    int digits = 0;
+    int point = 0;
+    for (; i < len; i++) {
+        char c = text[i];
+        if (c == '.' && !point) {
+            point = 1;
+        } else if (c >= '0' && c <= '9') {
+            digits = 1;
+            fraction_digits += point;
+            if (c == '0') {
+                zeros++;
+                continue;
+            }
+            if (mantissa && (zeros > 40 || mul_pow10(&mantissa, (unsigned int)zeros) < 0)) {
+                return BILL_ERR_OVERFLOW;
+            }
+            if (mul_pow10(&mantissa, 1) < 0 || mantissa > U128_MAX - (bill_u128)(c - '0')) {
+                return BILL_ERR_OVERFLOW;
+            }
+            mantissa += (bill_u128)(c - '0');
+            zeros = 0;
+        } else {
+            break;
+        }
+    }
+    if (!digits) {
+        return BILL_ERR_INVALID_FMT;
+    }
+
+    long exponent = 0;
+    if (i < len && (text[i] == 'E' || text[i] == 'e')) {
+        int exponent_negative = 0;
+        int exponent_digits = 0;
+        if (++i < len && (text[i] == '+' || text[i] == '-')) {
+            exponent_negative = text[i++] == '-';
+        }
+        for (; i < len && text[i] >= '0' && text[i] <= '9'; i++, exponent_digits = 1) {
+            if (exponent < EXPONENT_CAP) {
+                exponent = exponent * 10 + (text[i] - '0');
+            }
+        }
+        if (!exponent_digits) {
+            return BILL_ERR_INVALID_FMT;
+        }
+        exponent = exponent_negative ? -exponent : exponent;
+    }
+    if (i != len) {
+        return BILL_ERR_INVALID_FMT;
+    }
+
+    /* value x 10^scale = mantissa x 10^shift */
+    long shift = zeros + exponent - fraction_digits + (long)scale;
+    if (mantissa && shift > 0) {
+        if (shift > 40 || mul_pow10(&mantissa, (unsigned int)shift) < 0) {
+            return BILL_ERR_OVERFLOW;
+        }
+    } else if (mantissa && shift < 0) {
+        bill_u128 divisor = 1;
+        if (-shift > 38 || mul_pow10(&divisor, (unsigned int)-shift) < 0 || mantissa % divisor) {
+            return BILL_ERR_INVALID_FMT;  /* Non-zero digits below 10^-scale */
+        }
+        mantissa /= divisor;
+    }
+
+    bill_u128 limit = (bill_u128)INT64_MAX + (bill_u128)negative;
+    if (mantissa > limit) {
+        return BILL_ERR_OVERFLOW;
+    }
+    *out = negative ? (int64_t)(0 - (uint64_t)mantissa) : (int64_t)mantissa;
+    return BILL_SUCCESS;
+}
+
+int bill_format_fixed(int64_t value, unsigned int scale, char *buf, size_t buf_size, size_t *out_len) {
+    if (!buf) {
+        return BILL_ERR_NULL_INPUT;
+    }
+    if (scale > BILL_MAX_SCALE) {
+        return BILL_ERR_INVALID_SIZE;
+    }
+
+    /* Digits from the right, the point after `scale` of them, at least one before it */
+    char reversed[BILL_FIXED_BUF_SIZE];
+    size_t n = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    unsigned int written = 0;
+    do {
+        reversed[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+        if (++written == scale) {
+            reversed[n++] = '.';
+        }
+    } while (magnitude || written <= scale);
+    if (value < 0) {
+        reversed[n++] = '-';
+    }
+
+    if (n >= buf_size) {
+        return BILL_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = reversed[n - 1 - i];
+    }
+    buf[n] = '\0';
+    if (out_len) {
+        *out_len = n;
+    }
+    return BILL_SUCCESS;
+}
@@ -1,19 +1,16 @@
 #include "libcutils.h"
+#include "cutils_stats.h"
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/err.h>
+#include <openssl/crypto.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-
-/* Simple XXH3 implementation (simplified for demonstration) */
-static uint64_t xxh3_simple(const uint8_t *data, size_t len) {
-    uint64_t hash = 0x9E3779B97F4A7C15ULL;
-    for (size_t i = 0; i < len; i++) {
-        hash ^= data[i];
-        hash *= 0x100000001B3ULL;
-    }
-    return hash;
-}
+#include <unistd.h>
 
 const char* cutils_error_string(int error_code) {
     switch (error_code) {
@@ -27,87 +24,509 @@ const char* cutils_error_string(int error_code) {
             return "Cryptographic operation failed";
         case CUTILS_ERR_BUFFER_SIZE:
             return "Buffer size insufficient";
+        case CUTILS_ERR_IO:
+            return "I/O error";
+        case CUTILS_ERR_INTEGRITY:
+            return "Integrity check failed";
         default:
             return "Unknown error";
     }
 }
 
-int cutils_aes_gcm_encrypt(
-    const uint8_t *plaintext,
-    size_t plaintext_len,
-    const uint8_t *key,
-    uint8_t *output,
-    size_t *output_len
-) {
-    if (!plaintext || !key || !output || !output_len) {
+/*
+ * Instrumented APIs (HOSPITAL_NATIVE_STATS, see cutils_stats.h). The keyed
+ * (cutils_key_*) variants count under the same names as the raw-key ones.
+ */
+enum {
+    STAT_AES_GCM_ENCRYPT,
+    STAT_AES_GCM_DECRYPT,
+    STAT_AES_GCM_ENCRYPT_MANY,
+    STAT_AES_GCM_DECRYPT_MANY,
+    STAT_REENCRYPT_BATCH,
+    STAT_SHA256,
+    STAT_SHA256_MANY,
+    STAT_PSEUDONYMIZE,
+    STAT_PSEUDONYMIZE_MANY,
+    STAT_RANDOM_BYTES,
+    STAT_COUNT
+};
+
+#ifdef HOSPITAL_NATIVE_STATS
+static const char *const stat_names[STAT_COUNT] = {
+    "aes_gcm_encrypt",
+    "aes_gcm_decrypt",
+    "aes_gcm_encrypt_many",
+    "aes_gcm_decrypt_many",
+    "reencrypt_batch",
+    "sha256",
+    "sha256_many",
+    "pseudonymize",
+    "pseudonymize_many",
+    "random_bytes",
+};
+
+CUTILS_STATS_DOMAIN(cutils_api_stats, stat_names, STAT_COUNT);
+#endif
+
+int cutils_stats_enabled(void) {
+#ifdef HOSPITAL_NATIVE_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+size_t cutils_stats_snapshot(cutils_stats_t *out, size_t capacity) {
+#ifdef HOSPITAL_NATIVE_STATS
+    return cutils_stats_collect(&cutils_api_stats, out, capacity);
+#else
+    (void)out;
+    (void)capacity;
+    return 0;
+#endif
+}
+
+void cutils_stats_reset(void) {
+#ifdef HOSPITAL_NATIVE_STATS
+    cutils_stats_clear(&cutils_api_stats);
+#endif
+}
+
+/* Input bytes of a batch, for the counters */
+static inline uint64_t stats_buf_bytes(const cutils_buf_t *inputs, size_t count) {
+    uint64_t total = 0;
+    for (size_t i = 0; inputs && i < count; i++) {
+        total += inputs[i].len;
+    }
+    return total;
+}
+
+/*
+ * Per-thread random pool.
+ *
+ * RAND_bytes has a fixed per-call cost (locking, DRBG bookkeeping) that
+ * dominates 12-byte IVs and 32-byte tokens, so each thread draws 4 KiB at a
+ * time and serves small requests from that buffer. Bytes are wiped as they
+ * are handed out. A fork generation counter bumped in the atfork child
+ * handler makes a forked child drop the parent's buffered bytes, so
+ * gunicorn workers never hand out the same IVs/tokens as their parent.
+ */
+#define RAND_POOL_SIZE 4096
+
+typedef struct {
+    uint8_t buf[RAND_POOL_SIZE];
+    size_t pos;                /* Next unused byte; RAND_POOL_SIZE when empty */
+    unsigned int generation;   /* rand_generation at last refill */
+} rand_pool_t;
+
+static pthread_once_t rand_once = PTHREAD_ONCE_INIT;
+static pthread_key_t rand_tls_key;
+static _Atomic unsigned int rand_generation = 1;
+
+static void rand_pool_destroy(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    OPENSSL_cleanse(ptr, sizeof(rand_pool_t));
+    free(ptr);
+}
+
+static void rand_atfork_child(void) {
+    atomic_fetch_add(&rand_generation, 1);
+}
+
+static void rand_global_init(void) {
+    pthread_key_create(&rand_tls_key, rand_pool_destroy);
+    pthread_atfork(NULL, NULL, rand_atfork_child);
+}
+
+static int rand_direct(uint8_t *output, size_t len) {
+    while (len) {
+        int n = len > INT_MAX ? INT_MAX : (int)len;
+        if (RAND_bytes(output, n) != 1) {
+            return CUTILS_ERR_CRYPTO;
+        }
+        output += n;
+        len -= (size_t)n;
+    }
+    return CUTILS_SUCCESS;
+}
+
+static rand_pool_t* rand_pool_get(void) {
+    rand_pool_t *pool = pthread_getspecific(rand_tls_key);
+    if (pool) {
+        return pool;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->pos = RAND_POOL_SIZE;
+    pool->generation = atomic_load(&rand_generation);
+    if (pthread_setspecific(rand_tls_key, pool) != 0) {
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+static int random_bytes_impl(uint8_t *output, size_t len) {
+    if (!output && len) {
         return CUTILS_ERR_NULL_INPUT;
     }
+    if (len == 0) {
+        return CUTILS_SUCCESS;
+    }
 
-    if (*output_len < plaintext_len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE) {
-        return CUTILS_ERR_BUFFER_SIZE;
+    pthread_once(&rand_once, rand_global_init);
+
+    /* Large requests gain nothing from buffering */
+    rand_pool_t *pool = len >= RAND_POOL_SIZE / 4 ? NULL : rand_pool_get();
+    if (!pool) {
+        return rand_direct(output, len);
     }
 
-    EVP_CIPHER_CTX *ctx = NULL;
-    int len = 0;
-    int ciphertext_len = 0;
-    int ret = CUTILS_ERR_CRYPTO;
+    unsigned int generation = atomic_load(&rand_generation);
+    if (pool->generation != generation) {
+        OPENSSL_cleanse(pool->buf, sizeof(pool->buf));
+        pool->pos = RAND_POOL_SIZE;
+        pool->generation = generation;
+    }
 
-    /* Generate random IV */
-    uint8_t iv[CUTILS_AES_IV_SIZE];
-    if (RAND_bytes(iv, CUTILS_AES_IV_SIZE) != 1) {
-        goto cleanup;
+    while (len) {
+        if (pool->pos == RAND_POOL_SIZE) {
+            if (RAND_bytes(pool->buf, RAND_POOL_SIZE) != 1) {
+                return CUTILS_ERR_CRYPTO;
+            }
+            pool->pos = 0;
+        }
+        size_t n = RAND_POOL_SIZE - pool->pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(output, pool->buf + pool->pos, n);
+        OPENSSL_cleanse(pool->buf + pool->pos, n);
+        pool->pos += n;
+        output += n;
+        len -= n;
     }
+    return CUTILS_SUCCESS;
+}
+
+int cutils_random_bytes(uint8_t *output, size_t len) {
+    STATS_CALL(&cutils_api_stats, STAT_RANDOM_BYTES, len, random_bytes_impl(output, len));
+}
+
+/*
+ * Per-thread AES-GCM state.
+ *
+ * Each thread keeps one encrypt and one decrypt EVP_CIPHER_CTX alive for its
+ * lifetime, together with the identity of the key currently scheduled into
+ * it. Repeated calls with the same key only re-seed the IV, so the cost of a
+ * small encrypt is the GCM work itself rather than a malloc/free and a full
+ * key expansion. The contexts are released (and the cached key wiped) on
+ * thread exit.
+ *
+ * A slot is either bound to a raw key (key_id == 0, key bytes kept for
+ * comparison) or to a cutils_key_t handle (key_id == handle id).
+ */
+typedef struct {
+    EVP_CIPHER_CTX *ctx;
+    uint64_t key_id;
+    uint8_t key[CUTILS_AES_KEY_SIZE];
+    int key_set;
+} cutils_gcm_slot_t;
 
-    /* Copy IV to output */
-    memcpy(output, iv, CUTILS_AES_IV_SIZE);
+typedef struct {
+    cutils_gcm_slot_t enc;
+    cutils_gcm_slot_t dec;
+} cutils_gcm_tls_t;
 
-    /* Create and initialize context */
-    ctx = EVP_CIPHER_CTX_new();
+struct cutils_key {
+    uint64_t id;
+    EVP_CIPHER_CTX *enc_tmpl;  /* Key schedule expanded once at creation */
+    EVP_CIPHER_CTX *dec_tmpl;
+};
+
+static pthread_once_t gcm_once = PTHREAD_ONCE_INIT;
+static pthread_key_t gcm_tls_key;
+static const EVP_CIPHER *gcm_cipher = NULL;
+static _Atomic uint64_t gcm_next_key_id = 1;
+
+static void gcm_tls_destroy(void *ptr) {
+    cutils_gcm_tls_t *tls = ptr;
+    if (!tls) {
+        return;
+    }
+    EVP_CIPHER_CTX_free(tls->enc.ctx);
+    EVP_CIPHER_CTX_free(tls->dec.ctx);
+    OPENSSL_cleanse(tls, sizeof(*tls));
+    free(tls);
+}
+
+static void gcm_global_init(void) {
+    pthread_key_create(&gcm_tls_key, gcm_tls_destroy);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    /* Explicit fetch avoids the implicit provider lookup on every init */
+    gcm_cipher = EVP_CIPHER_fetch(NULL, "AES-256-GCM", NULL);
+#endif
+    if (!gcm_cipher) {
+        gcm_cipher = EVP_aes_256_gcm();
+    }
+}
+
+/* Create a GCM context with cipher and IV length set (no key yet) */
+static EVP_CIPHER_CTX* gcm_ctx_new(int encrypt) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
     if (!ctx) {
-        goto cleanup;
+        return NULL;
+    }
+    int ok = encrypt
+        ? EVP_EncryptInit_ex(ctx, gcm_cipher, NULL, NULL, NULL)
+        : EVP_DecryptInit_ex(ctx, gcm_cipher, NULL, NULL, NULL);
+    if (ok != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, CUTILS_AES_IV_SIZE, NULL) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static cutils_gcm_tls_t* gcm_tls_get(void) {
+    pthread_once(&gcm_once, gcm_global_init);
+
+    cutils_gcm_tls_t *tls = pthread_getspecific(gcm_tls_key);
+    if (tls) {
+        return tls;
     }
 
-    /* Initialize encryption */
-    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1) {
-        goto cleanup;
+    tls = calloc(1, sizeof(*tls));
+    if (!tls) {
+        return NULL;
     }
+    tls->enc.ctx = gcm_ctx_new(1);
+    tls->dec.ctx = gcm_ctx_new(0);
+    if (!tls->enc.ctx || !tls->dec.ctx ||
+        pthread_setspecific(gcm_tls_key, tls) != 0) {
+        gcm_tls_destroy(tls);
+        return NULL;
+    }
+    return tls;
+}
 
-    /* Set IV length */
-    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, CUTILS_AES_IV_SIZE, NULL) != 1) {
-        goto cleanup;
+/*
+ * Load a raw key and IV into a cached slot. The key schedule is only rebuilt
+ * when the key differs from the one already held by this thread.
+ */
+static int gcm_slot_init(cutils_gcm_slot_t *slot, int encrypt,
+                         const uint8_t *key, const uint8_t *iv) {
+    const uint8_t *new_key = NULL;
+    if (!slot->key_set || slot->key_id != 0 ||
+        CRYPTO_memcmp(slot->key, key, CUTILS_AES_KEY_SIZE) != 0) {
+        new_key = key;
     }
 
-    /* Initialize key and IV */
-    if (EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv) != 1) {
-        goto cleanup;
+    int ok = encrypt
+        ? EVP_EncryptInit_ex(slot->ctx, NULL, NULL, new_key, iv)
+        : EVP_DecryptInit_ex(slot->ctx, NULL, NULL, new_key, iv);
+    if (ok != 1) {
+        slot->key_set = 0;
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    if (new_key) {
+        memcpy(slot->key, key, CUTILS_AES_KEY_SIZE);
+        slot->key_id = 0;
+        slot->key_set = 1;
+    }
+    return CUTILS_SUCCESS;
+}
+
+/*
+ * Bind a slot to a key handle and load the IV. Switching handles copies the
+ * pre-expanded schedule from the handle's template instead of re-expanding.
+ */
+static int gcm_slot_init_handle(cutils_gcm_slot_t *slot, int encrypt,
+                                const cutils_key_t *key, const uint8_t *iv) {
+    if (!slot->key_set || slot->key_id != key->id) {
+        if (EVP_CIPHER_CTX_copy(slot->ctx, encrypt ? key->enc_tmpl : key->dec_tmpl) != 1) {
+            slot->key_set = 0;
+            return CUTILS_ERR_CRYPTO;
+        }
+        OPENSSL_cleanse(slot->key, sizeof(slot->key));
+        slot->key_id = key->id;
+        slot->key_set = 1;
     }
 
+    int ok = encrypt
+        ? EVP_EncryptInit_ex(slot->ctx, NULL, NULL, NULL, iv)
+        : EVP_DecryptInit_ex(slot->ctx, NULL, NULL, NULL, iv);
+    if (ok != 1) {
+        slot->key_set = 0;
+        return CUTILS_ERR_CRYPTO;
+    }
+    return CUTILS_SUCCESS;
+}
+
+static int gcm_check_encrypt_args(const uint8_t *plaintext, size_t plaintext_len,
+                                  const void *key, const uint8_t *output,
+                                  const size_t *output_len) {
+    if (!plaintext || !key || !output || !output_len) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    if (plaintext_len > INT_MAX - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+
+    if (*output_len < plaintext_len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE) {
+        return CUTILS_ERR_BUFFER_SIZE;
+    }
+    return CUTILS_SUCCESS;
+}
+
+static int gcm_check_decrypt_args(const uint8_t *ciphertext, size_t ciphertext_len,
+                                  const void *key, const uint8_t *output,
+                                  const size_t *output_len) {
+    if (!ciphertext || !key || !output || !output_len) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    if (ciphertext_len < CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE ||
+        ciphertext_len > INT_MAX) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+
+    if (*output_len < ciphertext_len - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE) {
+        return CUTILS_ERR_BUFFER_SIZE;
+    }
+    return CUTILS_SUCCESS;
+}
+
+/* Encrypt with a context whose key and IV (output[0..12)) are already loaded */
+static int gcm_seal(EVP_CIPHER_CTX *ctx, const uint8_t *plaintext, size_t plaintext_len,
+                    uint8_t *output, size_t *output_len) {
+    int len = 0;
+    int ciphertext_len = 0;
+
     /* Encrypt plaintext */
-    if (EVP_EncryptUpdate(ctx, output + CUTILS_AES_IV_SIZE, &len, plaintext, plaintext_len) != 1) {
-        goto cleanup;
+    if (EVP_EncryptUpdate(ctx, output + CUTILS_AES_IV_SIZE, &len, plaintext, (int)plaintext_len) != 1) {
+        return CUTILS_ERR_CRYPTO;
     }
     ciphertext_len = len;
 
     /* Finalize encryption */
     if (EVP_EncryptFinal_ex(ctx, output + CUTILS_AES_IV_SIZE + len, &len) != 1) {
-        goto cleanup;
+        return CUTILS_ERR_CRYPTO;
     }
     ciphertext_len += len;
 
     /* Get authentication tag */
     if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, CUTILS_AES_TAG_SIZE,
                             output + CUTILS_AES_IV_SIZE + ciphertext_len) != 1) {
-        goto cleanup;
+        return CUTILS_ERR_CRYPTO;
     }
 
     *output_len = CUTILS_AES_IV_SIZE + ciphertext_len + CUTILS_AES_TAG_SIZE;
-    ret = CUTILS_SUCCESS;
+    return CUTILS_SUCCESS;
+}
 
-cleanup:
-    if (ctx) {
-        EVP_CIPHER_CTX_free(ctx);
+/* Decrypt with a context whose key and IV are already loaded */
+static int gcm_open(EVP_CIPHER_CTX *ctx, const uint8_t *ciphertext, size_t ciphertext_len,
+                    uint8_t *output, size_t *output_len) {
+    int len = 0;
+    int plaintext_len = 0;
+
+    const uint8_t *ct = ciphertext + CUTILS_AES_IV_SIZE;
+    size_t ct_len = ciphertext_len - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE;
+    const uint8_t *tag = ct + ct_len;
+
+    /* Decrypt ciphertext */
+    if (EVP_DecryptUpdate(ctx, output, &len, ct, (int)ct_len) != 1) {
+        return CUTILS_ERR_CRYPTO;
     }
-    return ret;
+    plaintext_len = len;
+
+    /* Set expected tag */
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, CUTILS_AES_TAG_SIZE, (void*)tag) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    /* Finalize decryption (verifies tag) */
+    if (EVP_DecryptFinal_ex(ctx, output + len, &len) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    plaintext_len += len;
+
+    *output_len = plaintext_len;
+    return CUTILS_SUCCESS;
+}
+
+static int aes_gcm_encrypt_impl(
+    const uint8_t *plaintext,
+    size_t plaintext_len,
+    const uint8_t *key,
+    uint8_t *output,
+    size_t *output_len
+) {
+    int ret = gcm_check_encrypt_args(plaintext, plaintext_len, key, output, output_len);
+    if (ret != CUTILS_SUCCESS) {
+        return ret;
+    }
+
+    cutils_gcm_tls_t *tls = gcm_tls_get();
+    if (!tls) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    /* Generate random IV directly into the output */
+    if (random_bytes_impl(output, CUTILS_AES_IV_SIZE) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    /* Initialize key (if changed) and IV */
+    if (gcm_slot_init(&tls->enc, 1, key, output) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    return gcm_seal(tls->enc.ctx, plaintext, plaintext_len, output, output_len);
+}
+
+int cutils_aes_gcm_encrypt(
+    const uint8_t *plaintext,
+    size_t plaintext_len,
+    const uint8_t *key,
+    uint8_t *output,
+    size_t *output_len
+) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_ENCRYPT, plaintext_len,
+               aes_gcm_encrypt_impl(plaintext, plaintext_len, key, output, output_len));
+}
+
+static int aes_gcm_decrypt_impl(
+    const uint8_t *ciphertext,
+    size_t ciphertext_len,
+    const uint8_t *key,
+    uint8_t *output,
+    size_t *output_len
+) {
+    int ret = gcm_check_decrypt_args(ciphertext, ciphertext_len, key, output, output_len);
+    if (ret != CUTILS_SUCCESS) {
+        return ret;
+    }
+
+    cutils_gcm_tls_t *tls = gcm_tls_get();
+    if (!tls) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    /* Initialize key (if changed) and IV */
+    if (gcm_slot_init(&tls->dec, 0, key, ciphertext) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    return gcm_open(tls->dec.ctx, ciphertext, ciphertext_len, output, output_len);
 }
 
 int cutils_aes_gcm_decrypt(
@@ -117,162 +536,856 @@ int cutils_aes_gcm_decrypt(
     uint8_t *output,
     size_t *output_len
 ) {
-    if (!ciphertext || !key || !output || !output_len) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_DECRYPT, ciphertext_len,
+               aes_gcm_decrypt_impl(ciphertext, ciphertext_len, key, output, output_len));
+}
+
+int cutils_key_new(const uint8_t *key, cutils_key_t **out) {
+    if (!key || !out) {
         return CUTILS_ERR_NULL_INPUT;
     }
+    *out = NULL;
 
-    if (ciphertext_len < CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE) {
-        return CUTILS_ERR_INVALID_SIZE;
+    pthread_once(&gcm_once, gcm_global_init);
+
+    cutils_key_t *handle = calloc(1, sizeof(*handle));
+    if (!handle) {
+        return CUTILS_ERR_CRYPTO;
     }
 
-    EVP_CIPHER_CTX *ctx = NULL;
-    int len = 0;
-    int plaintext_len = 0;
-    int ret = CUTILS_ERR_CRYPTO;
+    handle->enc_tmpl = gcm_ctx_new(1);
+    handle->dec_tmpl = gcm_ctx_new(0);
+    if (!handle->enc_tmpl || !handle->dec_tmpl ||
+        EVP_EncryptInit_ex(handle->enc_tmpl, NULL, NULL, key, NULL) != 1 ||
+        EVP_DecryptInit_ex(handle->dec_tmpl, NULL, NULL, key, NULL) != 1) {
+        cutils_key_free(handle);
+        return CUTILS_ERR_CRYPTO;
+    }
 
-    /* Extract IV */
-    const uint8_t *iv = ciphertext;
-    const uint8_t *ct = ciphertext + CUTILS_AES_IV_SIZE;
-    size_t ct_len = ciphertext_len - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE;
-    const uint8_t *tag = ct + ct_len;
+    handle->id = gcm_next_key_id++;
+    *out = handle;
+    return CUTILS_SUCCESS;
+}
+
+void cutils_key_free(cutils_key_t *key) {
+    if (!key) {
+        return;
+    }
+    EVP_CIPHER_CTX_free(key->enc_tmpl);
+    EVP_CIPHER_CTX_free(key->dec_tmpl);
+    OPENSSL_cleanse(key, sizeof(*key));
+    free(key);
+}
 
-    if (*output_len < ct_len) {
+static int key_encrypt_impl(
+    const cutils_key_t *key,
+    const uint8_t *plaintext,
+    size_t plaintext_len,
+    uint8_t *output,
+    size_t *output_len
+) {
+    int ret = gcm_check_encrypt_args(plaintext, plaintext_len, key, output, output_len);
+    if (ret != CUTILS_SUCCESS) {
+        return ret;
+    }
+
+    cutils_gcm_tls_t *tls = gcm_tls_get();
+    if (!tls) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    if (random_bytes_impl(output, CUTILS_AES_IV_SIZE) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    if (gcm_slot_init_handle(&tls->enc, 1, key, output) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    return gcm_seal(tls->enc.ctx, plaintext, plaintext_len, output, output_len);
+}
+
+int cutils_key_encrypt(
+    const cutils_key_t *key,
+    const uint8_t *plaintext,
+    size_t plaintext_len,
+    uint8_t *output,
+    size_t *output_len
+) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_ENCRYPT, plaintext_len,
+               key_encrypt_impl(key, plaintext, plaintext_len, output, output_len));
+}
+
+static int key_decrypt_impl(
+    const cutils_key_t *key,
+    const uint8_t *ciphertext,
+    size_t ciphertext_len,
+    uint8_t *output,
+    size_t *output_len
+) {
+    int ret = gcm_check_decrypt_args(ciphertext, ciphertext_len, key, output, output_len);
+    if (ret != CUTILS_SUCCESS) {
+        return ret;
+    }
+
+    cutils_gcm_tls_t *tls = gcm_tls_get();
+    if (!tls) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    if (gcm_slot_init_handle(&tls->dec, 0, key, ciphertext) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    return gcm_open(tls->dec.ctx, ciphertext, ciphertext_len, output, output_len);
+}
+
+int cutils_key_decrypt(
+    const cutils_key_t *key,
+    const uint8_t *ciphertext,
+    size_t ciphertext_len,
+    uint8_t *output,
+    size_t *output_len
+) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_DECRYPT, ciphertext_len,
+               key_decrypt_impl(key, ciphertext, ciphertext_len, output, output_len));
+}
+
+/*
+ * Batch processing: one key setup (and one random pool draw per IV block)
+ * for the whole batch, records packed back to back into the caller's arena.
+ */
+#define GCM_BATCH_IV_BLOCK 64
+
+static size_t gcm_record_out_size(int encrypt, size_t in_len) {
+    if (encrypt) {
+        return in_len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE;
+    }
+    if (in_len < CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE) {
+        return 0;
+    }
+    return in_len - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE;
+}
+
+size_t cutils_aes_gcm_batch_size(int encrypt, const cutils_buf_t *inputs, size_t count) {
+    if (!inputs) {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += gcm_record_out_size(encrypt, inputs[i].len);
+    }
+    return total;
+}
+
+static int gcm_batch(
+    int encrypt,
+    const uint8_t *raw_key,
+    const cutils_key_t *handle,
+    const cutils_buf_t *inputs,
+    size_t count,
+    uint8_t *arena,
+    size_t arena_size,
+    cutils_batch_result_t *results
+) {
+    if ((!raw_key && !handle) || (count && (!inputs || !results || !arena))) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    if (cutils_aes_gcm_batch_size(encrypt, inputs, count) > arena_size) {
         return CUTILS_ERR_BUFFER_SIZE;
     }
 
-    /* Create and initialize context */
-    ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
-        goto cleanup;
+    cutils_gcm_tls_t *tls = gcm_tls_get();
+    if (!tls) {
+        return CUTILS_ERR_CRYPTO;
     }
+    cutils_gcm_slot_t *slot = encrypt ? &tls->enc : &tls->dec;
 
-    /* Initialize decryption */
-    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1) {
-        goto cleanup;
+    uint8_t ivs[GCM_BATCH_IV_BLOCK * CUTILS_AES_IV_SIZE];
+    size_t offset = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const cutils_buf_t *in = &inputs[i];
+        cutils_batch_result_t *res = &results[i];
+        size_t out_len = gcm_record_out_size(encrypt, in->len);
+        uint8_t *out = arena + offset;
+
+        res->offset = offset;
+        res->len = 0;
+        offset += out_len;
+
+        /* Draw IVs for the next block of records in one call */
+        if (encrypt && i % GCM_BATCH_IV_BLOCK == 0) {
+            size_t n = count - i < GCM_BATCH_IV_BLOCK ? count - i : GCM_BATCH_IV_BLOCK;
+            if (random_bytes_impl(ivs, n * CUTILS_AES_IV_SIZE) != CUTILS_SUCCESS) {
+                return CUTILS_ERR_CRYPTO;
+            }
+        }
+
+        if (!in->data && in->len) {
+            res->status = CUTILS_ERR_NULL_INPUT;
+            continue;
+        }
+        /* A NULL pointer is fine for empty records */
+        const uint8_t *data = in->data ? in->data : (const uint8_t*)"";
+
+        if (encrypt) {
+            if (in->len > INT_MAX - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE) {
+                res->status = CUTILS_ERR_INVALID_SIZE;
+                continue;
+            }
+            memcpy(out, ivs + (i % GCM_BATCH_IV_BLOCK) * CUTILS_AES_IV_SIZE, CUTILS_AES_IV_SIZE);
+        } else if (in->len < CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE || in->len > INT_MAX) {
+            res->status = CUTILS_ERR_INVALID_SIZE;
+            continue;
+        }
+
+        const uint8_t *iv = encrypt ? out : data;
+        int ret = handle
+            ? gcm_slot_init_handle(slot, encrypt, handle, iv)
+            : gcm_slot_init(slot, encrypt, raw_key, iv);
+        if (ret == CUTILS_SUCCESS) {
+            ret = encrypt
+                ? gcm_seal(slot->ctx, data, in->len, out, &out_len)
+                : gcm_open(slot->ctx, data, in->len, out, &out_len);
+        }
+
+        res->status = ret;
+        if (ret == CUTILS_SUCCESS) {
+            res->len = out_len;
+        } else {
+            /* Never leave unauthenticated plaintext in the arena */
+            OPENSSL_cleanse(out, gcm_record_out_size(encrypt, in->len));
+        }
     }
 
-    /* Set IV length */
-    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, CUTILS_AES_IV_SIZE, NULL) != 1) {
-        goto cleanup;
+    return CUTILS_SUCCESS;
+}
+
+int cutils_aes_gcm_encrypt_many(const uint8_t *key, const cutils_buf_t *inputs, size_t count,
+                                uint8_t *arena, size_t arena_size, cutils_batch_result_t *results) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_ENCRYPT_MANY, stats_buf_bytes(inputs, count),
+               gcm_batch(1, key, NULL, inputs, count, arena, arena_size, results));
+}
+
+int cutils_aes_gcm_decrypt_many(const uint8_t *key, const cutils_buf_t *inputs, size_t count,
+                                uint8_t *arena, size_t arena_size, cutils_batch_result_t *results) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_DECRYPT_MANY, stats_buf_bytes(inputs, count),
+               gcm_batch(0, key, NULL, inputs, count, arena, arena_size, results));
+}
+
+int cutils_key_encrypt_many(const cutils_key_t *key, const cutils_buf_t *inputs, size_t count,
+                            uint8_t *arena, size_t arena_size, cutils_batch_result_t *results) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_ENCRYPT_MANY, stats_buf_bytes(inputs, count),
+               gcm_batch(1, NULL, key, inputs, count, arena, arena_size, results));
+}
+
+int cutils_key_decrypt_many(const cutils_key_t *key, const cutils_buf_t *inputs, size_t count,
+                            uint8_t *arena, size_t arena_size, cutils_batch_result_t *results) {
+    STATS_CALL(&cutils_api_stats, STAT_AES_GCM_DECRYPT_MANY, stats_buf_bytes(inputs, count),
+               gcm_batch(0, NULL, key, inputs, count, arena, arena_size, results));
+}
+
+/*
+ * Minimal fork/join pool for the threaded batch APIs: the caller runs as
+ * worker 0 and up to num_threads - 1 extra threads (0 = online CPUs) run
+ * the same worker function over a shared job. Never more threads than
+ * chunks of work; if a thread cannot be created the batch simply runs on
+ * fewer workers.
+ */
+#define BATCH_MAX_THREADS 64
+
+static void batch_run_workers(void *(*worker)(void *), void *job,
+                              unsigned int num_threads, size_t chunks) {
+    if (num_threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = ncpu > 0 ? (unsigned int)ncpu : 1;
+    }
+    if (num_threads > chunks) {
+        num_threads = (unsigned int)chunks;
+    }
+    if (num_threads > BATCH_MAX_THREADS) {
+        num_threads = BATCH_MAX_THREADS;
     }
 
-    /* Initialize key and IV */
-    if (EVP_DecryptInit_ex(ctx, NULL, NULL, key, iv) != 1) {
-        goto cleanup;
+    pthread_t threads[BATCH_MAX_THREADS];
+    unsigned int started = 0;
+    for (unsigned int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[started], NULL, worker, job) != 0) {
+            break;
+        }
+        started++;
+    }
+    worker(job);
+    for (unsigned int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+/*
+ * Bulk re-encryption for key rotation.
+ *
+ * Output records have exactly the input sizes and are packed in input order.
+ * Each record is decrypted straight into its output slot (after the new IV)
+ * and re-encrypted in place, so plaintext never touches a scratch buffer.
+ * Workers pull fixed-size chunks off a shared counter, which keeps them
+ * balanced when record sizes vary.
+ */
+#define REENCRYPT_CHUNK 256
+
+typedef struct {
+    const cutils_key_t *old_key;
+    const cutils_key_t *new_key;
+    const cutils_buf_t *inputs;
+    const size_t *offsets;
+    size_t count;
+    uint8_t *output;
+    cutils_batch_result_t *results;
+    _Atomic size_t next;
+    _Atomic int fatal;
+} reencrypt_job_t;
+
+static int reencrypt_one(cutils_gcm_tls_t *tls, const reencrypt_job_t *job, size_t i) {
+    const cutils_buf_t *in = &job->inputs[i];
+    uint8_t *out = job->output + job->offsets[i];
+    size_t pt_len = in->len - CUTILS_AES_IV_SIZE - CUTILS_AES_TAG_SIZE;
+    size_t len = pt_len;
+
+    if (gcm_slot_init_handle(&tls->dec, 0, job->old_key, in->data) != CUTILS_SUCCESS ||
+        gcm_open(tls->dec.ctx, in->data, in->len, out + CUTILS_AES_IV_SIZE, &len) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
     }
 
-    /* Decrypt ciphertext */
-    if (EVP_DecryptUpdate(ctx, output, &len, ct, ct_len) != 1) {
-        goto cleanup;
+    if (random_bytes_impl(out, CUTILS_AES_IV_SIZE) != CUTILS_SUCCESS ||
+        gcm_slot_init_handle(&tls->enc, 1, job->new_key, out) != CUTILS_SUCCESS) {
+        return CUTILS_ERR_CRYPTO;
     }
-    plaintext_len = len;
 
-    /* Set expected tag */
-    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, CUTILS_AES_TAG_SIZE, (void*)tag) != 1) {
-        goto cleanup;
+    /* In-place: gcm_seal reads the plaintext from out + IV and overwrites it */
+    len = in->len;
+    return gcm_seal(tls->enc.ctx, out + CUTILS_AES_IV_SIZE, pt_len, out, &len);
+}
+
+static void* reencrypt_worker(void *arg) {
+    reencrypt_job_t *job = arg;
+    cutils_gcm_tls_t *tls = gcm_tls_get();
+    if (!tls) {
+        job->fatal = CUTILS_ERR_CRYPTO;
+        return NULL;
     }
 
-    /* Finalize decryption (verifies tag) */
-    if (EVP_DecryptFinal_ex(ctx, output + len, &len) != 1) {
+    for (;;) {
+        size_t start = atomic_fetch_add(&job->next, REENCRYPT_CHUNK);
+        if (start >= job->count || job->fatal) {
+            break;
+        }
+        size_t end = start + REENCRYPT_CHUNK < job->count ? start + REENCRYPT_CHUNK : job->count;
+
+        for (size_t i = start; i < end; i++) {
+            const cutils_buf_t *in = &job->inputs[i];
+            cutils_batch_result_t *res = &job->results[i];
+            res->offset = job->offsets[i];
+            res->len = 0;
+
+            if (!in->data) {
+                res->status = CUTILS_ERR_NULL_INPUT;
+                continue;
+            }
+            if (in->len < CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE || in->len > INT_MAX) {
+                res->status = CUTILS_ERR_INVALID_SIZE;
+                continue;
+            }
+
+            res->status = reencrypt_one(tls, job, i);
+            if (res->status == CUTILS_SUCCESS) {
+                res->len = in->len;
+            } else {
+                OPENSSL_cleanse(job->output + res->offset, in->len);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int reencrypt_batch_impl(
+    const uint8_t *old_key,
+    const uint8_t *new_key,
+    const cutils_buf_t *inputs,
+    size_t count,
+    uint8_t *output,
+    size_t output_size,
+    cutils_batch_result_t *results,
+    unsigned int num_threads
+) {
+    if (!old_key || !new_key || (count && (!inputs || !output || !results))) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (count == 0) {
+        return CUTILS_SUCCESS;
+    }
+
+    size_t *offsets = malloc(count * sizeof(size_t));
+    if (!offsets) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        offsets[i] = total;
+        total += inputs[i].len;
+    }
+    if (total > output_size) {
+        free(offsets);
+        return CUTILS_ERR_BUFFER_SIZE;
+    }
+
+    cutils_key_t *old_handle = NULL;
+    cutils_key_t *new_handle = NULL;
+    int ret = cutils_key_new(old_key, &old_handle);
+    if (ret == CUTILS_SUCCESS) {
+        ret = cutils_key_new(new_key, &new_handle);
+    }
+    if (ret != CUTILS_SUCCESS) {
         goto cleanup;
     }
-    plaintext_len += len;
 
-    *output_len = plaintext_len;
-    ret = CUTILS_SUCCESS;
+    reencrypt_job_t job = {
+        .old_key = old_handle,
+        .new_key = new_handle,
+        .inputs = inputs,
+        .offsets = offsets,
+        .count = count,
+        .output = output,
+        .results = results,
+    };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.fatal, 0);
 
-cleanup:
-    if (ctx) {
-        EVP_CIPHER_CTX_free(ctx);
+    batch_run_workers(reencrypt_worker, &job, num_threads,
+                      (count + REENCRYPT_CHUNK - 1) / REENCRYPT_CHUNK);
+
+    ret = job.fatal;
+    if (ret != CUTILS_SUCCESS) {
+        OPENSSL_cleanse(output, total);
     }
+
+cleanup:
+    cutils_key_free(old_handle);
+    cutils_key_free(new_handle);
+    free(offsets);
     return ret;
 }
 
-int cutils_sha256(const uint8_t *data, size_t data_len, uint8_t *output) {
+int cutils_reencrypt_batch(
+    const uint8_t *old_key,
+    const uint8_t *new_key,
+    const cutils_buf_t *inputs,
+    size_t count,
+    uint8_t *output,
+    size_t output_size,
+    cutils_batch_result_t *results,
+    unsigned int num_threads
+) {
+    STATS_CALL(&cutils_api_stats, STAT_REENCRYPT_BATCH, stats_buf_bytes(inputs, count),
+               reencrypt_batch_impl(old_key, new_key, inputs, count, output, output_size, results, num_threads));
+}
+
+/*
+ * SHA-256.
+ *
+ * The digest is fetched once per process and every thread keeps one
+ * EVP_MD_CTX for one-shot hashing, so cutils_sha256() does no allocation.
+ * Streaming contexts wrap their own EVP_MD_CTX and can be re-initialised
+ * for reuse.
+ */
+struct cutils_sha256_ctx {
+    EVP_MD_CTX *md;
+};
+
+static pthread_once_t sha256_once = PTHREAD_ONCE_INIT;
+static pthread_key_t sha256_tls_key;
+static const EVP_MD *sha256_md = NULL;
+
+static void sha256_tls_destroy(void *ptr) {
+    EVP_MD_CTX_free(ptr);
+}
+
+static void sha256_global_init(void) {
+    pthread_key_create(&sha256_tls_key, sha256_tls_destroy);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    sha256_md = EVP_MD_fetch(NULL, "SHA256", NULL);
+#endif
+    if (!sha256_md) {
+        sha256_md = EVP_sha256();
+    }
+}
+
+static EVP_MD_CTX* sha256_tls_get(void) {
+    pthread_once(&sha256_once, sha256_global_init);
+
+    EVP_MD_CTX *md = pthread_getspecific(sha256_tls_key);
+    if (md) {
+        return md;
+    }
+
+    md = EVP_MD_CTX_new();
+    if (!md) {
+        return NULL;
+    }
+    if (pthread_setspecific(sha256_tls_key, md) != 0) {
+        EVP_MD_CTX_free(md);
+        return NULL;
+    }
+    return md;
+}
+
+static int sha256_finish(EVP_MD_CTX *md, uint8_t *output) {
+    unsigned int out_len = 0;
+    if (EVP_DigestFinal_ex(md, output, &out_len) != 1 || out_len != CUTILS_SHA256_SIZE) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    return CUTILS_SUCCESS;
+}
+
+static int sha256_impl(const uint8_t *data, size_t data_len, uint8_t *output) {
     if (!data || !output) {
         return CUTILS_ERR_NULL_INPUT;
     }
 
-    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    EVP_MD_CTX *md = sha256_tls_get();
+    if (!md) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    if (EVP_DigestInit_ex(md, sha256_md, NULL) != 1 ||
+        EVP_DigestUpdate(md, data, data_len) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    return sha256_finish(md, output);
+}
+
+int cutils_sha256(const uint8_t *data, size_t data_len, uint8_t *output) {
+    STATS_CALL(&cutils_api_stats, STAT_SHA256, data_len, sha256_impl(data, data_len, output));
+}
+
+int cutils_sha256_new(cutils_sha256_ctx_t **out) {
+    if (!out) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+
+    pthread_once(&sha256_once, sha256_global_init);
+
+    cutils_sha256_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    ctx->md = EVP_MD_CTX_new();
+    if (!ctx->md || EVP_DigestInit_ex(ctx->md, sha256_md, NULL) != 1) {
+        cutils_sha256_free(ctx);
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    *out = ctx;
+    return CUTILS_SUCCESS;
+}
+
+void cutils_sha256_free(cutils_sha256_ctx_t *ctx) {
     if (!ctx) {
+        return;
+    }
+    EVP_MD_CTX_free(ctx->md);
+    free(ctx);
+}
+
+int cutils_sha256_init(cutils_sha256_ctx_t *ctx) {
+    if (!ctx) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (EVP_DigestInit_ex(ctx->md, sha256_md, NULL) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    return CUTILS_SUCCESS;
+}
+
+int cutils_sha256_update(cutils_sha256_ctx_t *ctx, const uint8_t *data, size_t data_len) {
+    if (!ctx || (!data && data_len)) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (data_len && EVP_DigestUpdate(ctx->md, data, data_len) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    return CUTILS_SUCCESS;
+}
+
+int cutils_sha256_final(cutils_sha256_ctx_t *ctx, uint8_t *output) {
+    if (!ctx || !output) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    return sha256_finish(ctx->md, output);
+}
+
+int cutils_sha256_copy(cutils_sha256_ctx_t *dst, const cutils_sha256_ctx_t *src) {
+    if (!dst || !src) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (EVP_MD_CTX_copy_ex(dst->md, src->md) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    return CUTILS_SUCCESS;
+}
+
+int cutils_sha256_peek(const cutils_sha256_ctx_t *ctx, uint8_t *output) {
+    if (!ctx || !output) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+
+    EVP_MD_CTX *md = sha256_tls_get();
+    if (!md) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    if (EVP_MD_CTX_copy_ex(md, ctx->md) != 1) {
         return CUTILS_ERR_CRYPTO;
     }
+    return sha256_finish(md, output);
+}
+
+static int sha256_many_impl(const cutils_buf_t *inputs, size_t count,
+                            const uint8_t *salt, size_t salt_len, uint8_t *output) {
+    if ((!inputs || !output) && count) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    if (!salt && salt_len) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!inputs[i].data && inputs[i].len) {
+            return CUTILS_ERR_NULL_INPUT;
+        }
+    }
+    if (count == 0) {
+        return CUTILS_SUCCESS;
+    }
+
+    EVP_MD_CTX *md = sha256_tls_get();
+    if (!md) {
+        return CUTILS_ERR_CRYPTO;
+    }
+
+    /* Hash the salt once; every value then starts from the saved midstate */
+    EVP_MD_CTX *midstate = NULL;
+    if (salt_len) {
+        midstate = EVP_MD_CTX_new();
+        if (!midstate ||
+            EVP_DigestInit_ex(midstate, sha256_md, NULL) != 1 ||
+            EVP_DigestUpdate(midstate, salt, salt_len) != 1) {
+            EVP_MD_CTX_free(midstate);
+            return CUTILS_ERR_CRYPTO;
+        }
+    }
+
+    int ret = CUTILS_SUCCESS;
+    for (size_t i = 0; i < count && ret == CUTILS_SUCCESS; i++) {
+        int ok = midstate
+            ? EVP_MD_CTX_copy_ex(md, midstate)
+            : EVP_DigestInit_ex(md, sha256_md, NULL);
+        if (ok != 1 || EVP_DigestUpdate(md, inputs[i].data, inputs[i].len) != 1) {
+            ret = CUTILS_ERR_CRYPTO;
+            break;
+        }
+        ret = sha256_finish(md, output + i * CUTILS_SHA256_SIZE);
+    }
+
+    EVP_MD_CTX_free(midstate);
+    return ret;
+}
+
+int cutils_sha256_many(const cutils_buf_t *inputs, size_t count,
+                       const uint8_t *salt, size_t salt_len, uint8_t *output) {
+    STATS_CALL(&cutils_api_stats, STAT_SHA256_MANY, stats_buf_bytes(inputs, count),
+               sha256_many_impl(inputs, count, salt, salt_len, output));
+}
+
+/*
+ * Keyed pseudonymization: HMAC-SHA256(key, value).
+ *
+ * The HMAC inner and outer pads are absorbed once into two SHA-256
+ * midstates when the handle is created. Each value then costs two context
+ * copies and two short compressions, with no per-value key setup or
+ * allocation. Batches fan out over worker threads; each worker hashes with
+ * its own per-thread context.
+ */
+#define PSEUDO_CHUNK 1024
+#define HMAC_BLOCK_SIZE 64
+
+struct cutils_pseudonymizer {
+    EVP_MD_CTX *inner;  /* SHA-256 state after (key ^ ipad) */
+    EVP_MD_CTX *outer;  /* SHA-256 state after (key ^ opad) */
+};
+
+typedef struct {
+    const cutils_pseudonymizer_t *ps;
+    const cutils_buf_t *inputs;
+    size_t count;
+    uint8_t *output;
+    _Atomic size_t next;
+    _Atomic int fatal;
+} pseudo_job_t;
+
+int cutils_pseudonymizer_new(const uint8_t *key, size_t key_len, cutils_pseudonymizer_t **out) {
+    if (!key || !out) {
+        return CUTILS_ERR_NULL_INPUT;
+    }
+    *out = NULL;
+    if (key_len == 0) {
+        return CUTILS_ERR_INVALID_SIZE;
+    }
+
+    pthread_once(&sha256_once, sha256_global_init);
+
+    /* Keys longer than a block are hashed first, as HMAC specifies */
+    uint8_t block[HMAC_BLOCK_SIZE] = {0};
+    if (key_len > HMAC_BLOCK_SIZE) {
+        if (sha256_impl(key, key_len, block) != CUTILS_SUCCESS) {
+            return CUTILS_ERR_CRYPTO;
+        }
+    } else {
+        memcpy(block, key, key_len);
+    }
+
+    uint8_t ipad[HMAC_BLOCK_SIZE];
+    uint8_t opad[HMAC_BLOCK_SIZE];
+    for (int i = 0; i < HMAC_BLOCK_SIZE; i++) {
+        ipad[i] = block[i] ^ 0x36;
+        opad[i] = block[i] ^ 0x5c;
+    }
 
     int ret = CUTILS_ERR_CRYPTO;
-    if (EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) == 1 &&
-        EVP_DigestUpdate(ctx, data, data_len) == 1) {
-        unsigned int out_len = 0;
-        if (EVP_DigestFinal_ex(ctx, output, &out_len) == 1 && out_len == 32) {
+    cutils_pseudonymizer_t *ps = calloc(1, sizeof(*ps));
+    if (ps) {
+        ps->inner = EVP_MD_CTX_new();
+        ps->outer = EVP_MD_CTX_new();
+        if (ps->inner && ps->outer &&
+            EVP_DigestInit_ex(ps->inner, sha256_md, NULL) == 1 &&
+            EVP_DigestUpdate(ps->inner, ipad, sizeof(ipad)) == 1 &&
+            EVP_DigestInit_ex(ps->outer, sha256_md, NULL) == 1 &&
+            EVP_DigestUpdate(ps->outer, opad, sizeof(opad)) == 1) {
+            *out = ps;
             ret = CUTILS_SUCCESS;
+        } else {
+            cutils_pseudonymizer_free(ps);
         }
     }
 
-    EVP_MD_CTX_free(ctx);
+    OPENSSL_cleanse(block, sizeof(block));
+    OPENSSL_cleanse(ipad, sizeof(ipad));
+    OPENSSL_cleanse(opad, sizeof(opad));
     return ret;
 }
 
-uint64_t cutils_xxh3(const uint8_t *data, size_t data_len) {
-    if (!data) {
-        return 0;
+void cutils_pseudonymizer_free(cutils_pseudonymizer_t *ps) {
+    if (!ps) {
+        return;
     }
-    return xxh3_simple(data, data_len);
+    EVP_MD_CTX_free(ps->inner);
+    EVP_MD_CTX_free(ps->outer);
+    free(ps);
 }
 
-int cutils_generate_token(uint8_t *output) {
-    if (!output) {
+static int pseudo_one(const cutils_pseudonymizer_t *ps, EVP_MD_CTX *md,
+                      const uint8_t *data, size_t data_len, uint8_t *output) {
+    uint8_t inner[CUTILS_SHA256_SIZE];
+    if (EVP_MD_CTX_copy_ex(md, ps->inner) != 1 ||
+        EVP_DigestUpdate(md, data, data_len) != 1 ||
+        sha256_finish(md, inner) != CUTILS_SUCCESS ||
+        EVP_MD_CTX_copy_ex(md, ps->outer) != 1 ||
+        EVP_DigestUpdate(md, inner, sizeof(inner)) != 1) {
+        return CUTILS_ERR_CRYPTO;
+    }
+    return sha256_finish(md, output);
+}
+
+static int pseudonymize_impl(const cutils_pseudonymizer_t *ps, const uint8_t *data, size_t data_len,
+                             uint8_t *output) {
+    if (!ps || !output || (!data && data_len)) {
         return CUTILS_ERR_NULL_INPUT;
     }
 
-    if (RAND_bytes(output, CUTILS_TOKEN_SIZE) != 1) {
+    EVP_MD_CTX *md = sha256_tls_get();
+    if (!md) {
         return CUTILS_ERR_CRYPTO;
     }
+    return pseudo_one(ps, md, data, data_len, output);
+}
 
-    return CUTILS_SUCCESS;
+int cutils_pseudonymize(const cutils_pseudonymizer_t *ps, const uint8_t *data, size_t data_len,
+                        uint8_t *output) {
+    STATS_CALL(&cutils_api_stats, STAT_PSEUDONYMIZE, data_len, pseudonymize_impl(ps, data, data_len, output));
 }
 
-int cutils_hex_encode(const uint8_t *data, size_t data_len, char *output) {
-    if (!data || !output) {
-        return CUTILS_ERR_NULL_INPUT;
+static void* pseudo_worker(void *arg) {
+    pseudo_job_t *job = arg;
+    EVP_MD_CTX *md = sha256_tls_get();
+    if (!md) {
+        job->fatal = CUTILS_ERR_CRYPTO;
+        return NULL;
     }
 
-    const char hex_chars[] = "0123456789abcdef";
-    for (size_t i = 0; i < data_len; i++) {
-        output[i * 2] = hex_chars[data[i] >> 4];
-        output[i * 2 + 1] = hex_chars[data[i] & 0x0F];
-    }
-    output[data_len * 2] = '\0';
+    for (;;) {
+        size_t start = atomic_fetch_add(&job->next, PSEUDO_CHUNK);
+        if (start >= job->count || job->fatal) {
+            break;
+        }
+        size_t end = start + PSEUDO_CHUNK < job->count ? start + PSEUDO_CHUNK : job->count;
 
-    return CUTILS_SUCCESS;
+        for (size_t i = start; i < end; i++) {
+            const cutils_buf_t *in = &job->inputs[i];
+            if (pseudo_one(job->ps, md, in->data, in->len, job->output + i * CUTILS_SHA256_SIZE) != CUTILS_SUCCESS) {
+                job->fatal = CUTILS_ERR_CRYPTO;
+                break;
+            }
+        }
+    }
+    return NULL;
 }
 
-int cutils_hex_decode(const char *hex, uint8_t *output, size_t *output_len) {
-    if (!hex || !output || !output_len) {
+static int pseudonymize_many_impl(const cutils_pseudonymizer_t *ps, const cutils_buf_t *inputs, size_t count,
+                                  uint8_t *output, unsigned int num_threads) {
+    if (!ps || ((!inputs || !output) && count)) {
         return CUTILS_ERR_NULL_INPUT;
     }
-
-    size_t hex_len = strlen(hex);
-    if (hex_len % 2 != 0) {
-        return CUTILS_ERR_INVALID_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        if (!inputs[i].data && inputs[i].len) {
+            return CUTILS_ERR_NULL_INPUT;
+        }
+    }
+    if (count == 0) {
+        return CUTILS_SUCCESS;
     }
 
-    *output_len = hex_len / 2;
-    for (size_t i = 0; i < *output_len; i++) {
-        char high = hex[i * 2];
-        char low = hex[i * 2 + 1];
+    pseudo_job_t job = {
+        .ps = ps,
+        .inputs = inputs,
+        .count = count,
+        .output = output,
+    };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.fatal, 0);
 
-        uint8_t val = 0;
-        if (high >= '0' && high <= '9') val = (high - '0') << 4;
-        else if (high >= 'a' && high <= 'f') val = (high - 'a' + 10) << 4;
-        else if (high >= 'A' && high <= 'F') val = (high - 'A' + 10) << 4;
-        else return CUTILS_ERR_INVALID_SIZE;
+    batch_run_workers(pseudo_worker, &job, num_threads, (count + PSEUDO_CHUNK - 1) / PSEUDO_CHUNK);
+    return job.fatal;
+}
 
-        if (low >= '0' && low <= '9') val |= (low - '0');
-        else if (low >= 'a' && low <= 'f') val |= (low - 'a' + 10);
-        else if (low >= 'A' && low <= 'F') val |= (low - 'A' + 10);
-        else return CUTILS_ERR_INVALID_SIZE;
+int cutils_pseudonymize_many(const cutils_pseudonymizer_t *ps, const cutils_buf_t *inputs, size_t count,
+                             uint8_t *output, unsigned int num_threads) {
+    STATS_CALL(&cutils_api_stats, STAT_PSEUDONYMIZE_MANY, stats_buf_bytes(inputs, count),
+               pseudonymize_many_impl(ps, inputs, count, output, num_threads));
+}
 
-        output[i] = val;
+int cutils_generate_token(uint8_t *output) {
+    if (!output) {
+        return CUTILS_ERR_NULL_INPUT;
     }
 
-    return CUTILS_SUCCESS;
+    return cutils_random_bytes(output, CUTILS_TOKEN_SIZE);
 }
@@ -1,4 +1,8 @@
 #include "libhl7val.h"
+#include "hl7val_scan.h"
+#include "hl7val_schema.h"
+#include "hl7val_split.h"
+#include "hl7val_stats.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -17,12 +21,139 @@ const char* hl7val_error_string(int error_code) {
             return "Invalid field count for segment type";
         case HL7VAL_ERR_DATATYPE:
             return "Invalid datatype in field";
+        case HL7VAL_ERR_NO_MEMORY:
+            return "Out of memory";
+        case HL7VAL_ERR_IO:
+            return "I/O error";
         default:
             return "Unknown error";
     }
 }
 
-int hl7val_validate_segment(const char *segment, size_t segment_len, char *error_msg) {
+#ifdef HOSPITAL_NATIVE_STATS
+static const char *const stat_names[HL7_STAT_COUNT] = {
+    "validate_segment",
+    "parse_segment",
+    "extract_fields",
+    "validate_message",
+    "parse_message",
+    "validate_buffer",
+    "mllp_feed",
+    "mllp_build_ack",
+    "cache_get",
+    "obx_columns",
+};
+
+CUTILS_STATS_DOMAIN(hl7_api_stats, stat_names, HL7_STAT_COUNT);
+
+_Static_assert(sizeof(hl7val_stats_t) == sizeof(cutils_stats_t), "stats entry layouts differ");
+#endif
+
+int hl7val_stats_enabled(void) {
+#ifdef HOSPITAL_NATIVE_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+size_t hl7val_stats_snapshot(hl7val_stats_t *out, size_t capacity) {
+#ifdef HOSPITAL_NATIVE_STATS
+    cutils_stats_t entries[HL7_STAT_COUNT];
+    size_t n = cutils_stats_collect(&hl7_api_stats, entries, HL7_STAT_COUNT);
+    for (size_t i = 0; out && i < n && i < capacity; i++) {
+        out[i].name = entries[i].name;
+        out[i].calls = entries[i].calls;
+        out[i].bytes = entries[i].bytes;
+        out[i].total_ns = entries[i].total_ns;
+        memcpy(out[i].errors, entries[i].errors, sizeof(out[i].errors));
+        memcpy(out[i].latency, entries[i].latency, sizeof(out[i].latency));
+    }
+    return n;
+#else
+    (void)out;
+    (void)capacity;
+    return 0;
+#endif
+}
+
+void hl7val_stats_reset(void) {
+#ifdef HOSPITAL_NATIVE_STATS
+    cutils_stats_clear(&hl7_api_stats);
+#endif
+}
+
+static const hl7val_delims_t default_delims = HL7VAL_DEFAULT_DELIMS_INIT;
+
+const hl7val_delims_t* hl7val_default_delims(void) {
+    return &default_delims;
+}
+
+int hl7val_delims_init(hl7val_delims_t *out, const char *chars, size_t len) {
+    if (!out || !chars) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    if (len < 1 || len > 5) {
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+
+    char c[5] = {0};
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)chars[i];
+        if (ch == '\0' || isalnum(ch) || isspace(ch)) {
+            return HL7VAL_ERR_INVALID_FMT;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (c[j] == chars[i]) {
+                return HL7VAL_ERR_INVALID_FMT;
+            }
+        }
+        c[i] = chars[i];
+    }
+
+    out->field = c[0];
+    out->component = c[1];
+    out->repetition = c[2];
+    out->escape = c[3];
+    out->subcomponent = c[4];
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_delims_from_msh(const char *msh, size_t msh_len, hl7val_delims_t *out) {
+    if (!msh || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    if (msh_len < 4 || memcmp(msh, "MSH", 3) != 0) {
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+
+    /* MSH-1 and MSH-2 are contiguous: "|^~\\&" */
+    size_t n = 1;
+    while (n < 5 && 3 + n < msh_len && msh[3 + n] != msh[3] &&
+           msh[3 + n] != '\r' && msh[3 + n] != '\n') {
+        n++;
+    }
+    return hl7val_delims_init(out, msh + 3, n);
+}
+
+/* Resolve the context for one segment: MSH always defines its own */
+static int resolve_delims(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                          hl7val_delims_t *out, char *error_msg) {
+    if (segment_len >= 4 && memcmp(segment, "MSH", 3) == 0) {
+        if (hl7val_delims_from_msh(segment, segment_len, out) != HL7VAL_SUCCESS) {
+            if (error_msg) {
+                snprintf(error_msg, 256, "Invalid MSH encoding characters");
+            }
+            return HL7VAL_ERR_INVALID_FMT;
+        }
+        return HL7VAL_SUCCESS;
+    }
+    *out = delims ? *delims : default_delims;
+    return HL7VAL_SUCCESS;
+}
+
+/* Size, segment ID and field delimiter checks shared by validate and parse */
+static int check_segment_header(const char *segment, size_t segment_len, char field_sep, char *error_msg) {
     /* Input validation */
     if (!segment) {
         if (error_msg) {
@@ -60,41 +191,227 @@ int hl7val_validate_segment(const char *segment, size_t segment_len, char *error
 
     /* Check for field delimiter */
     char delimiter = segment[3];
-    if (delimiter != '|') {
+    if (delimiter != field_sep) {
         if (error_msg) {
-            snprintf(error_msg, 256, "Invalid field delimiter (expected '|', got '%c')", delimiter);
+            snprintf(error_msg, 256, "Invalid field delimiter (expected '%c', got '%c')", field_sep, delimiter);
         }
         return HL7VAL_ERR_INVALID_FMT;
     }
 
-    /* Count fields */
-    int field_count = 1;
-    for (size_t i = 3; i < segment_len; i++) {
-        if (segment[i] == delimiter) {
-            field_count++;
+    return HL7VAL_SUCCESS;
+}
+
+/*
+ * State of the field walk in check_schema_fields. Component and repetition
+ * separators come from the same scan as field separators, so datatype
+ * checks never rescan a field.
+ */
+typedef struct {
+    const hl7_segment_schema_t *schema;
+    const hl7_field_rule_t *rule;  /* current field's rule, NULL if unchecked */
+    const char *segment;
+    char seg_type[4];
+    char *error_msg;
+    hl7_datatype_t varies;
+    int field;
+    int literal;       /* MSH-2: the encoding characters are data */
+    size_t start;      /* current field */
+    size_t rep_start;  /* current repetition */
+    size_t comp_end;   /* end of the repetition's first component */
+    int components;
+    int ret;
+} schema_walk_t;
+
+static inline void schema_walk_begin_field(schema_walk_t *walk) {
+    const hl7_field_rule_t *rule = NULL;
+    if (walk->ret == HL7VAL_SUCCESS && walk->field <= walk->schema->rule_count) {
+        rule = &walk->schema->rules[walk->field];
+        if (rule->type == HL7_DT_ANY && !rule->required && !rule->max_len) {
+            rule = NULL;
+        }
+    }
+    walk->rule = rule;
+    walk->rep_start = walk->start;
+    walk->comp_end = (size_t)-1;
+    walk->components = 1;
+}
+
+static void schema_walk_fail(schema_walk_t *walk, int ret) {
+    const hl7_field_rule_t *rule = walk->rule;
+    if (walk->error_msg) {
+        if (ret == HL7VAL_ERR_FIELD_COUNT) {
+            snprintf(walk->error_msg, 256, "Field %s-%d is required", walk->seg_type, walk->field);
+        } else if (ret == HL7VAL_ERR_TOO_LARGE) {
+            snprintf(walk->error_msg, 256, "Field %s-%d exceeds maximum length %u", walk->seg_type, walk->field,
+                     (unsigned)rule->max_len);
+        } else {
+            hl7_datatype_t type = rule->type == HL7_DT_VARIES ? walk->varies : (hl7_datatype_t)rule->type;
+            snprintf(walk->error_msg, 256, "Field %s-%d is not a valid %s value", walk->seg_type, walk->field,
+                     hl7_schema_type_name(type));
         }
     }
+    walk->ret = ret;
+    walk->rule = NULL;
+}
+
+/* The current repetition ends at offset `at`; length and datatype apply per repetition */
+static inline void schema_walk_close_rep(schema_walk_t *walk, size_t at) {
+    const hl7_field_rule_t *rule = walk->rule;
+    if (rule) {
+        size_t len = at - walk->rep_start;
+        hl7_datatype_t type = rule->type == HL7_DT_VARIES ? walk->varies : (hl7_datatype_t)rule->type;
+        size_t comp_len = walk->comp_end == (size_t)-1 ? len : walk->comp_end - walk->rep_start;
+        if (rule->max_len && len > rule->max_len) {
+            schema_walk_fail(walk, HL7VAL_ERR_TOO_LARGE);
+        } else if (!hl7_schema_check_value(type, walk->segment + walk->rep_start, len, comp_len,
+                                           walk->components)) {
+            schema_walk_fail(walk, HL7VAL_ERR_DATATYPE);
+        }
+    }
+    walk->rep_start = at + 1;
+    walk->comp_end = (size_t)-1;
+    walk->components = 1;
+}
+
+/* The current field ends at offset `at` */
+static inline void schema_walk_close_field(schema_walk_t *walk, size_t at) {
+    if (walk->field == walk->schema->type_field) {
+        walk->varies = hl7_schema_varies_type(walk->segment + walk->start, at - walk->start);
+    }
+    if (walk->rule && walk->rule->required && at == walk->start) {
+        schema_walk_fail(walk, HL7VAL_ERR_FIELD_COUNT);
+    }
+    schema_walk_close_rep(walk, at);
+    walk->field++;
+    walk->start = at + 1;
+    walk->literal = 0;
+    schema_walk_begin_field(walk);
+}
+
+/*
+ * Count the fields of a segment that has a schema, checking each field
+ * with a rule on the way. Returns the first violation, but always counts
+ * every field so field count errors can take precedence.
+ */
+static int check_schema_fields(const char *segment, size_t segment_len, const hl7val_delims_t *d,
+                               const hl7_segment_schema_t *schema, int *field_count, char *error_msg) {
+    /* MSH-1 is the separator at segment[3]; its fields start at MSH-2 */
+    const int is_msh = memcmp(segment, "MSH", 3) == 0;
+    schema_walk_t walk = {
+        .schema = schema,
+        .segment = segment,
+        .seg_type = {segment[0], segment[1], segment[2], '\0'},
+        .error_msg = error_msg,
+        .varies = HL7_DT_ANY,
+        .field = is_msh ? 2 : 1,
+        .literal = is_msh,
+        .start = 4,
+        .ret = HL7VAL_SUCCESS,
+    };
+    schema_walk_begin_field(&walk);
+
+    const char fs = d->field;
+    const char rs = d->repetition;
+    hl7_scan_set_t set = {{(unsigned char)fs}, 1};
+    if (d->component) {
+        set.chars[set.count++] = (unsigned char)d->component;
+    }
+    if (rs) {
+        set.chars[set.count++] = (unsigned char)rs;
+    }
+    uint64_t bitmap[HL7_SCAN_WORDS];
+
+    for (size_t base = 4; base < segment_len; base += HL7_SCAN_BLOCK) {
+        size_t n = segment_len - base < HL7_SCAN_BLOCK ? segment_len - base : HL7_SCAN_BLOCK;
+        hl7_scan_block(segment + base, n, &set, bitmap);
+        for (size_t w = 0; w < (n + 63) / 64; w++) {
+            for (uint64_t m = bitmap[w]; m; m &= m - 1) {
+                size_t at = base + 64 * w + (size_t)__builtin_ctzll(m);
+                char c = segment[at];
+                if (c == fs) {
+                    schema_walk_close_field(&walk, at);
+                } else if (walk.literal) {
+                    continue;
+                } else if (c == rs) {
+                    schema_walk_close_rep(&walk, at);
+                } else {
+                    if (walk.comp_end == (size_t)-1) {
+                        walk.comp_end = at;
+                    }
+                    walk.components++;
+                }
+            }
+        }
+    }
+    schema_walk_close_field(&walk, segment_len);
+    int highest = walk.field - 1;
+
+    /* Required fields past the end of the segment */
+    for (int f = highest + 1; walk.ret == HL7VAL_SUCCESS && f <= schema->rule_count; f++) {
+        if (schema->rules[f].required) {
+            if (error_msg) {
+                snprintf(error_msg, 256, "Field %s-%d is required", walk.seg_type, f);
+            }
+            walk.ret = HL7VAL_ERR_FIELD_COUNT;
+        }
+    }
+
+    /* Same convention as the plain count: the segment ID is field 0 */
+    *field_count = highest + 1;
+    return walk.ret;
+}
+
+/*
+ * hl7val_validate_segment_ex, also reporting the highest field number and
+ * the delimiters in effect (which an MSH segment defines for itself)
+ */
+static int validate_segment_impl(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                                 char *error_msg, int *highest_field, hl7val_delims_t *used) {
+    if (!segment) {
+        return check_segment_header(segment, segment_len, '|', error_msg);
+    }
+    hl7val_delims_t d;
+    int ret = resolve_delims(segment, segment_len, delims, &d, error_msg);
+    if (ret == HL7VAL_SUCCESS) {
+        ret = check_segment_header(segment, segment_len, d.field, error_msg);
+    }
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+    char delimiter = d.field;
 
-    /* For MSH segment, the field separator itself is MSH-1, so add 1 */
     char seg_type[4] = {segment[0], segment[1], segment[2], '\0'};
-    if (strcmp(seg_type, "MSH") == 0) {
-        field_count++;  /* MSH-1 is the field separator character */
-    }
-    
-    /* Basic field count validation for common segments */
-    int min_fields = 0;
-    if (strcmp(seg_type, "MSH") == 0) {
-        min_fields = 12;  /* MSH requires at least 12 fields */
-    } else if (strcmp(seg_type, "PID") == 0) {
-        min_fields = 5;   /* PID requires at least 5 fields */
-    } else if (strcmp(seg_type, "OBR") == 0) {
-        min_fields = 4;   /* OBR requires at least 4 fields */
-    } else if (strcmp(seg_type, "OBX") == 0) {
-        min_fields = 5;   /* OBX requires at least 5 fields */
+    const hl7_segment_schema_t *schema = hl7_schema_lookup(seg_type);
+    int field_count;
+    char schema_error[256];
+    int schema_ret = HL7VAL_SUCCESS;
+
+    if (schema) {
+        /* Walk the fields, checking each one that has a rule */
+        schema_ret = check_schema_fields(segment, segment_len, &d, schema, &field_count,
+                                         error_msg ? schema_error : NULL);
     } else {
-        min_fields = 1;   /* Generic segments need at least 1 field */
+        /* Count fields (the ID is never a delimiter, so scan from the start) */
+        const hl7_scan_set_t set = {{(unsigned char)delimiter}, 1};
+        uint64_t bitmap[HL7_SCAN_WORDS];
+        field_count = 1;
+        for (size_t base = 0; base < segment_len; base += HL7_SCAN_BLOCK) {
+            size_t n = segment_len - base < HL7_SCAN_BLOCK ? segment_len - base : HL7_SCAN_BLOCK;
+            hl7_scan_block(segment + base, n, &set, bitmap);
+            for (size_t w = 0; w < (n + 63) / 64; w++) {
+                field_count += __builtin_popcountll(bitmap[w]);
+            }
+        }
+
+        /* For MSH segment, the field separator itself is MSH-1, so add 1 */
+        if (strcmp(seg_type, "MSH") == 0) {
+            field_count++;  /* MSH-1 is the field separator character */
+        }
     }
 
+    /* Generic segments need at least 1 field */
+    int min_fields = schema ? schema->min_fields : 1;
+
     if (field_count < min_fields) {
         if (error_msg) {
             snprintf(error_msg, 256, "Segment %s has %d fields, requires at least %d",
@@ -111,50 +428,570 @@ int hl7val_validate_segment(const char *segment, size_t segment_len, char *error
         return HL7VAL_ERR_FIELD_COUNT;
     }
 
+    if (schema_ret != HL7VAL_SUCCESS) {
+        if (error_msg) {
+            strcpy(error_msg, schema_error);
+        }
+        return schema_ret;
+    }
+
+    /* field_count includes the segment ID */
+    *highest_field = field_count - 1;
+    if (used) {
+        *used = d;
+    }
     return HL7VAL_SUCCESS;
 }
 
+int hl7val_validate_segment(const char *segment, size_t segment_len, char *error_msg) {
+    return hl7val_validate_segment_ex(segment, segment_len, NULL, error_msg);
+}
+
+int hl7val_validate_segment_ex(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                               char *error_msg) {
+    int highest_field;
+    STATS_CALL(&hl7_api_stats, HL7_STAT_VALIDATE_SEGMENT, segment_len,
+               validate_segment_impl(segment, segment_len, delims, error_msg, &highest_field, NULL));
+}
+
 int hl7val_extract_field(const char *segment, int field_num, char *output, size_t output_size) {
     if (!segment || !output) {
         return HL7VAL_ERR_NULL_INPUT;
     }
+    return hl7val_extract_field_ex(segment, strlen(segment), field_num, NULL, output, output_size);
+}
+
+int hl7val_extract_field_ex(const char *segment, size_t len, int field_num, const hl7val_delims_t *delims,
+                            char *output, size_t output_size) {
+    if (!output) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+
+    hl7val_view_t view;
+    int ret = hl7val_field_view(segment, len, field_num, delims, &view);
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+
+    /* Copy field value */
+    if (view.len >= output_size) {
+        return HL7VAL_ERR_TOO_LARGE;
+    }
+
+    memcpy(output, view.data, view.len);
+    output[view.len] = '\0';
+
+    return HL7VAL_SUCCESS;
+}
+
+/* Checks shared by the view functions; fills the field separator */
+static int view_prologue(const char *segment, size_t len, const hl7val_delims_t *delims, char *field_sep) {
+    if (len < 4) {
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+
+    hl7val_delims_t d;
+    if (resolve_delims(segment, len, delims, &d, NULL) != HL7VAL_SUCCESS) {
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+    *field_sep = d.field;
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_field_view(const char *segment, size_t len, int field_num, const hl7val_delims_t *delims,
+                      hl7val_view_t *out) {
+    if (!segment || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
 
     if (field_num < 1) {
         return HL7VAL_ERR_INVALID_FMT;
     }
 
-    /* Skip segment ID and delimiter */
-    const char *ptr = segment + 4;
+    char field_sep;
+    int ret = view_prologue(segment, len, delims, &field_sep);
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+
+    /* Field n starts after the (n - 1)th delimiter past the segment ID */
+    const hl7_scan_set_t set = {{(unsigned char)field_sep}, 1};
+    uint64_t bitmap[HL7_SCAN_WORDS];
     int current_field = 1;
-    const char *field_start = ptr;
+    size_t field_start = 4;
+    size_t field_end = len;
 
-    /* Find the requested field */
-    while (*ptr != '\0' && current_field < field_num) {
-        if (*ptr == '|') {
-            current_field++;
-            field_start = ptr + 1;
+    for (size_t base = 4; base < len; base += HL7_SCAN_BLOCK) {
+        size_t n = len - base < HL7_SCAN_BLOCK ? len - base : HL7_SCAN_BLOCK;
+        hl7_scan_block(segment + base, n, &set, bitmap);
+        for (size_t w = 0; w < (n + 63) / 64; w++) {
+            for (uint64_t m = bitmap[w]; m; m &= m - 1) {
+                size_t at = base + 64 * w + (size_t)__builtin_ctzll(m);
+                if (current_field == field_num) {
+                    field_end = at;
+                    goto found;
+                }
+                current_field++;
+                field_start = at + 1;
+            }
         }
-        ptr++;
     }
 
     if (current_field != field_num) {
         return HL7VAL_ERR_FIELD_COUNT;
     }
 
-    /* Find end of field */
-    const char *field_end = field_start;
-    while (*field_end != '\0' && *field_end != '|') {
-        field_end++;
+found:
+    out->data = segment + field_start;
+    out->len = field_end - field_start;
+    return HL7VAL_SUCCESS;
+}
+
+static int extract_fields_impl(const char *segment, size_t len, const int *field_nums, size_t count,
+                               const hl7val_delims_t *delims, hl7val_view_t *out) {
+    if (!segment || (count && (!field_nums || !out))) {
+        return HL7VAL_ERR_NULL_INPUT;
     }
 
-    /* Copy field value */
-    size_t field_len = field_end - field_start;
-    if (field_len >= output_size) {
-        return HL7VAL_ERR_TOO_LARGE;
+    int max_field = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (field_nums[i] < 1) {
+            return HL7VAL_ERR_INVALID_FMT;
+        }
+        if (field_nums[i] >= HL7VAL_MAX_FIELDS) {
+            return HL7VAL_ERR_FIELD_COUNT;
+        }
+        if (field_nums[i] > max_field) {
+            max_field = field_nums[i];
+        }
     }
 
-    memcpy(output, field_start, field_len);
-    output[field_len] = '\0';
+    char field_sep;
+    int ret = view_prologue(segment, len, delims, &field_sep);
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+
+    /* One scan, stopping at the end of the highest requested field:
+     * field n spans starts[n] .. starts[n + 1] - 1 */
+    size_t starts[HL7VAL_MAX_FIELDS + 1];
+    const hl7_scan_set_t set = {{(unsigned char)field_sep}, 1};
+    uint64_t bitmap[HL7_SCAN_WORDS];
+    int seen = 1;
+    starts[1] = 4;
+
+    for (size_t base = 4; base < len && seen <= max_field; base += HL7_SCAN_BLOCK) {
+        size_t n = len - base < HL7_SCAN_BLOCK ? len - base : HL7_SCAN_BLOCK;
+        hl7_scan_block(segment + base, n, &set, bitmap);
+        for (size_t w = 0; w < (n + 63) / 64 && seen <= max_field; w++) {
+            for (uint64_t m = bitmap[w]; m && seen <= max_field; m &= m - 1) {
+                starts[++seen] = base + 64 * w + (size_t)__builtin_ctzll(m) + 1;
+            }
+        }
+    }
+    if (seen <= max_field) {
+        starts[seen + 1] = len + 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        int f = field_nums[i];
+        if (f > seen) {
+            out[i].data = NULL;
+            out[i].len = 0;
+        } else {
+            out[i].data = segment + starts[f];
+            out[i].len = starts[f + 1] - 1 - starts[f];
+        }
+    }
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_extract_fields(const char *segment, size_t len, const int *field_nums, size_t count,
+                          const hl7val_delims_t *delims, hl7val_view_t *out) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_EXTRACT_FIELDS, len,
+               extract_fields_impl(segment, len, field_nums, count, delims, out));
+}
+
+int hl7_extract_fields(const char *segment, size_t len, const int *field_nums, size_t count,
+                       const hl7val_delims_t *delims, hl7val_view_t *out) {
+    return extract_fields_impl(segment, len, field_nums, count, delims, out);
+}
+
+/*
+ * Tokenizer core. Always inlined so that the default-delimiter instance
+ * below is compiled with the separators as constants (static scan set,
+ * immediate compares); other encodings go through the generic instance.
+ */
+static inline __attribute__((always_inline))
+int tokenize_segment(const char *segment, size_t segment_len, hl7val_segment_t *out,
+                     char fs, char cs, char rs) {
+    out->data = segment;
+    out->len = segment_len;
+    memcpy(out->id, segment, 3);
+    out->id[3] = '\0';
+    out->sub_overflow = 0;
+    out->fields[0].start = 0;
+    out->fields[0].len = 3;
+    out->sub_first[0] = 0;
+
+    /* MSH-1 is the field separator and MSH-2 holds the encoding characters,
+     * which are literal rather than separators */
+    int is_msh = memcmp(segment, "MSH", 3) == 0;
+    int field = 1;
+    int split_from = is_msh ? 3 : 1;
+    if (is_msh) {
+        out->fields[1].start = 3;
+        out->fields[1].len = 1;
+        out->sub_first[1] = 0;
+        field = 2;
+    }
+
+    uint32_t start = 4;
+    unsigned int nsubs = 0;
+    out->fields[field].start = start;
+    out->sub_first[field] = 0;
+
+    /* Unused encoding characters are '\0' and must not be scanned for */
+    hl7_scan_set_t set = {{(unsigned char)fs}, 1};
+    if (cs) {
+        set.chars[set.count++] = (unsigned char)cs;
+    }
+    if (rs) {
+        set.chars[set.count++] = (unsigned char)rs;
+    }
+    uint64_t bitmap[HL7_SCAN_WORDS];
+
+    for (size_t base = 4; base < segment_len; base += HL7_SCAN_BLOCK) {
+        size_t n = segment_len - base < HL7_SCAN_BLOCK ? segment_len - base : HL7_SCAN_BLOCK;
+        hl7_scan_block(segment + base, n, &set, bitmap);
+
+        for (size_t w = 0; w < (n + 63) / 64; w++) {
+            for (uint64_t m = bitmap[w]; m; m &= m - 1) {
+                uint32_t i = (uint32_t)(base + 64 * w + (size_t)__builtin_ctzll(m));
+                if (segment[i] == fs) {
+                    out->fields[field].len = i - start;
+                    if (++field >= HL7VAL_MAX_FIELDS) {
+                        return HL7VAL_ERR_FIELD_COUNT;
+                    }
+                    start = i + 1;
+                    out->fields[field].start = start;
+                    out->sub_first[field] = (uint16_t)nsubs;
+                } else if (field >= split_from) {
+                    if (nsubs < HL7VAL_MAX_SUB_SEPARATORS) {
+                        out->subs[nsubs++] = i;
+                    } else {
+                        out->sub_overflow = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    out->fields[field].len = (uint32_t)segment_len - start;
+    out->sub_first[field + 1] = (uint16_t)nsubs;
+    out->field_count = field;
+    return HL7VAL_SUCCESS;
+}
+
+static int tokenize_default(const char *segment, size_t segment_len, hl7val_segment_t *out) {
+    return tokenize_segment(segment, segment_len, out, '|', '^', '~');
+}
+
+static int tokenize_generic(const char *segment, size_t segment_len, hl7val_segment_t *out,
+                            const hl7val_delims_t *d) {
+    return tokenize_segment(segment, segment_len, out, d->field, d->component, d->repetition);
+}
+
+int hl7val_parse_segment(const char *segment, size_t segment_len, hl7val_segment_t *out) {
+    return hl7val_parse_segment_ex(segment, segment_len, NULL, out);
+}
+
+static int parse_segment_impl(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                              hl7val_segment_t *out) {
+    if (!out || !segment) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+
+    hl7val_delims_t d;
+    int ret = resolve_delims(segment, segment_len, delims, &d, NULL);
+    if (ret == HL7VAL_SUCCESS) {
+        ret = check_segment_header(segment, segment_len, d.field, NULL);
+    }
+    if (ret != HL7VAL_SUCCESS) {
+        return ret;
+    }
+
+    out->delims = d;
+    if (d.field == '|' && d.component == '^' && d.repetition == '~') {
+        return tokenize_default(segment, segment_len, out);
+    }
+    return tokenize_generic(segment, segment_len, out, &d);
+}
+
+int hl7val_parse_segment_ex(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                            hl7val_segment_t *out) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_PARSE_SEGMENT, segment_len,
+               parse_segment_impl(segment, segment_len, delims, out));
+}
+
+int hl7_parse_segment(const char *segment, size_t segment_len, const hl7val_delims_t *delims,
+                      hl7val_segment_t *out) {
+    return parse_segment_impl(segment, segment_len, delims, out);
+}
+
+int hl7val_field_at(const hl7val_segment_t *seg, int field_num, hl7val_span_t *out) {
+    if (!seg || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    if (field_num < 0 || field_num > seg->field_count) {
+        return HL7VAL_ERR_FIELD_COUNT;
+    }
+    *out = seg->fields[field_num];
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_component_at(const hl7val_segment_t *seg, int field_num, int repetition, int component,
+                        hl7val_span_t *out) {
+    if (!seg || !out) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+    if (field_num < 0 || field_num > seg->field_count || repetition < 1 || component < 1) {
+        return HL7VAL_ERR_FIELD_COUNT;
+    }
+
+    hl7val_span_t f = seg->fields[field_num];
+    uint32_t end = f.start + f.len;
+    uint32_t pos = f.start;
+    int rep = 1;
+    int comp = 1;
+
+    /* Unused encoding characters ('\0') never match */
+    const int cs = seg->delims.component ? (unsigned char)seg->delims.component : -1;
+    const int rs = seg->delims.repetition ? (unsigned char)seg->delims.repetition : -1;
+
+    /* Separators inside the field, from the index or by rescanning it */
+    const uint32_t *sub = seg->subs + seg->sub_first[field_num];
+    const uint32_t *sub_end = seg->subs + seg->sub_first[field_num + 1];
+    int rescan = seg->sub_overflow && field_num >= (memcmp(seg->id, "MSH", 3) == 0 ? 3 : 1);
+    uint32_t scan = f.start;
+
+    for (;;) {
+        uint32_t at;
+        if (rescan) {
+            while (scan < end && (unsigned char)seg->data[scan] != cs && (unsigned char)seg->data[scan] != rs) {
+                scan++;
+            }
+            at = scan++;
+        } else {
+            at = sub < sub_end ? *sub++ : end;
+        }
+
+        if (at >= end) {
+            break;
+        }
+        if (rep == repetition && comp == component) {
+            out->start = pos;
+            out->len = at - pos;
+            return HL7VAL_SUCCESS;
+        }
+        if ((unsigned char)seg->data[at] == rs) {
+            if (rep == repetition) {
+                return HL7VAL_ERR_FIELD_COUNT;  /* component past the end of this repetition */
+            }
+            rep++;
+            comp = 1;
+        } else {
+            comp++;
+        }
+        pos = at + 1;
+    }
+
+    if (rep == repetition && comp == component) {
+        out->start = pos;
+        out->len = end - pos;
+        return HL7VAL_SUCCESS;
+    }
+    return HL7VAL_ERR_FIELD_COUNT;
+}
+
+typedef struct {
+    const char *message;
+    size_t message_len;
+    hl7_segment_sink_fn emit;
+    void *ctx;
+    int want_errors;
+    hl7val_delims_t delims;  /* from the last MSH, or the caller's */
+    size_t line_start;
+    size_t last_cr;
+    uint32_t line;
+} splitter_t;
+
+/* Validate and emit the line ending at `at` (a separator or the end) */
+static int splitter_end_line(splitter_t *sp, size_t at) {
+    const char *message = sp->message;
+
+    int is_sep = at < sp->message_len;
+    if (is_sep && message[at] == '\n' && at == sp->last_cr + 1) {
+        sp->line_start = at + 1;  /* LF of a CRLF pair */
+        return HL7VAL_SUCCESS;
+    }
+
+    size_t start = sp->line_start;
+    size_t end = at;
+    while (start < end && (message[start] == ' ' || message[start] == '\t')) {
+        start++;
+    }
+    while (end > start && (message[end - 1] == ' ' || message[end - 1] == '\t')) {
+        end--;
+    }
 
+    if (end > start) {
+        char error_msg[256] = "";
+        hl7val_segment_result_t r = {0};
+        r.offset = start;
+        r.len = end - start > UINT32_MAX ? UINT32_MAX : (uint32_t)(end - start);
+        r.line = sp->line;
+        memcpy(r.id, message + start, end - start < 3 ? end - start : 3);
+        hl7val_delims_t used;
+        r.status = validate_segment_impl(message + start, end - start, &sp->delims,
+                                         sp->want_errors ? error_msg : NULL, &r.field_count, &used);
+        if (r.status == HL7VAL_SUCCESS) {
+            sp->delims = used;  /* an MSH switches encoding for the segments after it */
+        } else {
+            r.field_count = 0;
+        }
+        int ret = sp->emit(sp->ctx, &r, error_msg);
+        if (ret != HL7VAL_SUCCESS) {
+            return ret;
+        }
+    }
+
+    if (is_sep && message[at] == '\r') {
+        sp->last_cr = at;
+    }
+    sp->line++;
+    sp->line_start = at + 1;
     return HL7VAL_SUCCESS;
 }
+
+/* Documented in hl7val_split.h */
+int hl7_split_message(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                      hl7_segment_sink_fn emit, void *ctx, int want_errors, uint32_t *line_count) {
+    const hl7_scan_set_t set = {{'\r', '\n'}, 2};
+    uint64_t bitmap[HL7_SCAN_WORDS];
+    splitter_t sp = {message, message_len, emit, ctx, want_errors, delims ? *delims : default_delims,
+                     0, (size_t)-2, 1};
+    int ret;
+
+    for (size_t base = 0; base < message_len; base += HL7_SCAN_BLOCK) {
+        size_t n = message_len - base < HL7_SCAN_BLOCK ? message_len - base : HL7_SCAN_BLOCK;
+        hl7_scan_block(message + base, n, &set, bitmap);
+        for (size_t w = 0; w < (n + 63) / 64; w++) {
+            for (uint64_t m = bitmap[w]; m; m &= m - 1) {
+                ret = splitter_end_line(&sp, base + 64 * w + (size_t)__builtin_ctzll(m));
+                if (ret != HL7VAL_SUCCESS) {
+                    return ret;
+                }
+            }
+        }
+    }
+
+    /* Final line without a trailing separator */
+    ret = sp.line_start < message_len ? splitter_end_line(&sp, message_len) : HL7VAL_SUCCESS;
+    if (line_count) {
+        *line_count = sp.line - 1;
+    }
+    return ret;
+}
+
+typedef struct {
+    hl7val_segment_result_t *results;
+    size_t capacity;
+    size_t count;
+} collect_ctx_t;
+
+static int collect_segment(void *arg, const hl7val_segment_result_t *result, const char *error_msg) {
+    (void)error_msg;
+    collect_ctx_t *ctx = arg;
+    if (ctx->count < ctx->capacity) {
+        ctx->results[ctx->count] = *result;
+    }
+    ctx->count++;
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_parse_message(const char *message, size_t message_len, hl7val_segment_result_t *results,
+                         size_t capacity, size_t *segment_count) {
+    return hl7val_parse_message_ex(message, message_len, NULL, results, capacity, segment_count);
+}
+
+static int parse_message_impl(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                              hl7val_segment_result_t *results, size_t capacity, size_t *segment_count) {
+    if (!message || !segment_count || (!results && capacity)) {
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+
+    collect_ctx_t ctx = {results, capacity, 0};
+    hl7_split_message(message, message_len, delims, collect_segment, &ctx, 0, NULL);
+    *segment_count = ctx.count;
+    return ctx.count > capacity ? HL7VAL_ERR_TOO_LARGE : HL7VAL_SUCCESS;
+}
+
+int hl7val_parse_message_ex(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                            hl7val_segment_result_t *results, size_t capacity, size_t *segment_count) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_PARSE_MESSAGE, message_len,
+               parse_message_impl(message, message_len, delims, results, capacity, segment_count));
+}
+
+typedef struct {
+    char *error_msg;
+    size_t segments;
+} first_error_ctx_t;
+
+static int stop_at_error(void *arg, const hl7val_segment_result_t *result, const char *error_msg) {
+    first_error_ctx_t *ctx = arg;
+    ctx->segments++;
+    if (result->status != HL7VAL_SUCCESS) {
+        if (ctx->error_msg) {
+            snprintf(ctx->error_msg, 256, "Line %u: %s", (unsigned int)result->line,
+                     error_msg[0] ? error_msg : hl7val_error_string(result->status));
+        }
+        return result->status;
+    }
+    return HL7VAL_SUCCESS;
+}
+
+int hl7val_validate_message(const char *message, size_t message_len, char *error_msg) {
+    return hl7val_validate_message_ex(message, message_len, NULL, error_msg);
+}
+
+static int validate_message_impl(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                                 char *error_msg) {
+    if (!message) {
+        if (error_msg) {
+            snprintf(error_msg, 256, "Message is NULL");
+        }
+        return HL7VAL_ERR_NULL_INPUT;
+    }
+
+    first_error_ctx_t ctx = {error_msg, 0};
+    int ret = hl7_split_message(message, message_len, delims, stop_at_error, &ctx, error_msg != NULL, NULL);
+    if (ret == HL7VAL_SUCCESS && ctx.segments == 0) {
+        if (error_msg) {
+            snprintf(error_msg, 256, "Message contains no segments");
+        }
+        return HL7VAL_ERR_INVALID_FMT;
+    }
+    return ret;
+}
+
+int hl7val_validate_message_ex(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                               char *error_msg) {
+    STATS_CALL(&hl7_api_stats, HL7_STAT_VALIDATE_MESSAGE, message_len,
+               validate_message_impl(message, message_len, delims, error_msg));
+}
+
+int hl7_validate_message(const char *message, size_t message_len, const hl7val_delims_t *delims,
+                         char *error_msg) {
+    return validate_message_impl(message, message_len, delims, error_msg);
+}
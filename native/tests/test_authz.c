@@ -0,0 +1,228 @@
+#include "../include/libauthz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG  /* Ensure assert() is active even in release builds */
+#include <assert.h>
+
+/* A small hospital: roles, permissions and lab order states as numbered by the caller */
+enum { ADMIN, DOCTOR, NURSE, LAB_TECH, RECEPTIONIST, ROLE_COUNT };
+enum { VIEW_ORDER, CREATE_ORDER, DELETE_ORDER, PERMISSION_COUNT };
+enum { PENDING, COLLECTED, RESULTED, REVIEWED, CANCELLED };
+
+#define ROLE(r) (UINT64_C(1) << (r))
+#define STATE(s) (UINT64_C(1) << (s))
+
+static authz_policy_t* hospital_policy(void) {
+    authz_policy_t *policy;
+    assert(authz_policy_new(ROLE_COUNT, PERMISSION_COUNT, &policy) == AUTHZ_SUCCESS);
+    authz_grant_t grants[] = {
+        {ADMIN, VIEW_ORDER, AUTHZ_ALL_STATES, 0},
+        {DOCTOR, VIEW_ORDER, 0, AUTHZ_ALL_STATES},
+        {NURSE, VIEW_ORDER, AUTHZ_ALL_STATES, 0},
+        {LAB_TECH, VIEW_ORDER, STATE(PENDING) | STATE(COLLECTED) | STATE(RESULTED), 0},
+        {ADMIN, CREATE_ORDER, AUTHZ_ALL_STATES, 0},
+        {DOCTOR, CREATE_ORDER, AUTHZ_ALL_STATES, 0},
+        {ADMIN, DELETE_ORDER, AUTHZ_ALL_STATES, 0},
+    };
+    assert(authz_policy_set(policy, grants, sizeof(grants) / sizeof(grants[0])) == AUTHZ_SUCCESS);
+    return policy;
+}
+
+void test_can() {
+    authz_policy_t *policy = hospital_policy();
+    assert(authz_can(policy, ROLE(ADMIN), DELETE_ORDER) == 1);
+    assert(authz_can(policy, ROLE(DOCTOR), CREATE_ORDER) == 1);
+    assert(authz_can(policy, ROLE(DOCTOR), DELETE_ORDER) == 0);
+    assert(authz_can(policy, ROLE(LAB_TECH), CREATE_ORDER) == 0);
+
+    /* Grants only on owned objects still count */
+    assert(authz_can(policy, ROLE(DOCTOR), VIEW_ORDER) == 1);
+    assert(authz_can(policy, ROLE(RECEPTIONIST), VIEW_ORDER) == 0);
+
+    /* Any of several roles; none; bits past the role count */
+    assert(authz_can(policy, ROLE(RECEPTIONIST) | ROLE(ADMIN), DELETE_ORDER) == 1);
+    assert(authz_can(policy, 0, VIEW_ORDER) == 0);
+    assert(authz_can(policy, ~UINT64_C(0) << ROLE_COUNT, VIEW_ORDER) == 0);
+
+    /* Fails closed */
+    assert(authz_can(policy, ROLE(ADMIN), PERMISSION_COUNT) == 0);
+    assert(authz_can(NULL, ROLE(ADMIN), VIEW_ORDER) == 0);
+
+    authz_policy_free(policy);
+    printf("✓ test_can passed\n");
+}
+
+void test_scope() {
+    authz_policy_t *policy = hospital_policy();
+    uint64_t states;
+    uint64_t own;
+
+    assert(authz_scope(policy, ROLE(ADMIN), VIEW_ORDER, &states, &own) == AUTHZ_SUCCESS);
+    assert(states == AUTHZ_ALL_STATES && own == 0);
+    assert(authz_scope(policy, ROLE(DOCTOR), VIEW_ORDER, &states, &own) == AUTHZ_SUCCESS);
+    assert(states == 0 && own == AUTHZ_ALL_STATES);
+    assert(authz_scope(policy, ROLE(RECEPTIONIST), VIEW_ORDER, &states, &own) == AUTHZ_SUCCESS);
+    assert(states == 0 && own == 0);
+
+    /* The union over roles; ownership adds only what the other roles lack */
+    assert(authz_scope(policy, ROLE(DOCTOR) | ROLE(LAB_TECH), VIEW_ORDER, &states, &own) == AUTHZ_SUCCESS);
+    assert(states == (STATE(PENDING) | STATE(COLLECTED) | STATE(RESULTED)));
+    assert(own == (AUTHZ_ALL_STATES & ~states));
+
+    assert(authz_scope(policy, ROLE(ADMIN), PERMISSION_COUNT, &states, &own) == AUTHZ_ERR_INVALID_SIZE);
+    assert(authz_scope(policy, ROLE(ADMIN), VIEW_ORDER, NULL, &own) == AUTHZ_ERR_NULL_INPUT);
+    assert(authz_scope(NULL, ROLE(ADMIN), VIEW_ORDER, &states, &own) == AUTHZ_ERR_NULL_INPUT);
+
+    authz_policy_free(policy);
+    printf("✓ test_scope passed\n");
+}
+
+void test_filter() {
+    authz_policy_t *policy = hospital_policy();
+    const uint8_t states[] = {PENDING, REVIEWED, RESULTED, CANCELLED, COLLECTED, 200};
+    const int64_t owners[] = {7, 7, 8, 8, AUTHZ_NO_OWNER, 7};
+    uint64_t allowed[1];
+    size_t count;
+
+    assert(authz_filter(policy, ROLE(LAB_TECH), VIEW_ORDER, 7, states, owners, 6, allowed, &count) ==
+           AUTHZ_SUCCESS);
+    assert(allowed[0] == 0x15 && count == 3);
+
+    /* The doctor's own orders, in any state but one out of range */
+    assert(authz_filter(policy, ROLE(DOCTOR), VIEW_ORDER, 7, states, owners, 6, allowed, &count) == AUTHZ_SUCCESS);
+    assert(allowed[0] == 0x03 && count == 2);
+    assert(authz_filter(policy, ROLE(DOCTOR), VIEW_ORDER, 8, states, owners, 6, allowed, &count) == AUTHZ_SUCCESS);
+    assert(allowed[0] == 0x0C && count == 2);
+
+    /* No owners, or a subject that owns nothing: ownership never matches */
+    assert(authz_filter(policy, ROLE(DOCTOR), VIEW_ORDER, 7, states, NULL, 6, allowed, &count) == AUTHZ_SUCCESS);
+    assert(allowed[0] == 0 && count == 0);
+    assert(authz_filter(policy, ROLE(DOCTOR), VIEW_ORDER, AUTHZ_NO_OWNER, states, owners, 6, allowed, NULL) ==
+           AUTHZ_SUCCESS);
+    assert(allowed[0] == 0);
+
+    assert(authz_filter(policy, ROLE(ADMIN), VIEW_ORDER, 0, states, NULL, 6, allowed, &count) == AUTHZ_SUCCESS);
+    assert(allowed[0] == 0x1F && count == 5);
+
+    /* Empty batches need no buffers */
+    assert(authz_filter(policy, ROLE(ADMIN), VIEW_ORDER, 0, NULL, NULL, 0, NULL, &count) == AUTHZ_SUCCESS);
+    assert(count == 0);
+    assert(authz_filter(policy, ROLE(ADMIN), VIEW_ORDER, 0, NULL, NULL, 1, allowed, NULL) == AUTHZ_ERR_NULL_INPUT);
+    assert(authz_filter(policy, ROLE(ADMIN), PERMISSION_COUNT, 0, states, NULL, 6, allowed, NULL) ==
+           AUTHZ_ERR_INVALID_SIZE);
+
+    authz_policy_free(policy);
+    printf("✓ test_filter passed\n");
+}
+
+/* Many words, with a partial last one: check each bit against the rule */
+void test_filter_batch() {
+    authz_policy_t *policy = hospital_policy();
+    const size_t n = 1000;
+    uint8_t *states = malloc(n);
+    int64_t *owners = malloc(n * sizeof(*owners));
+    uint64_t *allowed = malloc(((n + 63) / 64) * sizeof(*allowed));
+    assert(states && owners && allowed);
+    for (size_t i = 0; i < n; i++) {
+        states[i] = (uint8_t)(i % 5);
+        owners[i] = (int64_t)(i % 3);
+    }
+
+    size_t count;
+    uint64_t roles = ROLE(DOCTOR) | ROLE(LAB_TECH);
+    assert(authz_filter(policy, roles, VIEW_ORDER, 1, states, owners, n, allowed, &count) == AUTHZ_SUCCESS);
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        int ok = states[i] == PENDING || states[i] == COLLECTED || states[i] == RESULTED || owners[i] == 1;
+        assert((int)((allowed[i / 64] >> (i % 64)) & 1) == ok);
+        expected += (size_t)ok;
+    }
+    assert(count == expected);
+    assert((allowed[n / 64] >> (n % 64)) == 0);  /* Bits past the batch stay clear */
+
+    free(states);
+    free(owners);
+    free(allowed);
+    authz_policy_free(policy);
+    printf("✓ test_filter_batch passed\n");
+}
+
+void test_update() {
+    authz_policy_t *policy = hospital_policy();
+    authz_policy_t *copy;
+    assert(authz_policy_copy(policy, &copy) == AUTHZ_SUCCESS);
+
+    /* Change the copy only: revoke one cell, widen another, grant a new one */
+    authz_grant_t changes[] = {
+        {DOCTOR, CREATE_ORDER, 0, 0},
+        {LAB_TECH, VIEW_ORDER, AUTHZ_ALL_STATES, 0},
+        {RECEPTIONIST, VIEW_ORDER, 0, 0},
+        {RECEPTIONIST, VIEW_ORDER, STATE(PENDING), 0},  /* The later grant wins */
+    };
+    assert(authz_policy_set(copy, changes, 4) == AUTHZ_SUCCESS);
+    assert(authz_can(copy, ROLE(DOCTOR), CREATE_ORDER) == 0);
+    assert(authz_can(copy, ROLE(ADMIN), CREATE_ORDER) == 1);
+    assert(authz_can(copy, ROLE(RECEPTIONIST), VIEW_ORDER) == 1);
+    uint64_t states;
+    uint64_t own;
+    assert(authz_scope(copy, ROLE(LAB_TECH), VIEW_ORDER, &states, &own) == AUTHZ_SUCCESS);
+    assert(states == AUTHZ_ALL_STATES);
+
+    assert(authz_can(policy, ROLE(DOCTOR), CREATE_ORDER) == 1);
+    assert(authz_can(policy, ROLE(RECEPTIONIST), VIEW_ORDER) == 0);
+
+    /* A bad grant leaves the policy as it was */
+    authz_grant_t bad[] = {{ADMIN, CREATE_ORDER, 0, 0}, {ROLE_COUNT, VIEW_ORDER, AUTHZ_ALL_STATES, 0}};
+    assert(authz_policy_set(copy, bad, 2) == AUTHZ_ERR_INVALID_SIZE);
+    assert(authz_can(copy, ROLE(ADMIN), CREATE_ORDER) == 1);
+    bad[1] = (authz_grant_t){ADMIN, PERMISSION_COUNT, AUTHZ_ALL_STATES, 0};
+    assert(authz_policy_set(copy, bad, 2) == AUTHZ_ERR_INVALID_SIZE);
+    assert(authz_policy_set(copy, NULL, 1) == AUTHZ_ERR_NULL_INPUT);
+    assert(authz_policy_set(copy, NULL, 0) == AUTHZ_SUCCESS);
+
+    authz_policy_free(copy);
+    authz_policy_free(policy);
+    printf("✓ test_update passed\n");
+}
+
+void test_limits() {
+    authz_policy_t *policy;
+    assert(authz_policy_new(0, 1, &policy) == AUTHZ_ERR_INVALID_SIZE);
+    assert(authz_policy_new(AUTHZ_MAX_ROLES + 1, 1, &policy) == AUTHZ_ERR_INVALID_SIZE);
+    assert(authz_policy_new(1, 0, &policy) == AUTHZ_ERR_INVALID_SIZE);
+    assert(authz_policy_new(1, 1, NULL) == AUTHZ_ERR_NULL_INPUT);
+    assert(authz_policy_copy(NULL, &policy) == AUTHZ_ERR_NULL_INPUT);
+
+    /* The last role bit */
+    assert(authz_policy_new(AUTHZ_MAX_ROLES, 2, &policy) == AUTHZ_SUCCESS);
+    authz_grant_t grant = {AUTHZ_MAX_ROLES - 1, 1, STATE(AUTHZ_MAX_STATES - 1), 0};
+    assert(authz_policy_set(policy, &grant, 1) == AUTHZ_SUCCESS);
+    assert(authz_can(policy, ROLE(AUTHZ_MAX_ROLES - 1), 1) == 1);
+    assert(authz_can(policy, ROLE(AUTHZ_MAX_ROLES - 1), 0) == 0);
+    uint8_t state = AUTHZ_MAX_STATES - 1;
+    uint64_t allowed;
+    assert(authz_filter(policy, UINT64_MAX, 1, 0, &state, NULL, 1, &allowed, NULL) == AUTHZ_SUCCESS);
+    assert(allowed == 1);
+    authz_policy_free(policy);
+    authz_policy_free(NULL);
+
+    assert(strcmp(authz_error_string(AUTHZ_SUCCESS), "Success") == 0);
+    assert(strcmp(authz_error_string(AUTHZ_ERR_MEMORY), "Memory allocation failed") == 0);
+    assert(strcmp(authz_error_string(12345), "Unknown error") == 0);
+    printf("✓ test_limits passed\n");
+}
+
+int main() {
+    printf("Running authorization tests...\n");
+
+    test_can();
+    test_scope();
+    test_filter();
+    test_filter_batch();
+    test_update();
+    test_limits();
+
+    printf("\nAll tests passed! ✓\n");
+    return 0;
+}
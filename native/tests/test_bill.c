@@ -0,0 +1,230 @@
+#include "../include/libbill.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG  /* Ensure assert() is active even in release builds */
+#include <assert.h>
+
+static int64_t parse(const char *text, unsigned int scale, int expect) {
+    int64_t value = 12345;
+    int result = bill_parse_fixed(text, strlen(text), scale, &value);
+    assert(result == expect);
+    return value;
+}
+
+void test_parse_fixed() {
+    assert(parse("12.50", 2, BILL_SUCCESS) == 1250);
+    assert(parse("-0.05", 2, BILL_SUCCESS) == -5);
+    assert(parse("+7", 2, BILL_SUCCESS) == 700);
+    assert(parse("0", 2, BILL_SUCCESS) == 0);
+    assert(parse("-0.00", 2, BILL_SUCCESS) == 0);
+    assert(parse(".5", 2, BILL_SUCCESS) == 50);
+    assert(parse("5.", 2, BILL_SUCCESS) == 500);
+    assert(parse("0.160000", 6, BILL_SUCCESS) == 160000);
+
+    /* Exponent forms str(Decimal) uses */
+    assert(parse("1E+2", 2, BILL_SUCCESS) == 10000);
+    assert(parse("5.0E-1", 2, BILL_SUCCESS) == 50);
+    assert(parse("1e-2", 2, BILL_SUCCESS) == 1);
+    assert(parse("0E-8", 2, BILL_SUCCESS) == 0);
+    assert(parse("0E+100000000", 2, BILL_SUCCESS) == 0);
+
+    /* Trailing zeros past the scale are exact; other digits are not rounded */
+    assert(parse("1.2300000000000000000000000000000000000000000000000", 2, BILL_SUCCESS) == 123);
+    assert(parse("0.0000000000000000000000000000000000000000000001E+46", 2, BILL_SUCCESS) == 100);
+    parse("1.005", 2, BILL_ERR_INVALID_FMT);
+    parse("1E-3", 2, BILL_ERR_INVALID_FMT);
+    parse("1E-100", 2, BILL_ERR_INVALID_FMT);
+
+    /* int64 bounds */
+    assert(parse("92233720368547758.07", 2, BILL_SUCCESS) == INT64_MAX);
+    assert(parse("-92233720368547758.08", 2, BILL_SUCCESS) == INT64_MIN);
+    parse("92233720368547758.08", 2, BILL_ERR_OVERFLOW);
+    parse("1E+100", 2, BILL_ERR_OVERFLOW);
+    parse("123456789012345678901234567890123456789012345", 0, BILL_ERR_OVERFLOW);
+
+    parse("", 2, BILL_ERR_INVALID_FMT);
+    parse("-", 2, BILL_ERR_INVALID_FMT);
+    parse(".", 2, BILL_ERR_INVALID_FMT);
+    parse("1.2.3", 2, BILL_ERR_INVALID_FMT);
+    parse("1E", 2, BILL_ERR_INVALID_FMT);
+    parse("1E+", 2, BILL_ERR_INVALID_FMT);
+    parse(" 1", 2, BILL_ERR_INVALID_FMT);
+    parse("1 ", 2, BILL_ERR_INVALID_FMT);
+    parse("NaN", 2, BILL_ERR_INVALID_FMT);
+    parse("Infinity", 2, BILL_ERR_INVALID_FMT);
+    parse("1", BILL_MAX_SCALE + 1, BILL_ERR_INVALID_SIZE);
+    assert(bill_parse_fixed(NULL, 0, 2, &(int64_t){0}) == BILL_ERR_NULL_INPUT);
+
+    /* Length bounds the text: "12" of "123" */
+    int64_t value;
+    assert(bill_parse_fixed("123", 2, 2, &value) == BILL_SUCCESS && value == 1200);
+    printf("✓ test_parse_fixed passed\n");
+}
+
+void test_format_fixed() {
+    char buf[BILL_FIXED_BUF_SIZE];
+    size_t len;
+    assert(bill_format_fixed(1250, 2, buf, sizeof(buf), &len) == BILL_SUCCESS);
+    assert(strcmp(buf, "12.50") == 0 && len == 5);
+    assert(bill_format_fixed(-5, 2, buf, sizeof(buf), NULL) == BILL_SUCCESS && strcmp(buf, "-0.05") == 0);
+    assert(bill_format_fixed(0, 2, buf, sizeof(buf), NULL) == BILL_SUCCESS && strcmp(buf, "0.00") == 0);
+    assert(bill_format_fixed(0, 0, buf, sizeof(buf), NULL) == BILL_SUCCESS && strcmp(buf, "0") == 0);
+    assert(bill_format_fixed(42, 0, buf, sizeof(buf), NULL) == BILL_SUCCESS && strcmp(buf, "42") == 0);
+    assert(bill_format_fixed(INT64_MIN, 2, buf, sizeof(buf), NULL) == BILL_SUCCESS);
+    assert(strcmp(buf, "-92233720368547758.08") == 0);
+    assert(bill_format_fixed(INT64_MIN, BILL_MAX_SCALE, buf, sizeof(buf), NULL) == BILL_SUCCESS);
+    assert(strcmp(buf, "-9.223372036854775808") == 0);
+    assert(bill_format_fixed(-5, BILL_MAX_SCALE, buf, sizeof(buf), NULL) == BILL_SUCCESS);
+    assert(strcmp(buf, "-0.000000000000000005") == 0);
+
+    /* Round trip */
+    int64_t samples[] = {0, 1, -1, 99, 100, -100, 123456789, INT64_MAX, INT64_MIN};
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        for (unsigned int scale = 0; scale <= BILL_MAX_SCALE; scale++) {
+            int64_t back;
+            assert(bill_format_fixed(samples[i], scale, buf, sizeof(buf), &len) == BILL_SUCCESS);
+            assert(bill_parse_fixed(buf, len, scale, &back) == BILL_SUCCESS && back == samples[i]);
+        }
+    }
+
+    assert(bill_format_fixed(1250, 2, buf, 5, NULL) == BILL_ERR_INVALID_SIZE);
+    assert(bill_format_fixed(1250, 2, buf, 6, NULL) == BILL_SUCCESS);
+    assert(bill_format_fixed(1, BILL_MAX_SCALE + 1, buf, sizeof(buf), NULL) == BILL_ERR_INVALID_SIZE);
+    assert(bill_format_fixed(1, 2, NULL, 0, NULL) == BILL_ERR_NULL_INPUT);
+    printf("✓ test_format_fixed passed\n");
+}
+
+void test_totals() {
+    bill_invoice_t invoices[] = {
+        {.tax = 150, .discount = 200, .paid = 1000},                 /* Fixed amounts, as in the model */
+        {.paid = 0},                                                 /* No items */
+        {.discount_rate = 100000, .tax_rate = 160000},               /* 10% off, then 16% tax */
+        {.tax = 1, .discount = 5000, .tax_rate = 160000},            /* Discount above the subtotal */
+        {.tax_rate = 50000},                                         /* Half-cent ties */
+        {.tax_rate = 50000, .paid = 100},
+    };
+    bill_item_t items[] = {
+        {.invoice = 2, .quantity = 3, .unit_price = 1999},
+        {.invoice = 0, .quantity = 2, .unit_price = 2550},
+        {.invoice = 0, .quantity = 1, .unit_price = 499},
+        {.invoice = 3, .quantity = 1, .unit_price = 1000},
+        {.invoice = 4, .quantity = 1, .unit_price = 10},             /* 0.10 x 5% = 0.005 -> 0.01 */
+        {.invoice = 5, .quantity = 1, .unit_price = -10},            /* Negative subtotal: nothing taxable */
+        {.invoice = 2, .quantity = 0, .unit_price = 123456},
+    };
+    size_t n = sizeof(invoices) / sizeof(invoices[0]);
+    bill_totals_t out[6];
+
+    assert(bill_totals(invoices, n, items, sizeof(items) / sizeof(items[0]), out) == BILL_SUCCESS);
+    assert(out[0].subtotal == 5599 && out[0].tax == 150 && out[0].discount == 200);
+    assert(out[0].total == 5549 && out[0].balance == 4549);
+    assert(out[1].subtotal == 0 && out[1].total == 0 && out[1].balance == 0);
+    /* 59.97 - 6.00 (5.997) = 53.97, tax 8.6352 -> 8.64 */
+    assert(out[2].subtotal == 5997 && out[2].discount == 600 && out[2].tax == 864);
+    assert(out[2].total == 6261 && out[2].balance == 6261);
+    assert(out[3].subtotal == 1000 && out[3].discount == 5000 && out[3].tax == 1);
+    assert(out[3].total == -3999);
+    assert(out[4].tax == 1 && out[4].total == 11);
+    assert(out[5].tax == 0 && out[5].total == -10 && out[5].balance == -110);
+
+    /* Negative proportional parts round away from zero too */
+    bill_invoice_t credit = {.discount_rate = 50000};
+    bill_item_t refund = {.invoice = 0, .quantity = 1, .unit_price = -10};
+    assert(bill_totals(&credit, 1, &refund, 1, out) == BILL_SUCCESS);
+    assert(out[0].discount == -1 && out[0].total == -9);
+
+    /* Nothing to do */
+    assert(bill_totals(NULL, 0, NULL, 0, NULL) == BILL_SUCCESS);
+    printf("✓ test_totals passed\n");
+}
+
+void test_totals_errors() {
+    bill_invoice_t invoice = {0};
+    bill_totals_t out;
+    bill_item_t item = {.invoice = 1, .quantity = 1, .unit_price = 1};
+    assert(bill_totals(&invoice, 1, &item, 1, &out) == BILL_ERR_INVALID_SIZE);
+
+    item = (bill_item_t){.invoice = 0, .quantity = UINT32_MAX, .unit_price = INT64_MAX / 2};
+    assert(bill_totals(&invoice, 1, &item, 1, &out) == BILL_ERR_OVERFLOW);
+
+    bill_item_t pair[] = {{0, 1, INT64_MAX}, {0, 1, 1}};
+    assert(bill_totals(&invoice, 1, pair, 2, &out) == BILL_ERR_OVERFLOW);
+
+    bill_invoice_t paid = {.paid = INT64_MIN};
+    assert(bill_totals(&paid, 1, NULL, 0, &out) == BILL_ERR_OVERFLOW);
+
+    bill_invoice_t near_max = {.tax = INT64_MAX};
+    bill_item_t one = {0, 1, 1};
+    assert(bill_totals(&near_max, 1, &one, 1, &out) == BILL_ERR_OVERFLOW);
+
+    /* The largest subtotal still takes a full rate without overflowing the product */
+    bill_invoice_t full = {.discount_rate = BILL_RATE_SCALE};
+    bill_item_t max = {0, 1, INT64_MAX};
+    assert(bill_totals(&full, 1, &max, 1, &out) == BILL_SUCCESS);
+    assert(out.discount == INT64_MAX && out.total == 0);
+
+    bill_invoice_t rate = {.tax_rate = BILL_RATE_SCALE + 1};
+    assert(bill_totals(&rate, 1, NULL, 0, &out) == BILL_ERR_INVALID_SIZE);
+
+    assert(bill_totals(NULL, 1, NULL, 0, &out) == BILL_ERR_NULL_INPUT);
+    assert(bill_totals(&invoice, 1, NULL, 1, &out) == BILL_ERR_NULL_INPUT);
+    assert(bill_totals(&invoice, 1, NULL, 0, NULL) == BILL_ERR_NULL_INPUT);
+    assert(strcmp(bill_error_string(BILL_ERR_OVERFLOW), "Amount out of range") == 0);
+    printf("✓ test_totals_errors passed\n");
+}
+
+/* Many invoices in one call, against a direct per-invoice reference */
+void test_totals_batch() {
+    enum { INVOICES = 20000, PER_INVOICE = 7 };
+    bill_invoice_t *invoices = calloc(INVOICES, sizeof(*invoices));
+    bill_item_t *items = calloc((size_t)INVOICES * PER_INVOICE, sizeof(*items));
+    bill_totals_t *out = calloc(INVOICES, sizeof(*out));
+    assert(invoices && items && out);
+
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    size_t n = 0;
+    for (uint32_t i = 0; i < INVOICES; i++) {
+        invoices[i] = (bill_invoice_t){.tax = i % 500, .discount = i % 300, .paid = i % 7 ? 0 : 1000,
+                                       .discount_rate = (i % 4) * 25000, .tax_rate = (i % 3) * 80000};
+        for (uint32_t k = 0; k < PER_INVOICE; k++) {
+            state = state * 6364136223846793005u + 1442695040888963407u;
+            /* Interleave invoices so accumulation order is not sequential */
+            items[n++] = (bill_item_t){.invoice = (i + k * 7919) % INVOICES, .quantity = (uint32_t)(state >> 60),
+                                       .unit_price = (int64_t)((state >> 20) % 10000000)};
+        }
+    }
+    assert(bill_totals(invoices, INVOICES, items, n, out) == BILL_SUCCESS);
+
+    int64_t *subtotals = calloc(INVOICES, sizeof(*subtotals));
+    assert(subtotals);
+    for (size_t k = 0; k < n; k++) {
+        subtotals[items[k].invoice] += (int64_t)items[k].quantity * items[k].unit_price;
+    }
+    for (uint32_t i = 0; i < INVOICES; i++) {
+        int64_t s = subtotals[i];
+        int64_t d = invoices[i].discount + (s * invoices[i].discount_rate + BILL_RATE_SCALE / 2) / BILL_RATE_SCALE;
+        int64_t taxable = s - d > 0 ? s - d : 0;
+        int64_t t = invoices[i].tax + (taxable * invoices[i].tax_rate + BILL_RATE_SCALE / 2) / BILL_RATE_SCALE;
+        assert(out[i].subtotal == s && out[i].discount == d && out[i].tax == t);
+        assert(out[i].total == s + t - d && out[i].balance == out[i].total - invoices[i].paid);
+    }
+    free(subtotals);
+    free(out);
+    free(items);
+    free(invoices);
+    printf("✓ test_totals_batch passed\n");
+}
+
+int main() {
+    printf("Running billing tests...\n");
+
+    test_parse_fixed();
+    test_format_fixed();
+    test_totals();
+    test_totals_errors();
+    test_totals_batch();
+
+    printf("\nAll tests passed! ✓\n");
+    return 0;
+}
@@ -1,6 +1,14 @@
 #include "../include/libcutils.h"
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #undef NDEBUG  /* Ensure assert() is active even in release builds */
 #include <assert.h>
 
@@ -33,6 +41,245 @@ void test_aes_gcm_encryption() {
     printf("✓ test_aes_gcm_encryption passed\n");
 }
 
+void test_aes_gcm_key_switch() {
+    uint8_t key_a[CUTILS_AES_KEY_SIZE];
+    uint8_t key_b[CUTILS_AES_KEY_SIZE];
+    const char *plaintext = "123456789";
+    uint8_t ct_a[64], ct_b[64], out[64];
+    size_t ct_a_len = sizeof(ct_a), ct_b_len = sizeof(ct_b), out_len;
+
+    assert(cutils_generate_token(key_a) == CUTILS_SUCCESS);
+    assert(cutils_generate_token(key_b) == CUTILS_SUCCESS);
+
+    assert(cutils_aes_gcm_encrypt((uint8_t*)plaintext, strlen(plaintext),
+                                  key_a, ct_a, &ct_a_len) == CUTILS_SUCCESS);
+    assert(cutils_aes_gcm_encrypt((uint8_t*)plaintext, strlen(plaintext),
+                                  key_b, ct_b, &ct_b_len) == CUTILS_SUCCESS);
+
+    /* Cached key schedule must follow the key actually passed in */
+    out_len = sizeof(out);
+    assert(cutils_aes_gcm_decrypt(ct_a, ct_a_len, key_b, out, &out_len) == CUTILS_ERR_CRYPTO);
+    out_len = sizeof(out);
+    assert(cutils_aes_gcm_decrypt(ct_a, ct_a_len, key_a, out, &out_len) == CUTILS_SUCCESS);
+    assert(out_len == strlen(plaintext) && memcmp(out, plaintext, out_len) == 0);
+
+    /* A failed tag check must not poison the cached context */
+    ct_b[ct_b_len - 1] ^= 0x01;
+    out_len = sizeof(out);
+    assert(cutils_aes_gcm_decrypt(ct_b, ct_b_len, key_b, out, &out_len) == CUTILS_ERR_CRYPTO);
+    ct_b[ct_b_len - 1] ^= 0x01;
+    out_len = sizeof(out);
+    assert(cutils_aes_gcm_decrypt(ct_b, ct_b_len, key_b, out, &out_len) == CUTILS_SUCCESS);
+    assert(out_len == strlen(plaintext) && memcmp(out, plaintext, out_len) == 0);
+
+    /* Empty plaintext round-trips to a bare IV || tag */
+    ct_a_len = sizeof(ct_a);
+    assert(cutils_aes_gcm_encrypt((uint8_t*)"", 0, key_a, ct_a, &ct_a_len) == CUTILS_SUCCESS);
+    assert(ct_a_len == CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE);
+    out_len = sizeof(out);
+    assert(cutils_aes_gcm_decrypt(ct_a, ct_a_len, key_a, out, &out_len) == CUTILS_SUCCESS);
+    assert(out_len == 0);
+
+    printf("✓ test_aes_gcm_key_switch passed\n");
+}
+
+static void* aes_gcm_thread_worker(void *arg) {
+    const uint8_t *key = arg;
+    uint8_t ct[64], out[64];
+    for (int i = 0; i < 1000; i++) {
+        char plaintext[16];
+        int n = snprintf(plaintext, sizeof(plaintext), "%09d", i);
+        size_t ct_len = sizeof(ct), out_len = sizeof(out);
+        if (cutils_aes_gcm_encrypt((uint8_t*)plaintext, n, key, ct, &ct_len) != CUTILS_SUCCESS ||
+            cutils_aes_gcm_decrypt(ct, ct_len, key, out, &out_len) != CUTILS_SUCCESS ||
+            out_len != (size_t)n || memcmp(out, plaintext, n) != 0) {
+            return (void*)1;
+        }
+    }
+    return NULL;
+}
+
+void test_aes_gcm_threads() {
+    enum { NUM_THREADS = 4 };
+    uint8_t keys[NUM_THREADS][CUTILS_AES_KEY_SIZE];
+    pthread_t threads[NUM_THREADS];
+
+    for (int i = 0; i < NUM_THREADS; i++) {
+        assert(cutils_generate_token(keys[i]) == CUTILS_SUCCESS);
+        assert(pthread_create(&threads[i], NULL, aes_gcm_thread_worker, keys[i]) == 0);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        void *res = NULL;
+        assert(pthread_join(threads[i], &res) == 0);
+        assert(res == NULL);
+    }
+
+    printf("✓ test_aes_gcm_threads passed\n");
+}
+
+void test_key_handle() {
+    uint8_t raw_key[CUTILS_AES_KEY_SIZE];
+    uint8_t other_key[CUTILS_AES_KEY_SIZE];
+    cutils_key_t *key = NULL;
+    cutils_key_t *other = NULL;
+    const char *plaintext = "987654321";
+    uint8_t ct[64], out[64];
+    size_t ct_len = sizeof(ct), out_len = sizeof(out);
+
+    assert(cutils_generate_token(raw_key) == CUTILS_SUCCESS);
+    assert(cutils_generate_token(other_key) == CUTILS_SUCCESS);
+    assert(cutils_key_new(NULL, &key) == CUTILS_ERR_NULL_INPUT);
+    assert(cutils_key_new(raw_key, &key) == CUTILS_SUCCESS && key);
+    assert(cutils_key_new(other_key, &other) == CUTILS_SUCCESS && other);
+
+    /* Handle output is interchangeable with the raw-key API */
+    assert(cutils_key_encrypt(key, (uint8_t*)plaintext, strlen(plaintext), ct, &ct_len) == CUTILS_SUCCESS);
+    assert(cutils_aes_gcm_decrypt(ct, ct_len, raw_key, out, &out_len) == CUTILS_SUCCESS);
+    assert(out_len == strlen(plaintext) && memcmp(out, plaintext, out_len) == 0);
+
+    ct_len = sizeof(ct);
+    assert(cutils_aes_gcm_encrypt((uint8_t*)plaintext, strlen(plaintext), raw_key, ct, &ct_len) == CUTILS_SUCCESS);
+    out_len = sizeof(out);
+    assert(cutils_key_decrypt(key, ct, ct_len, out, &out_len) == CUTILS_SUCCESS);
+    assert(out_len == strlen(plaintext) && memcmp(out, plaintext, out_len) == 0);
+
+    /* Alternating handles on one thread must not mix up key schedules */
+    out_len = sizeof(out);
+    assert(cutils_key_decrypt(other, ct, ct_len, out, &out_len) == CUTILS_ERR_CRYPTO);
+    out_len = sizeof(out);
+    assert(cutils_key_decrypt(key, ct, ct_len, out, &out_len) == CUTILS_SUCCESS);
+
+    /* Buffer checks match the raw-key API */
+    out_len = 2;
+    assert(cutils_key_decrypt(key, ct, ct_len, out, &out_len) == CUTILS_ERR_BUFFER_SIZE);
+    ct_len = 8;
+    assert(cutils_key_encrypt(key, (uint8_t*)plaintext, strlen(plaintext), ct, &ct_len) == CUTILS_ERR_BUFFER_SIZE);
+
+    cutils_key_free(key);
+    cutils_key_free(other);
+    cutils_key_free(NULL);
+
+    printf("✓ test_key_handle passed\n");
+}
+
+void test_aes_gcm_batch() {
+    uint8_t raw_key[CUTILS_AES_KEY_SIZE];
+    cutils_key_t *key = NULL;
+    enum { COUNT = 130 };  /* spans more than one IV block */
+    char plaintexts[COUNT][16];
+    cutils_buf_t inputs[COUNT];
+    cutils_batch_result_t results[COUNT];
+
+    assert(cutils_generate_token(raw_key) == CUTILS_SUCCESS);
+    assert(cutils_key_new(raw_key, &key) == CUTILS_SUCCESS);
+
+    for (int i = 0; i < COUNT; i++) {
+        int n = snprintf(plaintexts[i], sizeof(plaintexts[i]), "%d", i * 7919);
+        inputs[i].data = (uint8_t*)plaintexts[i];
+        inputs[i].len = n;
+    }
+    inputs[5].data = NULL;
+    inputs[5].len = 3;  /* invalid record must not stop the batch */
+
+    size_t enc_size = cutils_aes_gcm_batch_size(1, inputs, COUNT);
+    uint8_t *enc = malloc(enc_size);
+    assert(enc);
+    assert(cutils_aes_gcm_encrypt_many(raw_key, inputs, COUNT, enc, enc_size - 1, results) == CUTILS_ERR_BUFFER_SIZE);
+    assert(cutils_aes_gcm_encrypt_many(raw_key, inputs, COUNT, enc, enc_size, results) == CUTILS_SUCCESS);
+    assert(results[5].status == CUTILS_ERR_NULL_INPUT && results[5].len == 0);
+
+    cutils_buf_t cts[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        if (i != 5) {
+            assert(results[i].status == CUTILS_SUCCESS);
+            assert(results[i].len == inputs[i].len + CUTILS_AES_IV_SIZE + CUTILS_AES_TAG_SIZE);
+            /* Distinct records must get distinct IVs */
+            if (i > 0 && i != 6) {
+                assert(memcmp(enc + results[i].offset, enc + results[i - 1].offset, CUTILS_AES_IV_SIZE) != 0);
+            }
+        }
+        cts[i].data = enc + results[i].offset;
+        cts[i].len = results[i].len;
+    }
+    /* Corrupt one tag */
+    enc[results[9].offset + results[9].len - 1] ^= 0x80;
+
+    size_t dec_size = cutils_aes_gcm_batch_size(0, cts, COUNT);
+    uint8_t *dec = malloc(dec_size ? dec_size : 1);
+    assert(dec);
+    assert(cutils_key_decrypt_many(key, cts, COUNT, dec, dec_size, results) == CUTILS_SUCCESS);
+    for (int i = 0; i < COUNT; i++) {
+        if (i == 5) {
+            assert(results[i].status == CUTILS_ERR_INVALID_SIZE);
+        } else if (i == 9) {
+            assert(results[i].status == CUTILS_ERR_CRYPTO && results[i].len == 0);
+        } else {
+            assert(results[i].status == CUTILS_SUCCESS);
+            assert(results[i].len == inputs[i].len);
+            assert(memcmp(dec + results[i].offset, plaintexts[i], inputs[i].len) == 0);
+        }
+    }
+
+    assert(cutils_aes_gcm_decrypt_many(raw_key, NULL, 0, NULL, 0, NULL) == CUTILS_SUCCESS);
+    assert(cutils_aes_gcm_decrypt_many(NULL, cts, COUNT, dec, dec_size, results) == CUTILS_ERR_NULL_INPUT);
+
+    free(enc);
+    free(dec);
+    cutils_key_free(key);
+
+    printf("✓ test_aes_gcm_batch passed\n");
+}
+
+void test_reencrypt_batch() {
+    uint8_t old_key[CUTILS_AES_KEY_SIZE];
+    uint8_t new_key[CUTILS_AES_KEY_SIZE];
+    enum { COUNT = 1000 };  /* several chunks so multiple workers run */
+    char plaintext[32];
+    cutils_buf_t inputs[COUNT];
+    cutils_batch_result_t results[COUNT];
+    static uint8_t cts[COUNT][64];
+    static uint8_t rotated[COUNT * 64];
+
+    assert(cutils_generate_token(old_key) == CUTILS_SUCCESS);
+    assert(cutils_generate_token(new_key) == CUTILS_SUCCESS);
+
+    size_t total = 0;
+    for (int i = 0; i < COUNT; i++) {
+        int n = snprintf(plaintext, sizeof(plaintext), "ssn-%d", i);
+        size_t ct_len = sizeof(cts[i]);
+        /* Record 7 is under the wrong key and must fail on its own */
+        assert(cutils_aes_gcm_encrypt((uint8_t*)plaintext, n, i == 7 ? new_key : old_key,
+                                      cts[i], &ct_len) == CUTILS_SUCCESS);
+        inputs[i].data = cts[i];
+        inputs[i].len = ct_len;
+        total += ct_len;
+    }
+
+    assert(cutils_reencrypt_batch(old_key, new_key, inputs, COUNT, rotated, total - 1,
+                                  results, 4) == CUTILS_ERR_BUFFER_SIZE);
+    assert(cutils_reencrypt_batch(old_key, new_key, inputs, COUNT, rotated, total,
+                                  results, 4) == CUTILS_SUCCESS);
+
+    for (int i = 0; i < COUNT; i++) {
+        uint8_t out[64];
+        size_t out_len = sizeof(out);
+        if (i == 7) {
+            assert(results[i].status == CUTILS_ERR_CRYPTO && results[i].len == 0);
+            continue;
+        }
+        assert(results[i].status == CUTILS_SUCCESS && results[i].len == inputs[i].len);
+        assert(cutils_aes_gcm_decrypt(rotated + results[i].offset, results[i].len,
+                                      new_key, out, &out_len) == CUTILS_SUCCESS);
+        int n = snprintf(plaintext, sizeof(plaintext), "ssn-%d", i);
+        assert(out_len == (size_t)n && memcmp(out, plaintext, n) == 0);
+    }
+
+    assert(cutils_reencrypt_batch(old_key, new_key, NULL, 0, NULL, 0, NULL, 0) == CUTILS_SUCCESS);
+    assert(cutils_reencrypt_batch(NULL, new_key, inputs, COUNT, rotated, total, results, 1) == CUTILS_ERR_NULL_INPUT);
+
+    printf("✓ test_reencrypt_batch passed\n");
+}
+
 void test_sha256() {
     const char *data = "test data";
     uint8_t hash[CUTILS_SHA256_SIZE];
@@ -47,6 +294,158 @@ void test_sha256() {
     printf("✓ test_sha256 passed\n");
 }
 
+void test_sha256_streaming() {
+    static const uint8_t abc_digest[CUTILS_SHA256_SIZE] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+    };
+    uint8_t data[10000];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 31);
+    }
+    uint8_t expected[CUTILS_SHA256_SIZE];
+    uint8_t hash[CUTILS_SHA256_SIZE];
+    assert(cutils_sha256(data, sizeof(data), expected) == CUTILS_SUCCESS);
+
+    cutils_sha256_ctx_t *ctx = NULL;
+    assert(cutils_sha256_new(&ctx) == CUTILS_SUCCESS);
+
+    /* Uneven chunks, then reuse the same context */
+    for (int round = 0; round < 2; round++) {
+        size_t off = 0, step = 1;
+        while (off < sizeof(data)) {
+            size_t n = sizeof(data) - off < step ? sizeof(data) - off : step;
+            assert(cutils_sha256_update(ctx, data + off, n) == CUTILS_SUCCESS);
+            off += n;
+            step = step * 3 + 1;
+        }
+        assert(cutils_sha256_final(ctx, hash) == CUTILS_SUCCESS);
+        assert(memcmp(hash, expected, CUTILS_SHA256_SIZE) == 0);
+        assert(cutils_sha256_init(ctx) == CUTILS_SUCCESS);
+    }
+
+    /* Copy a shared prefix, peek without finishing */
+    cutils_sha256_ctx_t *fork = NULL;
+    assert(cutils_sha256_new(&fork) == CUTILS_SUCCESS);
+    assert(cutils_sha256_update(ctx, (const uint8_t*)"ab", 2) == CUTILS_SUCCESS);
+    assert(cutils_sha256_copy(fork, ctx) == CUTILS_SUCCESS);
+    assert(cutils_sha256_update(fork, (const uint8_t*)"c", 1) == CUTILS_SUCCESS);
+    assert(cutils_sha256_peek(fork, hash) == CUTILS_SUCCESS);
+    assert(memcmp(hash, abc_digest, CUTILS_SHA256_SIZE) == 0);
+    assert(cutils_sha256_update(ctx, (const uint8_t*)"c", 1) == CUTILS_SUCCESS);
+    assert(cutils_sha256_final(ctx, hash) == CUTILS_SUCCESS);
+    assert(memcmp(hash, abc_digest, CUTILS_SHA256_SIZE) == 0);
+    assert(cutils_sha256_final(fork, hash) == CUTILS_SUCCESS);
+    assert(memcmp(hash, abc_digest, CUTILS_SHA256_SIZE) == 0);
+
+    assert(cutils_sha256_update(NULL, data, 1) == CUTILS_ERR_NULL_INPUT);
+    assert(cutils_sha256_new(NULL) == CUTILS_ERR_NULL_INPUT);
+    cutils_sha256_free(fork);
+    cutils_sha256_free(ctx);
+    cutils_sha256_free(NULL);
+
+    printf("✓ test_sha256_streaming passed\n");
+}
+
+void test_sha256_many() {
+    const char *values[] = {"123456789", "", "987654321", "a longer value that spans more than one block of sha-256 input data"};
+    const size_t count = sizeof(values) / sizeof(values[0]);
+    const char *salt = "pepper";
+    cutils_buf_t inputs[4];
+    for (size_t i = 0; i < count; i++) {
+        inputs[i].data = (const uint8_t*)values[i];
+        inputs[i].len = strlen(values[i]);
+    }
+
+    uint8_t plain[4 * CUTILS_SHA256_SIZE];
+    uint8_t salted[4 * CUTILS_SHA256_SIZE];
+    assert(cutils_sha256_many(inputs, count, NULL, 0, plain) == CUTILS_SUCCESS);
+    assert(cutils_sha256_many(inputs, count, (const uint8_t*)salt, strlen(salt), salted) == CUTILS_SUCCESS);
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t expected[CUTILS_SHA256_SIZE];
+        assert(cutils_sha256(inputs[i].data, inputs[i].len, expected) == CUTILS_SUCCESS);
+        assert(memcmp(plain + i * CUTILS_SHA256_SIZE, expected, CUTILS_SHA256_SIZE) == 0);
+
+        char buf[128];
+        size_t n = (size_t)snprintf(buf, sizeof(buf), "%s%s", salt, values[i]);
+        assert(cutils_sha256((const uint8_t*)buf, n, expected) == CUTILS_SUCCESS);
+        assert(memcmp(salted + i * CUTILS_SHA256_SIZE, expected, CUTILS_SHA256_SIZE) == 0);
+    }
+
+    assert(cutils_sha256_many(NULL, 0, NULL, 0, NULL) == CUTILS_SUCCESS);
+    assert(cutils_sha256_many(NULL, 1, NULL, 0, plain) == CUTILS_ERR_NULL_INPUT);
+    assert(cutils_sha256_many(inputs, count, NULL, 4, plain) == CUTILS_ERR_NULL_INPUT);
+
+    printf("✓ test_sha256_many passed\n");
+}
+
+void test_pseudonymize() {
+    /* RFC 4231 test cases 2 and 6 (the latter exercises key hashing) */
+    uint8_t long_key[131];
+    memset(long_key, 0xaa, sizeof(long_key));
+    const struct {
+        const uint8_t *key;
+        size_t key_len;
+        const char *data;
+        const char *hex;
+    } vectors[] = {
+        {(const uint8_t*)"Jefe", 4, "what do ya want for nothing?",
+         "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+        {long_key, sizeof(long_key), "Test Using Larger Than Block-Size Key - Hash Key First",
+         "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+    };
+
+    for (size_t v = 0; v < 2; v++) {
+        cutils_pseudonymizer_t *ps = NULL;
+        assert(cutils_pseudonymizer_new(vectors[v].key, vectors[v].key_len, &ps) == CUTILS_SUCCESS);
+        uint8_t mac[CUTILS_SHA256_SIZE];
+        char hex[2 * CUTILS_SHA256_SIZE + 1];
+        assert(cutils_pseudonymize(ps, (const uint8_t*)vectors[v].data, strlen(vectors[v].data), mac) == CUTILS_SUCCESS);
+        assert(cutils_hex_encode(mac, sizeof(mac), hex) == CUTILS_SUCCESS);
+        assert(strcmp(hex, vectors[v].hex) == 0);
+        cutils_pseudonymizer_free(ps);
+    }
+
+    /* Threaded batch matches one-at-a-time for every thread count */
+    const uint8_t key[] = "analytics-export-key-for-tests!!";
+    cutils_pseudonymizer_t *ps = NULL;
+    assert(cutils_pseudonymizer_new(key, sizeof(key) - 1, &ps) == CUTILS_SUCCESS);
+
+    const size_t count = 5000;
+    char (*ids)[16] = malloc(count * sizeof(*ids));
+    cutils_buf_t *inputs = malloc(count * sizeof(cutils_buf_t));
+    uint8_t *expected = malloc(count * CUTILS_SHA256_SIZE);
+    uint8_t *output = malloc(count * CUTILS_SHA256_SIZE);
+    assert(ids && inputs && expected && output);
+    for (size_t i = 0; i < count; i++) {
+        inputs[i].len = (size_t)snprintf(ids[i], sizeof(ids[i]), "MRN%06zu", i);
+        inputs[i].data = (const uint8_t*)ids[i];
+        assert(cutils_pseudonymize(ps, inputs[i].data, inputs[i].len, expected + i * CUTILS_SHA256_SIZE) == CUTILS_SUCCESS);
+    }
+
+    const unsigned int thread_counts[] = {0, 1, 3, 8};
+    for (int t = 0; t < 4; t++) {
+        memset(output, 0, count * CUTILS_SHA256_SIZE);
+        assert(cutils_pseudonymize_many(ps, inputs, count, output, thread_counts[t]) == CUTILS_SUCCESS);
+        assert(memcmp(output, expected, count * CUTILS_SHA256_SIZE) == 0);
+    }
+
+    uint8_t empty[CUTILS_SHA256_SIZE];
+    assert(cutils_pseudonymize(ps, NULL, 0, empty) == CUTILS_SUCCESS);
+    assert(cutils_pseudonymize(ps, NULL, 1, empty) == CUTILS_ERR_NULL_INPUT);
+    assert(cutils_pseudonymize_many(ps, NULL, 0, NULL, 0) == CUTILS_SUCCESS);
+    cutils_pseudonymizer_free(ps);
+    assert(cutils_pseudonymizer_new(key, 0, &ps) == CUTILS_ERR_INVALID_SIZE);
+    assert(ps == NULL);
+
+    free(ids);
+    free(inputs);
+    free(expected);
+    free(output);
+    printf("✓ test_pseudonymize passed\n");
+}
+
 void test_hex_encoding() {
     uint8_t data[] = {0xDE, 0xAD, 0xBE, 0xEF};
     char hex[32];
@@ -64,6 +463,64 @@ void test_hex_encoding() {
     printf("✓ test_hex_encoding passed\n");
 }
 
+void test_hex_kernels() {
+    uint8_t data[300];
+    char expected[sizeof(data) * 2 + 1];
+    char hex[sizeof(data) * 2 + 1];
+    uint8_t decoded[sizeof(data)];
+    size_t decoded_len;
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    assert(cutils_hex_force_impl("scalar") == CUTILS_SUCCESS);
+    assert(cutils_hex_encode(data, sizeof(data), expected) == CUTILS_SUCCESS);
+
+    const char *impls[] = {"scalar", "ssse3", "avx2", "neon"};
+    for (int k = 0; k < 4; k++) {
+        if (cutils_hex_force_impl(impls[k]) != CUTILS_SUCCESS) {
+            continue;
+        }
+        assert(strcmp(cutils_hex_impl(), impls[k]) == 0);
+
+        for (size_t len = 0; len <= sizeof(data); len++) {
+            memset(hex, 'x', sizeof(hex));
+            assert(cutils_hex_encode(data, len, hex) == CUTILS_SUCCESS);
+            assert(memcmp(hex, expected, len * 2) == 0 && hex[len * 2] == '\0');
+
+            assert(cutils_hex_decode_len(expected, len * 2, decoded, &decoded_len) == CUTILS_SUCCESS);
+            assert(decoded_len == len && memcmp(decoded, data, len) == 0);
+        }
+
+        /* Uppercase is accepted */
+        char upper[sizeof(expected)];
+        for (size_t i = 0; i < sizeof(data) * 2; i++) {
+            upper[i] = (expected[i] >= 'a') ? (char)(expected[i] - 32) : expected[i];
+        }
+        assert(cutils_hex_decode_len(upper, sizeof(data) * 2, decoded, NULL) == CUTILS_SUCCESS);
+        assert(memcmp(decoded, data, sizeof(data)) == 0);
+
+        /* A single bad character anywhere is rejected */
+        const char bad_chars[] = {'g', 'G', ':', '/', '@', '`', ' ', '\0', (char)0x80, (char)0xB0};
+        for (size_t pos = 0; pos < 130; pos++) {
+            for (size_t b = 0; b < sizeof(bad_chars); b++) {
+                char tmp[130];
+                memcpy(tmp, expected, sizeof(tmp));
+                tmp[pos] = bad_chars[b];
+                assert(cutils_hex_decode_len(tmp, sizeof(tmp), decoded, NULL) == CUTILS_ERR_INVALID_SIZE);
+            }
+        }
+    }
+    assert(cutils_hex_force_impl("bogus") == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_hex_force_impl(NULL) == CUTILS_SUCCESS);
+
+    assert(cutils_hex_decode_len("abc", 3, decoded, &decoded_len) == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_hex_decode_len(NULL, 0, NULL, &decoded_len) == CUTILS_SUCCESS && decoded_len == 0);
+    assert(cutils_hex_decode_len(NULL, 2, decoded, NULL) == CUTILS_ERR_NULL_INPUT);
+
+    printf("✓ test_hex_kernels passed\n");
+}
+
 void test_token_generation() {
     uint8_t token1[CUTILS_TOKEN_SIZE];
     uint8_t token2[CUTILS_TOKEN_SIZE];
@@ -77,13 +534,538 @@ void test_token_generation() {
     printf("✓ test_token_generation passed\n");
 }
 
+void test_random_pool() {
+    uint8_t a[64], b[64], big[8192];
+    assert(cutils_random_bytes(a, sizeof(a)) == CUTILS_SUCCESS);
+    assert(cutils_random_bytes(b, sizeof(b)) == CUTILS_SUCCESS);
+    assert(memcmp(a, b, sizeof(a)) != 0);
+    assert(cutils_random_bytes(big, sizeof(big)) == CUTILS_SUCCESS);
+    assert(cutils_random_bytes(NULL, 0) == CUTILS_SUCCESS);
+    assert(cutils_random_bytes(NULL, 1) == CUTILS_ERR_NULL_INPUT);
+
+    /* Drain across several refills in odd-sized pieces */
+    for (int i = 0; i < 1000; i++) {
+        assert(cutils_random_bytes(a, 1 + i % 63) == CUTILS_SUCCESS);
+    }
+
+    /* A forked child must not replay the parent's buffered bytes */
+    int fds[2];
+    assert(pipe(fds) == 0);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        uint8_t child[64];
+        int ok = cutils_random_bytes(child, sizeof(child)) == CUTILS_SUCCESS &&
+                 write(fds[1], child, sizeof(child)) == (ssize_t)sizeof(child);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    uint8_t child[64];
+    assert(read(fds[0], child, sizeof(child)) == (ssize_t)sizeof(child));
+    close(fds[0]);
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(cutils_random_bytes(a, sizeof(a)) == CUTILS_SUCCESS);
+    assert(memcmp(a, child, sizeof(a)) != 0);
+
+    printf("✓ test_random_pool passed\n");
+}
+
+void test_xxh3() {
+    /* Reference vectors from xxHash 0.8 */
+    assert(cutils_xxh3_64((const uint8_t*)"", 0, 0) == 0x2D06800538D394C2ULL);
+    assert(cutils_xxh3_64((const uint8_t*)"", 0, 42) == 0xB029411FF43D84D2ULL);
+    assert(cutils_xxh3_64((const uint8_t*)"abc", 3, 0) == 0x78AF5F94892F3950ULL);
+    assert(cutils_xxh3_64((const uint8_t*)"Hello, World!", 13, 0) == 0x60415D5F616602AAULL);
+    assert(cutils_xxh3_64((const uint8_t*)"Hello, World!", 13, 42) == 0x9125EABA28E37E5BULL);
+    assert(cutils_xxh3((const uint8_t*)"abc", 3) == 0x78AF5F94892F3950ULL);
+    assert(cutils_xxh3(NULL, 0) == 0);
+
+    cutils_xxh128_t h = cutils_xxh3_128((const uint8_t*)"", 0, 0);
+    assert(h.low == 0x6001C324468D497FULL && h.high == 0x99AA06D3014798D8ULL);
+    h = cutils_xxh3_128((const uint8_t*)"abc", 3, 0);
+    assert(h.low == 0x78AF5F94892F3950ULL && h.high == 0x06B05AB6733A6185ULL);
+
+    /* Long input exercises the SIMD accumulator */
+    uint8_t data[4096];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+    assert(cutils_xxh3_64(data, 1024, 0) == 0xA870F92984398D22ULL);
+    h = cutils_xxh3_128(data, 1024, 0);
+    assert(h.low == 0xA870F92984398D22ULL && h.high == 0x83885E853BB6640CULL);
+
+    /* Every available kernel agrees with the scalar one */
+    assert(cutils_xxh3_force_impl("scalar") == CUTILS_SUCCESS);
+    uint64_t expected[5];
+    const size_t lens[5] = {241, 1024, 1025, 2049, 4096};
+    for (int i = 0; i < 5; i++) {
+        expected[i] = cutils_xxh3_64(data, lens[i], 7);
+    }
+    const char *impls[] = {"sse2", "avx2", "neon"};
+    for (int k = 0; k < 3; k++) {
+        if (cutils_xxh3_force_impl(impls[k]) != CUTILS_SUCCESS) {
+            continue;
+        }
+        assert(strcmp(cutils_xxh3_impl(), impls[k]) == 0);
+        for (int i = 0; i < 5; i++) {
+            assert(cutils_xxh3_64(data, lens[i], 7) == expected[i]);
+        }
+    }
+    assert(cutils_xxh3_force_impl("bogus") == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_xxh3_force_impl(NULL) == CUTILS_SUCCESS);
+
+    /* HOSPITAL_NATIVE_ISA caps dispatch (ctest runs this binary again with it set) */
+    const char *isa = getenv("HOSPITAL_NATIVE_ISA");
+    if (isa && strcmp(isa, "scalar") == 0) {
+        assert(strcmp(cutils_xxh3_impl(), "scalar") == 0);
+        assert(strcmp(cutils_hex_impl(), "scalar") == 0);
+        assert(cutils_xxh3_force_impl("sse2") == CUTILS_ERR_INVALID_SIZE);
+    }
+
+    /* Streaming in uneven chunks matches one-shot */
+    const size_t chunks[] = {1, 7, 63, 64, 65, 255, 256, 257, 1000};
+    for (size_t len = 0; len <= sizeof(data); len += 97) {
+        for (int c = 0; c < 9; c++) {
+            cutils_xxh3_state_t state;
+            assert(cutils_xxh3_init(&state, len) == CUTILS_SUCCESS);
+            for (size_t off = 0; off < len; off += chunks[c]) {
+                size_t n = len - off < chunks[c] ? len - off : chunks[c];
+                assert(cutils_xxh3_update(&state, data + off, n) == CUTILS_SUCCESS);
+            }
+            assert(cutils_xxh3_digest(&state) == cutils_xxh3_64(data, len, len));
+            cutils_xxh128_t a = cutils_xxh3_128_digest(&state);
+            cutils_xxh128_t b = cutils_xxh3_128(data, len, len);
+            assert(a.low == b.low && a.high == b.high);
+        }
+    }
+    assert(cutils_xxh3_init(NULL, 0) == CUTILS_ERR_NULL_INPUT);
+
+    printf("✓ test_xxh3 passed\n");
+}
+
+static const cutils_stats_t* stats_find(const cutils_stats_t *entries, size_t n, const char *name) {
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void* stats_hash_worker(void *arg) {
+    (void)arg;
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    for (int i = 0; i < 100; i++) {
+        assert(cutils_sha256((const uint8_t*)"abcd", 4, digest) == CUTILS_SUCCESS);
+    }
+    return NULL;
+}
+
+void test_stats() {
+    cutils_stats_t entries[32];
+    if (!cutils_stats_enabled()) {
+        assert(cutils_stats_snapshot(entries, 32) == 0);
+        printf("✓ test_stats passed (instrumentation not built)\n");
+        return;
+    }
+
+    size_t n = cutils_stats_snapshot(NULL, 0);
+    assert(n > 0 && n <= 32);
+    cutils_stats_reset();
+    assert(cutils_stats_snapshot(entries, 32) == n);
+    for (size_t i = 0; i < n; i++) {
+        assert(entries[i].calls == 0 && entries[i].total_ns == 0);
+    }
+
+    uint8_t key[CUTILS_AES_KEY_SIZE] = {0};
+    uint8_t out[64];
+    size_t out_len = sizeof(out);
+    assert(cutils_aes_gcm_encrypt((const uint8_t*)"123456789", 9, key, out, &out_len) == CUTILS_SUCCESS);
+    out_len = 8;
+    assert(cutils_aes_gcm_encrypt((const uint8_t*)"123456789", 9, key, out, &out_len) == CUTILS_ERR_BUFFER_SIZE);
+
+    /* Threads that have exited still count */
+    pthread_t threads[4];
+    for (int t = 0; t < 4; t++) {
+        assert(pthread_create(&threads[t], NULL, stats_hash_worker, NULL) == 0);
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    stats_hash_worker(NULL);
+
+    assert(cutils_stats_snapshot(entries, 32) == n);
+    const cutils_stats_t *enc = stats_find(entries, n, "aes_gcm_encrypt");
+    assert(enc && enc->calls == 2 && enc->bytes == 18);
+    assert(enc->errors[-CUTILS_ERR_BUFFER_SIZE] == 1 && enc->errors[0] == 0);
+    uint64_t buckets = 0;
+    for (int b = 0; b < CUTILS_STATS_LATENCY_BUCKETS; b++) {
+        buckets += enc->latency[b];
+    }
+    assert(buckets == 2);
+
+    /* The IV draw inside encrypt is not a separate call */
+    const cutils_stats_t *rnd = stats_find(entries, n, "random_bytes");
+    assert(rnd && rnd->calls == 0);
+
+    const cutils_stats_t *sha = stats_find(entries, n, "sha256");
+    assert(sha && sha->calls == 500 && sha->bytes == 2000 && sha->total_ns > 0);
+
+    cutils_stats_reset();
+    assert(cutils_stats_snapshot(entries, 32) == n);
+    sha = stats_find(entries, n, "sha256");
+    assert(sha->calls == 0);
+    stats_hash_worker(NULL);
+    assert(cutils_stats_snapshot(entries, 32) == n);
+    assert(stats_find(entries, n, "sha256")->calls == 100);
+
+    printf("✓ test_stats passed\n");
+}
+
+typedef struct {
+    cutils_audit_t *log;
+    int id;
+} audit_worker_arg_t;
+
+static void* audit_append_worker(void *arg) {
+    audit_worker_arg_t *a = arg;
+    char entry[64];
+    for (int i = 0; i < 500; i++) {
+        int n = snprintf(entry, sizeof(entry), "{\"thread\": %d, \"i\": %d}", a->id, i);
+        assert(cutils_audit_append(a->log, (const uint8_t*)entry, (size_t)n) == CUTILS_SUCCESS);
+        if (i % 100 == 99) {
+            assert(cutils_audit_flush(a->log) == CUTILS_SUCCESS);
+        }
+    }
+    return NULL;
+}
+
+/* Flip one byte of the file at offset */
+static void audit_corrupt(const char *path, off_t offset) {
+    int fd = open(path, O_RDWR);
+    uint8_t b;
+    assert(fd >= 0 && pread(fd, &b, 1, offset) == 1);
+    b ^= 0x01;
+    assert(pwrite(fd, &b, 1, offset) == 1);
+    close(fd);
+}
+
+void test_audit() {
+    char path[] = "/tmp/test_cutils_audit_XXXXXX";
+    int tmp = mkstemp(path);
+    assert(tmp >= 0);
+    close(tmp);
+
+    uint8_t seed[CUTILS_SHA256_SIZE];
+    uint8_t head[CUTILS_SHA256_SIZE];
+    uint8_t digest[CUTILS_SHA256_SIZE];
+    uint64_t count;
+    memset(seed, 0x5A, sizeof(seed));
+
+    cutils_audit_t *log = NULL;
+    assert(cutils_audit_open(path, seed, 0, &log) == CUTILS_SUCCESS);
+    assert(cutils_audit_head(log, head, &count) == CUTILS_SUCCESS);
+    assert(count == 0 && memcmp(head, seed, sizeof(seed)) == 0);
+
+    /* A second writer is refused */
+    cutils_audit_t *other = NULL;
+    assert(cutils_audit_open(path, seed, 0, &other) == CUTILS_ERR_IO && other == NULL);
+
+    assert(cutils_audit_append(log, NULL, 1) == CUTILS_ERR_NULL_INPUT);
+    assert(cutils_audit_append(log, seed, CUTILS_AUDIT_MAX_ENTRY + 1) == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_audit_append(log, NULL, 0) == CUTILS_SUCCESS);
+
+    /* Concurrent appenders: every entry lands exactly once */
+    pthread_t threads[4];
+    audit_worker_arg_t args[4];
+    for (int t = 0; t < 4; t++) {
+        args[t].log = log;
+        args[t].id = t;
+        assert(pthread_create(&threads[t], NULL, audit_append_worker, &args[t]) == 0);
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    assert(cutils_audit_flush(log) == CUTILS_SUCCESS);
+    assert(cutils_audit_head(log, head, &count) == CUTILS_SUCCESS && count == 2001);
+    assert(cutils_audit_close(log) == CUTILS_SUCCESS);
+
+    assert(cutils_audit_verify(path, seed, digest, &count) == CUTILS_SUCCESS);
+    assert(count == 2001 && memcmp(digest, head, sizeof(head)) == 0);
+    assert(cutils_audit_verify(path, NULL, NULL, &count) == CUTILS_ERR_INTEGRITY && count == 0);
+
+    /* Reopening continues the chain; close writes out what is still queued */
+    assert(cutils_audit_open(path, NULL, CUTILS_AUDIT_SYNC, &log) == CUTILS_SUCCESS);
+    assert(cutils_audit_head(log, digest, &count) == CUTILS_SUCCESS);
+    assert(count == 2001 && memcmp(digest, head, sizeof(head)) == 0);
+    assert(cutils_audit_append(log, (const uint8_t*)"last", 4) == CUTILS_SUCCESS);
+    assert(cutils_audit_close(log) == CUTILS_SUCCESS);
+    assert(cutils_audit_verify(path, seed, head, &count) == CUTILS_SUCCESS && count == 2002);
+
+    /* Record 0 is the empty entry: magic, header, digest, then record 1 */
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    audit_corrupt(path, 8 + 12 + 32 + 12 + 3);
+    assert(cutils_audit_verify(path, seed, NULL, &count) == CUTILS_ERR_INTEGRITY && count == 1);
+    audit_corrupt(path, 8 + 12 + 32 + 12 + 3);
+
+    /* A fork child has no writer: the inherited handle refuses work and closes cleanly */
+    assert(cutils_audit_open(path, NULL, 0, &log) == CUTILS_SUCCESS);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        int ok = cutils_audit_append(log, (const uint8_t*)"child", 5) == CUTILS_ERR_IO &&
+                 cutils_audit_flush(log) == CUTILS_ERR_IO && cutils_audit_close(log) == CUTILS_SUCCESS;
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(cutils_audit_close(log) == CUTILS_SUCCESS);
+    assert(cutils_audit_verify(path, seed, NULL, &count) == CUTILS_SUCCESS && count == 2002);
+
+    /* A torn last record fails verification and is trimmed on open */
+    assert(truncate(path, st.st_size - 5) == 0);
+    assert(cutils_audit_verify(path, seed, NULL, &count) == CUTILS_ERR_INTEGRITY && count == 2001);
+    assert(cutils_audit_open(path, seed, 0, &log) == CUTILS_SUCCESS);
+    assert(cutils_audit_head(log, digest, &count) == CUTILS_SUCCESS && count == 2001);
+    assert(cutils_audit_close(log) == CUTILS_SUCCESS);
+    assert(cutils_audit_verify(path, seed, NULL, &count) == CUTILS_SUCCESS && count == 2001);
+
+    /* Not an audit log */
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    assert(fd >= 0 && write(fd, "MSH|^~\\&|", 9) == 9);
+    close(fd);
+    assert(cutils_audit_open(path, seed, 0, &log) == CUTILS_ERR_INTEGRITY && log == NULL);
+    assert(cutils_audit_verify(path, seed, NULL, NULL) == CUTILS_ERR_INTEGRITY);
+    unlink(path);
+    assert(cutils_audit_verify(path, seed, NULL, NULL) == CUTILS_ERR_IO);
+    assert(cutils_audit_close(NULL) == CUTILS_SUCCESS);
+
+    printf("✓ test_audit passed\n");
+}
+
+typedef struct {
+    cutils_ratelimit_t *rl;
+    int allowed;
+} ratelimit_worker_arg_t;
+
+static void* ratelimit_hit_worker(void *arg) {
+    ratelimit_worker_arg_t *a = arg;
+    uint64_t retry;
+    for (int i = 0; i < 1000; i++) {
+        assert(cutils_ratelimit_hit(a->rl, (const uint8_t*)"shared", 6, 1000, 3600000000000ull, &retry) ==
+               CUTILS_SUCCESS);
+        a->allowed += retry == 0;
+    }
+    return NULL;
+}
+
+static int ratelimit_allowed(cutils_ratelimit_t *rl, const char *key, uint32_t limit, uint64_t window_ns) {
+    uint64_t retry = 0;
+    assert(cutils_ratelimit_hit(rl, (const uint8_t*)key, strlen(key), limit, window_ns, &retry) == CUTILS_SUCCESS);
+    return retry == 0;
+}
+
+void test_ratelimit() {
+    const uint64_t second = 1000000000ull;
+    cutils_ratelimit_t *rl = NULL;
+    assert(cutils_ratelimit_open(NULL, 0, &rl) == CUTILS_SUCCESS);
+
+    /* limit per window in one burst, then a wait of one emission interval */
+    for (int i = 0; i < 5; i++) {
+        assert(ratelimit_allowed(rl, "10.0.0.1|/api/v1/auth/login/", 5, 10 * second));
+    }
+    uint64_t retry = 0;
+    assert(cutils_ratelimit_hit(rl, (const uint8_t*)"10.0.0.1|/api/v1/auth/login/", 28, 5, 10 * second, &retry) ==
+           CUTILS_SUCCESS);
+    assert(retry > second && retry <= 2 * second);
+    assert(ratelimit_allowed(rl, "10.0.0.2|/api/v1/auth/login/", 5, 10 * second));
+    assert(cutils_ratelimit_reset(rl, (const uint8_t*)"10.0.0.1|/api/v1/auth/login/", 28) == CUTILS_SUCCESS);
+    assert(ratelimit_allowed(rl, "10.0.0.1|/api/v1/auth/login/", 5, 10 * second));
+
+    /* Buckets refill evenly: one hit back every window / limit */
+    assert(ratelimit_allowed(rl, "refill", 2, 40000000));
+    assert(ratelimit_allowed(rl, "refill", 2, 40000000));
+    assert(!ratelimit_allowed(rl, "refill", 2, 40000000));
+    usleep(30000);
+    assert(ratelimit_allowed(rl, "refill", 2, 40000000));
+
+    assert(cutils_ratelimit_hit(rl, (const uint8_t*)"k", 1, 0, second, &retry) == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_ratelimit_hit(rl, (const uint8_t*)"k", 1, 1, 0, &retry) == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_ratelimit_hit(rl, NULL, 1, 1, second, &retry) == CUTILS_ERR_NULL_INPUT);
+    assert(cutils_ratelimit_hit(NULL, (const uint8_t*)"k", 1, 1, second, &retry) == CUTILS_ERR_NULL_INPUT);
+    cutils_ratelimit_t *none = NULL;
+    assert(cutils_ratelimit_open(NULL, CUTILS_RATELIMIT_MAX_SLOTS + 1, &none) == CUTILS_ERR_INVALID_SIZE);
+
+    /* Concurrent hits never let more than limit through */
+    pthread_t threads[4];
+    ratelimit_worker_arg_t args[4];
+    for (int t = 0; t < 4; t++) {
+        args[t].rl = rl;
+        args[t].allowed = 0;
+        assert(pthread_create(&threads[t], NULL, ratelimit_hit_worker, &args[t]) == 0);
+    }
+    int allowed = 0;
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+        allowed += args[t].allowed;
+    }
+    assert(allowed == 1000);
+
+    /* An anonymous table is shared with children forked after opening */
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        int ok = ratelimit_allowed(rl, "forked", 3, 10 * second);
+        ok &= ratelimit_allowed(rl, "forked", 3, 10 * second);
+        ok &= ratelimit_allowed(rl, "forked", 3, 10 * second);
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(!ratelimit_allowed(rl, "forked", 3, 10 * second));
+    cutils_ratelimit_close(rl);
+
+    /* A full table hands slots over rather than refusing new keys */
+    assert(cutils_ratelimit_open(NULL, 1, &rl) == CUTILS_SUCCESS);
+    char key[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "192.0.2.%d|%d", i % 256, i);
+        assert(ratelimit_allowed(rl, key, 1, 10 * second));
+    }
+    cutils_ratelimit_close(rl);
+
+    /* Named tables are shared by every handle on the segment */
+    char name[64];
+    snprintf(name, sizeof(name), "/test_cutils_rl_%d", (int)getpid());
+    cutils_ratelimit_t *a = NULL, *b = NULL;
+    assert(cutils_ratelimit_open(name, 100, &a) == CUTILS_SUCCESS);
+    assert(cutils_ratelimit_open(name, 4096, &b) == CUTILS_SUCCESS);
+    assert(ratelimit_allowed(a, "named", 1, 10 * second));
+    assert(!ratelimit_allowed(b, "named", 1, 10 * second));
+    cutils_ratelimit_close(a);
+    cutils_ratelimit_close(b);
+    assert(cutils_ratelimit_unlink(name) == CUTILS_SUCCESS);
+    assert(cutils_ratelimit_unlink(name) == CUTILS_ERR_IO);
+
+    /* A segment that is not a table */
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    assert(fd >= 0 && write(fd, "MSH|^~\\&|", 9) == 9);
+    close(fd);
+    assert(cutils_ratelimit_open(name, 0, &a) == CUTILS_ERR_INTEGRITY && a == NULL);
+    assert(cutils_ratelimit_unlink(name) == CUTILS_SUCCESS);
+    cutils_ratelimit_close(NULL);
+
+    printf("✓ test_ratelimit passed\n");
+}
+
+static int ipset_has(const cutils_ipset_t *set, const char *ip) {
+    uint8_t addr[16];
+    size_t len;
+    unsigned int prefix;
+    int found = -1;
+    assert(cutils_ip_parse(ip, addr, &len, &prefix) == CUTILS_SUCCESS && prefix == len * 8);
+    assert(cutils_ipset_contains(set, addr, len, &found) == CUTILS_SUCCESS);
+    return found;
+}
+
+static void ipset_add_text(cutils_ipset_t *set, const char *network) {
+    uint8_t addr[16];
+    size_t len;
+    unsigned int prefix;
+    assert(cutils_ip_parse(network, addr, &len, &prefix) == CUTILS_SUCCESS);
+    assert(cutils_ipset_add(set, addr, len, prefix) == CUTILS_SUCCESS);
+}
+
+void test_ipset() {
+    uint8_t addr[16];
+    size_t len;
+    unsigned int prefix;
+    assert(cutils_ip_parse("10.1.2.3", addr, &len, &prefix) == CUTILS_SUCCESS && len == 4 && prefix == 32);
+    assert(addr[0] == 10 && addr[3] == 3);
+    assert(cutils_ip_parse("2001:db8::/32", addr, &len, &prefix) == CUTILS_SUCCESS && len == 16 && prefix == 32);
+    const char *bad[] = {"", "10.1.2", "10.1.2.3/33", "10.1.2.3/", "10.1.2.3/2x", "::1/129", "example.org",
+                         "10.1.2.3/0032", NULL};
+    for (int i = 0; bad[i]; i++) {
+        assert(cutils_ip_parse(bad[i], addr, &len, &prefix) == CUTILS_ERR_INVALID_SIZE);
+    }
+
+    cutils_ipset_t *set = NULL;
+    assert(cutils_ipset_new(&set) == CUTILS_SUCCESS);
+    assert(!ipset_has(set, "10.1.2.3"));
+
+    ipset_add_text(set, "10.0.0.0/8");
+    ipset_add_text(set, "10.20.0.0/16");    /* Covered: no-op */
+    ipset_add_text(set, "192.168.1.77/30"); /* Host bits ignored: .76 - .79 */
+    ipset_add_text(set, "203.0.113.9");
+    ipset_add_text(set, "2001:db8:abcd::/47");
+    ipset_add_text(set, "::ffff:198.51.100.0/120");
+
+    assert(ipset_has(set, "10.255.255.255") && ipset_has(set, "10.20.1.1"));
+    assert(!ipset_has(set, "11.0.0.0") && !ipset_has(set, "9.255.255.255"));
+    assert(!ipset_has(set, "192.168.1.75") && ipset_has(set, "192.168.1.76") && ipset_has(set, "192.168.1.79"));
+    assert(!ipset_has(set, "192.168.1.80"));
+    assert(ipset_has(set, "203.0.113.9") && !ipset_has(set, "203.0.113.8"));
+    assert(ipset_has(set, "2001:db8:abcd:1::5") && ipset_has(set, "2001:db8:abcc::1"));  /* abcc: last bit free */
+    assert(!ipset_has(set, "2001:db8:abce::1"));
+    /* IPv4-mapped addresses and networks meet the IPv4 trie */
+    assert(ipset_has(set, "::ffff:10.9.8.7") && ipset_has(set, "198.51.100.200"));
+    assert(!ipset_has(set, "::10.9.8.7"));
+
+    /* A wider network added later replaces the narrower ones below it */
+    ipset_add_text(set, "192.168.0.0/16");
+    assert(ipset_has(set, "192.168.200.1") && ipset_has(set, "192.168.1.76"));
+    ipset_add_text(set, "::/0");
+    assert(ipset_has(set, "fe80::1") && !ipset_has(set, "172.16.0.1"));
+
+    assert(cutils_ipset_add(set, addr, 5, 8) == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_ipset_add(set, addr, 4, 33) == CUTILS_ERR_INVALID_SIZE);
+    int found;
+    assert(cutils_ipset_contains(set, addr, 8, &found) == CUTILS_ERR_INVALID_SIZE);
+    assert(cutils_ipset_contains(set, NULL, 4, &found) == CUTILS_ERR_NULL_INPUT);
+    cutils_ipset_free(set);
+
+    /* Many host entries grow the node array */
+    assert(cutils_ipset_new(&set) == CUTILS_SUCCESS);
+    for (uint32_t i = 0; i < 5000; i++) {
+        uint32_t ip = htonl(0x64400000u + i * 7919u);
+        assert(cutils_ipset_add(set, (const uint8_t*)&ip, 4, 32) == CUTILS_SUCCESS);
+    }
+    for (uint32_t i = 0; i < 5000; i++) {
+        uint32_t ip = htonl(0x64400000u + i * 7919u);
+        uint32_t next = htonl(0x64400000u + i * 7919u + 1);
+        assert(cutils_ipset_contains(set, (const uint8_t*)&ip, 4, &found) == CUTILS_SUCCESS && found);
+        assert(cutils_ipset_contains(set, (const uint8_t*)&next, 4, &found) == CUTILS_SUCCESS && !found);
+    }
+    cutils_ipset_free(set);
+    cutils_ipset_free(NULL);
+
+    printf("✓ test_ipset passed\n");
+}
+
 int main() {
     printf("Running crypto utils tests...\n");
     
     test_aes_gcm_encryption();
+    test_aes_gcm_key_switch();
+    test_aes_gcm_threads();
+    test_key_handle();
+    test_aes_gcm_batch();
+    test_reencrypt_batch();
     test_sha256();
+    test_sha256_streaming();
+    test_sha256_many();
+    test_pseudonymize();
     test_hex_encoding();
+    test_hex_kernels();
     test_token_generation();
+    test_random_pool();
+    test_xxh3();
+    test_stats();
+    test_audit();
+    test_ratelimit();
+    test_ipset();
     
     printf("\nAll tests passed! ✓\n");
     return 0;
@@ -1,6 +1,9 @@
 #include "../include/libhl7val.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #undef NDEBUG  /* Ensure assert() is active even in release builds */
 #include <assert.h>
 
@@ -50,6 +53,833 @@ void test_field_extraction() {
     printf("✓ test_field_extraction passed\n");
 }
 
+static int span_eq(const hl7val_segment_t *seg, hl7val_span_t span, const char *expected) {
+    return span.len == strlen(expected) && memcmp(seg->data + span.start, expected, span.len) == 0;
+}
+
+void test_parse_segment() {
+    static hl7val_segment_t seg;
+    hl7val_span_t span;
+
+    const char *pid = "PID|1|12345~67890|JONES^JOHN^Q~SMITH^J||19800101|M";
+    assert(hl7val_parse_segment(pid, strlen(pid), &seg) == HL7VAL_SUCCESS);
+    assert(strcmp(seg.id, "PID") == 0);
+    assert(seg.field_count == 6);
+
+    const char *fields[] = {"PID", "1", "12345~67890", "JONES^JOHN^Q~SMITH^J", "", "19800101", "M"};
+    for (int i = 0; i <= 6; i++) {
+        assert(hl7val_field_at(&seg, i, &span) == HL7VAL_SUCCESS);
+        assert(span_eq(&seg, span, fields[i]));
+    }
+    assert(hl7val_field_at(&seg, 7, &span) == HL7VAL_ERR_FIELD_COUNT);
+
+    assert(hl7val_component_at(&seg, 3, 1, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "JOHN"));
+    assert(hl7val_component_at(&seg, 3, 2, 1, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "SMITH"));
+    assert(hl7val_component_at(&seg, 3, 2, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "J"));
+    assert(hl7val_component_at(&seg, 3, 1, 4, &span) == HL7VAL_ERR_FIELD_COUNT);
+    assert(hl7val_component_at(&seg, 3, 3, 1, &span) == HL7VAL_ERR_FIELD_COUNT);
+    assert(hl7val_component_at(&seg, 2, 2, 1, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "67890"));
+    assert(hl7val_component_at(&seg, 4, 1, 1, &span) == HL7VAL_SUCCESS && span.len == 0);
+
+    /* MSH-1 is the separator; MSH-2 is not split on its own ^ and ~ */
+    const char *msh = "MSH|^~\\&|LAB^1|HOSP";
+    assert(hl7val_parse_segment(msh, strlen(msh), &seg) == HL7VAL_SUCCESS);
+    assert(seg.field_count == 4);
+    assert(hl7val_field_at(&seg, 1, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "|"));
+    assert(hl7val_field_at(&seg, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "^~\\&"));
+    assert(hl7val_component_at(&seg, 2, 1, 1, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "^~\\&"));
+    assert(hl7val_component_at(&seg, 3, 1, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "1"));
+
+    /* The index agrees with the rescanning fallback when separators overflow */
+    static char big[8192];
+    size_t n = (size_t)snprintf(big, sizeof(big), "OBX|1|ED|");
+    for (int i = 0; i < 1500; i++) {
+        n += (size_t)snprintf(big + n, sizeof(big) - n, "%s%d", i ? "^" : "", i);
+    }
+    n += (size_t)snprintf(big + n, sizeof(big) - n, "|a^b");
+    assert(hl7val_parse_segment(big, n, &seg) == HL7VAL_SUCCESS);
+    assert(seg.sub_overflow);
+    assert(hl7val_component_at(&seg, 3, 1, 1500, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "1499"));
+    assert(hl7val_component_at(&seg, 4, 1, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "b"));
+
+    /* Structural errors match hl7val_validate_segment */
+    assert(hl7val_parse_segment("AB|x|y", 6, &seg) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_parse_segment("PID^1^2", 7, &seg) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_parse_segment(NULL, 0, &seg) == HL7VAL_ERR_NULL_INPUT);
+    assert(hl7val_parse_segment(pid, strlen(pid), NULL) == HL7VAL_ERR_NULL_INPUT);
+    memset(big, '|', sizeof(big));
+    memcpy(big, "ZZZ", 3);
+    assert(hl7val_parse_segment(big, 300, &seg) == HL7VAL_ERR_FIELD_COUNT);
+
+    printf("✓ test_parse_segment passed\n");
+}
+
+void test_scan_kernels() {
+    /* A long Z segment (no schema, so only structure is checked) with
+     * irregular field and component sizes crossing blocks */
+    static char seg[HL7VAL_MAX_SEGMENT_SIZE];
+    static hl7val_segment_t parsed;
+    size_t n = (size_t)snprintf(seg, sizeof(seg), "ZDS|1|ED|");
+    unsigned int lcg = 12345;
+    char delims[] = "|^~";
+    while (n < 20000) {
+        lcg = lcg * 1103515245 + 12345;
+        int run = (int)((lcg >> 16) % 97);
+        for (int i = 0; i < run; i++) {
+            seg[n++] = (char)('A' + (i % 26));
+        }
+        seg[n++] = delims[(lcg >> 8) % 3];
+    }
+    /* keep MAX_FIELDS: turn surplus field separators into components */
+    int fields = 0;
+    for (size_t i = 4; i < n; i++) {
+        if (seg[i] == '|' && ++fields >= 200) {
+            seg[i] = '^';
+        }
+    }
+
+    /* Reference offsets computed byte by byte */
+    uint32_t ref_start[HL7VAL_MAX_FIELDS];
+    int ref_count = 1;
+    ref_start[1] = 4;
+    for (size_t i = 4; i < n; i++) {
+        if (seg[i] == '|') {
+            ref_start[++ref_count] = (uint32_t)i + 1;
+        }
+    }
+
+    const char *impls[] = {"avx2", "sse2", "neon", "scalar"};
+    for (int k = 0; k < 4; k++) {
+        if (hl7val_scan_force_impl(impls[k]) != HL7VAL_SUCCESS) {
+            continue;
+        }
+        assert(strcmp(hl7val_scan_impl(), impls[k]) == 0);
+
+        /* Every length exercises a different partial tail word */
+        for (size_t len = n - 130; len <= n; len++) {
+            assert(hl7val_parse_segment(seg, len, &parsed) == HL7VAL_SUCCESS);
+            int expected_count = 1;
+            for (int f = 2; f <= ref_count && ref_start[f] <= len; f++) {
+                expected_count = f;
+            }
+            assert(parsed.field_count == expected_count);
+            for (int f = 1; f <= expected_count; f++) {
+                assert(parsed.fields[f].start == ref_start[f]);
+            }
+            assert(hl7val_validate_segment(seg, len, NULL) == HL7VAL_SUCCESS);
+        }
+
+        char *copy = malloc(n + 1);
+        char out[128];
+        assert(copy);
+        memcpy(copy, seg, n);
+        copy[n] = '\0';
+        for (int f = 1; f < ref_count; f++) {
+            size_t flen = ref_start[f + 1] - 1 - ref_start[f];
+            int result = hl7val_extract_field(copy, f, out, sizeof(out));
+            if (flen < sizeof(out)) {
+                assert(result == HL7VAL_SUCCESS);
+                assert(strlen(out) == flen && memcmp(out, seg + ref_start[f], flen) == 0);
+            } else {
+                assert(result == HL7VAL_ERR_TOO_LARGE);
+            }
+        }
+        assert(hl7val_extract_field(copy, ref_count + 1, out, sizeof(out)) == HL7VAL_ERR_FIELD_COUNT);
+        free(copy);
+    }
+    assert(hl7val_scan_force_impl("bogus") == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_scan_force_impl(NULL) == HL7VAL_SUCCESS);
+
+    /* HOSPITAL_NATIVE_ISA caps dispatch (ctest runs this binary again with it set) */
+    const char *isa = getenv("HOSPITAL_NATIVE_ISA");
+    if (isa && strcmp(isa, "scalar") == 0) {
+        assert(strcmp(hl7val_scan_impl(), "scalar") == 0);
+    }
+
+    printf("✓ test_scan_kernels passed\n");
+}
+
+void test_parse_message() {
+    const char *msg =
+        "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5\r\n"
+        "OBR|1|12345|67890|58410-2^CBC^LN\r\n"
+        "\r\n"
+        "  OBX|1|NM|WBC||7.5|10*3/uL|4.5-11.0|N  \n"
+        "OBX|2|NM\r"
+        "ob|bad\n"
+        "OBX|3|NM|HGB||14.5";
+    hl7val_segment_result_t results[8];
+    size_t count = 0;
+
+    assert(hl7val_parse_message(msg, strlen(msg), results, 8, &count) == HL7VAL_SUCCESS);
+    assert(count == 6);
+
+    const unsigned int lines[] = {1, 2, 4, 5, 6, 7};
+    const char *ids[] = {"MSH", "OBR", "OBX", "OBX", "ob|", "OBX"};
+    const int statuses[] = {HL7VAL_SUCCESS, HL7VAL_SUCCESS, HL7VAL_SUCCESS, HL7VAL_ERR_FIELD_COUNT,
+                            HL7VAL_ERR_INVALID_FMT, HL7VAL_SUCCESS};
+    for (size_t i = 0; i < count; i++) {
+        assert(results[i].line == lines[i]);
+        assert(strcmp(results[i].id, ids[i]) == 0);
+        assert(results[i].status == statuses[i]);
+    }
+    assert(results[0].field_count == 12);
+    assert(results[2].field_count == 8);
+    assert(results[2].len == strlen("OBX|1|NM|WBC||7.5|10*3/uL|4.5-11.0|N"));
+    assert(memcmp(msg + results[2].offset, "OBX|1|", 6) == 0);
+    assert(results[5].len == strlen("OBX|3|NM|HGB||14.5"));
+
+    /* Too small a result array still reports the full count */
+    assert(hl7val_parse_message(msg, strlen(msg), results, 2, &count) == HL7VAL_ERR_TOO_LARGE);
+    assert(count == 6);
+    assert(hl7val_parse_message(msg, strlen(msg), NULL, 0, &count) == HL7VAL_ERR_TOO_LARGE);
+    assert(hl7val_parse_message(NULL, 0, results, 8, &count) == HL7VAL_ERR_NULL_INPUT);
+
+    char error[256];
+    assert(hl7val_validate_message(msg, strlen(msg), error) == HL7VAL_ERR_FIELD_COUNT);
+    assert(strncmp(error, "Line 5: ", 8) == 0);
+    assert(hl7val_validate_message(msg, strlen("MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5"),
+                                   error) == HL7VAL_SUCCESS);
+    assert(hl7val_validate_message("\r\n \n", 4, error) == HL7VAL_ERR_INVALID_FMT);
+
+    /* Many segments spanning several scan blocks */
+    static char big[200000];
+    size_t n = 0;
+    for (int i = 0; i < 5000; i++) {
+        n += (size_t)snprintf(big + n, sizeof(big) - n, "OBX|%d|NM|K||4.%d|mmol/L|3.5-5.0|N\r", i, i % 10);
+    }
+    assert(hl7val_parse_message(big, n, NULL, 0, &count) == HL7VAL_ERR_TOO_LARGE);
+    assert(count == 5000);
+    assert(hl7val_validate_message(big, n, NULL) == HL7VAL_SUCCESS);
+
+    printf("✓ test_parse_message passed\n");
+}
+
+void test_delimiters() {
+    static hl7val_segment_t seg;
+    hl7val_span_t span;
+    hl7val_delims_t d;
+    char output[128];
+
+    assert(hl7val_delims_from_msh("MSH|^~\\&|LAB", 13, &d) == HL7VAL_SUCCESS);
+    assert(memcmp(&d, hl7val_default_delims(), sizeof(d)) == 0);
+    assert(hl7val_delims_from_msh("MSH#$*!@#LAB", 12, &d) == HL7VAL_SUCCESS);
+    assert(d.field == '#' && d.component == '$' && d.repetition == '*' && d.escape == '!' && d.subcomponent == '@');
+    /* Only the characters actually declared */
+    assert(hl7val_delims_from_msh("MSH|^|LAB", 9, &d) == HL7VAL_SUCCESS);
+    assert(d.component == '^' && d.repetition == '\0' && d.subcomponent == '\0');
+    assert(hl7val_delims_from_msh("MSH|^^~&|LAB", 12, &d) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_delims_from_msh("MSH|A~\\&|LAB", 13, &d) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_delims_from_msh("MSH| ~\\&|LAB", 13, &d) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_delims_from_msh("PID|1", 5, &d) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_delims_init(&d, "|^~\\&!", 6) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_delims_init(&d, "", 0) == HL7VAL_ERR_INVALID_FMT);
+
+    /* An MSH segment uses its own encoding characters */
+    const char *msh = "MSH#$*!@#LAB#HOSP#EHR#HOSP#20231115120000##ORU$R01#MSG1#P#2.5";
+    char error[256];
+    assert(hl7val_validate_segment(msh, strlen(msh), error) == HL7VAL_SUCCESS);
+    assert(hl7val_parse_segment(msh, strlen(msh), &seg) == HL7VAL_SUCCESS);
+    assert(seg.field_count == 12 && seg.delims.field == '#');
+    assert(hl7val_field_at(&seg, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "$*!@"));
+    assert(hl7val_component_at(&seg, 9, 1, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "R01"));
+    assert(hl7val_validate_segment("MSH#$$!@#LAB#HOSP#EHR#HOSP#1##ORU#M#P#2.5", 41, error) == HL7VAL_ERR_INVALID_FMT);
+    assert(strcmp(error, "Invalid MSH encoding characters") == 0);
+
+    /* Other segments take the caller's context; the default '|' no longer splits */
+    assert(hl7val_delims_from_msh(msh, strlen(msh), &d) == HL7VAL_SUCCESS);
+    const char *obx = "OBX#1#CE#WBC$White|cells*WBC2$Alt##7.5";
+    assert(hl7val_validate_segment_ex(obx, strlen(obx), &d, error) == HL7VAL_SUCCESS);
+    assert(hl7val_validate_segment(obx, strlen(obx), error) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_parse_segment_ex(obx, strlen(obx), &d, &seg) == HL7VAL_SUCCESS);
+    assert(seg.field_count == 5);
+    assert(hl7val_component_at(&seg, 3, 1, 2, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "White|cells"));
+    assert(hl7val_component_at(&seg, 3, 2, 1, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "WBC2"));
+    assert(hl7val_extract_field_ex(obx, strlen(obx), 3, &d, output, sizeof(output)) == HL7VAL_SUCCESS);
+    assert(strcmp(output, "WBC$White|cells*WBC2$Alt") == 0);
+    assert(hl7val_parse_segment_ex(obx, strlen(obx), NULL, &seg) == HL7VAL_ERR_INVALID_FMT);
+
+    /* A context without a repetition separator leaves '~' as data */
+    assert(hl7val_delims_init(&d, "|^", 2) == HL7VAL_SUCCESS);
+    const char *pid = "PID|1||A~B^C";
+    assert(hl7val_parse_segment_ex(pid, strlen(pid), &d, &seg) == HL7VAL_SUCCESS);
+    assert(hl7val_component_at(&seg, 3, 1, 1, &span) == HL7VAL_SUCCESS && span_eq(&seg, span, "A~B"));
+    assert(hl7val_component_at(&seg, 3, 2, 1, &span) == HL7VAL_ERR_FIELD_COUNT);
+
+    /* Each MSH switches the context for the segments after it */
+    const char *msg =
+        "OBX|1|NM|K||4.1\r"
+        "MSH#$*!@#LAB#HOSP#EHR#HOSP#20231115120000##ORU$R01#MSG1#P#2.5\r"
+        "OBX#2#NM#K##4.2\r"
+        "OBX|3|NM|K||4.3\r"
+        "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG2|P|2.5\r"
+        "OBX|4|NM|K||4.4";
+    hl7val_segment_result_t results[8];
+    size_t count = 0;
+    assert(hl7val_parse_message(msg, strlen(msg), results, 8, &count) == HL7VAL_SUCCESS);
+    assert(count == 6);
+    const int statuses[] = {HL7VAL_SUCCESS, HL7VAL_SUCCESS, HL7VAL_SUCCESS, HL7VAL_ERR_INVALID_FMT,
+                            HL7VAL_SUCCESS, HL7VAL_SUCCESS};
+    for (size_t i = 0; i < count; i++) {
+        assert(results[i].status == statuses[i]);
+    }
+    assert(results[2].field_count == 5);
+    assert(hl7val_validate_message(msg, strlen(msg), error) == HL7VAL_ERR_INVALID_FMT);
+    assert(strncmp(error, "Line 4: ", 8) == 0);
+
+    /* A caller context applies until the first MSH */
+    assert(hl7val_delims_init(&d, "#$*!@", 5) == HL7VAL_SUCCESS);
+    assert(hl7val_validate_message_ex("OBX#1#NM#K##4.1\nOBX#2#NM#K##4.2", 31, &d, error) == HL7VAL_SUCCESS);
+    assert(hl7val_parse_message_ex(msg, strlen(msg), &d, results, 8, &count) == HL7VAL_SUCCESS);
+    assert(results[0].status == HL7VAL_ERR_INVALID_FMT);
+
+    printf("✓ test_delimiters passed\n");
+}
+
+static int view_eq(hl7val_view_t view, const char *expected) {
+    return view.data && view.len == strlen(expected) && memcmp(view.data, expected, view.len) == 0;
+}
+
+void test_field_views() {
+    const char *seg = "OBX|1|NM|2345-7^Glucose^LN||105|mg/dL|70-99|H|||F";
+    hl7val_view_t view;
+    hl7val_view_t views[6];
+
+    assert(hl7val_field_view(seg, strlen(seg), 5, NULL, &view) == HL7VAL_SUCCESS);
+    assert(view.data == seg + 28 && view_eq(view, "105"));
+    assert(hl7val_field_view(seg, strlen(seg), 11, NULL, &view) == HL7VAL_SUCCESS && view_eq(view, "F"));
+    assert(hl7val_field_view(seg, strlen(seg), 12, NULL, &view) == HL7VAL_ERR_FIELD_COUNT);
+    assert(hl7val_field_view(seg, strlen(seg), 0, NULL, &view) == HL7VAL_ERR_INVALID_FMT);
+
+    /* Any order, repeats, empty and absent fields */
+    const int wanted[] = {11, 3, 5, 4, 3, 40};
+    assert(hl7val_extract_fields(seg, strlen(seg), wanted, 6, NULL, views) == HL7VAL_SUCCESS);
+    assert(view_eq(views[0], "F"));
+    assert(view_eq(views[1], "2345-7^Glucose^LN") && view_eq(views[4], "2345-7^Glucose^LN"));
+    assert(view_eq(views[2], "105"));
+    assert(views[3].data == seg + 27 && views[3].len == 0);
+    assert(views[5].data == NULL && views[5].len == 0);
+    const int last[] = {1};
+    assert(hl7val_extract_fields("PID|", 4, last, 1, NULL, views) == HL7VAL_SUCCESS);
+    assert(views[0].data && views[0].len == 0);
+    const int bad[] = {3, 0};
+    assert(hl7val_extract_fields(seg, strlen(seg), bad, 2, NULL, views) == HL7VAL_ERR_INVALID_FMT);
+    const int too_high[] = {HL7VAL_MAX_FIELDS};
+    assert(hl7val_extract_fields(seg, strlen(seg), too_high, 1, NULL, views) == HL7VAL_ERR_FIELD_COUNT);
+
+    /* Fields far longer than any fixed output buffer, across scan blocks */
+    size_t big_len = 3 * 4096 + 100;
+    char *big = malloc(big_len);
+    memcpy(big, "OBX|1|ED|", 9);
+    memset(big + 9, 'A', big_len - 9 - 4);
+    memcpy(big + big_len - 4, "|F|X", 4);
+    const int ed[] = {4, 3, 5};
+    assert(hl7val_extract_fields(big, big_len, ed, 3, NULL, views) == HL7VAL_SUCCESS);
+    assert(views[0].len == 1 && views[0].data[0] == 'F');
+    assert(views[1].data == big + 9 && views[1].len == big_len - 13);
+    assert(view_eq(views[2], "X"));
+    char small[256];
+    assert(hl7val_extract_field_ex(big, big_len, 3, NULL, small, sizeof(small)) == HL7VAL_ERR_TOO_LARGE);
+    free(big);
+
+    /* Custom delimiters */
+    hl7val_delims_t d;
+    assert(hl7val_delims_init(&d, "#$*!@", 5) == HL7VAL_SUCCESS);
+    const int two[] = {2, 1};
+    assert(hl7val_extract_fields("OBX#1#N|M", 9, two, 2, &d, views) == HL7VAL_SUCCESS);
+    assert(view_eq(views[0], "N|M") && view_eq(views[1], "1"));
+
+    printf("✓ test_field_views passed\n");
+}
+
+static int validate_str(const char *seg, char *error) {
+    return hl7val_validate_segment(seg, strlen(seg), error);
+}
+
+void test_schema() {
+    char error[256];
+    char seg[128];
+
+    /* OBX-5 is checked as the type OBX-2 names */
+    assert(validate_str("OBX|1|NM|WBC||7.5|10*3/uL|4.5-11.0|N", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|NM|WBC||-0.25", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|NM|WBC||7.5~8", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|NM|WBC||\"\"", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|NM|WBC||7.5 H", error) == HL7VAL_ERR_DATATYPE);
+    assert(strcmp(error, "Field OBX-5 is not a valid NM value") == 0);
+    assert(validate_str("OBX|1|NM|WBC||7~1.2.3", error) == HL7VAL_ERR_DATATYPE);
+
+    /* Numeric results may carry a comparator, inline or in the SN components */
+    const char *sn_ok[] = {"<5", ">1000", "<=0.5", ">=10", "=3", "<>0", "<^5", "^1^:^128", "^10^+", "^2^-^8", ">^1.5"};
+    const char *sn_bad[] = {"<", "<<5", "=>5", "5<", "<^", "<^a", "^1^x^2", "^1^:^b", "a^1", "<^1^-^2^3", "<5 H"};
+    for (size_t i = 0; i < sizeof(sn_ok) / sizeof(sn_ok[0]); i++) {
+        snprintf(seg, sizeof(seg), "OBX|1|NM|GLU||%s", sn_ok[i]);
+        assert(validate_str(seg, error) == HL7VAL_SUCCESS);
+        snprintf(seg, sizeof(seg), "OBX|1|SN|GLU||%s", sn_ok[i]);
+        assert(validate_str(seg, error) == HL7VAL_SUCCESS);
+    }
+    for (size_t i = 0; i < sizeof(sn_bad) / sizeof(sn_bad[0]); i++) {
+        snprintf(seg, sizeof(seg), "OBX|1|NM|GLU||%s", sn_bad[i]);
+        assert(validate_str(seg, error) == HL7VAL_ERR_DATATYPE);
+        assert(strcmp(error, "Field OBX-5 is not a valid NM value") == 0);
+        snprintf(seg, sizeof(seg), "OBX|1|SN|GLU||%s", sn_bad[i]);
+        assert(validate_str(seg, error) == HL7VAL_ERR_DATATYPE);
+        assert(strcmp(error, "Field OBX-5 is not a valid SN value") == 0);
+    }
+    /* NM fields outside OBX-5 stay plain numbers */
+    assert(validate_str("MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5|<5", error) ==
+           HL7VAL_ERR_DATATYPE);
+    assert(strcmp(error, "Field MSH-13 is not a valid NM value") == 0);
+    assert(validate_str("OBX|1|ST|NOTE||7.5 H", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|DT|DOB||20240229", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|DT|DOB||20230229", error) == HL7VAL_ERR_DATATYPE);
+    assert(validate_str("OBX|1|CE|ORG||A^B^C^D^E^F", error) == HL7VAL_SUCCESS);
+    assert(validate_str("OBX|1|CE|ORG||A^B^C^D^E^F^G", error) == HL7VAL_ERR_DATATYPE);
+    assert(validate_str("OBX|1|ED|IMG||anything^goes", error) == HL7VAL_SUCCESS);
+
+    /* Fixed field types, required fields and lengths */
+    assert(validate_str("OBX|A|NM|WBC||7.5", error) == HL7VAL_ERR_DATATYPE);
+    assert(strcmp(error, "Field OBX-1 is not a valid SI value") == 0);
+    assert(validate_str("OBX|1|NM|||7.5", error) == HL7VAL_ERR_FIELD_COUNT);
+    assert(strcmp(error, "Field OBX-3 is required") == 0);
+    assert(validate_str("OBX|1|NM|WBC|012345678901234567890|7.5", error) == HL7VAL_ERR_TOO_LARGE);
+    assert(strcmp(error, "Field OBX-4 exceeds maximum length 20") == 0);
+    assert(validate_str("PV1|1|I", error) == HL7VAL_SUCCESS);
+    assert(validate_str("PV1|1", error) == HL7VAL_ERR_FIELD_COUNT);
+    assert(strcmp(error, "Field PV1-2 is required") == 0);
+
+    /* Time stamps */
+    const char *ts_ok[] = {"2023", "202311", "20231115", "2023111512", "20231115120000",
+                           "20231115120000.1234", "20231115120000+0100", "202311151200-0500", "20231115^S"};
+    const char *ts_bad[] = {"202", "2023111", "20231315", "20231115250000", "20231115126000",
+                            "20231115120000.", "20231115120000.12345", "20231115120000+01", "2023111512.5", "20x"};
+    for (size_t i = 0; i < sizeof(ts_ok) / sizeof(ts_ok[0]); i++) {
+        snprintf(seg, sizeof(seg), "PID|1||12345||DOE^JOHN||%s", ts_ok[i]);
+        assert(validate_str(seg, error) == HL7VAL_SUCCESS);
+    }
+    for (size_t i = 0; i < sizeof(ts_bad) / sizeof(ts_bad[0]); i++) {
+        snprintf(seg, sizeof(seg), "PID|1||12345||DOE^JOHN||%s", ts_bad[i]);
+        assert(validate_str(seg, error) == HL7VAL_ERR_DATATYPE);
+        assert(strcmp(error, "Field PID-7 is not a valid TS value") == 0);
+    }
+
+    /* MSH numbering starts at the separator (MSH-1) */
+    assert(validate_str("MSH|^~\\&|LAB|HOSP|EHR|HOSP|2023111512000||ORU^R01|MSG1|P|2.5", error) ==
+           HL7VAL_ERR_DATATYPE);
+    assert(strcmp(error, "Field MSH-7 is not a valid TS value") == 0);
+    assert(validate_str("MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01||P|2.5", error) ==
+           HL7VAL_ERR_FIELD_COUNT);
+    assert(strcmp(error, "Field MSH-10 is required") == 0);
+
+    /* Too few fields is still reported as such, before field rules */
+    assert(validate_str("OBX|X|NM", error) == HL7VAL_ERR_FIELD_COUNT);
+    assert(strncmp(error, "Segment OBX has", 15) == 0);
+
+    /* Segments without a schema only get structural checks */
+    assert(validate_str("ZPI|anything|at^all", error) == HL7VAL_SUCCESS);
+
+    /* Message validation reports the line */
+    const char *msg = "OBR|1|12345|67890|58410-2^CBC^LN\rOBX|1|NM|WBC||7,5";
+    assert(hl7val_validate_message(msg, strlen(msg), error) == HL7VAL_ERR_DATATYPE);
+    assert(strcmp(error, "Line 2: Field OBX-5 is not a valid NM value") == 0);
+
+    printf("✓ test_schema passed\n");
+}
+
+typedef struct {
+    int count;
+    int status[16];
+    size_t len[16];
+    const char *ptr[16];
+    char first[16][4];
+} mllp_sink_t;
+
+static void mllp_collect(void *ctx, const char *message, size_t len, int status, const char *error_msg) {
+    mllp_sink_t *sink = ctx;
+    assert(sink->count < 16);
+    assert((status == HL7VAL_SUCCESS) == (error_msg == NULL));
+    sink->status[sink->count] = status;
+    sink->len[sink->count] = len;
+    sink->ptr[sink->count] = message;
+    memset(sink->first[sink->count], 0, 4);
+    if (message) {
+        memcpy(sink->first[sink->count], message, len < 3 ? len : 3);
+    }
+    sink->count++;
+}
+
+void test_mllp() {
+    #define MSG_A "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5\rOBX|1|NM|K||4.1"
+    #define MSG_B "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG2|P|2.5\rOBX|2|NM|K||high"
+    const char stream[] = "noise\x0b" MSG_A "\x1c\r\r\n\x0b" MSG_B "\x1c\r";
+    const size_t stream_len = sizeof(stream) - 1;
+    hl7val_mllp_t *mllp;
+    mllp_sink_t sink = {0};
+    hl7val_mllp_stats_t stats;
+
+    assert(hl7val_mllp_new(0, NULL, NULL, &mllp) == HL7VAL_ERR_NULL_INPUT);
+    assert(hl7val_mllp_new(0, mllp_collect, &sink, &mllp) == HL7VAL_SUCCESS);
+
+    /* Whole frames in one chunk are delivered in place */
+    assert(hl7val_mllp_feed(mllp, stream, stream_len) == 2);
+    assert(sink.count == 2);
+    assert(sink.status[0] == HL7VAL_SUCCESS && sink.len[0] == strlen(MSG_A) && sink.ptr[0] == stream + 6);
+    assert(sink.status[1] == HL7VAL_ERR_DATATYPE && sink.len[1] == strlen(MSG_B));
+    hl7val_mllp_get_stats(mllp, &stats);
+    assert(stats.messages == 1 && stats.invalid == 1 && stats.dropped == 0 && stats.discarded_bytes == 7);
+
+    /* Every split point, then byte by byte, gives the same frames */
+    for (size_t split = 0; split <= stream_len; split++) {
+        hl7val_mllp_reset(mllp);
+        memset(&sink, 0, sizeof(sink));
+        int n = hl7val_mllp_feed(mllp, stream, split);
+        n += hl7val_mllp_feed(mllp, stream + split, stream_len - split);
+        assert(n == 2 && sink.count == 2);
+        assert(sink.status[0] == HL7VAL_SUCCESS && sink.len[0] == strlen(MSG_A));
+        assert(sink.status[1] == HL7VAL_ERR_DATATYPE && sink.len[1] == strlen(MSG_B));
+        assert(strcmp(sink.first[0], "MSH") == 0 && strcmp(sink.first[1], "MSH") == 0);
+    }
+    hl7val_mllp_reset(mllp);
+    memset(&sink, 0, sizeof(sink));
+    for (size_t i = 0; i < stream_len; i++) {
+        hl7val_mllp_feed(mllp, stream + i, 1);
+    }
+    assert(sink.count == 2 && sink.status[0] == HL7VAL_SUCCESS && sink.len[1] == strlen(MSG_B));
+    hl7val_mllp_free(mllp);
+
+    /* Interrupted, unterminated and oversized frames are dropped, then framing resumes */
+    const char bad[] = "\x0bMSH|partial\x0b" MSG_A "\x1c\r\x0bOBX|1\x1cX\x0b" MSG_A MSG_A MSG_A "\x1c\r\x0b" MSG_A "\x1c\r";
+    assert(hl7val_mllp_new(200, mllp_collect, &sink, &mllp) == HL7VAL_SUCCESS);
+    for (size_t chunk = 1; chunk <= sizeof(bad); chunk += 13) {
+        hl7val_mllp_reset(mllp);
+        memset(&sink, 0, sizeof(sink));
+        for (size_t i = 0; i < sizeof(bad) - 1; i += chunk) {
+            size_t n = sizeof(bad) - 1 - i < chunk ? sizeof(bad) - 1 - i : chunk;
+            hl7val_mllp_feed(mllp, bad + i, n);
+        }
+        assert(sink.count == 5);
+        assert(sink.status[0] == HL7VAL_ERR_INVALID_FMT && sink.ptr[0] == NULL);
+        assert(sink.status[1] == HL7VAL_SUCCESS);
+        assert(sink.status[2] == HL7VAL_ERR_INVALID_FMT && sink.ptr[2] == NULL);
+        assert(sink.status[3] == HL7VAL_ERR_TOO_LARGE && sink.ptr[3] == NULL);
+        assert(sink.status[4] == HL7VAL_SUCCESS && sink.len[4] == strlen(MSG_A));
+        hl7val_mllp_get_stats(mllp, &stats);
+        assert(stats.messages == 2 && stats.dropped == 3);
+    }
+    hl7val_mllp_free(mllp);
+    hl7val_mllp_free(NULL);
+
+    /* ACK mirrors the routing fields and control ID */
+    char ack[512];
+    size_t ack_len;
+    assert(hl7val_mllp_build_ack(MSG_A, strlen(MSG_A), "AA", NULL, ack, sizeof(ack), &ack_len) == HL7VAL_SUCCESS);
+    assert(ack[0] == 0x0b && ack[ack_len - 2] == 0x1c && ack[ack_len - 1] == '\r');
+    ack[ack_len] = '\0';
+    assert(strncmp(ack + 1, "MSH|^~\\&|EHR|HOSP|LAB|HOSP|", 27) == 0);
+    const char *rest = strstr(ack, "+0000||");
+    assert(rest && rest - (ack + 28) == 14);
+    assert(strcmp(rest, "+0000||ACK^R01^ACK|MSG1|P|2.5\rMSA|AA|MSG1\r\x1c\r") == 0);
+    assert(hl7val_validate_message(ack + 1, ack_len - 3, NULL) == HL7VAL_SUCCESS);
+
+    /* NAK text is escaped with the message's own delimiters */
+    const char *custom = "MSH#$*!@#LAB#HOSP#EHR#HOSP#20231115120000##ORU$R01#MSG9#P#2.5";
+    assert(hl7val_mllp_build_ack(custom, strlen(custom), "AE", "Bad #5 $x\ny!", ack, sizeof(ack), &ack_len) ==
+           HL7VAL_SUCCESS);
+    ack[ack_len] = '\0';
+    assert(strncmp(ack + 1, "MSH#$*!@#EHR#HOSP#LAB#HOSP#", 27) == 0);
+    assert(strstr(ack, "##ACK$R01$ACK#MSG9#P#2.5\rMSA#AE#MSG9#Bad !F!5 !S!x y!E!\r\x1c\r"));
+
+    /* Unparseable input still gets a rejection */
+    assert(hl7val_mllp_build_ack("garbage", 7, "AR", "Unreadable", ack, sizeof(ack), &ack_len) == HL7VAL_SUCCESS);
+    ack[ack_len] = '\0';
+    assert(strstr(ack, "||ACK|||\rMSA|AR||Unreadable\r"));
+    assert(hl7val_mllp_build_ack(MSG_A, strlen(MSG_A), "OK", NULL, ack, sizeof(ack), &ack_len) ==
+           HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_mllp_build_ack(MSG_A, strlen(MSG_A), "AA", NULL, ack, 40, &ack_len) == HL7VAL_ERR_TOO_LARGE);
+    #undef MSG_A
+    #undef MSG_B
+
+    printf("✓ test_mllp passed\n");
+}
+
+void test_validate_file() {
+    /* A few MB of messages alternating default and '#' delimiters and line endings */
+    static const char *messages[] = {
+        "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5\rPID|1||12345||DOE^JOHN\r"
+        "OBX|1|NM|K||4.1\r",
+        "MSH#^~\\&#LAB#HOSP#EHR#HOSP#20231115120000##ORU^R01#MSG2#P#2.5\r\nOBX#1#NM#K##4.1\r\n"
+        "OBX#2#NM#K##4.2\r\n",
+        "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG3|P|2.5\nOBX|1|NM|K||high\n\n",
+        "MSH#^~\\&#LAB#HOSP#EHR#HOSP#20231115120000##ORU^R01#MSG4#P#2.5\rOBX#1#NM#K##low\r"
+        "OBX|1|NM|K||4.1\r",
+    };
+    size_t cap = 3 * 1024 * 1024 + 4096;
+    char *data = malloc(cap);
+    size_t len = 0;
+    for (size_t i = 0; len + 256 < cap - 4096; i++) {
+        const char *m = messages[i % 4 == 3 && i % 7 ? 1 : i % 4];
+        memcpy(data + len, m, strlen(m));
+        len += strlen(m);
+    }
+
+    size_t count;
+    hl7val_parse_message(data, len, NULL, 0, &count);
+    hl7val_segment_result_t *expected = malloc(count * sizeof(*expected));
+    assert(hl7val_parse_message(data, len, expected, count, &count) == HL7VAL_SUCCESS);
+    size_t invalid = 0;
+    for (size_t i = 0; i < count; i++) {
+        invalid += expected[i].status != HL7VAL_SUCCESS;
+    }
+    assert(invalid > 0);
+
+    /* Any thread count gives the single-pass result */
+    hl7val_file_error_t *errors = malloc(invalid * sizeof(*errors));
+    hl7val_file_report_t report;
+    const unsigned int thread_counts[] = {1, 3, 8, 0};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        memset(errors, 0, invalid * sizeof(*errors));
+        assert(hl7val_validate_buffer(data, len, thread_counts[t], errors, invalid, &report) == HL7VAL_SUCCESS);
+        assert(report.bytes == len && report.segments == count && report.errors == invalid);
+        for (size_t i = 0, e = 0; i < count; i++) {
+            if (expected[i].status == HL7VAL_SUCCESS) {
+                continue;
+            }
+            assert(errors[e].offset == expected[i].offset && errors[e].segment_index == i);
+            assert(errors[e].line == expected[i].line && errors[e].status == expected[i].status);
+            assert(memcmp(errors[e].id, expected[i].id, 4) == 0);
+            e++;
+        }
+    }
+
+    /* Errors past the capacity are counted, not stored */
+    assert(hl7val_validate_buffer(data, len, 4, errors, 2, &report) == HL7VAL_ERR_TOO_LARGE);
+    assert(report.errors == invalid && errors[1].segment_index < errors[2].segment_index);
+    assert(hl7val_validate_buffer(data, len, 4, NULL, 0, &report) == HL7VAL_ERR_TOO_LARGE);
+    assert(hl7val_validate_buffer("", 0, 4, NULL, 0, &report) == HL7VAL_SUCCESS && report.segments == 0);
+    assert(hl7val_validate_buffer(NULL, 0, 4, NULL, 0, &report) == HL7VAL_ERR_NULL_INPUT);
+
+    /* Files are mapped and give the same report */
+    char path[] = "/tmp/test_hl7val_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE *f = fdopen(fd, "wb");
+    assert(fwrite(data, 1, len, f) == len);
+    fclose(f);
+    assert(hl7val_validate_file(path, 0, errors, invalid, &report) == HL7VAL_SUCCESS);
+    assert(report.bytes == len && report.segments == count && report.errors == invalid);
+    assert(errors[invalid - 1].offset == expected[count - 1].offset ||
+           expected[count - 1].status == HL7VAL_SUCCESS);
+    unlink(path);
+    errno = 0;
+    assert(hl7val_validate_file(path, 0, errors, invalid, &report) == HL7VAL_ERR_IO && errno == ENOENT);
+    assert(hl7val_validate_file("/tmp", 0, errors, invalid, &report) == HL7VAL_ERR_IO);
+
+    free(errors);
+    free(expected);
+    free(data);
+    printf("✓ test_validate_file passed\n");
+}
+
+void test_cache() {
+    const char msg[] = "MSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5\r"
+                       "OBX|1|NM|WBC^White cells||7.5|10*3/uL|4.5-11.0|N\r"
+                       "OBX|2|NM|K||high\r"
+                       "OBX|3|ST|NOTE||ok\r"
+                       "obx|4";
+    hl7val_cache_t *cache;
+    const hl7val_message_index_t *index;
+    hl7val_cache_stats_t stats;
+    hl7val_span_t span;
+
+    assert(hl7val_cache_new(0, NULL) == HL7VAL_ERR_NULL_INPUT);
+    assert(hl7val_cache_new(0, &cache) == HL7VAL_SUCCESS);
+    assert(hl7val_cache_get(cache, NULL, 0, NULL, &index) == HL7VAL_ERR_NULL_INPUT);
+
+    /* A miss parses the message; fields are message offsets in HL7 numbering */
+    assert(hl7val_cache_get(cache, msg, sizeof(msg) - 1, NULL, &index) == HL7VAL_SUCCESS);
+    assert(index->segment_count == 5 && index->message_len == sizeof(msg) - 1);
+    assert(strcmp(index->segments[1].id, "OBX") == 0 && index->segments[1].field_count == 8);
+    assert(index->segments[2].status == HL7VAL_ERR_DATATYPE && index->segments[2].field_count == 5);
+    assert(index->segments[4].status == HL7VAL_ERR_INVALID_FMT && index->segments[4].field_count == 0);
+    assert(hl7val_index_field(index, 0, 1, &span) == HL7VAL_SUCCESS && msg[span.start] == '|' && span.len == 1);
+    assert(hl7val_index_field(index, 1, 5, &span) == HL7VAL_SUCCESS);
+    assert(span.len == 3 && memcmp(msg + span.start, "7.5", 3) == 0);
+    assert(hl7val_index_field(index, 1, 3, &span) == HL7VAL_SUCCESS);
+    assert(span.len == 15 && memcmp(msg + span.start, "WBC^White cells", 15) == 0);
+    assert(hl7val_index_field(index, 1, 9, &span) == HL7VAL_ERR_FIELD_COUNT);
+    /* A segment failing the schema still has its fields; one that does not tokenize has none */
+    assert(hl7val_index_field(index, 2, 5, &span) == HL7VAL_SUCCESS);
+    assert(span.len == 4 && memcmp(msg + span.start, "high", 4) == 0);
+    assert(hl7val_index_field(index, 4, 0, &span) == HL7VAL_ERR_FIELD_COUNT);
+    assert(hl7val_index_field(index, 5, 0, &span) == HL7VAL_ERR_FIELD_COUNT);
+
+    /* Same bytes in another buffer hit; other delimiters do not */
+    char copy[sizeof(msg)];
+    memcpy(copy, msg, sizeof(msg));
+    const hl7val_message_index_t *again;
+    assert(hl7val_cache_get(cache, copy, sizeof(copy) - 1, NULL, &again) == HL7VAL_SUCCESS && again == index);
+    hl7val_delims_t hash_delims;
+    assert(hl7val_delims_init(&hash_delims, "#^~\\&", 5) == HL7VAL_SUCCESS);
+    assert(hl7val_cache_get(cache, msg, sizeof(msg) - 1, &hash_delims, &again) == HL7VAL_SUCCESS && again != index);
+    hl7val_cache_get_stats(cache, &stats);
+    assert(stats.hits == 1 && stats.misses == 2 && stats.entries == 2 && stats.evictions == 0);
+    hl7val_cache_clear(cache);
+    hl7val_cache_get_stats(cache, &stats);
+    assert(stats.entries == 0 && stats.hits == 1);
+    hl7val_cache_free(cache);
+
+    /* A small budget evicts the least recently used entries */
+    char line[64];
+    assert(hl7val_cache_new(8192, &cache) == HL7VAL_SUCCESS);
+    snprintf(line, sizeof(line), "OBX|1|NM|K||%d", 0);
+    assert(hl7val_cache_get(cache, line, strlen(line), NULL, &index) == HL7VAL_SUCCESS);
+    for (int i = 1; i < 400; i++) {
+        snprintf(line, sizeof(line), "OBX|1|NM|K||%d", i);
+        assert(hl7val_cache_get(cache, line, strlen(line), NULL, &index) == HL7VAL_SUCCESS);
+        assert(index->segment_count == 1 && index->segments[0].status == HL7VAL_SUCCESS);
+        snprintf(line, sizeof(line), "OBX|1|NM|K||%d", 0);
+        assert(hl7val_cache_get(cache, line, strlen(line), NULL, &index) == HL7VAL_SUCCESS);
+    }
+    hl7val_cache_get_stats(cache, &stats);
+    assert(stats.evictions > 0 && stats.bytes <= stats.max_bytes && stats.max_bytes == 8192);
+    assert(stats.hits == 399 && stats.misses == 400);
+
+    /* An index larger than the budget is returned but not kept */
+    size_t big_len = 16 * 1024;
+    char *big = malloc(big_len);
+    for (size_t off = 0; off < big_len; off += 16) {
+        memcpy(big + off, "OBX|1|NM|K||42\r\r", 16);
+    }
+    assert(hl7val_cache_get(cache, big, big_len, NULL, &index) == HL7VAL_SUCCESS);
+    assert(index->segment_count == big_len / 16);
+    assert(hl7val_index_field(index, 1023, 5, &span) == HL7VAL_SUCCESS && memcmp(big + span.start, "42", 2) == 0);
+    size_t entries = stats.entries;
+    hl7val_cache_get_stats(cache, &stats);
+    assert(stats.entries == entries && stats.bytes <= stats.max_bytes);
+    hl7val_cache_free(cache);
+    hl7val_cache_free(NULL);
+    free(big);
+    printf("✓ test_cache passed\n");
+}
+
+static int column_equals(const hl7val_str_column_t *col, size_t row, const char *expected) {
+    size_t len = (size_t)(col->offsets[row + 1] - col->offsets[row]);
+    return len == strlen(expected) && memcmp(col->data + col->offsets[row], expected, len) == 0;
+}
+
+void test_obx_columns() {
+    const char *texts[] = {
+        "OBX|1|NM|WBC^White cells^LN||7.5|10*3/uL^^ISO|4.5-11.0|N\n"
+        "  OBX|2|NM|K^Potassium||-0.25|mmol/L||L  \r\n\r\n"
+        "NTE|1||comment",
+        "OBX|1|ST|NOTE||ok",
+        "OBX|1|NM|GLU||+12345678901234567890.5|mg/dL||H~A",
+    };
+    hl7val_view_t views[4];
+    for (int i = 0; i < 3; i++) {
+        views[i].data = texts[i];
+        views[i].len = strlen(texts[i]);
+    }
+    views[3].data = NULL;
+    views[3].len = 0;
+
+    hl7val_obx_columns_t cols;
+    assert(hl7val_obx_columns(NULL, 1, 0, &cols) == HL7VAL_ERR_NULL_INPUT);
+    assert(hl7val_obx_columns(views, 4, 0, &cols) == HL7VAL_SUCCESS);
+    assert(cols.rows == 4 && cols.value_null_count == 1);
+    assert(cols.record[0] == 0 && cols.record[1] == 0 && cols.record[2] == 1 && cols.record[3] == 2);
+    assert(cols.value[0] == 7.5 && cols.value[1] == -0.25 && cols.value[2] == 0.0);
+    assert(cols.value[3] == 12345678901234567890.5);
+    assert(cols.value_valid[0] == 0x0b);
+    assert(column_equals(&cols.code, 0, "WBC") && column_equals(&cols.code, 1, "K"));
+    assert(column_equals(&cols.code, 2, "NOTE") && column_equals(&cols.units, 0, "10*3/uL"));
+    assert(column_equals(&cols.units, 2, "") && column_equals(&cols.flags, 1, "L"));
+    assert(column_equals(&cols.flags, 3, "H~A") && cols.flags.offsets[0] == 0);
+    assert(((uintptr_t)cols.value | (uintptr_t)cols.code.offsets | (uintptr_t)cols.code.data) % 64 == 0);
+    hl7val_obx_columns_free(&cols);
+    assert(cols.rows == 0 && cols.value == NULL);
+    hl7val_obx_columns_free(NULL);
+
+    /* Many texts split across ranges come back in input order */
+    size_t count = 5000;
+    hl7val_view_t *many = malloc(count * sizeof(*many));
+    char *buf = malloc(count * 64);
+    for (size_t i = 0; i < count; i++) {
+        many[i].data = buf + i * 64;
+        many[i].len = (size_t)snprintf(buf + i * 64, 64, "OBX|1|NM|C%zu||%zu.5|u||%s", i % 7, i, i % 3 ? "N" : "H");
+    }
+    hl7val_obx_columns_t single;
+    assert(hl7val_obx_columns(many, count, 1, &single) == HL7VAL_SUCCESS);
+    assert(hl7val_obx_columns(many, count, 4, &cols) == HL7VAL_SUCCESS);
+    assert(cols.rows == count && single.rows == count && cols.value_null_count == 0);
+    assert(memcmp(cols.value, single.value, count * sizeof(double)) == 0);
+    assert(memcmp(cols.code.offsets, single.code.offsets, (count + 1) * sizeof(int64_t)) == 0);
+    assert(cols.flags.data_len == single.flags.data_len && cols.flags.data_len == count);
+    for (size_t i = 0; i < count; i++) {
+        assert(cols.record[i] == i && cols.value[i] == (double)i + 0.5);
+        assert((cols.value_valid[i / 8] >> (i % 8)) & 1);
+        assert(cols.flags.data[i] == (i % 3 ? 'N' : 'H'));
+    }
+    hl7val_obx_columns_free(&single);
+    hl7val_obx_columns_free(&cols);
+    assert(hl7val_obx_columns(many, 0, 0, &cols) == HL7VAL_SUCCESS && cols.rows == 0);
+    hl7val_obx_columns_free(&cols);
+    free(buf);
+    free(many);
+    printf("✓ test_obx_columns passed\n");
+}
+
+static const hl7val_stats_t* stats_find(const hl7val_stats_t *entries, size_t n, const char *name) {
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+void test_stats() {
+    hl7val_stats_t entries[32];
+    if (!hl7val_stats_enabled()) {
+        assert(hl7val_stats_snapshot(entries, 32) == 0);
+        printf("✓ test_stats passed (instrumentation not built)\n");
+        return;
+    }
+
+    size_t n = hl7val_stats_snapshot(NULL, 0);
+    assert(n > 0 && n <= 32);
+    hl7val_stats_reset();
+
+    const char *seg = "PID|1||12345||DOE^JOHN";
+    const char *bad = "pid|1";
+    assert(hl7val_validate_segment(seg, strlen(seg), NULL) == HL7VAL_SUCCESS);
+    assert(hl7val_validate_segment(bad, strlen(bad), NULL) == HL7VAL_ERR_INVALID_FMT);
+    assert(hl7val_validate_segment(NULL, 0, NULL) == HL7VAL_ERR_NULL_INPUT);
+
+    /* The framer validates each message itself; that is not a validate_message call */
+    const char frame[] = "\x0bMSH|^~\\&|LAB|HOSP|EHR|HOSP|20231115120000||ORU^R01|MSG1|P|2.5\x1c\r";
+    hl7val_mllp_t *mllp;
+    mllp_sink_t sink = {0};
+    assert(hl7val_mllp_new(0, mllp_collect, &sink, &mllp) == HL7VAL_SUCCESS);
+    assert(hl7val_mllp_feed(mllp, frame, sizeof(frame) - 1) == 1);
+    hl7val_mllp_free(mllp);
+
+    assert(hl7val_stats_snapshot(entries, 32) == n);
+    const hl7val_stats_t *v = stats_find(entries, n, "validate_segment");
+    assert(v && v->calls == 3 && v->bytes == strlen(seg) + strlen(bad));
+    assert(v->errors[-HL7VAL_ERR_INVALID_FMT] == 1 && v->errors[-HL7VAL_ERR_NULL_INPUT] == 1);
+    const hl7val_stats_t *feed = stats_find(entries, n, "mllp_feed");
+    assert(feed && feed->calls == 1 && feed->bytes == sizeof(frame) - 1);
+    assert(stats_find(entries, n, "validate_message")->calls == 0);
+
+    hl7val_stats_reset();
+    assert(hl7val_stats_snapshot(entries, 32) == n);
+    for (size_t i = 0; i < n; i++) {
+        assert(entries[i].calls == 0);
+    }
+    printf("✓ test_stats passed\n");
+}
+
 int main() {
     printf("Running HL7 validation tests...\n");
     
@@ -58,6 +888,17 @@ int main() {
     test_too_short();
     test_null_input();
     test_field_extraction();
+    test_parse_segment();
+    test_scan_kernels();
+    test_parse_message();
+    test_delimiters();
+    test_field_views();
+    test_schema();
+    test_mllp();
+    test_validate_file();
+    test_cache();
+    test_obx_columns();
+    test_stats();
     
     printf("\nAll tests passed! ✓\n");
     return 0;